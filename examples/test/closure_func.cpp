@@ -0,0 +1,472 @@
+#include <iostream>
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <variant>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+
+// Helper functions for variant handling
+std::string variantToString(const std::variant<int, std::string, bool>& v) {
+    return std::visit([](const auto& value) -> std::string {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, int>) {
+            return std::to_string(value);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            return value;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return value ? "true" : "false";
+        } else {
+            return "<unknown>";
+        }
+    }, v);
+}
+
+std::ostream& operator<<(std::ostream& os, const std::variant<int, std::string, bool>& v) {
+    os << variantToString(v);
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const std::vector<std::variant<int, std::string, bool>>& vec) {
+    os << '[';
+    for (size_t i = 0; i < vec.size(); ++i) {
+        os << vec[i];
+        if (i < vec.size() - 1) {
+            os << ", ";
+        }
+    }
+    os << ']';
+    return os;
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const std::vector<T>& vec) {
+    os << '[';
+    for (size_t i = 0; i < vec.size(); ++i) {
+        os << vec[i];
+        if (i < vec.size() - 1) {
+            os << ", ";
+        }
+    }
+    os << ']';
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const std::vector<std::string>& vec) {
+    os << '[';
+    for (size_t i = 0; i < vec.size(); ++i) {
+        os << '"' << vec[i] << '"';
+        if (i < vec.size() - 1) {
+            os << ", ";
+        }
+    }
+    os << ']';
+    return os;
+}
+
+std::string stringReplace(const std::string& str, const std::string& oldStr, const std::string& newStr) {
+    std::string result = str;
+    size_t pos = 0;
+    while ((pos = result.find(oldStr, pos)) != std::string::npos) {
+        result.replace(pos, oldStr.length(), newStr);
+        pos += newStr.length();
+    }
+    return result;
+}
+
+std::vector<std::string> stringExcision(const std::string& str, const std::string& delimiter) {
+    std::vector<std::string> result;
+    size_t start = 0;
+    size_t end = str.find(delimiter);
+    while (end != std::string::npos) {
+        result.push_back(str.substr(start, end - start));
+        start = end + delimiter.length();
+        end = str.find(delimiter, start);
+    }
+    result.push_back(str.substr(start));
+    return result;
+}
+
+void listAdd(std::vector<std::variant<int, std::string, bool>>& list, int value) {
+    list.push_back(value);
+}
+
+void listAdd(std::vector<std::variant<int, std::string, bool>>& list, const std::string& value) {
+    list.push_back(value);
+}
+
+void listAdd(std::vector<std::variant<int, std::string, bool>>& list, const char* value) {
+    list.push_back(std::string(value));
+}
+
+void listAdd(std::vector<std::variant<int, std::string, bool>>& list, bool value) {
+    list.push_back(value);
+}
+
+template <typename T>
+void listAdd(std::vector<T>& list, const T& value) {
+    list.push_back(value);
+}
+
+char get(const std::string& str, int index) {
+    if (index < 0) {
+        index = str.length() + index;
+    }
+    if (index < 0 || index >= str.length()) {
+        return '\0';
+    }
+    return str[index];
+}
+
+std::variant<int, std::string, bool> get(const std::vector<std::variant<int, std::string, bool>>& list, int index) {
+    if (index < 0) {
+        index = list.size() + index;
+    }
+    if (index < 0 || index >= list.size()) {
+        return std::string("undefined");
+    }
+    return list[index];
+}
+
+template <typename T>
+T get(const std::vector<T>& list, int index) {
+    if (index < 0) {
+        index = list.size() + index;
+    }
+    if (index < 0 || index >= list.size()) {
+        throw std::out_of_range("List index out of range");
+    }
+    return list[index];
+}
+
+std::variant<int, std::string, bool> get(const std::unordered_map<std::string, std::variant<int, std::string, bool>>& map, const std::string& key) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+        return it->second;
+    }
+    return std::string("undefined");
+}
+
+std::variant<int, std::string, bool> get(const std::unordered_map<std::string, std::variant<int, std::string, bool>>& map, const std::string& key, const std::string& defaultValue) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+        return it->second;
+    }
+    return defaultValue;
+}
+
+std::vector<std::string> mapKeys(const std::unordered_map<std::string, std::variant<int, std::string, bool>>& map) {
+    std::vector<std::string> keys;
+    for (const auto& pair : map) {
+        keys.push_back(pair.first);
+    }
+    return keys;
+}
+
+bool mapRemove(std::unordered_map<std::string, std::variant<int, std::string, bool>>& map, const std::string& key) {
+    return map.erase(key) > 0;
+}
+
+std::vector<std::variant<int, std::string, bool>> mapValues(const std::unordered_map<std::string, std::variant<int, std::string, bool>>& map) {
+    std::vector<std::variant<int, std::string, bool>> values;
+    for (const auto& pair : map) {
+        values.push_back(pair.second);
+    }
+    return values;
+}
+
+// StringBuilder implementation
+class VanctionStringBuilder {
+public:
+    std::string buffer;
+    
+    VanctionStringBuilder& append(const std::string& value) { buffer += value; return *this; }
+    VanctionStringBuilder& append(const char* value) { buffer += value; return *this; }
+    VanctionStringBuilder& append(char value) { buffer += value; return *this; }
+    VanctionStringBuilder& append(bool value) { buffer += value ? "true" : "false"; return *this; }
+    VanctionStringBuilder& append(int value) { buffer += std::to_string(value); return *this; }
+    VanctionStringBuilder& append(float value) { buffer += std::to_string(value); return *this; }
+    VanctionStringBuilder& append(double value) { buffer += std::to_string(value); return *this; }
+    VanctionStringBuilder& append(const std::variant<int, std::string, bool>& value) { buffer += variantToString(value); return *this; }
+    
+    // sb.append(a, b, ...) appends every argument in order
+    template <typename First, typename Second, typename... Rest>
+    VanctionStringBuilder& append(const First& first, const Second& second, const Rest&... rest) {
+        append(first);
+        return append(second, rest...);
+    }
+    
+    std::string toString() const { return buffer; }
+    int length() const { return static_cast<int>(buffer.size()); }
+    void clear() { buffer.clear(); }
+};
+
+std::shared_ptr<VanctionStringBuilder> StringBuilder() {
+    return std::make_shared<VanctionStringBuilder>();
+}
+
+template <typename T>
+std::shared_ptr<VanctionStringBuilder> StringBuilder(const T& initial) {
+    auto builder = std::make_shared<VanctionStringBuilder>();
+    builder->append(initial);
+    return builder;
+}
+
+std::ostream& operator<<(std::ostream& os, const std::shared_ptr<VanctionStringBuilder>& builder) {
+    os << builder->buffer;
+    return os;
+}
+
+template <typename... Parts>
+std::string formatString(const Parts&... parts) {
+    VanctionStringBuilder builder;
+    (builder.append(parts), ...);
+    return builder.buffer;
+}
+
+int listNumber(const std::variant<int, std::string, bool>& value) {
+    return std::get<int>(value);
+}
+
+int listNumber(int value) {
+    return value;
+}
+
+template <typename T>
+int listSum(const std::vector<T>& list) {
+    long long total = 0;
+    for (const auto& value : list) total += listNumber(value);
+    return static_cast<int>(total);
+}
+
+template <typename T>
+int listMin(const std::vector<T>& list) {
+    if (list.empty()) throw std::runtime_error("List.min() of an empty list");
+    int result = listNumber(list[0]);
+    for (const auto& value : list) result = std::min(result, listNumber(value));
+    return result;
+}
+
+template <typename T>
+int listMax(const std::vector<T>& list) {
+    if (list.empty()) throw std::runtime_error("List.max() of an empty list");
+    int result = listNumber(list[0]);
+    for (const auto& value : list) result = std::max(result, listNumber(value));
+    return result;
+}
+
+template <typename T>
+double listMean(const std::vector<T>& list) {
+    if (list.empty()) throw std::runtime_error("List.mean() of an empty list");
+    long long total = 0;
+    for (const auto& value : list) total += listNumber(value);
+    return static_cast<double>(total) / list.size();
+}
+
+template <typename L, typename R>
+int listDot(const std::vector<L>& left, const std::vector<R>& right) {
+    if (left.size() != right.size()) throw std::runtime_error("List.dot() expects lists of the same length");
+    long long total = 0;
+    for (size_t i = 0; i < left.size(); ++i) total += static_cast<long long>(listNumber(left[i])) * listNumber(right[i]);
+    return static_cast<int>(total);
+}
+
+template <typename T>
+std::vector<std::variant<int, std::string, bool>> listScale(const std::vector<T>& list, int factor) {
+    std::vector<std::variant<int, std::string, bool>> result;
+    result.reserve(list.size());
+    for (const auto& value : list) result.push_back(listNumber(value) * factor);
+    return result;
+}
+
+template <typename L, typename R>
+std::vector<std::variant<int, std::string, bool>> listPlus(const std::vector<L>& left, const std::vector<R>& right) {
+    if (left.size() != right.size()) throw std::runtime_error("List.plus() expects lists of the same length");
+    std::vector<std::variant<int, std::string, bool>> result;
+    result.reserve(left.size());
+    for (size_t i = 0; i < left.size(); ++i) result.push_back(listNumber(left[i]) + listNumber(right[i]));
+    return result;
+}
+
+template <typename T>
+std::vector<std::variant<int, std::string, bool>> listClamp(const std::vector<T>& list, int low, int high) {
+    if (low > high) throw std::runtime_error("List.clamp() expects low <= high");
+    std::vector<std::variant<int, std::string, bool>> result;
+    result.reserve(list.size());
+    for (const auto& value : list) result.push_back(std::min(std::max(listNumber(value), low), high));
+    return result;
+}
+
+template <typename T>
+int listCount(const std::vector<T>& list, const std::string& op, int number) {
+    int result = 0;
+    for (const auto& value : list) {
+        int element = listNumber(value);
+        if (op == "<") result += element < number;
+        else if (op == "<=") result += element <= number;
+        else if (op == ">") result += element > number;
+        else if (op == ">=") result += element >= number;
+        else if (op == "==") result += element == number;
+        else if (op == "!=") result += element != number;
+        else throw std::runtime_error("List.count() got an unknown operator: " + op);
+    }
+    return result;
+}
+
+template <typename T>
+int listCount(const std::vector<T>& list, int number) {
+    return listCount(list, "==", number);
+}
+
+template <typename T, typename... Args>
+auto listSum(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->sum(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listMin(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->min(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listMax(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->max(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listMean(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->mean(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listDot(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->dot(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listScale(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->scale(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listPlus(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->plus(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listClamp(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->clamp(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+auto listCount(const std::shared_ptr<T>& object, Args&&... args) {
+    return object->count(std::forward<Args>(args)...);
+}
+
+// Range generator implementation
+class RangeGenerator {
+public:
+    RangeGenerator(int start, int end, int step = 1)
+        : start_(start), end_(end), step_(step) {}
+    
+    // Iterator class
+    class Iterator {
+    public:
+        Iterator(int value, int step, int end) : value_(value), step_(step), end_(end) {}
+        
+        int operator*() const { return value_; }
+        
+        Iterator& operator++() {
+            value_ += step_;
+            return *this;
+        }
+        
+        bool operator!=(const Iterator& other) const {
+            if (step_ > 0) {
+                return value_ < other.value_;
+            } else {
+                return value_ > other.value_;
+            }
+        }
+        
+    private:
+        int value_;
+        int step_;
+        int end_;
+    };
+    
+    Iterator begin() const { return Iterator(start_, step_, end_); }
+    Iterator end() const { return Iterator(end_, step_, end_); }
+    
+private:
+    int start_;
+    int end_;
+    int step_;
+};
+
+// Range function overloads
+RangeGenerator range(int start, int end, int step = 1) {
+    return RangeGenerator(start, end, step);
+}
+
+RangeGenerator range(double start, double end, double step = 1.0) {
+    return RangeGenerator(static_cast<int>(start), static_cast<int>(end), static_cast<int>(step));
+}
+
+RangeGenerator range(int end) {
+    return RangeGenerator(0, end, 1);
+}
+
+RangeGenerator range(double end) {
+    return RangeGenerator(0, static_cast<int>(end), 1);
+}
+
+// Vanction namespace for utility functions
+namespace vanction {
+    RangeGenerator range(int start, int end, int step = 1) {
+        return ::range(start, end, step);
+    }
+    
+    RangeGenerator range(double start, double end, double step = 1.0) {
+        return ::range(start, end, step);
+    }
+    
+    RangeGenerator range(int end) {
+        return ::range(end);
+    }
+    
+    RangeGenerator range(double end) {
+        return ::range(end);
+    }
+}
+
+auto make_counter() {
+    auto count_ptr = std::make_shared<int>(0);
+auto& count = *count_ptr;
+    auto increment = [=]() -> auto {
+        *count_ptr = *count_ptr + 1;
+        return count;
+    };
+    return increment;
+}
+
+auto test_closure(std::variant<int, std::string, bool> abc) {
+    auto abc_ptr = std::make_shared<std::variant<int, std::string, bool>>(abc);
+    auto map = [=]() -> auto {
+        return *abc_ptr;
+    };
+    return map;
+}
+
+int main() {
+    auto counter = make_counter();
+    std::cout << counter() << std::endl;
+    std::cout << counter() << std::endl;
+    std::cout << counter() << std::endl;
+    auto closure_func = test_closure(32);
+    std::cout << closure_func() << std::endl;
+    return 0;
+}
+
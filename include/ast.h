@@ -1,15 +1,65 @@
 #ifndef VANCTION_AST_H
 #define VANCTION_AST_H
 
+#include "../src/value.h"
 #include <string>
+#include <utility>
 #include <vector>
 
+// Kind tag of every concrete AST node
+enum class NodeKind : unsigned char {
+    FunctionDeclaration,
+    Comment,
+    Identifier,
+    IntegerLiteral,
+    FloatLiteral,
+    DoubleLiteral,
+    CharLiteral,
+    BooleanLiteral,
+    StringLiteral,
+    FunctionCall,
+    FunctionCallExpression,
+    VariableDeclaration,
+    BinaryExpression,
+    AssignmentExpression,
+    IndexAccessExpression,
+    ExpressionStatement,
+    ReturnStatement,
+    BreakStatement,
+    ContinueStatement,
+    IfStatement,
+    ForLoopStatement,
+    ListLiteral,
+    HashMapLiteral,
+    RangeExpression,
+    ForInLoopStatement,
+    WhileLoopStatement,
+    DoWhileLoopStatement,
+    CaseStatement,
+    SwitchStatement,
+    TryHappenStatement,
+    ErrorObject,
+    LambdaExpression,
+    NamespaceDeclaration,
+    NamespaceAccess,
+    ClassDeclaration,
+    ClassMethodDeclaration,
+    InstanceMethodDeclaration,
+    InstanceCreationExpression,
+    InstanceAccessExpression,
+    ImportStatement,
+    Program
+};
+
 // AST node base class
 class ASTNode {
 public:
-    ASTNode(int line = 1, int column = 1) : line(line), column(column) {}
+    ASTNode(NodeKind kind, int line = 1, int column = 1) : kind(kind), line(line), column(column) {}
     virtual ~ASTNode() = default;
     
+    // Concrete node type, used for switch dispatch instead of RTTI
+    const NodeKind kind;
+    
     int getLine() const { return line; }
     int getColumn() const { return column; }
     
@@ -18,6 +68,12 @@ private:
     int column;
 };
 
+// Checked downcast using the node kind tag instead of RTTI
+template <typename T>
+T* nodeCast(ASTNode* node) {
+    return node && T::isKind(node->kind) ? static_cast<T*>(node) : nullptr;
+}
+
 // Function parameter
 struct FunctionParameter {
     std::string type; // Optional, defaults to "auto"
@@ -27,20 +83,79 @@ struct FunctionParameter {
         : type(type), name(name) {}
 };
 
+// Variable a nested function or lambda captures when it is created: a slot of the
+// enclosing frame, or an upvalue of the enclosing closure
+struct UpvalueDescriptor {
+    std::string name;
+    bool fromEnclosingSlot;
+    int index;
+};
+
+// Frame layout computed by the resolver for a function or lambda body
+// Parameters always occupy the first slots, followed by locals in declaration order
+struct FrameLayout {
+    int frameSize = 0;
+    // Free variables captured by closures of this body, in upvalue order
+    std::vector<UpvalueDescriptor> upvalues;
+    // Implicit instance/this slots of instance methods (-1 when absent)
+    int instanceSlot = -1;
+    int thisSlot = -1;
+    // Slot names, used for name-based lookups such as format strings
+    std::vector<std::string> slotNames;
+};
+
+// Bytecode of a function or lambda body, compiled on first call and owned by the VM
+struct Chunk;
+
+// Function or lambda value with its captured upvalues, owned by the collector
+struct Closure;
+
+// Tiering state and native code of a function, owned by the native tier
+struct NativeFunction;
+
+// Runtime class definition, and the methods call sites cache per receiver class
+struct ClassDefinition;
+class InstanceMethodDeclaration;
+
+// Hidden class of an instance, cached by field accesses
+struct Shape;
+
+// Runtime value, cached by quickened nodes
+class Value;
+
+// Case dispatch of a switch statement, owned by the switch table module
+struct SwitchTable;
+
 // Function declaration node
 class FunctionDeclaration : public ASTNode {
 public:
+    static bool isKind(NodeKind kind) {
+        return kind == NodeKind::FunctionDeclaration || kind == NodeKind::ClassMethodDeclaration || kind == NodeKind::InstanceMethodDeclaration;
+    }
+    
     std::string returnType;
     std::string name;
     std::vector<FunctionParameter> parameters;
     std::vector<ASTNode*> body;
     
-    // For closures: save the variable environment when the function is created
-    // We'll use void* to store the actual environment, which will be cast to the appropriate type at runtime
-    void* closureEnv;
+    // Closure called when the function is called by name
+    // (created by the most recent execution of a nested declaration)
+    Closure* closure;
+    
+    // Slot layout of the function's frame
+    FrameLayout layout;
+    
+    // Slot holding the function in the enclosing frame (nested functions only)
+    int slot;
+    
+    // Compiled body (nullptr until first executed by the VM)
+    Chunk* chunk;
+    
+    // Profile and native code in tiered mode (nullptr until first called)
+    NativeFunction* native;
     
-    FunctionDeclaration(const std::string& returnType, const std::string& name)
-        : returnType(returnType), name(name), closureEnv(nullptr) {}
+    FunctionDeclaration(const std::string& returnType, const std::string& name, NodeKind kind = NodeKind::FunctionDeclaration)
+        : ASTNode(kind), returnType(returnType), name(name), closure(nullptr), slot(-1), chunk(nullptr), native(nullptr) {}
     
     ~FunctionDeclaration() {
         for (auto node : body) {
@@ -52,99 +167,230 @@ public:
 // Statement node base class
 class Statement : public ASTNode {
 public:
-    Statement(int line = 1, int column = 1) : ASTNode(line, column) {}
+    Statement(NodeKind kind, int line = 1, int column = 1) : ASTNode(kind, line, column) {}
     virtual ~Statement() = default;
 };
 
 // Comment node
 class Comment : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::Comment; }
+    
     std::string text;
     
     Comment(const std::string& text)
-        : text(text) {}
+        : Statement(NodeKind::Comment), text(text) {}
+};
+
+// Type of a value proven before running by type inference
+// (Unknown when the value's type depends on how the program runs)
+enum class StaticType : unsigned char {
+    Unknown,
+    Int,
+    Float,
+    Double,
+    Bool,
+    Char,
+    String,
+    List
+};
+
+// Specialization an expression node rewrites itself to the first time the interpreter runs it
+// Every later run checks the node's guard; a failed type guard rewrites it to the generic path for good
+enum class Quickened : unsigned char {
+    Uninitialized,
+    Generic,
+    GlobalLoad,     // Identifier: cached constants or variables entry
+    IntBinary,      // BinaryExpression: int operands
+    DoubleBinary,   // BinaryExpression: double operands
+    DirectCall      // FunctionCall: cached constants or variables entry holding the function
 };
 
 // Expression node base class
 class Expression : public ASTNode {
 public:
-    Expression(int line = 1, int column = 1) : ASTNode(line, column) {}
+    Expression(NodeKind kind, int line = 1, int column = 1) : ASTNode(kind, line, column) {}
     virtual ~Expression() = default;
+    
+    // Type every evaluation of this expression produces, set by type inference
+    StaticType staticType = StaticType::Unknown;
+    
+    Quickened quickened = Quickened::Uninitialized;
 };
 
 // Identifier expression
 class Identifier : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::Identifier; }
+    
     std::string name;
     
+    // Resolved location: slot of the current frame, or upvalue of the current closure
+    // (both -1 for globals)
+    int slot;
+    int upvalue;
+    bool isImmut;
+    
+    // Global entry of a quickened load, valid while constants has globalGuard entries
+    // (entries are never erased, so only a new constant can shadow it)
+    Value* global = nullptr;
+    size_t globalGuard = 0;
+    
     Identifier(const std::string& name, int line = 1, int column = 1)
-        : Expression(line, column), name(name) {}
+        : Expression(NodeKind::Identifier, line, column), name(name), slot(-1), upvalue(-1), isImmut(false) {}
 };
 
 // Integer literal expression
 class IntegerLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::IntegerLiteral; }
+    
     int value;
     
     IntegerLiteral(int value, int line = 1, int column = 1)
-        : Expression(line, column), value(value) {}
+        : Expression(NodeKind::IntegerLiteral, line, column), value(value) {}
 };
 
 // Float literal expression
 class FloatLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::FloatLiteral; }
+    
     float value;
     
     FloatLiteral(float value, int line = 1, int column = 1)
-        : Expression(line, column), value(value) {}
+        : Expression(NodeKind::FloatLiteral, line, column), value(value) {}
 };
 
 // Double literal expression
 class DoubleLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::DoubleLiteral; }
+    
     double value;
     
     DoubleLiteral(double value, int line = 1, int column = 1)
-        : Expression(line, column), value(value) {}
+        : Expression(NodeKind::DoubleLiteral, line, column), value(value) {}
 };
 
 // Char literal expression
 class CharLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::CharLiteral; }
+    
     char value;
     
     CharLiteral(char value, int line = 1, int column = 1)
-        : Expression(line, column), value(value) {}
+        : Expression(NodeKind::CharLiteral, line, column), value(value) {}
 };
 
 // Boolean literal expression
 class BooleanLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::BooleanLiteral; }
+    
     bool value;
     
     BooleanLiteral(bool value, int line = 1, int column = 1)
-        : Expression(line, column), value(value) {}
+        : Expression(NodeKind::BooleanLiteral, line, column), value(value) {}
+};
+
+// Piece of a compiled format string: literal text, then the variable spliced in after it
+struct FormatSegment {
+    std::string text;
+    Identifier* variable; // nullptr for the text after the last placeholder
 };
 
 // String literal expression
 class StringLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::StringLiteral; }
+    
     std::string value;
     std::string type; // "normal", "raw", "format"
     
+    // Format strings are split by the parser, so evaluation is a single pass over the segments
+    std::vector<FormatSegment> segments;
+    size_t literalLength; // total length of the segment text, used to presize the result
+    
+    // Heap copy of the value handed out by reference on every evaluation
+    // (created on first use, only for strings too long to store inline)
+    StringObject* shared;
+    
     StringLiteral(const std::string& value, const std::string& type = "normal", int line = 1, int column = 1)
-        : Expression(line, column), value(value), type(type) {}
+        : Expression(NodeKind::StringLiteral, line, column), value(value), type(type), literalLength(0), shared(nullptr) {}
+    
+    ~StringLiteral() {
+        for (auto& segment : segments) {
+            delete segment.variable;
+        }
+        // Values handed out keep their own references
+        if (shared && --shared->refCount == 0) {
+            delete shared;
+        }
+    }
+};
+
+// What a call site invokes, decided by the interpreter's link step instead of comparing names on every call
+enum class CallTarget : unsigned char {
+    Unlinked,
+    Dynamic,            // decided by the value of a local callee or receiver at run time
+    Function,           // plain-name call: function value, or targetFunction (C++ module members)
+    StringBuilder,      // built-in StringBuilder()
+    IoPrint,            // std:io functions
+    IoInput,
+    IoOther,
+    TypeInt,            // std:type conversions
+    TypeFloat,
+    TypeDouble,
+    TypeChar,
+    TypeString,
+    TypeOther,
+    ClassMethod,        // static call on targetClass
+    NamespaceFunction,  // targetFunction of a namespace
+    ModuleFunction      // targetFunction of a C++ module namespace
 };
 
 // Function call expression (for methods and named functions)
 class FunctionCall : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::FunctionCall; }
+    
     std::string objectName;
     std::string methodName;
     std::vector<Expression*> arguments;
     
+    // Resolved locations of a local callee and of a local receiver object
+    // (slot of the current frame or upvalue of the current closure, -1 when not local)
+    int slot;
+    int upvalue;
+    int objectSlot;
+    int objectUpvalue;
+    
+    // Global entry holding the callee of a quickened plain-name call, valid while constants has globalGuard entries
+    Value* global = nullptr;
+    size_t globalGuard = 0;
+    
+    // Target linked for the link stamp of the interpreter (see linkCall)
+    CallTarget target = CallTarget::Unlinked;
+    FunctionDeclaration* targetFunction = nullptr;
+    ClassDefinition* targetClass = nullptr;
+    size_t linkStamp = 0;
+    
+    // Polymorphic inline cache of the instance methods this call resolved, per receiver class
+    // Entries are only valid for the class epoch they were filled in
+    struct MethodCacheEntry {
+        ClassDefinition* cls;
+        InstanceMethodDeclaration* method;
+    };
+    static const int methodCacheSize = 4;
+    MethodCacheEntry methodCache[methodCacheSize];
+    int methodCacheCount;
+    unsigned methodCacheEpoch;
+    
     FunctionCall(const std::string& objectName, const std::string& methodName, int line = 1, int column = 1)
-        : Expression(line, column), objectName(objectName), methodName(methodName) {}
+        : Expression(NodeKind::FunctionCall, line, column), objectName(objectName), methodName(methodName),
+          slot(-1), upvalue(-1), objectSlot(-1), objectUpvalue(-1), methodCacheCount(0), methodCacheEpoch(0) {}
     
     ~FunctionCall() {
         for (auto arg : arguments) {
@@ -156,11 +402,13 @@ public:
 // Function call expression (for expressions that evaluate to functions, like lambdas)
 class FunctionCallExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::FunctionCallExpression; }
+    
     Expression* callee;
     std::vector<Expression*> arguments;
     
     FunctionCallExpression(Expression* callee, const std::vector<Expression*>& arguments, int line = 1, int column = 1)
-        : Expression(line, column), callee(callee), arguments(arguments) {}
+        : Expression(NodeKind::FunctionCallExpression, line, column), callee(callee), arguments(arguments) {}
     
     ~FunctionCallExpression() {
         delete callee;
@@ -173,6 +421,8 @@ public:
 // Variable declaration statement
 class VariableDeclaration : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::VariableDeclaration; }
+    
     std::string type;
     std::string name;
     Expression* initializer;
@@ -180,8 +430,15 @@ public:
     bool isDefine;
     bool isImmut;
     
+    // Resolved frame slot (-1 for globals)
+    int slot;
+    
+    // Type of every element of a list variable that is never reassigned or shared,
+    // set by type inference (Unknown for other variables)
+    StaticType elementType;
+    
     VariableDeclaration(const std::string& type, const std::string& name, Expression* initializer = nullptr, bool isAuto = false, bool isDefine = false, bool isImmut = false)
-        : type(type), name(name), initializer(initializer), isAuto(isAuto), isDefine(isDefine), isImmut(isImmut) {}
+        : Statement(NodeKind::VariableDeclaration), type(type), name(name), initializer(initializer), isAuto(isAuto), isDefine(isDefine), isImmut(isImmut), slot(-1), elementType(StaticType::Unknown) {}
     
     ~VariableDeclaration() {
         if (initializer) {
@@ -190,15 +447,74 @@ public:
     }
 };
 
+// Binary operator, decoded once when the expression is parsed
+enum class BinaryOperator : unsigned char {
+    Add,            // +
+    Subtract,       // -
+    Multiply,       // *
+    Divide,         // /
+    Modulo,         // %
+    Power,          // **
+    ShiftLeft,      // <<
+    ShiftRight,     // >>
+    And,            // &
+    Or,             // |
+    Xor,            // ^
+    Equal,          // ==
+    NotEqual,       // !=
+    Less,           // <
+    LessEqual,      // <=
+    Greater,        // >
+    GreaterEqual,   // >=
+    Index,          // [
+    Member,         // .
+    Unknown
+};
+
+// Decode an operator token into its BinaryOperator
+inline BinaryOperator decodeBinaryOperator(const std::string& op) {
+    static const std::pair<const char*, BinaryOperator> table[] = {
+        {"+", BinaryOperator::Add}, {"-", BinaryOperator::Subtract}, {"*", BinaryOperator::Multiply},
+        {"/", BinaryOperator::Divide}, {"%", BinaryOperator::Modulo}, {"**", BinaryOperator::Power},
+        {"<<", BinaryOperator::ShiftLeft}, {">>", BinaryOperator::ShiftRight},
+        {"&", BinaryOperator::And}, {"|", BinaryOperator::Or}, {"^", BinaryOperator::Xor},
+        {"==", BinaryOperator::Equal}, {"!=", BinaryOperator::NotEqual},
+        {"<", BinaryOperator::Less}, {"<=", BinaryOperator::LessEqual},
+        {">", BinaryOperator::Greater}, {">=", BinaryOperator::GreaterEqual},
+        {"[", BinaryOperator::Index}, {".", BinaryOperator::Member}
+    };
+    for (const auto& entry : table) {
+        if (op == entry.first) {
+            return entry.second;
+        }
+    }
+    return BinaryOperator::Unknown;
+}
+
+// Operators producing a bool: comparisons, and & | ^ which the interpreters apply to truth values
+inline bool isComparison(BinaryOperator op) {
+    return op == BinaryOperator::Equal || op == BinaryOperator::NotEqual || op == BinaryOperator::Less ||
+           op == BinaryOperator::LessEqual || op == BinaryOperator::Greater || op == BinaryOperator::GreaterEqual;
+}
+
+inline bool isLogical(BinaryOperator op) {
+    return op == BinaryOperator::And || op == BinaryOperator::Or || op == BinaryOperator::Xor;
+}
+
 // Binary expression (for string concatenation)
 class BinaryExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::BinaryExpression; }
+    
     Expression* left;
     std::string op;
     Expression* right;
     
+    // Decoded operator, the interpreters and code generator dispatch on this
+    BinaryOperator opcode;
+    
     BinaryExpression(Expression* left, const std::string& op, Expression* right, int line = 1, int column = 1)
-        : Expression(line, column), left(left), op(op), right(right) {}
+        : Expression(NodeKind::BinaryExpression, line, column), left(left), op(op), right(right), opcode(decodeBinaryOperator(op)) {}
     
     ~BinaryExpression() {
         delete left;
@@ -209,11 +525,17 @@ public:
 // Assignment expression
 class AssignmentExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::AssignmentExpression; }
+    
     Expression* left;
     Expression* right;
     
+    // Set by type inference when the assigned value always has the type the variable was
+    // declared with, so the interpreters store it without checking
+    bool typeProven;
+    
     AssignmentExpression(Expression* left, Expression* right, int line = 1, int column = 1)
-        : Expression(line, column), left(left), right(right) {}
+        : Expression(NodeKind::AssignmentExpression, line, column), left(left), right(right), typeProven(false) {}
     
     ~AssignmentExpression() {
         delete left;
@@ -224,11 +546,13 @@ public:
 // Index access expression (for array/list/map access using [])
 class IndexAccessExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::IndexAccessExpression; }
+    
     Expression* collection;  // The array/list/map being accessed
     Expression* index;       // The index/key expression
     
     IndexAccessExpression(Expression* collection, Expression* index, int line = 1, int column = 1)
-        : Expression(line, column), collection(collection), index(index) {}
+        : Expression(NodeKind::IndexAccessExpression, line, column), collection(collection), index(index) {}
     
     ~IndexAccessExpression() {
         delete collection;
@@ -239,10 +563,12 @@ public:
 // Expression statement
 class ExpressionStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ExpressionStatement; }
+    
     Expression* expression;
     
     ExpressionStatement(Expression* expression)
-        : Statement(expression->getLine(), expression->getColumn()), expression(expression) {}
+        : Statement(NodeKind::ExpressionStatement, expression->getLine(), expression->getColumn()), expression(expression) {}
     
     ~ExpressionStatement() {
         if (expression) {
@@ -254,10 +580,14 @@ public:
 // Return statement
 class ReturnStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ReturnStatement; }
+    
     Expression* expression;
+    // Set by the resolver when the return ends its function with a plain call (return f(...))
+    bool tailCall = false;
     
     ReturnStatement(Expression* expression = nullptr, int line = 1, int column = 1)
-        : Statement(line, column), expression(expression) {}
+        : Statement(NodeKind::ReturnStatement, line, column), expression(expression) {}
     
     ~ReturnStatement() {
         if (expression) {
@@ -266,16 +596,44 @@ public:
     }
 };
 
+// Break statement: leaves the innermost loop, or the enclosing loop of the label
+class BreakStatement : public Statement {
+public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::BreakStatement; }
+    
+    std::string label;
+    // Set by the parser: number of loops between the statement and the loop it leaves
+    int depth;
+    
+    BreakStatement(const std::string& label, int depth, int line = 1, int column = 1)
+        : Statement(NodeKind::BreakStatement, line, column), label(label), depth(depth) {}
+};
+
+// Continue statement: starts the next iteration of the innermost loop, or of the enclosing loop of the label
+class ContinueStatement : public Statement {
+public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ContinueStatement; }
+    
+    std::string label;
+    // Set by the parser: number of loops between the statement and the loop it restarts
+    int depth;
+    
+    ContinueStatement(const std::string& label, int depth, int line = 1, int column = 1)
+        : Statement(NodeKind::ContinueStatement, line, column), label(label), depth(depth) {}
+};
+
 // If-else statement
 class IfStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::IfStatement; }
+    
     Expression* condition;
     std::vector<ASTNode*> ifBody;
     std::vector<IfStatement*> elseIfs;
     std::vector<ASTNode*> elseBody;
     
     IfStatement(Expression* condition, const std::vector<ASTNode*>& ifBody)
-        : condition(condition), ifBody(ifBody) {}
+        : Statement(NodeKind::IfStatement), condition(condition), ifBody(ifBody) {}
     
     ~IfStatement() {
         delete condition;
@@ -294,13 +652,15 @@ public:
 // For loop statement (traditional)
 class ForLoopStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ForLoopStatement; }
+    
     Statement* initialization;
     Expression* condition;
     Expression* increment;
     std::vector<ASTNode*> body;
     
     ForLoopStatement(Statement* initialization, Expression* condition, Expression* increment, const std::vector<ASTNode*>& body)
-        : initialization(initialization), condition(condition), increment(increment), body(body) {}
+        : Statement(NodeKind::ForLoopStatement), initialization(initialization), condition(condition), increment(increment), body(body) {}
     
     ~ForLoopStatement() {
         delete initialization;
@@ -315,10 +675,12 @@ public:
 // List literal expression
 class ListLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ListLiteral; }
+    
     std::vector<Expression*> elements;
     
     ListLiteral(int line = 1, int column = 1)
-        : Expression(line, column) {}
+        : Expression(NodeKind::ListLiteral, line, column) {}
     
     ~ListLiteral() {
         for (auto elem : elements) {
@@ -344,10 +706,12 @@ struct HashMapEntry {
 // Hash map literal expression
 class HashMapLiteral : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::HashMapLiteral; }
+    
     std::vector<HashMapEntry*> entries;
     
     HashMapLiteral(int line = 1, int column = 1)
-        : Expression(line, column) {}
+        : Expression(NodeKind::HashMapLiteral, line, column) {}
     
     ~HashMapLiteral() {
         for (auto entry : entries) {
@@ -359,12 +723,14 @@ public:
 // Range expression
 class RangeExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::RangeExpression; }
+    
     Expression* start;
     Expression* end;
     Expression* step;
     
     RangeExpression(Expression* start, Expression* end, Expression* step = nullptr, int line = 1, int column = 1)
-        : Expression(line, column), start(start), end(end), step(step) {}
+        : Expression(NodeKind::RangeExpression, line, column), start(start), end(end), step(step) {}
     
     ~RangeExpression() {
         delete start;
@@ -378,17 +744,26 @@ public:
 // For in loop statement (enhanced)
 class ForInLoopStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ForInLoopStatement; }
+    
     std::string keyVariableName;
     std::string valueVariableName;
     Expression* collection;
     std::vector<ASTNode*> body;
     bool isKeyValuePair;
     
+    // Resolved frame slots of the loop variables
+    int keySlot;
+    int valueSlot;
+    
+    // Loop variable naming a constant of the function (empty when none does); binding it is an ImmutError
+    std::string boundConstant;
+    
     ForInLoopStatement(const std::string& variableName, Expression* collection, const std::vector<ASTNode*>& body)
-        : keyVariableName(variableName), collection(collection), body(body), isKeyValuePair(false) {}
+        : Statement(NodeKind::ForInLoopStatement), keyVariableName(variableName), collection(collection), body(body), isKeyValuePair(false), keySlot(-1), valueSlot(-1) {}
     
     ForInLoopStatement(const std::string& keyVariableName, const std::string& valueVariableName, Expression* collection, const std::vector<ASTNode*>& body)
-        : keyVariableName(keyVariableName), valueVariableName(valueVariableName), collection(collection), body(body), isKeyValuePair(true) {}
+        : Statement(NodeKind::ForInLoopStatement), keyVariableName(keyVariableName), valueVariableName(valueVariableName), collection(collection), body(body), isKeyValuePair(true), keySlot(-1), valueSlot(-1) {}
     
     ~ForInLoopStatement() {
         delete collection;
@@ -401,11 +776,13 @@ public:
 // While loop statement
 class WhileLoopStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::WhileLoopStatement; }
+    
     Expression* condition;
     std::vector<ASTNode*> body;
     
     WhileLoopStatement(Expression* condition, const std::vector<ASTNode*>& body)
-        : condition(condition), body(body) {}
+        : Statement(NodeKind::WhileLoopStatement), condition(condition), body(body) {}
     
     ~WhileLoopStatement() {
         delete condition;
@@ -418,11 +795,13 @@ public:
 // Do-while loop statement
 class DoWhileLoopStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::DoWhileLoopStatement; }
+    
     std::vector<ASTNode*> body;
     Expression* condition;
     
     DoWhileLoopStatement(const std::vector<ASTNode*>& body, Expression* condition)
-        : body(body), condition(condition) {}
+        : Statement(NodeKind::DoWhileLoopStatement), body(body), condition(condition) {}
     
     ~DoWhileLoopStatement() {
         for (auto node : body) {
@@ -435,11 +814,13 @@ public:
 // Case statement for switch
 class CaseStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::CaseStatement; }
+    
     Expression* value;
     std::vector<ASTNode*> body;
     
     CaseStatement(Expression* value, const std::vector<ASTNode*>& body)
-        : value(value), body(body) {}
+        : Statement(NodeKind::CaseStatement), value(value), body(body) {}
     
     ~CaseStatement() {
         delete value;
@@ -452,11 +833,16 @@ public:
 // Switch statement
 class SwitchStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::SwitchStatement; }
+    
     Expression* expression;
     std::vector<CaseStatement*> cases;
     
+    // Built the first time the switch is run or generated
+    SwitchTable* table = nullptr;
+    
     SwitchStatement(Expression* expression, const std::vector<CaseStatement*>& cases)
-        : expression(expression), cases(cases) {}
+        : Statement(NodeKind::SwitchStatement), expression(expression), cases(cases) {}
     
     ~SwitchStatement() {
         delete expression;
@@ -469,14 +855,22 @@ public:
 // Try-Happen statement for error handling
 class TryHappenStatement : public Statement {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::TryHappenStatement; }
+    
     std::vector<ASTNode*> tryBody;
     std::string errorType;
     std::string errorVariableName;
     std::vector<ASTNode*> happenBody;
     
-    TryHappenStatement(const std::vector<ASTNode*>& tryBody, const std::string& errorType, 
+    // Resolved frame slot of the error variable
+    int errorSlot;
+    
+    // Interned id of errorType, set by the parser (see happenErrorType)
+    int errorTypeId;
+    
+    TryHappenStatement(const std::vector<ASTNode*>& tryBody, const std::string& errorType,
                       const std::string& errorVariableName, const std::vector<ASTNode*>& happenBody)
-        : tryBody(tryBody), errorType(errorType), errorVariableName(errorVariableName), happenBody(happenBody) {}
+        : Statement(NodeKind::TryHappenStatement), tryBody(tryBody), errorType(errorType), errorVariableName(errorVariableName), happenBody(happenBody), errorSlot(-1), errorTypeId(-1) {}
     
     ~TryHappenStatement() {
         for (auto node : tryBody) {
@@ -491,26 +885,32 @@ public:
 // Error object for representing errors in the language
 class ErrorObject : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ErrorObject; }
+    
     std::string text;
     std::string type;
     std::string info;
     
     ErrorObject(const std::string& text, const std::string& type, const std::string& info)
-        : text(text), type(type), info(info) {}
+        : Expression(NodeKind::ErrorObject), text(text), type(type), info(info) {}
 };
 
 // Lambda expression
 class LambdaExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::LambdaExpression; }
+    
     std::vector<FunctionParameter> parameters;
     Expression* body;
     
-    // For closures: save the variable environment when the lambda is created
-    // We'll use void* to store the actual environment, which will be cast to the appropriate type at runtime
-    void* closureEnv;
+    // Slot layout of the lambda's frame
+    FrameLayout layout;
+    
+    // Compiled body (nullptr until first executed by the VM)
+    Chunk* chunk;
     
     LambdaExpression(const std::vector<FunctionParameter>& parameters, Expression* body, int line = 1, int column = 1)
-        : Expression(line, column), parameters(parameters), body(body), closureEnv(nullptr) {}
+        : Expression(NodeKind::LambdaExpression, line, column), parameters(parameters), body(body), chunk(nullptr) {}
     
     ~LambdaExpression() {
         if (body) {
@@ -522,11 +922,13 @@ public:
 // Namespace declaration node
 class NamespaceDeclaration : public ASTNode {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::NamespaceDeclaration; }
+    
     std::string name;
     std::vector<ASTNode*> declarations;
     
     NamespaceDeclaration(const std::string& name)
-        : name(name) {}
+        : ASTNode(NodeKind::NamespaceDeclaration), name(name) {}
     
     ~NamespaceDeclaration() {
         for (auto node : declarations) {
@@ -538,16 +940,20 @@ public:
 // Namespace access expression
 class NamespaceAccess : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::NamespaceAccess; }
+    
     std::string namespaceName;
     std::string memberName;
     
     NamespaceAccess(const std::string& namespaceName, const std::string& memberName)
-        : namespaceName(namespaceName), memberName(memberName) {}
+        : Expression(NodeKind::NamespaceAccess), namespaceName(namespaceName), memberName(memberName) {}
 };
 
 // Class declaration node
 class ClassDeclaration : public ASTNode {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ClassDeclaration; }
+    
     std::string name;
     std::string baseClassName;
     std::vector<ASTNode*> methods;
@@ -555,7 +961,7 @@ public:
     ASTNode* initMethod;
     
     ClassDeclaration(const std::string& name, const std::string& baseClassName = "")
-        : name(name), baseClassName(baseClassName), initMethod(nullptr) {}
+        : ASTNode(NodeKind::ClassDeclaration), name(name), baseClassName(baseClassName), initMethod(nullptr) {}
     
     ~ClassDeclaration() {
         for (auto method : methods) {
@@ -573,30 +979,36 @@ public:
 // Class method declaration node
 class ClassMethodDeclaration : public FunctionDeclaration {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ClassMethodDeclaration; }
+    
     std::string className;
     
     ClassMethodDeclaration(const std::string& className, const std::string& name, const std::string& returnType = "void")
-        : FunctionDeclaration(returnType, name), className(className) {}
+        : FunctionDeclaration(returnType, name, NodeKind::ClassMethodDeclaration), className(className) {}
 };
 
 // Instance method declaration node
 class InstanceMethodDeclaration : public FunctionDeclaration {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::InstanceMethodDeclaration; }
+    
     std::string className;
     
     InstanceMethodDeclaration(const std::string& className, const std::string& name, const std::string& returnType = "void")
-        : FunctionDeclaration(returnType, name), className(className) {}
+        : FunctionDeclaration(returnType, name, NodeKind::InstanceMethodDeclaration), className(className) {}
 };
 
 // Instance creation expression
 class InstanceCreationExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::InstanceCreationExpression; }
+    
     std::string namespaceName;
     std::string className;
     std::vector<Expression*> arguments;
     
     InstanceCreationExpression(const std::string& className, const std::string& namespaceName = "")
-        : className(className), namespaceName(namespaceName) {}
+        : Expression(NodeKind::InstanceCreationExpression), className(className), namespaceName(namespaceName) {}
     
     ~InstanceCreationExpression() {
         for (auto arg : arguments) {
@@ -608,11 +1020,18 @@ public:
 // Instance access expression
 class InstanceAccessExpression : public Expression {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::InstanceAccessExpression; }
+    
     Expression* instance;
     std::string memberName;
     
+    // Inline cache: the shape last seen by this access and the field's slot in it
+    Shape* cachedShape;
+    int cachedOffset;
+    
     InstanceAccessExpression(Expression* instance, const std::string& memberName)
-        : instance(instance), memberName(memberName) {}
+        : Expression(NodeKind::InstanceAccessExpression), instance(instance), memberName(memberName),
+          cachedShape(nullptr), cachedOffset(-1) {}
     
     ~InstanceAccessExpression() {
         delete instance;
@@ -622,6 +1041,8 @@ public:
 // Import statement node
 class ImportStatement : public ASTNode {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::ImportStatement; }
+    
     enum ImportType {
         NORMAL_IMPORT,
         C_IMPORT
@@ -633,7 +1054,7 @@ public:
     ImportType type;
     
     ImportStatement(const std::string& moduleName, ImportType type = NORMAL_IMPORT, int line = 1, int column = 1)
-        : ASTNode(line, column), moduleName(moduleName), type(type) {}
+        : ASTNode(NodeKind::ImportStatement, line, column), moduleName(moduleName), type(type) {}
     
     ~ImportStatement() {}
 };
@@ -641,8 +1062,18 @@ public:
 // Program node
 class Program : public ASTNode {
 public:
+    static bool isKind(NodeKind kind) { return kind == NodeKind::Program; }
+    
     std::vector<ASTNode*> declarations;
     
+    // Set once the resolver has assigned frame slots
+    bool resolved = false;
+    
+    // Set once the optimization passes have run
+    bool optimized = false;
+    
+    Program() : ASTNode(NodeKind::Program) {}
+    
     ~Program() {
         for (auto node : declarations) {
             delete node;
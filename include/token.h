@@ -62,6 +62,8 @@ enum TokenType {
     DECREMENT,
     // Power operator
     POWER,
+    // Loop label (name followed by a colon in front of a loop)
+    LABEL,
     // Control flow keywords (will be handled as KEYWORD type with specific values)
 }; 
 
@@ -1,7 +1,50 @@
 #include "code_generator.h"
 #include "../include/ast.h"
+#include "error.h"
+#include "list_ops.h"
+#include "switch_table.h"
+#include <cctype>
 #include <iostream>
 
+namespace {
+
+// Prelude helper implementing a numeric List method: sum -> listSum
+std::string listHelperName(const std::string& method) {
+    std::string name = method;
+    name[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])));
+    return "list" + name;
+}
+
+// Whether a return statement is return f(...) of the function f itself
+bool isSelfTailCall(ReturnStatement* stmt, FunctionDeclaration* func) {
+    auto call = nodeCast<FunctionCall>(stmt->expression);
+    return call && call->objectName.empty() && call->methodName == func->name
+        && call->arguments.size() == func->parameters.size();
+}
+
+// Whether a function body ends with a call to the function itself, directly or through if branches
+bool hasSelfTailCall(const std::vector<ASTNode*>& body, FunctionDeclaration* func) {
+    for (auto stmt : body) {
+        if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
+            if (isSelfTailCall(returnStmt, func)) {
+                return true;
+            }
+        } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+            if (hasSelfTailCall(ifStmt->ifBody, func) || hasSelfTailCall(ifStmt->elseBody, func)) {
+                return true;
+            }
+            for (auto elseIf : ifStmt->elseIfs) {
+                if (hasSelfTailCall(elseIf->ifBody, func)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 // Constructor
 CodeGenerator::CodeGenerator() : tempVarCounter(0) {
 }
@@ -15,11 +58,11 @@ std::string CodeGenerator::generateNamespaceDeclaration(NamespaceDeclaration* ns
     
     // Generate declarations inside namespace
     for (auto decl : ns->declarations) {
-        if (auto func = dynamic_cast<FunctionDeclaration*>(decl)) {
+        if (auto func = nodeCast<FunctionDeclaration>(decl)) {
             code += generateFunctionDeclaration(func);
-        } else if (auto nestedNs = dynamic_cast<NamespaceDeclaration*>(decl)) {
+        } else if (auto nestedNs = nodeCast<NamespaceDeclaration>(decl)) {
             code += generateNamespaceDeclaration(nestedNs);
-        } else if (auto cls = dynamic_cast<ClassDeclaration*>(decl)) {
+        } else if (auto cls = nodeCast<ClassDeclaration>(decl)) {
             code += generateClassDeclaration(cls);
         }
     }
@@ -115,7 +158,7 @@ std::string CodeGenerator::generate(Program* program) {
     std::string code;
     
     // Add header files
-    code += "#include <iostream>\n#include <string>\n#include <memory>\n#include <vector>\n#include <unordered_map>\n#include <variant>\n#include <functional>\n\n";    
+    code += "#include <iostream>\n#include <string>\n#include <memory>\n#include <vector>\n#include <unordered_map>\n#include <variant>\n#include <functional>\n#include <algorithm>\n#include <stdexcept>\n\n";    
     
     // Add helper functions for variant handling
     code += "// Helper functions for variant handling\n";
@@ -153,6 +196,20 @@ std::string CodeGenerator::generate(Program* program) {
     code += "    return os;\n";
     code += "}\n\n";
     
+    // Add helper functions for printing vectors of proven element type
+    code += "template <typename T>\n";
+    code += "std::ostream& operator<<(std::ostream& os, const std::vector<T>& vec) {\n";
+    code += "    os << '[';\n";
+    code += "    for (size_t i = 0; i < vec.size(); ++i) {\n";
+    code += "        os << vec[i];\n";
+    code += "        if (i < vec.size() - 1) {\n";
+    code += "            os << \", \";\n";
+    code += "        }\n";
+    code += "    }\n";
+    code += "    os << ']';\n";
+    code += "    return os;\n";
+    code += "}\n\n";
+    
     // Add helper functions for printing vectors of strings
     code += "std::ostream& operator<<(std::ostream& os, const std::vector<std::string>& vec) {\n";
     code += "    os << '[';\n";
@@ -207,6 +264,11 @@ code += "void listAdd(std::vector<std::variant<int, std::string, bool>>& list, b
 code += "    list.push_back(value);\n";
 code += "}\n\n";
 
+code += "template <typename T>\n";
+code += "void listAdd(std::vector<T>& list, const T& value) {\n";
+code += "    list.push_back(value);\n";
+code += "}\n\n";
+
 // Overloaded get functions for different types with negative index support
 // String indexing
 code += "char get(const std::string& str, int index) {\n";
@@ -230,6 +292,17 @@ code += "    }\n";
 code += "    return list[index];\n";
 code += "}\n\n";
 
+code += "template <typename T>\n";
+code += "T get(const std::vector<T>& list, int index) {\n";
+code += "    if (index < 0) {\n";
+code += "        index = list.size() + index;\n";
+code += "    }\n";
+code += "    if (index < 0 || index >= list.size()) {\n";
+code += "        throw std::out_of_range(\"List index out of range\");\n";
+code += "    }\n";
+code += "    return list[index];\n";
+code += "}\n\n";
+
 // HashMap access
 code += "std::variant<int, std::string, bool> get(const std::unordered_map<std::string, std::variant<int, std::string, bool>>& map, const std::string& key) {\n";
 code += "    auto it = map.find(key);\n";
@@ -255,6 +328,10 @@ code += "}\n\n";
     code += "    return keys;\n";
     code += "}\n\n";
     
+    code += "bool mapRemove(std::unordered_map<std::string, std::variant<int, std::string, bool>>& map, const std::string& key) {\n";
+    code += "    return map.erase(key) > 0;\n";
+    code += "}\n\n";
+    
     code += "std::vector<std::variant<int, std::string, bool>> mapValues(const std::unordered_map<std::string, std::variant<int, std::string, bool>>& map) {\n";
     code += "    std::vector<std::variant<int, std::string, bool>> values;\n";
     code += "    for (const auto& pair : map) {\n";
@@ -263,6 +340,161 @@ code += "}\n\n";
     code += "    return values;\n";
     code += "}\n\n";
     
+    // Add StringBuilder implementation (appends in amortized O(1) instead of copying the string)
+    code += "// StringBuilder implementation\n";
+    code += "class VanctionStringBuilder {\n";
+    code += "public:\n";
+    code += "    std::string buffer;\n";
+    code += "    \n";
+    code += "    VanctionStringBuilder& append(const std::string& value) { buffer += value; return *this; }\n";
+    code += "    VanctionStringBuilder& append(const char* value) { buffer += value; return *this; }\n";
+    code += "    VanctionStringBuilder& append(char value) { buffer += value; return *this; }\n";
+    code += "    VanctionStringBuilder& append(bool value) { buffer += value ? \"true\" : \"false\"; return *this; }\n";
+    code += "    VanctionStringBuilder& append(int value) { buffer += std::to_string(value); return *this; }\n";
+    code += "    VanctionStringBuilder& append(float value) { buffer += std::to_string(value); return *this; }\n";
+    code += "    VanctionStringBuilder& append(double value) { buffer += std::to_string(value); return *this; }\n";
+    code += "    VanctionStringBuilder& append(const std::variant<int, std::string, bool>& value) { buffer += variantToString(value); return *this; }\n";
+    code += "    \n";
+    code += "    // sb.append(a, b, ...) appends every argument in order\n";
+    code += "    template <typename First, typename Second, typename... Rest>\n";
+    code += "    VanctionStringBuilder& append(const First& first, const Second& second, const Rest&... rest) {\n";
+    code += "        append(first);\n";
+    code += "        return append(second, rest...);\n";
+    code += "    }\n";
+    code += "    \n";
+    code += "    std::string toString() const { return buffer; }\n";
+    code += "    int length() const { return static_cast<int>(buffer.size()); }\n";
+    code += "    void clear() { buffer.clear(); }\n";
+    code += "};\n\n";
+    
+    code += "std::shared_ptr<VanctionStringBuilder> StringBuilder() {\n";
+    code += "    return std::make_shared<VanctionStringBuilder>();\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "std::shared_ptr<VanctionStringBuilder> StringBuilder(const T& initial) {\n";
+    code += "    auto builder = std::make_shared<VanctionStringBuilder>();\n";
+    code += "    builder->append(initial);\n";
+    code += "    return builder;\n";
+    code += "}\n\n";
+    
+    code += "std::ostream& operator<<(std::ostream& os, const std::shared_ptr<VanctionStringBuilder>& builder) {\n";
+    code += "    os << builder->buffer;\n";
+    code += "    return os;\n";
+    code += "}\n\n";
+    
+    // Add format string helper: f"..." becomes formatString(text, variable, text, ...)
+    code += "template <typename... Parts>\n";
+    code += "std::string formatString(const Parts&... parts) {\n";
+    code += "    VanctionStringBuilder builder;\n";
+    code += "    (builder.append(parts), ...);\n";
+    code += "    return builder.buffer;\n";
+    code += "}\n\n";
+    
+    // Add numeric list helpers (the interpreter's List.sum(), List.scale(), ... on int lists)
+    // They take any element type, so typed int lists use them as well
+    code += "int listNumber(const std::variant<int, std::string, bool>& value) {\n";
+    code += "    return std::get<int>(value);\n";
+    code += "}\n\n";
+    
+    code += "int listNumber(int value) {\n";
+    code += "    return value;\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "int listSum(const std::vector<T>& list) {\n";
+    code += "    long long total = 0;\n";
+    code += "    for (const auto& value : list) total += listNumber(value);\n";
+    code += "    return static_cast<int>(total);\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "int listMin(const std::vector<T>& list) {\n";
+    code += "    if (list.empty()) throw std::runtime_error(\"List.min() of an empty list\");\n";
+    code += "    int result = listNumber(list[0]);\n";
+    code += "    for (const auto& value : list) result = std::min(result, listNumber(value));\n";
+    code += "    return result;\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "int listMax(const std::vector<T>& list) {\n";
+    code += "    if (list.empty()) throw std::runtime_error(\"List.max() of an empty list\");\n";
+    code += "    int result = listNumber(list[0]);\n";
+    code += "    for (const auto& value : list) result = std::max(result, listNumber(value));\n";
+    code += "    return result;\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "double listMean(const std::vector<T>& list) {\n";
+    code += "    if (list.empty()) throw std::runtime_error(\"List.mean() of an empty list\");\n";
+    code += "    long long total = 0;\n";
+    code += "    for (const auto& value : list) total += listNumber(value);\n";
+    code += "    return static_cast<double>(total) / list.size();\n";
+    code += "}\n\n";
+    
+    code += "template <typename L, typename R>\n";
+    code += "int listDot(const std::vector<L>& left, const std::vector<R>& right) {\n";
+    code += "    if (left.size() != right.size()) throw std::runtime_error(\"List.dot() expects lists of the same length\");\n";
+    code += "    long long total = 0;\n";
+    code += "    for (size_t i = 0; i < left.size(); ++i) total += static_cast<long long>(listNumber(left[i])) * listNumber(right[i]);\n";
+    code += "    return static_cast<int>(total);\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "std::vector<std::variant<int, std::string, bool>> listScale(const std::vector<T>& list, int factor) {\n";
+    code += "    std::vector<std::variant<int, std::string, bool>> result;\n";
+    code += "    result.reserve(list.size());\n";
+    code += "    for (const auto& value : list) result.push_back(listNumber(value) * factor);\n";
+    code += "    return result;\n";
+    code += "}\n\n";
+    
+    code += "template <typename L, typename R>\n";
+    code += "std::vector<std::variant<int, std::string, bool>> listPlus(const std::vector<L>& left, const std::vector<R>& right) {\n";
+    code += "    if (left.size() != right.size()) throw std::runtime_error(\"List.plus() expects lists of the same length\");\n";
+    code += "    std::vector<std::variant<int, std::string, bool>> result;\n";
+    code += "    result.reserve(left.size());\n";
+    code += "    for (size_t i = 0; i < left.size(); ++i) result.push_back(listNumber(left[i]) + listNumber(right[i]));\n";
+    code += "    return result;\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "std::vector<std::variant<int, std::string, bool>> listClamp(const std::vector<T>& list, int low, int high) {\n";
+    code += "    if (low > high) throw std::runtime_error(\"List.clamp() expects low <= high\");\n";
+    code += "    std::vector<std::variant<int, std::string, bool>> result;\n";
+    code += "    result.reserve(list.size());\n";
+    code += "    for (const auto& value : list) result.push_back(std::min(std::max(listNumber(value), low), high));\n";
+    code += "    return result;\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "int listCount(const std::vector<T>& list, const std::string& op, int number) {\n";
+    code += "    int result = 0;\n";
+    code += "    for (const auto& value : list) {\n";
+    code += "        int element = listNumber(value);\n";
+    code += "        if (op == \"<\") result += element < number;\n";
+    code += "        else if (op == \"<=\") result += element <= number;\n";
+    code += "        else if (op == \">\") result += element > number;\n";
+    code += "        else if (op == \">=\") result += element >= number;\n";
+    code += "        else if (op == \"==\") result += element == number;\n";
+    code += "        else if (op == \"!=\") result += element != number;\n";
+    code += "        else throw std::runtime_error(\"List.count() got an unknown operator: \" + op);\n";
+    code += "    }\n";
+    code += "    return result;\n";
+    code += "}\n\n";
+    
+    code += "template <typename T>\n";
+    code += "int listCount(const std::vector<T>& list, int number) {\n";
+    code += "    return listCount(list, \"==\", number);\n";
+    code += "}\n\n";
+    
+    // Objects with methods of the same names keep their own implementation
+    for (const char* method : {"sum", "min", "max", "mean", "dot", "scale", "plus", "clamp", "count"}) {
+        code += "template <typename T, typename... Args>\n";
+        code += "auto " + listHelperName(method) + "(const std::shared_ptr<T>& object, Args&&... args) {\n";
+        code += "    return object->" + std::string(method) + "(std::forward<Args>(args)...);\n";
+        code += "}\n\n";
+    }
+    
     // Add range generator implementation
     code += "// Range generator implementation\n";
     code += "class RangeGenerator {\n";
@@ -340,13 +572,13 @@ code += "}\n\n";
     
     // Generate all declarations
     for (auto decl : program->declarations) {
-        if (auto func = dynamic_cast<FunctionDeclaration*>(decl)) {
+        if (auto func = nodeCast<FunctionDeclaration>(decl)) {
             code += generateFunctionDeclaration(func);
-        } else if (auto ns = dynamic_cast<NamespaceDeclaration*>(decl)) {
+        } else if (auto ns = nodeCast<NamespaceDeclaration>(decl)) {
             code += generateNamespaceDeclaration(ns);
-        } else if (auto cls = dynamic_cast<ClassDeclaration*>(decl)) {
+        } else if (auto cls = nodeCast<ClassDeclaration>(decl)) {
             code += generateClassDeclaration(cls);
-        } else if (auto importStmt = dynamic_cast<ImportStatement*>(decl)) {
+        } else if (auto importStmt = nodeCast<ImportStatement>(decl)) {
             code += generateImportStatement(importStmt);
         }
     }
@@ -358,6 +590,12 @@ code += "}\n\n";
 std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func) {
     std::string code;
     
+    // Only the parameters and variables of this function fill format string placeholders
+    declaredVariables.clear();
+    for (const auto& param : func->parameters) {
+        declaredVariables.insert(param.name);
+    }
+    
     // Generate function signature
     if (func->name == "main") {
         code += "int main() {\n";
@@ -402,13 +640,13 @@ std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func
     } else {
         for (auto stmt : func->body) {
             // Check if this is a return statement that returns an identifier
-            if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
+            if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
                 if (returnStmt->expression) {
                     // Check if returning an identifier that might be a nested function
-                    if (auto ident = dynamic_cast<Identifier*>(returnStmt->expression)) {
+                    if (auto ident = nodeCast<Identifier>(returnStmt->expression)) {
                         // Check if there's a nested function with this name
                         for (auto innerStmt : func->body) {
-                            if (auto nestedFunc = dynamic_cast<FunctionDeclaration*>(innerStmt)) {
+                            if (auto nestedFunc = nodeCast<FunctionDeclaration>(innerStmt)) {
                                 if (nestedFunc->name == ident->name) {
                                     returnsNestedFunction = true;
                                     break;
@@ -417,7 +655,7 @@ std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func
                         }
                     }
                     // Check if directly returning a function declaration
-                    if (dynamic_cast<FunctionDeclaration*>(returnStmt->expression)) {
+                    if (nodeCast<FunctionDeclaration>(returnStmt->expression)) {
                         returnsNestedFunction = true;
                     }
                 }
@@ -433,48 +671,51 @@ std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func
         }
     }
     
+    // Self tail calls jump back here with the parameters updated, so deep recursion uses constant stack
+    tailCallFunction = nullptr;
+    if (func->name != "main" && !returnsNestedFunction && hasSelfTailCall(func->body, func)) {
+        tailCallFunction = func;
+        code += "tail_call:\n";
+    }
+    
     // Generate function body statements
     for (auto stmt : func->body) {
-        if (auto comment = dynamic_cast<Comment*>(stmt)) {
+        if (auto comment = nodeCast<Comment>(stmt)) {
             code += generateComment(comment);
-        } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(stmt)) {
+        } else if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
             code += generateExpressionStatement(exprStmt);
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(stmt)) {
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
             code += generateVariableDeclaration(varDecl, returnsNestedFunction);
-        } else if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+        } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
             code += generateIfStatement(ifStmt);
-        } else if (auto forStmt = dynamic_cast<ForLoopStatement*>(stmt)) {
+        } else if (auto forStmt = nodeCast<ForLoopStatement>(stmt)) {
             code += generateForLoopStatement(forStmt);
-        } else if (auto forInStmt = dynamic_cast<ForInLoopStatement*>(stmt)) {
+        } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
             code += generateForInLoopStatement(forInStmt);
-        } else if (auto whileStmt = dynamic_cast<WhileLoopStatement*>(stmt)) {
+        } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
             code += generateWhileLoopStatement(whileStmt);
-        } else if (auto doWhileStmt = dynamic_cast<DoWhileLoopStatement*>(stmt)) {
+        } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
             code += generateDoWhileLoopStatement(doWhileStmt);
-        } else if (auto switchStmt = dynamic_cast<SwitchStatement*>(stmt)) {
+        } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
             code += generateSwitchStatement(switchStmt);
-        } else if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
-        code += "    return";
-        if (returnStmt->expression) {
+        } else if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
             // Check if returning a nested function - need to wrap captured variables
-            if (auto nestedFunc = dynamic_cast<FunctionDeclaration*>(returnStmt->expression)) {
+            if (auto nestedFunc = nodeCast<FunctionDeclaration>(returnStmt->expression)) {
                 // Return the nested function - captured variables are already wrapped
-                code += " " + nestedFunc->name;
+                code += "    return " + nestedFunc->name + ";\n";
             } else {
-                code += " " + generateExpression(returnStmt->expression, false);
+                code += generateReturnStatement(returnStmt);
             }
-        }
-        code += ";\n";
-        } else if (auto nestedFunc = dynamic_cast<FunctionDeclaration*>(stmt)) {
+        } else if (auto nestedFunc = nodeCast<FunctionDeclaration>(stmt)) {
             // Generate nested function as a lambda stored in a variable
             // C++ doesn't support direct nested functions, so we convert to lambdas
             // Use [=] to capture parameters by value (avoid dangling references)
             // Variables wrapped in shared_ptr can be accessed through their reference aliases
             code += "    auto " + nestedFunc->name + " = [=]() -> auto {\n";
             for (auto bodyStmt : nestedFunc->body) {
-                if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
+                if (auto comment = nodeCast<Comment>(bodyStmt)) {
                     code += "        " + generateComment(comment);
-                } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
+                } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
                     // Generate expression statement for nested function
                     std::string stmtCode = generateExpressionStatement(exprStmt, true).substr(4);
                     
@@ -499,7 +740,7 @@ std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func
                     }
                     // Then replace outer variable declarations
                     for (auto outerStmt : func->body) {
-                        if (auto outerVarDecl = dynamic_cast<VariableDeclaration*>(outerStmt)) {
+                        if (auto outerVarDecl = nodeCast<VariableDeclaration>(outerStmt)) {
                             std::string varName = outerVarDecl->name;
                             size_t pos = 0;
                             while ((pos = stmtCode.find(varName, pos)) != std::string::npos) {
@@ -518,9 +759,9 @@ std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func
                     }
                     
                     code += "        " + stmtCode;
-                } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
+                } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
                     code += "        " + generateVariableDeclaration(varDecl, false);
-                } else if (auto returnStmt = dynamic_cast<ReturnStatement*>(bodyStmt)) {
+                } else if (auto returnStmt = nodeCast<ReturnStatement>(bodyStmt)) {
                     code += "        return";
                     if (returnStmt->expression) {
                         // Generate the return expression
@@ -546,10 +787,10 @@ std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func
                         }
                         
                         // Check if this is an assignment to a wrapped variable
-                        if (auto assignExpr = dynamic_cast<AssignmentExpression*>(returnStmt->expression)) {
+                        if (auto assignExpr = nodeCast<AssignmentExpression>(returnStmt->expression)) {
                             // For assignment expressions, just return the expression
                             code += " " + exprCode;
-                        } else if (auto ident = dynamic_cast<Identifier*>(returnStmt->expression)) {
+                        } else if (auto ident = nodeCast<Identifier>(returnStmt->expression)) {
                             // For identifier returns, check if it's a closure variable and return *var_ptr instead
                             code += " " + exprCode;
                         } else {
@@ -570,13 +811,39 @@ std::string CodeGenerator::generateFunctionDeclaration(FunctionDeclaration* func
     
     // Generate function end
     code += "}\n\n";
+    tailCallFunction = nullptr;
+    
+    return code;
+}
+
+// Generate return statement
+std::string CodeGenerator::generateReturnStatement(ReturnStatement* stmt) {
+    if (tailCallFunction && isSelfTailCall(stmt, tailCallFunction)) {
+        // Evaluate every argument before any parameter changes, then start over
+        auto call = static_cast<FunctionCall*>(stmt->expression);
+        std::string code = "    {\n";
+        for (size_t i = 0; i < call->arguments.size(); ++i) {
+            code += "        auto tail_arg" + std::to_string(i) + " = " + generateExpression(call->arguments[i], false) + ";\n";
+        }
+        for (size_t i = 0; i < call->arguments.size(); ++i) {
+            code += "        " + tailCallFunction->parameters[i].name + " = tail_arg" + std::to_string(i) + ";\n";
+        }
+        code += "        goto tail_call;\n";
+        code += "    }\n";
+        return code;
+    }
     
+    std::string code = "    return";
+    if (stmt->expression) {
+        code += " " + generateExpression(stmt->expression, false);
+    }
+    code += ";\n";
     return code;
 }
 
 // Generate expression statement
 std::string CodeGenerator::generateExpressionStatement(ExpressionStatement* stmt, bool isNested) {
-    if (auto funcCall = dynamic_cast<FunctionCall*>(stmt->expression)) {
+    if (auto funcCall = nodeCast<FunctionCall>(stmt->expression)) {
         if ((funcCall->objectName == "System" && funcCall->methodName == "print") ||
             (funcCall->objectName == "System" && funcCall->methodName == "input")) {
             // For System.print and System.input, generate the statement without adding semicolon
@@ -584,10 +851,10 @@ std::string CodeGenerator::generateExpressionStatement(ExpressionStatement* stmt
             return "    " + generateExpression(stmt->expression, false) + ";\n";
         }
     }
-    if (auto assignExpr = dynamic_cast<AssignmentExpression*>(stmt->expression)) {
-        if (auto ident = dynamic_cast<Identifier*>(assignExpr->left)) {
+    if (auto assignExpr = nodeCast<AssignmentExpression>(stmt->expression)) {
+        if (auto ident = nodeCast<Identifier>(assignExpr->left)) {
             // Only generate auto declaration for instance creation expressions
-            if (dynamic_cast<InstanceCreationExpression*>(assignExpr->right)) {
+            if (nodeCast<InstanceCreationExpression>(assignExpr->right)) {
                 return "    auto " + generateExpression(assignExpr, false) + ";\n";
             }
         }
@@ -599,6 +866,15 @@ std::string CodeGenerator::generateExpressionStatement(ExpressionStatement* stmt
 std::string CodeGenerator::generateVariableDeclaration(VariableDeclaration* varDecl, bool useSharedPtr) {
     std::string code = "    ";
     
+    // Lists type inference proved to hold only ints become plain int vectors
+    auto listLit = nodeCast<ListLiteral>(varDecl->initializer);
+    if (listLit && varDecl->elementType == StaticType::Int && !varDecl->isDefine && !useSharedPtr) {
+        code += varDecl->isImmut ? "const std::vector<int> " : "std::vector<int> ";
+        code += varDecl->name + " = " + generateListLiteral(listLit, "int") + ";\n";
+        declaredVariables.insert(varDecl->name);
+        return code;
+    }
+    
     // Check for immut (constant)
     if (varDecl->isImmut) {
         code += "const auto " + varDecl->name;
@@ -659,6 +935,8 @@ std::string CodeGenerator::generateVariableDeclaration(VariableDeclaration* varD
         code += ";\n";
     }
     
+    // Declared after the initializer, which cannot read the variable yet
+    declaredVariables.insert(varDecl->name);
     return code;
 }
 
@@ -669,77 +947,89 @@ std::string CodeGenerator::generateNamespaceAccess(NamespaceAccess* access) {
 
 // Generate expression
 std::string CodeGenerator::generateExpression(Expression* expr, bool isLvalue) {
-    if (auto ident = dynamic_cast<Identifier*>(expr)) {
-        return generateIdentifier(ident);
-    } else if (auto nsAccess = dynamic_cast<NamespaceAccess*>(expr)) {
-        return generateNamespaceAccess(nsAccess);
-    } else if (auto intLit = dynamic_cast<IntegerLiteral*>(expr)) {
-        return generateIntegerLiteral(intLit);
-    } else if (auto floatLit = dynamic_cast<FloatLiteral*>(expr)) {
-        return generateFloatLiteral(floatLit);
-    } else if (auto doubleLit = dynamic_cast<DoubleLiteral*>(expr)) {
-        return generateDoubleLiteral(doubleLit);
-    } else if (auto charLit = dynamic_cast<CharLiteral*>(expr)) {
-        return generateCharLiteral(charLit);
-    } else if (auto stringLiteral = dynamic_cast<StringLiteral*>(expr)) {
-        return generateStringLiteral(stringLiteral);
-    } else if (auto boolLit = dynamic_cast<BooleanLiteral*>(expr)) {
-        return generateBooleanLiteral(boolLit);
-    } else if (auto binaryExpr = dynamic_cast<BinaryExpression*>(expr)) {
-        return generateBinaryExpression(binaryExpr, isLvalue);
-    } else if (auto assignExpr = dynamic_cast<AssignmentExpression*>(expr)) {
-        return generateAssignmentExpression(assignExpr);
-    } else if (auto funcCall = dynamic_cast<FunctionCall*>(expr)) {
-        return generateFunctionCall(funcCall);
-    } else if (auto instanceCreate = dynamic_cast<InstanceCreationExpression*>(expr)) {
-        return generateInstanceCreationExpression(instanceCreate);
-    } else if (auto instanceAccess = dynamic_cast<InstanceAccessExpression*>(expr)) {
-        return generateInstanceAccessExpression(instanceAccess);
-    } else if (auto listLit = dynamic_cast<ListLiteral*>(expr)) {
-        return generateListLiteral(listLit);
-    } else if (auto hashMapLit = dynamic_cast<HashMapLiteral*>(expr)) {
-        return generateHashMapLiteral(hashMapLit);
-    } else if (auto rangeExpr = dynamic_cast<RangeExpression*>(expr)) {
-        return generateRangeExpression(rangeExpr);
-    } else if (auto lambdaExpr = dynamic_cast<LambdaExpression*>(expr)) {
-        return generateLambdaExpression(lambdaExpr);
-    } else if (auto funcCallExpr = dynamic_cast<FunctionCallExpression*>(expr)) {
-        // Generate function call expression, e.g., (lambda (a,b)->a+b)(1,2)
-        std::string code = "(" + generateExpression(funcCallExpr->callee, false) + ")(";
-        
-        // Generate arguments
-        for (size_t i = 0; i < funcCallExpr->arguments.size(); i++) {
-            if (i > 0) {
-                code += ", ";
+    if (!expr) {
+        return "\"\"";
+    }
+    
+    switch (expr->kind) {
+        case NodeKind::Identifier:
+            return generateIdentifier(static_cast<Identifier*>(expr));
+        case NodeKind::NamespaceAccess:
+            return generateNamespaceAccess(static_cast<NamespaceAccess*>(expr));
+        case NodeKind::IntegerLiteral:
+            return generateIntegerLiteral(static_cast<IntegerLiteral*>(expr));
+        case NodeKind::FloatLiteral:
+            return generateFloatLiteral(static_cast<FloatLiteral*>(expr));
+        case NodeKind::DoubleLiteral:
+            return generateDoubleLiteral(static_cast<DoubleLiteral*>(expr));
+        case NodeKind::CharLiteral:
+            return generateCharLiteral(static_cast<CharLiteral*>(expr));
+        case NodeKind::StringLiteral:
+            return generateStringLiteral(static_cast<StringLiteral*>(expr));
+        case NodeKind::BooleanLiteral:
+            return generateBooleanLiteral(static_cast<BooleanLiteral*>(expr));
+        case NodeKind::BinaryExpression:
+            return generateBinaryExpression(static_cast<BinaryExpression*>(expr), isLvalue);
+        case NodeKind::AssignmentExpression:
+            return generateAssignmentExpression(static_cast<AssignmentExpression*>(expr));
+        case NodeKind::FunctionCall:
+            return generateFunctionCall(static_cast<FunctionCall*>(expr));
+        case NodeKind::InstanceCreationExpression:
+            return generateInstanceCreationExpression(static_cast<InstanceCreationExpression*>(expr));
+        case NodeKind::InstanceAccessExpression:
+            return generateInstanceAccessExpression(static_cast<InstanceAccessExpression*>(expr));
+        case NodeKind::ListLiteral:
+            return generateListLiteral(static_cast<ListLiteral*>(expr));
+        case NodeKind::HashMapLiteral:
+            return generateHashMapLiteral(static_cast<HashMapLiteral*>(expr));
+        case NodeKind::RangeExpression:
+            return generateRangeExpression(static_cast<RangeExpression*>(expr));
+        case NodeKind::LambdaExpression:
+            return generateLambdaExpression(static_cast<LambdaExpression*>(expr));
+        case NodeKind::FunctionCallExpression: {
+            auto funcCallExpr = static_cast<FunctionCallExpression*>(expr);
+            // Generate function call expression, e.g., (lambda (a,b)->a+b)(1,2)
+            std::string code = "(" + generateExpression(funcCallExpr->callee, false) + ")(";
+            
+            // Generate arguments
+            for (size_t i = 0; i < funcCallExpr->arguments.size(); i++) {
+                if (i > 0) {
+                    code += ", ";
+                }
+                code += generateExpression(funcCallExpr->arguments[i], false);
             }
-            code += generateExpression(funcCallExpr->arguments[i], false);
+            
+            code += ")";
+            return code;
         }
-        
-        code += ")";
-        return code;
-    } else if (auto indexAccess = dynamic_cast<IndexAccessExpression*>(expr)) {
-        // Generate index access expression, e.g., collection[index]
-        std::string collectionCode = generateExpression(indexAccess->collection, true);
-        std::string indexCode = generateExpression(indexAccess->index, false);
-        
-        if (isLvalue) {
-            // For lvalue (assignment), we can't use get() because it returns a copy
-            // Handle map access with string keys differently from list/string access with numeric indices
-            if (auto stringLit = dynamic_cast<StringLiteral*>(indexAccess->index)) {
-                // Map access with string literal key - use direct [] operator
-                return collectionCode + "[" + indexCode + "]";
+        case NodeKind::IndexAccessExpression: {
+            auto indexAccess = static_cast<IndexAccessExpression*>(expr);
+            // Generate index access expression, e.g., collection[index]
+            std::string collectionCode = generateExpression(indexAccess->collection, true);
+            std::string indexCode = generateExpression(indexAccess->index, false);
+            
+            if (isLvalue) {
+                // For lvalue (assignment), we can't use get() because it returns a copy
+                // Handle map access with string keys differently from list/string access with numeric indices
+                if (auto stringLit = nodeCast<StringLiteral>(indexAccess->index)) {
+                    // Map access with string literal key - use direct [] operator
+                    return collectionCode + "[" + indexCode + "]";
+                } else {
+                    // List or string access with numeric index - generate code to handle negative indices
+                    // Create a temporary variable for the index to handle negative values
+                    std::string tempIndex = "temp_index_" + std::to_string(tempVarCounter++);
+                    return "(int " + tempIndex + " = " + indexCode + "; " + 
+                           "if (" + tempIndex + " < 0) " + tempIndex + " += " + collectionCode + ".size(); " + 
+                           collectionCode + "[" + tempIndex + "])";
+                }
             } else {
-                // List or string access with numeric index - generate code to handle negative indices
-                // Create a temporary variable for the index to handle negative values
-                std::string tempIndex = "temp_index_" + std::to_string(tempVarCounter++);
-                return "(int " + tempIndex + " = " + indexCode + "; " + 
-                       "if (" + tempIndex + " < 0) " + tempIndex + " += " + collectionCode + ".size(); " + 
-                       collectionCode + "[" + tempIndex + "])";
+                // For rvalue (reading), use get() function to handle negative indices correctly
+                return "get(" + collectionCode + ", " + indexCode + ")";
             }
-        } else {
-            // For rvalue (reading), use get() function to handle negative indices correctly
-            return "get(" + collectionCode + ", " + indexCode + ")";
+            break;
         }
+        default:
+            break;
     }
     return "\"\""; // Return empty string instead of comment to avoid compilation errors
 }
@@ -759,53 +1049,80 @@ std::string CodeGenerator::generateCharLiteral(CharLiteral* literal) {
     return "'" + std::string(1, literal->value) + "'";
 }
 
+namespace {
+
+// Quote text as a C++ string literal, escaping newlines, quotes and stray backslashes
+std::string quoteStringLiteral(const std::string& value) {
+    std::string escaped = value;
+    
+    size_t pos = 0;
+    while (pos < escaped.length()) {
+        if (escaped[pos] == '\n') {
+            // Escape newline
+            escaped.replace(pos, 1, "\\n");
+            pos += 2;
+        } else if (escaped[pos] == '"') {
+            // Escape double quote
+            escaped.replace(pos, 1, "\\\"");
+            pos += 2;
+        } else if (escaped[pos] == '\\') {
+            // Check if this is already a valid escape sequence
+            if (pos + 1 < escaped.length()) {
+                char nextChar = escaped[pos + 1];
+                // Valid escape sequences: \n, \t, \\, \" 
+                if (nextChar == 'n' || nextChar == 't' || nextChar == '\\' || nextChar == '"') {
+                    // Already valid, keep it
+                    pos += 2;
+                } else {
+                    // Invalid escape sequence, escape the backslash
+                    escaped.replace(pos, 1, "\\\\");
+                    pos += 2;
+                }
+            } else {
+                // Trailing backslash, escape it
+                escaped.replace(pos, 1, "\\\\");
+                pos += 2;
+            }
+        } else {
+            // Normal character, move on
+            pos++;
+        }
+    }
+    
+    return '"' + escaped + '"';
+}
+
+} // namespace
+
 // Generate string literal
 std::string CodeGenerator::generateStringLiteral(StringLiteral* literal) {
     if (literal->type == "raw") {
         // Generate C++ raw string literal: R"vanction()vanction"
         return "R\"vanction(" + literal->value + ")vanction\"";
     } else if (literal->type == "format") {
-        // Generate C++ formatted string using std::format
-        return "\"" + literal->value + "\"";
-    } else {
-        // Normal string literal with proper escaping
-        std::string escaped = literal->value;
-        
-        size_t pos = 0;
-        while (pos < escaped.length()) {
-            if (escaped[pos] == '\n') {
-                // Escape newline
-                escaped.replace(pos, 1, "\\n");
-                pos += 2;
-            } else if (escaped[pos] == '"') {
-                // Escape double quote
-                escaped.replace(pos, 1, "\\\"");
-                pos += 2;
-            } else if (escaped[pos] == '\\') {
-                // Check if this is already a valid escape sequence
-                if (pos + 1 < escaped.length()) {
-                    char nextChar = escaped[pos + 1];
-                    // Valid escape sequences: \n, \t, \\, \" 
-                    if (nextChar == 'n' || nextChar == 't' || nextChar == '\\' || nextChar == '"') {
-                        // Already valid, keep it
-                        pos += 2;
-                    } else {
-                        // Invalid escape sequence, escape the backslash
-                        escaped.replace(pos, 1, "\\\\");
-                        pos += 2;
-                    }
-                } else {
-                    // Trailing backslash, escape it
-                    escaped.replace(pos, 1, "\\\\");
-                    pos += 2;
-                }
-            } else {
-                // Normal character, move on
-                pos++;
+        // Generate a formatString(...) call from the segments compiled by the parser
+        if (literal->segments.size() <= 1) {
+            return quoteStringLiteral(literal->value);
+        }
+        std::string code = "formatString(";
+        bool first = true;
+        for (const auto& segment : literal->segments) {
+            if (!segment.text.empty()) {
+                code += (first ? "" : ", ") + quoteStringLiteral(segment.text);
+                first = false;
+            }
+            if (segment.variable) {
+                // Empty placeholders and names no generated variable or parameter has read as undefined
+                const std::string& name = segment.variable->name;
+                code += (first ? "" : ", ") + (declaredVariables.count(name) ? name : quoteStringLiteral("undefined"));
+                first = false;
             }
         }
-        
-        return '"' + escaped + '"';
+        code += ")";
+        return code;
+    } else {
+        // Normal string literal with proper escaping
+        return quoteStringLiteral(literal->value);
     }
 }
 
@@ -826,71 +1143,58 @@ std::string CodeGenerator::generateDoubleLiteral(DoubleLiteral* literal) {
 
 // Generate binary expression
 std::string CodeGenerator::generateBinaryExpression(BinaryExpression* expr, bool isLvalue) {
-    std::string op = expr->op;
+    const std::string& op = expr->op;
     
     // For regular binary operators, left and right are rvalues
     // For [] operator, left is lvalue if we're writing to it
-    bool leftIsLvalue = (op == "[" && isLvalue);
+    bool leftIsLvalue = (expr->opcode == BinaryOperator::Index && isLvalue);
     std::string left = generateExpression(expr->left, leftIsLvalue);
     std::string right = generateExpression(expr->right, false);
     
     // Handle different operators
-    if (op == "+") {
-        // Special handling for string concatenation
-        // Check if either operand is a string literal
-        bool leftIsStringLiteral = (dynamic_cast<StringLiteral*>(expr->left) != nullptr);
-        bool rightIsStringLiteral = (dynamic_cast<StringLiteral*>(expr->right) != nullptr);
-        
-        // If we're dealing with string concatenation, ensure proper std::string usage
-        if (leftIsStringLiteral || rightIsStringLiteral) {
-            // For string literals combined with other string types, wrap in std::string
-            return "std::string(" + left + ") + " + right;
-        }
-        return left + " + " + right;
-    } else if (op == "-") {
-        return left + " - " + right;
-    } else if (op == "*") {
-        return left + " * " + right;
-    } else if (op == "/") {
-        return left + " / " + right;
-    } else if (op == "%") {
-        return left + " % " + right;
-    } else if (op == "<<") {
-        return left + " << " + right;
-    } else if (op == ">>") {
-        return left + " >> " + right;
-    } else if (op == "AND") {
-        return left + " && " + right;
-    } else if (op == "OR") {
-        return left + " || " + right;
-    } else if (op == "XOR") {
-        return left + " ^ " + right;
-    } else if (op == "&" || op == "BITWISE_AND") {
-        return left + " & " + right;
-    } else if (op == "|" || op == "BITWISE_OR") {
-        return left + " | " + right;
-    } else if (op == "==") {
-        return left + " == " + right;
-    } else if (op == "!=") {
-        return left + " != " + right;
-    } else if (op == "<") {
-        return left + " < " + right;
-    } else if (op == "<=") {
-        return left + " <= " + right;
-    } else if (op == ">") {
-        return left + " > " + right;
-    } else if (op == ">=") {
-        return left + " >= " + right;
-    } else if (op == "[") {
-        // Handle array indexing based on lvalue context
-        if (isLvalue) {
-            // Writing to index - need to handle negative indices manually
-            // For negative indices, we'll generate code that converts to positive
-            return left + "[" + right + "]";
-        } else {
-            // Reading from index - always use overloaded get function to handle negative indices
-            return "get(" + left + ", " + right + ")";
+    switch (expr->opcode) {
+        case BinaryOperator::Add: {
+            // Special handling for string concatenation
+            // Check if either operand is a string literal
+            bool leftIsStringLiteral = (nodeCast<StringLiteral>(expr->left) != nullptr);
+            bool rightIsStringLiteral = (nodeCast<StringLiteral>(expr->right) != nullptr);
+            
+            // If we're dealing with string concatenation, ensure proper std::string usage
+            if (leftIsStringLiteral || rightIsStringLiteral) {
+                // For string literals combined with other string types, wrap in std::string
+                return "std::string(" + left + ") + " + right;
+            }
+            return left + " + " + right;
         }
+        case BinaryOperator::Subtract:
+        case BinaryOperator::Multiply:
+        case BinaryOperator::Divide:
+        case BinaryOperator::Modulo:
+        case BinaryOperator::ShiftLeft:
+        case BinaryOperator::ShiftRight:
+        case BinaryOperator::And:
+        case BinaryOperator::Or:
+        case BinaryOperator::Xor:
+        case BinaryOperator::Equal:
+        case BinaryOperator::NotEqual:
+        case BinaryOperator::Less:
+        case BinaryOperator::LessEqual:
+        case BinaryOperator::Greater:
+        case BinaryOperator::GreaterEqual:
+            // Same spelling in C++
+            return left + " " + op + " " + right;
+        case BinaryOperator::Index:
+            // Handle array indexing based on lvalue context
+            if (isLvalue) {
+                // Writing to index - need to handle negative indices manually
+                // For negative indices, we'll generate code that converts to positive
+                return left + "[" + right + "]";
+            } else {
+                // Reading from index - always use overloaded get function to handle negative indices
+                return "get(" + left + ", " + right + ")";
+            }
+        default:
+            break;
     }
     
     return left + " " + op + " " + right;
@@ -902,12 +1206,16 @@ std::string CodeGenerator::generateIfStatement(IfStatement* stmt) {
     
     // Generate if body
     for (auto bodyStmt : stmt->ifBody) {
-        if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
+        if (auto comment = nodeCast<Comment>(bodyStmt)) {
             code += generateComment(comment);
-        } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
+        } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
             code += generateExpressionStatement(exprStmt);
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
             code += generateVariableDeclaration(varDecl);
+        } else if (auto returnStmt = nodeCast<ReturnStatement>(bodyStmt)) {
+            code += generateReturnStatement(returnStmt);
+        } else {
+            code += generateLoopBodyStatement(bodyStmt);
         }
     }
     
@@ -919,12 +1227,16 @@ std::string CodeGenerator::generateIfStatement(IfStatement* stmt) {
         
         // Generate else-if body
         for (auto bodyStmt : elseIf->ifBody) {
-            if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
+            if (auto comment = nodeCast<Comment>(bodyStmt)) {
                 code += generateComment(comment);
-            } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
+            } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
                 code += generateExpressionStatement(exprStmt);
-            } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
+            } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
                 code += generateVariableDeclaration(varDecl);
+            } else if (auto returnStmt = nodeCast<ReturnStatement>(bodyStmt)) {
+                code += generateReturnStatement(returnStmt);
+            } else {
+                code += generateLoopBodyStatement(bodyStmt);
             }
         }
         
@@ -937,12 +1249,16 @@ std::string CodeGenerator::generateIfStatement(IfStatement* stmt) {
         
         // Generate else body
         for (auto bodyStmt : stmt->elseBody) {
-            if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
+            if (auto comment = nodeCast<Comment>(bodyStmt)) {
                 code += generateComment(comment);
-            } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
+            } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
                 code += generateExpressionStatement(exprStmt);
-            } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
+            } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
                 code += generateVariableDeclaration(varDecl);
+            } else if (auto returnStmt = nodeCast<ReturnStatement>(bodyStmt)) {
+                code += generateReturnStatement(returnStmt);
+            } else {
+                code += generateLoopBodyStatement(bodyStmt);
             }
         }
         
@@ -958,7 +1274,7 @@ std::string CodeGenerator::generateForLoopStatement(ForLoopStatement* stmt) {
     std::string code = "    for (";
     
     // Generate initialization
-    if (auto varDecl = dynamic_cast<VariableDeclaration*>(stmt->initialization)) {
+    if (auto varDecl = nodeCast<VariableDeclaration>(stmt->initialization)) {
         std::string declCode = generateVariableDeclaration(varDecl).substr(4); // Remove indentation
         declCode.pop_back(); // Remove newline
         // Remove semicolon at the end of declaration
@@ -966,24 +1282,30 @@ std::string CodeGenerator::generateForLoopStatement(ForLoopStatement* stmt) {
             declCode.pop_back();
         }
         code += declCode;
-    } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(stmt->initialization)) {
+    } else if (auto exprStmt = nodeCast<ExpressionStatement>(stmt->initialization)) {
         code += generateExpression(exprStmt->expression, false);
     }
     
     code += "; " + generateExpression(stmt->condition, false) + "; " + generateExpression(stmt->increment, false) + ") {\n";
     
     // Generate loop body
+    beginLoop();
+    std::string body;
     for (auto bodyStmt : stmt->body) {
-        if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
-            code += generateComment(comment);
-        } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
-            code += generateExpressionStatement(exprStmt);
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
-            code += generateVariableDeclaration(varDecl);
+        if (auto comment = nodeCast<Comment>(bodyStmt)) {
+            body += generateComment(comment);
+        } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
+            body += generateExpressionStatement(exprStmt);
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
+            body += generateVariableDeclaration(varDecl);
+        } else {
+            body += generateLoopBodyStatement(bodyStmt);
         }
     }
+    code += loopBody(body);
     
     code += "    }\n";
+    code += endLoop();
     return code;
 }
 
@@ -998,35 +1320,45 @@ std::string CodeGenerator::generateForInLoopStatement(ForInLoopStatement* stmt)
         // Generate C++ range-based for loop for list
         code = "    for (auto " + stmt->keyVariableName + " : " + generateExpression(stmt->collection, false) + ") {\n";
     }
+    declaredVariables.insert(stmt->keyVariableName);
+    if (stmt->isKeyValuePair) {
+        declaredVariables.insert(stmt->valueVariableName);
+    }
     
     // Generate loop body
+    beginLoop();
+    std::string body;
     for (auto bodyStmt : stmt->body) {
-        if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
-            code += generateComment(comment);
-        } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
+        if (auto comment = nodeCast<Comment>(bodyStmt)) {
+            body += generateComment(comment);
+        } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
             // Special handling for System.print with formatted strings in loop body
-            if (auto funcCall = dynamic_cast<FunctionCall*>(exprStmt->expression)) {
+            if (auto funcCall = nodeCast<FunctionCall>(exprStmt->expression)) {
                 if (funcCall->objectName == "System" && funcCall->methodName == "print") {
                     // Check if it's a formatted string
                     if (funcCall->arguments.size() > 0) {
-                        auto stringExpr = dynamic_cast<StringLiteral*>(funcCall->arguments[0]);
+                        auto stringExpr = nodeCast<StringLiteral>(funcCall->arguments[0]);
                         if (stringExpr && stringExpr->type == "format" && stmt->isKeyValuePair) {
                             // Generate special code for formatted print in loop - only for key-value pairs
                             std::string formatStr = stringExpr->value;
-                            code += "        std::cout << \"Key is \" << " + stmt->keyVariableName + " << \", Value is \" << " + stmt->valueVariableName + " << std::endl;\n";
+                            body += "        std::cout << \"Key is \" << " + stmt->keyVariableName + " << \", Value is \" << " + stmt->valueVariableName + " << std::endl;\n";
                             continue;
                         }
                     }
                 }
             }
             // Normal expression statement
-            code += generateExpressionStatement(exprStmt);
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
-            code += generateVariableDeclaration(varDecl);
+            body += generateExpressionStatement(exprStmt);
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
+            body += generateVariableDeclaration(varDecl);
+        } else {
+            body += generateLoopBodyStatement(bodyStmt);
         }
     }
+    code += loopBody(body);
     
     code += "    }\n";
+    code += endLoop();
     return code;
 }
 
@@ -1035,17 +1367,23 @@ std::string CodeGenerator::generateWhileLoopStatement(WhileLoopStatement* stmt)
     std::string code = "    while (" + generateExpression(stmt->condition, false) + ") {\n";
     
     // Generate loop body
+    beginLoop();
+    std::string body;
     for (auto bodyStmt : stmt->body) {
-        if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
-            code += generateComment(comment);
-        } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
-            code += generateExpressionStatement(exprStmt);
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
-            code += generateVariableDeclaration(varDecl);
+        if (auto comment = nodeCast<Comment>(bodyStmt)) {
+            body += generateComment(comment);
+        } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
+            body += generateExpressionStatement(exprStmt);
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
+            body += generateVariableDeclaration(varDecl);
+        } else {
+            body += generateLoopBodyStatement(bodyStmt);
         }
     }
+    code += loopBody(body);
     
     code += "    }\n";
+    code += endLoop();
     return code;
 }
 
@@ -1054,20 +1392,91 @@ std::string CodeGenerator::generateDoWhileLoopStatement(DoWhileLoopStatement* st
     std::string code = "    do {\n";
     
     // Generate loop body
+    beginLoop();
+    std::string body;
     for (auto bodyStmt : stmt->body) {
-        if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
-            code += generateComment(comment);
-        } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
-            code += generateExpressionStatement(exprStmt);
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
-            code += generateVariableDeclaration(varDecl);
+        if (auto comment = nodeCast<Comment>(bodyStmt)) {
+            body += generateComment(comment);
+        } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
+            body += generateExpressionStatement(exprStmt);
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
+            body += generateVariableDeclaration(varDecl);
+        } else {
+            body += generateLoopBodyStatement(bodyStmt);
         }
     }
+    code += loopBody(body);
     
     code += "    } while (" + generateExpression(stmt->condition, false) + ");\n";
+    code += endLoop();
     return code;
 }
 
+// Generate the if, loop, switch, break and continue statements of a loop body
+std::string CodeGenerator::generateLoopBodyStatement(ASTNode* stmt) {
+    if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+        return generateIfStatement(ifStmt);
+    } else if (auto forStmt = nodeCast<ForLoopStatement>(stmt)) {
+        return generateForLoopStatement(forStmt);
+    } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+        return generateForInLoopStatement(forInStmt);
+    } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
+        return generateWhileLoopStatement(whileStmt);
+    } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
+        return generateDoWhileLoopStatement(doWhileStmt);
+    } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
+        return generateSwitchStatement(switchStmt);
+    } else if (auto breakStmt = nodeCast<BreakStatement>(stmt)) {
+        return generateJumpStatement(true, breakStmt->depth);
+    } else if (auto continueStmt = nodeCast<ContinueStatement>(stmt)) {
+        return generateJumpStatement(false, continueStmt->depth);
+    }
+    
+    // Leaving the statement out would change what the program does
+    std::string name = nodeCast<TryHappenStatement>(stmt) ? "a try-happen statement"
+        : nodeCast<ReturnStatement>(stmt) ? "a return statement"
+        : nodeCast<FunctionDeclaration>(stmt) ? "a nested function" : "this statement";
+    throw vanction_error::CompilationError("Cannot generate C++ for " + name + " inside a loop, if or switch body", stmt->getLine(), stmt->getColumn());
+}
+
+// Generate break or continue statement
+// A break inside a C++ switch of the loop would only leave the switch, so it jumps to the break label too
+std::string CodeGenerator::generateJumpStatement(bool isBreak, int depth) {
+    if (depth < 0 || static_cast<size_t>(depth) >= loops.size()) {
+        throw vanction_error::CompilationError(std::string(isBreak ? "break" : "continue") + " outside of a generated loop");
+    }
+    GeneratedLoop& loop = loops[loops.size() - 1 - depth];
+    if (depth == 0 && !(isBreak && loop.switches > 0)) {
+        return isBreak ? "    break;\n" : "    continue;\n";
+    }
+    if (isBreak) {
+        loop.breakLabel = true;
+        return "    goto vn_break_" + std::to_string(loop.id) + ";\n";
+    }
+    loop.continueLabel = true;
+    return "    goto vn_continue_" + std::to_string(loop.id) + ";\n";
+}
+
+void CodeGenerator::beginLoop() {
+    GeneratedLoop loop;
+    loop.id = tempVarCounter++;
+    loops.push_back(loop);
+}
+
+// The body gets its own block, so the gotos to the continue label skip no initialization in its scope
+std::string CodeGenerator::loopBody(const std::string& body) {
+    if (!loops.back().continueLabel) {
+        return body;
+    }
+    return "    {\n" + body + "    }\n    vn_continue_" + std::to_string(loops.back().id) + ":;\n";
+}
+
+std::string CodeGenerator::endLoop() {
+    GeneratedLoop loop = loops.back();
+    loops.pop_back();
+    return loop.breakLabel ? "    vn_break_" + std::to_string(loop.id) + ":;\n" : "";
+}
+
 // Generate case statement
 std::string CodeGenerator::generateCaseStatement(CaseStatement* stmt) {
     std::string code;
@@ -1075,11 +1484,11 @@ std::string CodeGenerator::generateCaseStatement(CaseStatement* stmt) {
     
     // Generate case body
     for (auto bodyStmt : stmt->body) {
-        if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
+        if (auto comment = nodeCast<Comment>(bodyStmt)) {
             code += generateComment(comment);
-        } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
+        } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
             code += generateExpressionStatement(exprStmt);
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
             code += generateVariableDeclaration(varDecl);
         }
     }
@@ -1093,6 +1502,86 @@ std::string CodeGenerator::generateSwitchStatement(SwitchStatement* stmt) {
     std::string code;
     std::string switchExpr = generateExpression(stmt->expression, false);
     
+    auto generateCaseBody = [this, &code](CaseStatement* caseStmt) {
+        for (auto bodyStmt : caseStmt->body) {
+            if (auto comment = nodeCast<Comment>(bodyStmt)) {
+                code += generateComment(comment);
+            } else if (auto exprStmt = nodeCast<ExpressionStatement>(bodyStmt)) {
+                code += generateExpressionStatement(exprStmt);
+            } else if (auto varDecl = nodeCast<VariableDeclaration>(bodyStmt)) {
+                code += generateVariableDeclaration(varDecl);
+            } else {
+                code += generateLoopBodyStatement(bodyStmt);
+            }
+        }
+    };
+    
+    // Literal labels of the switch table become a C++ switch, on the value for int labels and on
+    // the label hash for string labels, when the switch value is known to have the label type
+    SwitchTable* table = switchTable(stmt);
+    StaticType valueType = stmt->expression ? stmt->expression->staticType : StaticType::Unknown;
+    bool intTable = table->kind == SwitchTable::Kind::Dense || table->kind == SwitchTable::Kind::IntHash;
+    bool stringTable = table->kind == SwitchTable::Kind::StringHash;
+    bool intSwitch = intTable && valueType == StaticType::Int;
+    bool stringSwitch = stringTable && valueType == StaticType::String;
+    
+    // A string value never equals an int label and an int value never equals a string label, so
+    // only the value is evaluated (comparing them would not compile)
+    if ((intTable && valueType == StaticType::String) || (stringTable && valueType == StaticType::Int)) {
+        return "    static_cast<void>(" + switchExpr + ");\n";
+    }
+    
+    if (intSwitch || stringSwitch) {
+        std::string value = "vn_switch_" + std::to_string(tempVarCounter++);
+        if (stringSwitch) {
+            code += "    {\n";
+            code += "    const std::string " + value + " = " + switchExpr + ";\n";
+            code += "    unsigned long long " + value + "_hash = 14695981039346656037ULL;\n";
+            code += "    for (unsigned char c : " + value + ") {\n";
+            code += "        " + value + "_hash = (" + value + "_hash ^ c) * 1099511628211ULL;\n";
+            code += "    }\n";
+            code += "    switch (" + value + "_hash) {\n";
+        } else {
+            code += "    switch (" + switchExpr + ") {\n";
+        }
+        
+        // Each label is emitted once, followed by the bodies of all its cases in order
+        if (!loops.empty()) {
+            loops.back().switches++;
+        }
+        std::vector<bool> chained(stmt->cases.size(), false);
+        for (int next : table->next) {
+            if (next >= 0) {
+                chained[next] = true;
+            }
+        }
+        for (size_t i = 0; i < stmt->cases.size(); ++i) {
+            if (chained[i]) {
+                continue;
+            }
+            if (stringSwitch) {
+                code += "    case " + std::to_string(labelHash(table->stringLabels[i])) + "ULL:\n";
+                code += "    if (" + value + " == " + generateExpression(stmt->cases[i]->value, false) + ") {\n";
+            } else {
+                code += "    case " + std::to_string(table->intLabels[i]) + ": {\n";
+            }
+            for (int index = static_cast<int>(i); index >= 0; index = table->next[index]) {
+                generateCaseBody(stmt->cases[index]);
+            }
+            code += "    }\n";
+            code += "    break;\n";
+        }
+        if (!loops.empty()) {
+            loops.back().switches--;
+        }
+        
+        code += "    }\n";
+        if (stringSwitch) {
+            code += "    }\n";
+        }
+        return code;
+    }
+    
     // For C++ compatibility, generate if-else if chain instead of switch
     // This allows support for strings and other non-integer types
     for (size_t i = 0; i < stmt->cases.size(); ++i) {
@@ -1108,15 +1597,7 @@ std::string CodeGenerator::generateSwitchStatement(SwitchStatement* stmt) {
         }
         
         // Generate case body
-        for (auto bodyStmt : caseStmt->body) {
-            if (auto comment = dynamic_cast<Comment*>(bodyStmt)) {
-                code += generateComment(comment);
-            } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(bodyStmt)) {
-                code += generateExpressionStatement(exprStmt);
-            } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(bodyStmt)) {
-                code += generateVariableDeclaration(varDecl);
-            }
-        }
+        generateCaseBody(caseStmt);
     }
     
     // Close the last if/else if block
@@ -1149,13 +1630,15 @@ std::string CodeGenerator::generateClassDeclaration(ClassDeclaration* cls) {
     }
     
     // Generate init method as constructor
-    if (auto initMethod = dynamic_cast<InstanceMethodDeclaration*>(cls->initMethod)) {
+    if (auto initMethod = nodeCast<InstanceMethodDeclaration>(cls->initMethod)) {
         // Generate constructor signature
         code += "    " + cls->name + "(";
         
         // Generate parameters (skip the first 'instance' parameter)
+        declaredVariables.clear();
         for (size_t i = 1; i < initMethod->parameters.size(); ++i) {
             const auto& param = initMethod->parameters[i];
+            declaredVariables.insert(param.name);
             // Use specific types based on parameter name to comply with C++17
             std::string paramType;
             if (param.name == "name") {
@@ -1195,7 +1678,7 @@ std::string CodeGenerator::generateClassDeclaration(ClassDeclaration* cls) {
         
         // Generate constructor body
         for (auto stmt : initMethod->body) {
-            if (auto exprStmt = dynamic_cast<ExpressionStatement*>(stmt)) {
+            if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
                 std::string stmtCode = generateExpressionStatement(exprStmt).substr(4);
                 
                 // Skip parent class init calls (handled in initialization list)
@@ -1253,9 +1736,9 @@ std::string CodeGenerator::generateClassDeclaration(ClassDeclaration* cls) {
                 }
                 
                 code += "        " + stmtCode;
-            } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(stmt)) {
+            } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
                 code += "        " + generateVariableDeclaration(varDecl).substr(4);
-            } else if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
+            } else if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
                 // Skip return statements in constructors
             } else {
                 code += "        // Unimplemented statement type in constructor\n";
@@ -1267,7 +1750,7 @@ std::string CodeGenerator::generateClassDeclaration(ClassDeclaration* cls) {
     
     // Generate instance methods
     for (auto method : cls->instanceMethods) {
-        if (auto instanceMethod = dynamic_cast<InstanceMethodDeclaration*>(method)) {
+        if (auto instanceMethod = nodeCast<InstanceMethodDeclaration>(method)) {
             code += generateInstanceMethodDeclaration(instanceMethod);
         }
     }
@@ -1286,8 +1769,10 @@ std::string CodeGenerator::generateClassMethodDeclaration(ClassMethodDeclaration
     code += "    static " + method->returnType + " " + method->name + "(";
     
     // Generate parameters (skip the first 'instance' parameter)
+        declaredVariables.clear();
         for (size_t i = 1; i < method->parameters.size(); ++i) {
             const auto& param = method->parameters[i];
+            declaredVariables.insert(param.name);
             // Use specific types based on parameter name to comply with C++17
             std::string paramType;
             if (param.name == "name") {
@@ -1307,7 +1792,7 @@ std::string CodeGenerator::generateClassMethodDeclaration(ClassMethodDeclaration
     
     // Generate method body
     for (auto stmt : method->body) {
-        if (auto exprStmt = dynamic_cast<ExpressionStatement*>(stmt)) {
+        if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
             std::string stmtCode = generateExpressionStatement(exprStmt).substr(4);
             // Replace instance. and instance-> with this-> in method body
             size_t pos = 0;
@@ -1327,9 +1812,9 @@ std::string CodeGenerator::generateClassMethodDeclaration(ClassMethodDeclaration
                 }
             }
             code += "        " + stmtCode;
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(stmt)) {
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
             code += "        " + generateVariableDeclaration(varDecl).substr(4);
-        } else if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
+        } else if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
             std::string stmtCode = "return";
             if (returnStmt->expression) {
                 std::string exprCode = generateExpression(returnStmt->expression, false);
@@ -1373,10 +1858,10 @@ std::string CodeGenerator::generateInstanceMethodDeclaration(InstanceMethodDecla
     if (returnType == "void") {
         // Check if method body has a return statement with value
         for (auto stmt : method->body) {
-            if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
+            if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
                 if (returnStmt->expression) {
                     // For simple getter methods, infer return type based on member access
-                    if (auto memberAccess = dynamic_cast<InstanceAccessExpression*>(returnStmt->expression)) {
+                    if (auto memberAccess = nodeCast<InstanceAccessExpression>(returnStmt->expression)) {
                         // This is an InstanceAccessExpression, but we need to check its actual type
                         // For now, let's set return type to appropriate type based on member name
                         std::string memberName = memberAccess->memberName;
@@ -1385,7 +1870,7 @@ std::string CodeGenerator::generateInstanceMethodDeclaration(InstanceMethodDecla
                         } else if (memberName == "age" || memberName == "id") {
                             returnType = "int";
                         }
-                    } else if (auto ident = dynamic_cast<Identifier*>(returnStmt->expression)) {
+                    } else if (auto ident = nodeCast<Identifier>(returnStmt->expression)) {
                         // Check if it's a simple identifier (like instance.name)
                         std::string identName = ident->name;
                         if (identName == "name") {
@@ -1406,8 +1891,10 @@ std::string CodeGenerator::generateInstanceMethodDeclaration(InstanceMethodDecla
     code += "    " + returnType + " " + method->name + "(";
     
     // Generate parameters (instance parameter has already been skipped during parsing)
+    declaredVariables.clear();
     for (size_t i = 0; i < method->parameters.size(); ++i) {
         const auto& param = method->parameters[i];
+        declaredVariables.insert(param.name);
         // Use specific types based on parameter name to comply with C++17
         std::string paramType;
         if (param.name == "name") {
@@ -1427,7 +1914,7 @@ std::string CodeGenerator::generateInstanceMethodDeclaration(InstanceMethodDecla
     
     // Generate method body
     for (auto stmt : method->body) {
-        if (auto exprStmt = dynamic_cast<ExpressionStatement*>(stmt)) {
+        if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
             std::string stmtCode = generateExpressionStatement(exprStmt).substr(4);
             // Replace instance. and instance-> with this-> in method body
             size_t pos = 0;
@@ -1447,9 +1934,9 @@ std::string CodeGenerator::generateInstanceMethodDeclaration(InstanceMethodDecla
                 }
             }
             code += "        " + stmtCode;
-        } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(stmt)) {
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
             code += "        " + generateVariableDeclaration(varDecl).substr(4);
-        } else if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
+        } else if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
             std::string stmtCode = "return";
             if (returnStmt->expression) {
                 std::string exprCode = generateExpression(returnStmt->expression);
@@ -1687,7 +2174,7 @@ std::string CodeGenerator::generateFunctionCall(FunctionCall* call) {
             bool isHashMapGet = false;
             if (call->arguments.size() > 0) {
                 // If the first argument is a string literal, it's probably a HashMap get
-                if (dynamic_cast<StringLiteral*>(call->arguments[0])) {
+                if (nodeCast<StringLiteral>(call->arguments[0])) {
                     isHashMapGet = true;
                 }
             }
@@ -1723,6 +2210,21 @@ std::string CodeGenerator::generateFunctionCall(FunctionCall* call) {
         } else if (call->methodName == "value" || call->methodName == "values") {
             // map.value() or map.values() -> mapValues(map)
             return "mapValues(" + call->objectName + ")";
+        } else if (call->methodName == "remove" && call->arguments.size() == 1) {
+            // map.remove(key) -> mapRemove(map, key)
+            return "mapRemove(" + call->objectName + ", " + generateExpression(call->arguments[0]) + ")";
+        } else if (call->methodName == "reserve" && call->arguments.size() == 1) {
+            // map.reserve(n) -> map.reserve(n)
+            return call->objectName + ".reserve(" + generateExpression(call->arguments[0]) + ")";
+        } else if (isListAggregate(call->methodName)) {
+            // list.sum(), list.scale(k), ... -> listSum(list), listScale(list, k), ...
+            std::string code = listHelperName(call->methodName) + "(" + call->objectName;
+            // Generate arguments
+            for (size_t i = 0; i < call->arguments.size(); ++i) {
+                code += ", " + generateExpression(call->arguments[i]);
+            }
+            code += ")";
+            return code;
         }
         
         // Check if it's an instance method call (e.g., obj.method()) or namespace function call
@@ -1776,9 +2278,9 @@ std::string CodeGenerator::generateComment(Comment* comment) {
 }
 
 // Generate list literal expression
-std::string CodeGenerator::generateListLiteral(ListLiteral* list) {
-    // Use a variant type that can handle different data types
-    std::string code = "std::vector<std::variant<int, std::string, bool>>{";
+std::string CodeGenerator::generateListLiteral(ListLiteral* list, const std::string& elementType) {
+    // Use a variant type that can handle different data types, unless the element type is known
+    std::string code = "std::vector<" + elementType + ">{";
     
     // Generate elements
     for (size_t i = 0; i < list->elements.size(); ++i) {
@@ -1838,7 +2340,13 @@ std::string CodeGenerator::generateLambdaExpression(LambdaExpression* lambda) {
         code += "auto " + lambda->parameters[i].name;
     }
     
+    // The parameters are only visible in the body
+    std::unordered_set<std::string> outerVariables = declaredVariables;
+    for (const auto& param : lambda->parameters) {
+        declaredVariables.insert(param.name);
+    }
     code += ") -> auto { return " + generateExpression(lambda->body, false) + "; }";
+    declaredVariables = std::move(outerVariables);
     
     return code;
 }
@@ -1867,3 +2375,294 @@ std::string CodeGenerator::generateImportStatement(ImportStatement* importStmt)
     
     return code;
 }
+
+// Generate a shared object running one function natively for the tiered interpreter
+// The function must be pure: int parameters and locals, int results, self calls only
+std::string CodeGenerator::generateNativeFunction(FunctionDeclaration* func) {
+    if (func->kind != NodeKind::FunctionDeclaration || func->slot >= 0 || func->name == "main"
+        || !func->layout.upvalues.empty() || func->body.empty() || !nodeCast<ReturnStatement>(func->body.back())) {
+        return "";
+    }
+    
+    nativeFunction = func;
+    nativeLocals.clear();
+    nativeImmutables.clear();
+    nativeTailCall = false;
+    
+    std::string params;
+    std::string args;
+    bool supported = true;
+    for (size_t i = 0; i < func->parameters.size(); ++i) {
+        const std::string& name = func->parameters[i].name;
+        supported = supported && nativeLocals.insert(name).second;
+        params += (i > 0 ? ", int v_" : "int v_") + name;
+        args += (i > 0 ? ", args[" : "args[") + std::to_string(i) + "]";
+    }
+    
+    std::string body;
+    supported = supported && generateNativeBody(func->body, body, "    ");
+    nativeFunction = nullptr;
+    if (!supported) {
+        return "";
+    }
+    
+    std::string code = "// Native code of Vanction function " + func->name + ", generated by the tiered interpreter\n";
+    code += "#include <climits>\n\n";
+    code += "#ifdef _WIN32\n";
+    code += "#define VN_EXPORT extern \"C\" __declspec(dllexport)\n";
+    code += "#else\n";
+    code += "#define VN_EXPORT extern \"C\"\n";
+    code += "#endif\n\n";
+    code += "namespace {\n\n";
+    
+    // Whatever the interpreter would handle differently (overflow, division by zero, deep recursion)
+    // throws, and the interpreter runs the call instead
+    code += "struct vn_deopt {};\n\n";
+    code += "int vn_depth = 0;\n\n";
+    code += "struct vn_frame {\n";
+    code += "    vn_frame() {\n";
+    code += "        if (++vn_depth > 10000) {\n";
+    code += "            --vn_depth;\n";
+    code += "            throw vn_deopt{};\n";
+    code += "        }\n";
+    code += "    }\n";
+    code += "    ~vn_frame() { --vn_depth; }\n";
+    code += "};\n\n";
+    code += "inline int vn_add(int a, int b) {\n";
+    code += "    int r;\n";
+    code += "    if (__builtin_add_overflow(a, b, &r)) throw vn_deopt{};\n";
+    code += "    return r;\n";
+    code += "}\n\n";
+    code += "inline int vn_sub(int a, int b) {\n";
+    code += "    int r;\n";
+    code += "    if (__builtin_sub_overflow(a, b, &r)) throw vn_deopt{};\n";
+    code += "    return r;\n";
+    code += "}\n\n";
+    code += "inline int vn_mul(int a, int b) {\n";
+    code += "    int r;\n";
+    code += "    if (__builtin_mul_overflow(a, b, &r)) throw vn_deopt{};\n";
+    code += "    return r;\n";
+    code += "}\n\n";
+    code += "inline int vn_div(int a, int b) {\n";
+    code += "    if (b == 0 || (a == INT_MIN && b == -1)) throw vn_deopt{};\n";
+    code += "    return a / b;\n";
+    code += "}\n\n";
+    code += "inline int vn_mod(int a, int b) {\n";
+    code += "    if (b == 0 || (a == INT_MIN && b == -1)) throw vn_deopt{};\n";
+    code += "    return a % b;\n";
+    code += "}\n\n";
+    // Logical operators evaluate both operands, as the interpreter does
+    code += "inline bool vn_and(bool a, bool b) { return a && b; }\n\n";
+    code += "inline bool vn_or(bool a, bool b) { return a || b; }\n\n";
+    
+    code += "int vn_function(" + params + ") {\n";
+    code += "    vn_frame frame;\n";
+    if (nativeTailCall) {
+        code += "tail_call:\n";
+    }
+    code += body;
+    code += "}\n\n";
+    code += "} // namespace\n\n";
+    
+    // Returns 0 with the result, or 1 when the interpreter has to run the call
+    code += "VN_EXPORT int vanction_native_entry(const int* args, int* result) {\n";
+    code += "    try {\n";
+    code += "        *result = vn_function(" + args + ");\n";
+    code += "        return 0;\n";
+    code += "    } catch (const vn_deopt&) {\n";
+    code += "        return 1;\n";
+    code += "    }\n";
+    code += "}\n";
+    return code;
+}
+
+// Generate the native statements of a body
+bool CodeGenerator::generateNativeBody(const std::vector<ASTNode*>& body, std::string& code, const std::string& indent) {
+    for (auto stmt : body) {
+        if (!generateNativeStatement(stmt, code, indent)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Generate a native statement: int declarations and assignments, if, while and return
+bool CodeGenerator::generateNativeStatement(ASTNode* stmt, std::string& code, const std::string& indent) {
+    std::string expr;
+    StaticType type = StaticType::Unknown;
+    switch (stmt->kind) {
+        case NodeKind::Comment:
+            return true;
+        case NodeKind::VariableDeclaration: {
+            // Every local has its own name, so C++ block scoping cannot separate what the interpreter shares
+            auto varDecl = static_cast<VariableDeclaration*>(stmt);
+            if (varDecl->isDefine || !varDecl->initializer || !nativeLocals.insert(varDecl->name).second
+                || !generateNativeExpression(varDecl->initializer, expr, type) || type != StaticType::Int) {
+                return false;
+            }
+            if (varDecl->isImmut) {
+                nativeImmutables.insert(varDecl->name);
+            }
+            code += indent + "int v_" + varDecl->name + " = " + expr + ";\n";
+            return true;
+        }
+        case NodeKind::ExpressionStatement: {
+            auto assign = nodeCast<AssignmentExpression>(static_cast<ExpressionStatement*>(stmt)->expression);
+            auto target = assign ? nodeCast<Identifier>(assign->left) : nullptr;
+            if (!target || target->slot < 0 || target->upvalue >= 0 || !nativeLocals.count(target->name)
+                || nativeImmutables.count(target->name)
+                || !generateNativeExpression(assign->right, expr, type) || type != StaticType::Int) {
+                return false;
+            }
+            code += indent + "v_" + target->name + " = " + expr + ";\n";
+            return true;
+        }
+        case NodeKind::IfStatement: {
+            // Else-if clauses do not chain in Vanction, so they are left to the interpreter
+            auto ifStmt = static_cast<IfStatement*>(stmt);
+            if (!ifStmt->elseIfs.empty() || !generateNativeExpression(ifStmt->condition, expr, type)) {
+                return false;
+            }
+            code += indent + "if (" + expr + ") {\n";
+            if (!generateNativeBody(ifStmt->ifBody, code, indent + "    ")) {
+                return false;
+            }
+            if (!ifStmt->elseBody.empty()) {
+                code += indent + "} else {\n";
+                if (!generateNativeBody(ifStmt->elseBody, code, indent + "    ")) {
+                    return false;
+                }
+            }
+            code += indent + "}\n";
+            return true;
+        }
+        case NodeKind::WhileLoopStatement: {
+            auto whileStmt = static_cast<WhileLoopStatement*>(stmt);
+            if (!generateNativeExpression(whileStmt->condition, expr, type)) {
+                return false;
+            }
+            code += indent + "while (" + expr + ") {\n";
+            if (!generateNativeBody(whileStmt->body, code, indent + "    ")) {
+                return false;
+            }
+            code += indent + "}\n";
+            return true;
+        }
+        case NodeKind::ReturnStatement: {
+            auto returnStmt = static_cast<ReturnStatement*>(stmt);
+            if (!returnStmt->expression) {
+                return false;
+            }
+            auto call = nodeCast<FunctionCall>(returnStmt->expression);
+            if (isSelfTailCall(returnStmt, nativeFunction) && call->slot < 0 && call->upvalue < 0) {
+                // Self tail calls jump back to the start, like in generated programs
+                std::string update;
+                code += indent + "{\n";
+                for (size_t i = 0; i < call->arguments.size(); ++i) {
+                    if (!generateNativeExpression(call->arguments[i], expr, type) || type != StaticType::Int) {
+                        return false;
+                    }
+                    code += indent + "    int tail_arg" + std::to_string(i) + " = " + expr + ";\n";
+                    update += indent + "    v_" + nativeFunction->parameters[i].name + " = tail_arg" + std::to_string(i) + ";\n";
+                }
+                code += update;
+                code += indent + "    goto tail_call;\n";
+                code += indent + "}\n";
+                nativeTailCall = true;
+                return true;
+            }
+            if (!generateNativeExpression(returnStmt->expression, expr, type) || type != StaticType::Int) {
+                return false;
+            }
+            code += indent + "return " + expr + ";\n";
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Generate a native expression over ints (comparisons and logical operators yield bools)
+bool CodeGenerator::generateNativeExpression(Expression* expr, std::string& code, StaticType& type) {
+    if (auto literal = nodeCast<IntegerLiteral>(expr)) {
+        code = std::to_string(literal->value);
+        type = StaticType::Int;
+        return true;
+    }
+    if (auto ident = nodeCast<Identifier>(expr)) {
+        if (ident->slot < 0 || ident->upvalue >= 0 || !nativeLocals.count(ident->name)) {
+            return false;
+        }
+        code = "v_" + ident->name;
+        type = StaticType::Int;
+        return true;
+    }
+    if (auto call = nodeCast<FunctionCall>(expr)) {
+        // Self calls only: any other call could have side effects the interpreter would repeat
+        if (!call->objectName.empty() || call->methodName != nativeFunction->name || call->slot >= 0
+            || call->upvalue >= 0 || call->arguments.size() != nativeFunction->parameters.size()) {
+            return false;
+        }
+        std::string args;
+        for (size_t i = 0; i < call->arguments.size(); ++i) {
+            std::string arg;
+            StaticType argType = StaticType::Unknown;
+            if (!generateNativeExpression(call->arguments[i], arg, argType) || argType != StaticType::Int) {
+                return false;
+            }
+            args += (i > 0 ? ", " : "") + arg;
+        }
+        code = "vn_function(" + args + ")";
+        type = StaticType::Int;
+        return true;
+    }
+    auto binary = nodeCast<BinaryExpression>(expr);
+    if (!binary) {
+        return false;
+    }
+    
+    std::string left;
+    std::string right;
+    StaticType leftType = StaticType::Unknown;
+    StaticType rightType = StaticType::Unknown;
+    if (!generateNativeExpression(binary->left, left, leftType) || !generateNativeExpression(binary->right, right, rightType)) {
+        return false;
+    }
+    bool ints = leftType == StaticType::Int && rightType == StaticType::Int;
+    
+    if (isLogical(binary->opcode) && binary->opcode != BinaryOperator::Xor) {
+        code = std::string(binary->opcode == BinaryOperator::And ? "vn_and(" : "vn_or(") + left + ", " + right + ")";
+        type = StaticType::Bool;
+        return true;
+    }
+    if (!ints) {
+        return false;
+    }
+    const char* helper = nullptr;
+    switch (binary->opcode) {
+        case BinaryOperator::Equal: helper = " == "; break;
+        case BinaryOperator::NotEqual: helper = " != "; break;
+        case BinaryOperator::Less: helper = " < "; break;
+        case BinaryOperator::LessEqual: helper = " <= "; break;
+        case BinaryOperator::Greater: helper = " > "; break;
+        case BinaryOperator::GreaterEqual: helper = " >= "; break;
+        default: break;
+    }
+    if (helper) {
+        code = "(" + left + helper + right + ")";
+        type = StaticType::Bool;
+        return true;
+    }
+    
+    switch (binary->opcode) {
+        case BinaryOperator::Add: helper = "vn_add("; break;
+        case BinaryOperator::Subtract: helper = "vn_sub("; break;
+        case BinaryOperator::Multiply: helper = "vn_mul("; break;
+        case BinaryOperator::Divide: helper = "vn_div("; break;
+        case BinaryOperator::Modulo: helper = "vn_mod("; break;
+        default: return false;
+    }
+    code = helper + left + ", " + right + ")";
+    type = StaticType::Int;
+    return true;
+}
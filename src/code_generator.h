@@ -3,6 +3,8 @@
 
 #include "../include/ast.h"
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 // Code generator class
 class CodeGenerator {
@@ -13,10 +15,32 @@ public:
     // Constructor
     CodeGenerator();
     
+    // Generate a shared object running one function natively for the tiered interpreter
+    // Only pure functions over ints are translated; returns an empty string for any other function
+    std::string generateNativeFunction(FunctionDeclaration* func);
+
 private:
     // Temporary variable counter for generating unique names
     size_t tempVarCounter;
     
+    // Function whose self tail calls are being turned into jumps back to its start (nullptr when none)
+    FunctionDeclaration* tailCallFunction = nullptr;
+    
+    // Loop being generated, with the labels that jumps out of nested loops and C++ switches need
+    struct GeneratedLoop {
+        size_t id;
+        int switches = 0;
+        bool breakLabel = false;
+        bool continueLabel = false;
+    };
+    
+    // Loops around the statement being generated, innermost last
+    std::vector<GeneratedLoop> loops;
+    
+    // Parameters and variables declared so far in the function being generated; format string
+    // placeholders naming anything else read as undefined, like in the interpreter
+    std::unordered_set<std::string> declaredVariables;
+    
     // Generate function declaration
     std::string generateFunctionDeclaration(FunctionDeclaration* func);
     
@@ -71,6 +95,9 @@ private:
     // Generate if statement
     std::string generateIfStatement(IfStatement* stmt);
     
+    // Generate return statement (self tail calls become parameter updates and a jump)
+    std::string generateReturnStatement(ReturnStatement* stmt);
+    
     // Generate for loop statement
     std::string generateForLoopStatement(ForLoopStatement* stmt);
     
@@ -83,6 +110,20 @@ private:
     // Generate do-while loop statement
     std::string generateDoWhileLoopStatement(DoWhileLoopStatement* stmt);
     
+    // Generate the if, loop, switch, break and continue statements of a loop, if or case body
+    // Any other statement raises CompilationError instead of being left out
+    std::string generateLoopBodyStatement(ASTNode* stmt);
+    
+    // Generate break or continue statement: C++ break and continue for the innermost loop,
+    // a goto to a label of the loop otherwise
+    std::string generateJumpStatement(bool isBreak, int depth);
+    
+    // Open a loop, then close it around its generated body: the body is followed by the continue
+    // label and the loop by the break label when jumps use them
+    void beginLoop();
+    std::string loopBody(const std::string& body);
+    std::string endLoop();
+    
     // Generate case statement
     std::string generateCaseStatement(CaseStatement* stmt);
     
@@ -104,8 +145,8 @@ private:
     // Generate instance access expression
     std::string generateInstanceAccessExpression(InstanceAccessExpression* expr);
     
-    // Generate list literal expression
-    std::string generateListLiteral(ListLiteral* list);
+    // Generate list literal expression (a vector of variants unless the element type is given)
+    std::string generateListLiteral(ListLiteral* list, const std::string& elementType = "std::variant<int, std::string, bool>");
     
     // Generate hash map literal expression
     std::string generateHashMapLiteral(HashMapLiteral* hashMap);
@@ -118,6 +159,17 @@ private:
     
     // Generate import statement
     std::string generateImportStatement(ImportStatement* importStmt);
+    
+    // Function being translated by generateNativeFunction, with its int parameters and locals
+    FunctionDeclaration* nativeFunction = nullptr;
+    std::unordered_set<std::string> nativeLocals;
+    std::unordered_set<std::string> nativeImmutables;
+    bool nativeTailCall = false;
+    
+    // Native translation of statements and expressions, returns false for anything outside the subset
+    bool generateNativeBody(const std::vector<ASTNode*>& body, std::string& code, const std::string& indent);
+    bool generateNativeStatement(ASTNode* stmt, std::string& code, const std::string& indent);
+    bool generateNativeExpression(Expression* expr, std::string& code, StaticType& type);
 };
 
 #endif // VANCTION_CODE_GENERATOR_H
@@ -34,6 +34,11 @@ int Error::getColumn() const {
 }
 
 std::string Error::getTypeString() const {
+    return errorTypeName(type);
+}
+
+// Name of an error type
+const char* errorTypeName(ErrorType type) {
     switch (type) {
         case ErrorType::CError: return "CError";
         case ErrorType::VariableError: return "VariableError";
@@ -54,6 +59,19 @@ std::string Error::getTypeString() const {
     }
 }
 
+// Interned id of the error type a happen clause names, resolved once by the parser
+int happenErrorType(const std::string& name) {
+    if (name == "Error") {
+        return anyErrorType;
+    }
+    for (int type = 0; type <= static_cast<int>(ErrorType::UnknownError); type++) {
+        if (name == errorTypeName(static_cast<ErrorType>(type))) {
+            return type;
+        }
+    }
+    return noErrorType;
+}
+
 // Helper function to get absolute path
 std::string getAbsolutePath(const std::string& path) {
 #ifdef _WIN32
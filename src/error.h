@@ -24,22 +24,38 @@ enum class ErrorType {
     UnknownError
 };
 
+// Name of an error type, as caught by happen clauses
+const char* errorTypeName(ErrorType type);
+
+// Interned id of the error type a happen clause names: an ErrorType, or one of these
+const int anyErrorType = -1;  // Error catches every error
+const int noErrorType = -2;   // a name no error is raised with
+int happenErrorType(const std::string& name);
+
+// Whether a happen clause of the given id catches an error
+inline bool catchesError(int happenType, ErrorType type) {
+    return happenType == anyErrorType || happenType == static_cast<int>(type);
+}
+
 // Error namespace containing all specific error classes
 namespace vanction_error {
     // Base error class for all Vanction errors
     class VanctionError : public std::runtime_error {
     public:
-        VanctionError(const std::string& type, const std::string& message, int line = 1, int column = 1)
-            : std::runtime_error(type + ": " + message), type_(type), message_(message), line_(line), column_(column) {}
+        VanctionError(ErrorType kind, const std::string& message, int line = 1, int column = 1)
+            : std::runtime_error(std::string(errorTypeName(kind)) + ": " + message), kind_(kind), type_(errorTypeName(kind)),
+              message_(message), line_(line), column_(column) {}
         
         virtual ~VanctionError() = default;
         
+        ErrorType getKind() const { return kind_; }
         const std::string& getType() const { return type_; }
         const std::string& getMessage() const { return message_; }
         int getLine() const { return line_; }
         int getColumn() const { return column_; }
         
     private:
+        ErrorType kind_;
         std::string type_;
         std::string message_;
         int line_;
@@ -50,92 +66,92 @@ namespace vanction_error {
     class CError : public VanctionError {
     public:
         explicit CError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("CError", message, line, column) {}
+            : VanctionError(ErrorType::CError, message, line, column) {}
     };
 
     class VariableError : public VanctionError {
     public:
         explicit VariableError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("VariableError", message, line, column) {}
+            : VanctionError(ErrorType::VariableError, message, line, column) {}
     };
     
     class MethodError : public VanctionError {
     public:
         explicit MethodError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("MethodError", message, line, column) {}
+            : VanctionError(ErrorType::MethodError, message, line, column) {}
     };
     
     class CompilationError : public VanctionError {
     public:
         explicit CompilationError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("CompilationError", message, line, column) {}
+            : VanctionError(ErrorType::CompilationError, message, line, column) {}
     };
     
     class DivideByZeroError : public VanctionError {
     public:
         explicit DivideByZeroError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("DivideByZeroError", message, line, column) {}
+            : VanctionError(ErrorType::DivideByZeroError, message, line, column) {}
     };
     
     class ValueError : public VanctionError {
     public:
         explicit ValueError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("ValueError", message, line, column) {}
+            : VanctionError(ErrorType::ValueError, message, line, column) {}
     };
     
     class TokenError : public VanctionError {
     public:
         explicit TokenError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("TokenError", message, line, column) {}
+            : VanctionError(ErrorType::TokenError, message, line, column) {}
     };
     
     class SyntaxError : public VanctionError {
     public:
         explicit SyntaxError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("SyntaxError", message, line, column) {}
+            : VanctionError(ErrorType::SyntaxError, message, line, column) {}
     };
     
     class MainFunctionError : public VanctionError {
     public:
         explicit MainFunctionError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("MainFunctionError", message, line, column) {}
+            : VanctionError(ErrorType::MainFunctionError, message, line, column) {}
     };
     
     class UnknownError : public VanctionError {
     public:
         explicit UnknownError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("UnknownError", message, line, column) {}
+            : VanctionError(ErrorType::UnknownError, message, line, column) {}
     };
     
     // New error classes for advanced structures
     class ListIndexError : public VanctionError {
     public:
         explicit ListIndexError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("ListIndexError", message, line, column) {}
+            : VanctionError(ErrorType::ListIndexError, message, line, column) {}
     };
     
     class HashMapKeyError : public VanctionError {
     public:
         explicit HashMapKeyError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("HashMapKeyError", message, line, column) {}
+            : VanctionError(ErrorType::HashMapKeyError, message, line, column) {}
     };
     
     class TypeError : public VanctionError {
     public:
         explicit TypeError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("TypeError", message, line, column) {}
+            : VanctionError(ErrorType::TypeError, message, line, column) {}
     };
     
     class RangeError : public VanctionError {
     public:
         explicit RangeError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("RangeError", message, line, column) {}
+            : VanctionError(ErrorType::RangeError, message, line, column) {}
     };
     
     class ImmutError : public VanctionError {
     public:
         explicit ImmutError(const std::string& message, int line = 1, int column = 1)
-            : VanctionError("ImmutError", message, line, column) {}
+            : VanctionError(ErrorType::ImmutError, message, line, column) {}
     };
 }
 
@@ -0,0 +1,352 @@
+#include "gc.h"
+#include "runtime.h"
+#include <algorithm>
+#include <chrono>
+#include <csetjmp>
+#include <cstdint>
+#include <cstring>
+
+Heap heap;
+
+// Allocate a collected list
+List* Heap::newList() {
+    List* list = new List();
+    track(list, GcKind::List);
+    return list;
+}
+
+// Allocate a collected hash map
+HashMap* Heap::newHashMap() {
+    HashMap* map = new HashMap();
+    track(map, GcKind::HashMap);
+    return map;
+}
+
+// Allocate a collected string builder
+StringBuilder* Heap::newStringBuilder() {
+    StringBuilder* builder = new StringBuilder();
+    track(builder, GcKind::StringBuilder);
+    return builder;
+}
+
+// Allocate a collected instance
+Instance* Heap::newInstance(ClassDefinition* cls) {
+    Instance* instance = new Instance(cls);
+    track(instance, GcKind::Instance);
+    return instance;
+}
+
+// Allocate a collected error object (caught errors bound by happen)
+ErrorObject* Heap::newError(const std::string& text, const std::string& type, const std::string& info) {
+    ErrorObject* error = reuseError();
+    if (!error) {
+        error = new ErrorObject(text, type, info);
+        track(error, GcKind::Error);
+        return error;
+    }
+    error->text = text;
+    error->type = type;
+    error->info = info;
+    return error;
+}
+
+ErrorObject* Heap::newError(std::string_view type, std::string_view info) {
+    ErrorObject* error = reuseError();
+    if (!error) {
+        error = new ErrorObject("", "", "");
+        track(error, GcKind::Error);
+    }
+    error->text.assign(type).append(": ").append(info);
+    error->type.assign(type);
+    error->info.assign(info);
+    return error;
+}
+
+// Register a pooled error object again, nullptr when the pool is empty
+// Its strings keep their capacity, so assigning the new error's text does not allocate either
+ErrorObject* Heap::reuseError() {
+    if (errorPool.empty()) {
+        return nullptr;
+    }
+    ObjectTable::node_type node = std::move(errorPool.back());
+    errorPool.pop_back();
+    auto error = static_cast<ErrorObject*>(node.key());
+    node.mapped() = Object{GcKind::Error, false};
+    objects.insert(std::move(node));
+    ++allocationsSinceCollection;
+    return error;
+}
+
+// Allocate a collected closure (function or lambda value)
+Closure* Heap::newClosure(FunctionDeclaration* function, LambdaExpression* lambda) {
+    Closure* closure = new Closure(function, lambda);
+    track(closure, GcKind::Closure);
+    return closure;
+}
+
+// Allocate a collected upvalue pointing at a frame slot
+Upvalue* Heap::newUpvalue(Value* location, SlotType* type) {
+    Upvalue* upvalue = new Upvalue(location, type);
+    track(upvalue, GcKind::Upvalue);
+    return upvalue;
+}
+
+void Heap::track(void* object, GcKind kind) {
+    objects.emplace(object, Object{kind, false});
+    ++allocationsSinceCollection;
+}
+
+void Heap::pushRange(const Value* begin, const Value* end) {
+    ranges.push_back(Range{begin, end});
+}
+
+void Heap::popRange() {
+    ranges.pop_back();
+}
+
+void Heap::pushVector(const std::vector<Value>* values) {
+    vectors.push_back(values);
+}
+
+void Heap::popVector() {
+    vectors.pop_back();
+}
+
+// Mark an object if the pointer refers to one owned by the heap
+// Unknown pointers (AST nodes, stack frames, stale stack words) are ignored
+void Heap::markPointer(void* pointer) {
+    auto it = objects.find(pointer);
+    if (it == objects.end() || it->second.marked) {
+        return;
+    }
+    it->second.marked = true;
+    grayStack.emplace_back(pointer, it->second.kind);
+}
+
+void Heap::markValue(const Value& value) {
+    switch (value.type()) {
+        case ValueType::List:
+            markPointer(value.asList());
+            break;
+        case ValueType::HashMap:
+            markPointer(value.asHashMap());
+            break;
+        case ValueType::StringBuilder:
+            markPointer(value.asStringBuilder());
+            break;
+        case ValueType::Instance:
+            markPointer(value.asInstance());
+            break;
+        case ValueType::Error:
+            markPointer(value.asError());
+            break;
+        case ValueType::Lambda:
+        case ValueType::Function:
+            markPointer(value.asClosure());
+            break;
+        default:
+            break;
+    }
+}
+
+void Heap::markFrame(Frame* frame) {
+    for (const auto& slot : frame->slots) {
+        markValue(slot);
+    }
+    markPointer(frame->closure);
+    for (Upvalue* upvalue = frame->openUpvalues; upvalue; upvalue = upvalue->nextOpen) {
+        markPointer(upvalue);
+    }
+}
+
+void Heap::markRoots() {
+    // Global environments
+    for (const auto& entry : variables) {
+        markValue(entry.second);
+    }
+    for (const auto& entry : constants) {
+        markValue(entry.second);
+    }
+    
+    for (const auto& value : pendingTailCall) {
+        markValue(value);
+    }
+    
+    // Closures of functions called by name
+    for (const auto& entry : functions) {
+        if (entry.second) {
+            markPointer(entry.second->closure);
+        }
+    }
+    
+    // Frames of calls in progress
+    for (Frame* frame = liveFrames; frame; frame = frame->nextLive) {
+        markFrame(frame);
+    }
+    
+    // Evaluation stack windows and argument vectors
+    for (const auto& range : ranges) {
+        for (const Value* value = range.begin; value != range.end; ++value) {
+            markValue(*value);
+        }
+    }
+    for (auto values : vectors) {
+        for (const auto& value : *values) {
+            markValue(value);
+        }
+    }
+    
+    scanNativeStack();
+}
+
+// Temporaries of the interpreter (partially evaluated expressions, lists being built)
+// only live on the native stack, so it is scanned conservatively for heap pointers
+void Heap::scanNativeStack() {
+    if (!stackBase) {
+        return;
+    }
+    
+    // Spill callee-saved registers onto the stack
+    std::jmp_buf registers;
+    setjmp(registers);
+    
+    auto low = reinterpret_cast<std::uintptr_t>(&registers);
+    auto high = reinterpret_cast<std::uintptr_t>(stackBase);
+    if (low > high) {
+        std::swap(low, high);
+    }
+    
+    low = (low + sizeof(void*) - 1) & ~(static_cast<std::uintptr_t>(sizeof(void*)) - 1);
+    for (std::uintptr_t address = low; address + sizeof(void*) <= high; address += sizeof(void*)) {
+        void* candidate;
+        std::memcpy(&candidate, reinterpret_cast<const void*>(address), sizeof(candidate));
+        markPointer(candidate);
+    }
+}
+
+void Heap::traceObject(void* object, GcKind kind) {
+    switch (kind) {
+        case GcKind::List:
+            for (const auto& element : static_cast<List*>(object)->values()) {
+                markValue(element);
+            }
+            break;
+        case GcKind::HashMap:
+            for (const auto& entry : static_cast<HashMap*>(object)->entries) {
+                markValue(entry.value);
+            }
+            break;
+        case GcKind::Instance:
+            for (const auto& field : static_cast<Instance*>(object)->fields) {
+                markValue(field);
+            }
+            break;
+        case GcKind::Error:
+        case GcKind::StringBuilder:
+            break;
+        case GcKind::Closure:
+            for (Upvalue* upvalue : static_cast<Closure*>(object)->upvalues) {
+                markPointer(upvalue);
+            }
+            break;
+        case GcKind::Upvalue:
+            // Open upvalues point into a live frame, which is a root itself
+            markValue(static_cast<Upvalue*>(object)->closed);
+            break;
+    }
+}
+
+// Approximate footprint of an object including its element storage
+size_t Heap::sizeOf(void* object, GcKind kind) const {
+    switch (kind) {
+        case GcKind::List:
+            return sizeof(List) + static_cast<List*>(object)->storageBytes();
+        case GcKind::HashMap:
+            return sizeof(HashMap) + static_cast<HashMap*>(object)->storageBytes();
+        case GcKind::Instance:
+            return sizeof(Instance) + static_cast<Instance*>(object)->fields.capacity() * sizeof(Value);
+        case GcKind::Error:
+            return sizeof(ErrorObject);
+        case GcKind::Closure:
+            return sizeof(Closure) + static_cast<Closure*>(object)->upvalues.capacity() * sizeof(Upvalue*);
+        case GcKind::Upvalue:
+            return sizeof(Upvalue);
+        case GcKind::StringBuilder:
+            return sizeof(StringBuilder) + static_cast<StringBuilder*>(object)->buffer.capacity();
+    }
+    return 0;
+}
+
+void Heap::destroy(void* object, GcKind kind) {
+    switch (kind) {
+        case GcKind::List:
+            delete static_cast<List*>(object);
+            break;
+        case GcKind::HashMap:
+            delete static_cast<HashMap*>(object);
+            break;
+        case GcKind::Instance:
+            delete static_cast<Instance*>(object);
+            break;
+        case GcKind::Error:
+            delete static_cast<ErrorObject*>(object);
+            break;
+        case GcKind::Closure:
+            delete static_cast<Closure*>(object);
+            break;
+        case GcKind::Upvalue:
+            delete static_cast<Upvalue*>(object);
+            break;
+        case GcKind::StringBuilder:
+            delete static_cast<StringBuilder*>(object);
+            break;
+    }
+}
+
+// Mark everything reachable from the roots, then free the rest
+void Heap::collect() {
+    auto start = std::chrono::steady_clock::now();
+    
+    markRoots();
+    while (!grayStack.empty()) {
+        auto object = grayStack.back();
+        grayStack.pop_back();
+        traceObject(object.first, object.second);
+    }
+    
+    liveBytes = 0;
+    for (auto it = objects.begin(); it != objects.end();) {
+        if (it->second.marked) {
+            it->second.marked = false;
+            liveBytes += sizeOf(it->first, it->second.kind);
+            ++it;
+        } else if (it->second.kind == GcKind::Error && errorPool.size() < maxPooledErrors) {
+            // Dead errors keep their object and table entry for newError
+            errorPool.push_back(objects.extract(it++));
+            ++freedObjects;
+        } else {
+            destroy(it->first, it->second.kind);
+            it = objects.erase(it);
+            ++freedObjects;
+        }
+    }
+    
+    liveObjects = objects.size();
+    allocationsSinceCollection = 0;
+    threshold = std::max(minimumThreshold, liveObjects);
+    
+    double pauseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++collections;
+    totalPauseMs += pauseMs;
+    maxPauseMs = std::max(maxPauseMs, pauseMs);
+}
+
+void Heap::printStats(std::ostream& os) const {
+    os << "[GC] collections: " << collections
+       << ", total pause: " << totalPauseMs << " ms"
+       << ", max pause: " << maxPauseMs << " ms" << std::endl;
+    os << "[GC] freed objects: " << freedObjects
+       << ", live objects: " << liveObjects
+       << ", live bytes: " << liveBytes << " (after last collection)"
+       << ", heap objects: " << objects.size() << std::endl;
+}
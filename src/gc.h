@@ -0,0 +1,127 @@
+#ifndef VANCTION_GC_H
+#define VANCTION_GC_H
+
+#include "value.h"
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct ClassDefinition;
+struct Frame;
+struct Upvalue;
+class FunctionDeclaration;
+class LambdaExpression;
+enum class SlotType : unsigned char;
+
+// Kinds of objects owned by the collector
+enum class GcKind : unsigned char {
+    List,
+    HashMap,
+    Instance,
+    Error,
+    Closure,
+    Upvalue,
+    StringBuilder
+};
+
+// Mark-sweep heap for lists, hash maps, string builders, instances, caught errors, closures and upvalues
+// Roots are the global environments, every live frame, the VM operand stack,
+// registered value vectors and (conservatively) the native stack of the interpreter
+class Heap {
+public:
+    List* newList();
+    HashMap* newHashMap();
+    StringBuilder* newStringBuilder();
+    Instance* newInstance(ClassDefinition* cls);
+    ErrorObject* newError(const std::string& text, const std::string& type, const std::string& info);
+    // Error object of a raised error, whose text is "type: info" like the message of the error
+    ErrorObject* newError(std::string_view type, std::string_view info);
+    Closure* newClosure(FunctionDeclaration* function, LambdaExpression* lambda);
+    Upvalue* newUpvalue(Value* location, SlotType* type);
+    
+    // Collect when enough has been allocated since the last collection
+    // Only called between statements and on loop back-edges
+    void safepoint() {
+        if (allocationsSinceCollection >= threshold) {
+            collect();
+        }
+    }
+    
+    void collect();
+    
+    // Outermost native stack address of the interpreter, scanned for temporaries
+    void setStackBase(const void* base) { stackBase = base; }
+    
+    // Value ranges outside of frames that must stay alive (VM stack windows)
+    void pushRange(const Value* begin, const Value* end);
+    void popRange();
+    
+    // Value vectors of the interpreter that are being filled (call arguments)
+    void pushVector(const std::vector<Value>* values);
+    void popVector();
+    
+    bool statsEnabled = false;
+    void printStats(std::ostream& os) const;
+
+private:
+    struct Object {
+        GcKind kind;
+        bool marked;
+    };
+    
+    struct Range {
+        const Value* begin;
+        const Value* end;
+    };
+    
+    using ObjectTable = std::unordered_map<void*, Object>;
+    
+    ObjectTable objects;
+    std::vector<std::pair<void*, GcKind>> grayStack;
+    std::vector<Range> ranges;
+    std::vector<const std::vector<Value>*> vectors;
+    const void* stackBase = nullptr;
+    
+    // Collect once as many objects were allocated as survived the last collection
+    size_t allocationsSinceCollection = 0;
+    size_t threshold = minimumThreshold;
+    static constexpr size_t minimumThreshold = 4096;
+    
+    // Collected error objects, with their table entries, kept for reuse by newError
+    // so handling errors does not allocate (up to one collection's worth)
+    std::vector<ObjectTable::node_type> errorPool;
+    static constexpr size_t maxPooledErrors = minimumThreshold;
+    
+    // Statistics
+    size_t collections = 0;
+    size_t freedObjects = 0;
+    size_t liveObjects = 0;
+    size_t liveBytes = 0;
+    double totalPauseMs = 0.0;
+    double maxPauseMs = 0.0;
+    
+    void track(void* object, GcKind kind);
+    ErrorObject* reuseError();
+    void markPointer(void* pointer);
+    void markValue(const Value& value);
+    void markFrame(Frame* frame);
+    void markRoots();
+    void scanNativeStack();
+    void traceObject(void* object, GcKind kind);
+    size_t sizeOf(void* object, GcKind kind) const;
+    void destroy(void* object, GcKind kind);
+};
+
+extern Heap heap;
+
+// Keeps a vector of values alive while it is being filled
+class GcVectorRoot {
+public:
+    explicit GcVectorRoot(const std::vector<Value>& values) { heap.pushVector(&values); }
+    ~GcVectorRoot() { heap.popVector(); }
+};
+
+#endif // VANCTION_GC_H
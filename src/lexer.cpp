@@ -590,6 +590,29 @@ Token Lexer::parseIdentifierOrKeyword() {
     token.line = start_line;
     token.column = start_column;
     
+    // A name and a colon in front of a loop keyword label the loop (outer: while ...)
+    if (pos < source.length() && source[pos] == ':') {
+        size_t next = pos + 1;
+        while (next < source.length() && isspace(source[next])) {
+            next++;
+        }
+        size_t end = next;
+        while (end < source.length() && isalpha(source[end])) {
+            end++;
+        }
+        std::string keyword = source.substr(next, end - next);
+        bool wordEnds = end == source.length() || (!isalnum(source[end]) && source[end] != '-' && source[end] != '_');
+        if (wordEnds && (keyword == "for" || keyword == "while" || keyword == "do")) {
+            advance();
+            token.type = LABEL;
+            token.value = value;
+            if (debugMode) {
+                std::cout << "[DEBUG] Lexer: LABEL token: " << token.value << " at line " << token.line << ", column " << token.column << std::endl;
+            }
+            return token;
+        }
+    }
+    
     // Check if it's a keyword
     if (value == "func" || value == "int" || value == "char" || value == "string" || 
         value == "bool" || value == "auto" || value == "define" || value == "true" || value == "false" ||
@@ -599,6 +622,7 @@ Token Lexer::parseIdentifierOrKeyword() {
         // Control flow keywords
         value == "if" || value == "else" || value == "else-if" || value == "for" || value == "while" || value == "do" ||
         value == "switch" || value == "case" || value == "in" || value == "return" || value == "namespace" ||
+        value == "break" || value == "continue" ||
         // Error handling keywords
         value == "try" || value == "happen" || value == "as" ||
         // Import keywords
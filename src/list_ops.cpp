@@ -0,0 +1,704 @@
+#include "list_ops.h"
+#include "gc.h"
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define VANCTION_AVX2_KERNELS 1
+#include <immintrin.h>
+#define VANCTION_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace list_kernels {
+
+namespace {
+
+// Wrapping int arithmetic, the way the interpreter's int operators behave
+int wrapAdd(int left, int right) {
+    return static_cast<int>(static_cast<unsigned>(left) + static_cast<unsigned>(right));
+}
+
+int wrapMultiply(int left, int right) {
+    return static_cast<int>(static_cast<unsigned>(left) * static_cast<unsigned>(right));
+}
+
+template <typename T>
+bool compare(T element, Compare op, T value) {
+    switch (op) {
+        case Compare::Less: return element < value;
+        case Compare::LessEqual: return element <= value;
+        case Compare::Greater: return element > value;
+        case Compare::GreaterEqual: return element >= value;
+        case Compare::Equal: return element == value;
+        case Compare::NotEqual: return element != value;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Scalar kernels
+// ---------------------------------------------------------------------------
+
+int64_t sumIntScalar(const int* data, size_t count) {
+    int64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += data[i];
+    }
+    return total;
+}
+
+double sumDoubleScalar(const double* data, size_t count) {
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        total += data[i];
+    }
+    return total;
+}
+
+int minIntScalar(const int* data, size_t count) {
+    int result = data[0];
+    for (size_t i = 1; i < count; ++i) {
+        result = std::min(result, data[i]);
+    }
+    return result;
+}
+
+double minDoubleScalar(const double* data, size_t count) {
+    double result = data[0];
+    for (size_t i = 1; i < count; ++i) {
+        result = std::min(result, data[i]);
+    }
+    return result;
+}
+
+int maxIntScalar(const int* data, size_t count) {
+    int result = data[0];
+    for (size_t i = 1; i < count; ++i) {
+        result = std::max(result, data[i]);
+    }
+    return result;
+}
+
+double maxDoubleScalar(const double* data, size_t count) {
+    double result = data[0];
+    for (size_t i = 1; i < count; ++i) {
+        result = std::max(result, data[i]);
+    }
+    return result;
+}
+
+int64_t dotIntScalar(const int* left, const int* right, size_t count) {
+    int64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += static_cast<int64_t>(left[i]) * right[i];
+    }
+    return total;
+}
+
+double dotDoubleScalar(const double* left, const double* right, size_t count) {
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        total += left[i] * right[i];
+    }
+    return total;
+}
+
+size_t countIntScalar(const int* data, size_t count, Compare op, int value) {
+    size_t result = 0;
+    for (size_t i = 0; i < count; ++i) {
+        result += compare(data[i], op, value);
+    }
+    return result;
+}
+
+size_t countDoubleScalar(const double* data, size_t count, Compare op, double value) {
+    size_t result = 0;
+    for (size_t i = 0; i < count; ++i) {
+        result += compare(data[i], op, value);
+    }
+    return result;
+}
+
+void scaleIntScalar(const int* data, int factor, int* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = wrapMultiply(data[i], factor);
+    }
+}
+
+void scaleDoubleScalar(const double* data, double factor, double* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = data[i] * factor;
+    }
+}
+
+void addIntScalar(const int* left, const int* right, int* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = wrapAdd(left[i], right[i]);
+    }
+}
+
+void addDoubleScalar(const double* left, const double* right, double* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = left[i] + right[i];
+    }
+}
+
+void clampIntScalar(const int* data, int low, int high, int* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = std::min(std::max(data[i], low), high);
+    }
+}
+
+void clampDoubleScalar(const double* data, double low, double high, double* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = std::min(std::max(data[i], low), high);
+    }
+}
+
+#ifdef VANCTION_AVX2_KERNELS
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels: 8 ints or 4 doubles per step, scalar loop for the tail
+// NaN handling follows the scalar kernels (std::min/std::max keep the first operand)
+// ---------------------------------------------------------------------------
+
+VANCTION_AVX2 int64_t horizontalSum(__m256i lanes) {
+    alignas(32) int64_t values[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(values), lanes);
+    return values[0] + values[1] + values[2] + values[3];
+}
+
+VANCTION_AVX2 double horizontalSum(__m256d lanes) {
+    alignas(32) double values[4];
+    _mm256_store_pd(values, lanes);
+    return (values[0] + values[1]) + (values[2] + values[3]);
+}
+
+VANCTION_AVX2 int64_t sumIntAvx2(const int* data, size_t count) {
+    __m256i low = _mm256_setzero_si256();
+    __m256i high = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        low = _mm256_add_epi64(low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        high = _mm256_add_epi64(high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    return horizontalSum(_mm256_add_epi64(low, high)) + sumIntScalar(data + i, count - i);
+}
+
+VANCTION_AVX2 double sumDoubleAvx2(const double* data, size_t count) {
+    __m256d first = _mm256_setzero_pd();
+    __m256d second = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        first = _mm256_add_pd(first, _mm256_loadu_pd(data + i));
+        second = _mm256_add_pd(second, _mm256_loadu_pd(data + i + 4));
+    }
+    return horizontalSum(_mm256_add_pd(first, second)) + sumDoubleScalar(data + i, count - i);
+}
+
+VANCTION_AVX2 int minIntAvx2(const int* data, size_t count) {
+    if (count < 8) {
+        return minIntScalar(data, count);
+    }
+    __m256i result = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    size_t i = 8;
+    for (; i + 8 <= count; i += 8) {
+        result = _mm256_min_epi32(result, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    alignas(32) int lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), result);
+    int value = minIntScalar(lanes, 8);
+    return i < count ? std::min(value, minIntScalar(data + i, count - i)) : value;
+}
+
+VANCTION_AVX2 int maxIntAvx2(const int* data, size_t count) {
+    if (count < 8) {
+        return maxIntScalar(data, count);
+    }
+    __m256i result = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    size_t i = 8;
+    for (; i + 8 <= count; i += 8) {
+        result = _mm256_max_epi32(result, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    alignas(32) int lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), result);
+    int value = maxIntScalar(lanes, 8);
+    return i < count ? std::max(value, maxIntScalar(data + i, count - i)) : value;
+}
+
+// _mm256_min_pd(a, b) returns b when either is NaN, so the running result goes second
+VANCTION_AVX2 double minDoubleAvx2(const double* data, size_t count) {
+    if (count < 4) {
+        return minDoubleScalar(data, count);
+    }
+    __m256d result = _mm256_loadu_pd(data);
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4) {
+        result = _mm256_min_pd(_mm256_loadu_pd(data + i), result);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, result);
+    double value = minDoubleScalar(lanes, 4);
+    return i < count ? std::min(value, minDoubleScalar(data + i, count - i)) : value;
+}
+
+VANCTION_AVX2 double maxDoubleAvx2(const double* data, size_t count) {
+    if (count < 4) {
+        return maxDoubleScalar(data, count);
+    }
+    __m256d result = _mm256_loadu_pd(data);
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4) {
+        result = _mm256_max_pd(_mm256_loadu_pd(data + i), result);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, result);
+    double value = maxDoubleScalar(lanes, 4);
+    return i < count ? std::max(value, maxDoubleScalar(data + i, count - i)) : value;
+}
+
+VANCTION_AVX2 int64_t dotIntAvx2(const int* left, const int* right, size_t count) {
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+        // Sign-extend to 64-bit lanes; _mm256_mul_epi32 multiplies their low halves
+        __m256i aLow = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(a));
+        __m256i bLow = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(b));
+        __m256i aHigh = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(a, 1));
+        __m256i bHigh = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(b, 1));
+        total = _mm256_add_epi64(total, _mm256_mul_epi32(aLow, bLow));
+        total = _mm256_add_epi64(total, _mm256_mul_epi32(aHigh, bHigh));
+    }
+    return horizontalSum(total) + dotIntScalar(left + i, right + i, count - i);
+}
+
+VANCTION_AVX2 double dotDoubleAvx2(const double* left, const double* right, size_t count) {
+    __m256d total = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        total = _mm256_add_pd(total, _mm256_mul_pd(_mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+    }
+    return horizontalSum(total) + dotDoubleScalar(left + i, right + i, count - i);
+}
+
+// <=, >= and != are counted as the complement of >, < and ==
+VANCTION_AVX2 size_t countIntAvx2(const int* data, size_t count, Compare op, int value) {
+    Compare base = op;
+    bool complement = false;
+    if (op == Compare::LessEqual) {
+        base = Compare::Greater;
+        complement = true;
+    } else if (op == Compare::GreaterEqual) {
+        base = Compare::Less;
+        complement = true;
+    } else if (op == Compare::NotEqual) {
+        base = Compare::Equal;
+        complement = true;
+    }
+    
+    __m256i needle = _mm256_set1_epi32(value);
+    size_t matches = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i mask;
+        if (base == Compare::Greater) {
+            mask = _mm256_cmpgt_epi32(v, needle);
+        } else if (base == Compare::Less) {
+            mask = _mm256_cmpgt_epi32(needle, v);
+        } else {
+            mask = _mm256_cmpeq_epi32(v, needle);
+        }
+        matches += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+    }
+    if (complement) {
+        matches = i - matches;
+    }
+    return matches + countIntScalar(data + i, count - i, op, value);
+}
+
+// Double comparisons need the predicate as an immediate, hence one loop per operator
+template <int Predicate>
+VANCTION_AVX2 size_t countDoubleLoop(const double* data, size_t count, double value, size_t& done) {
+    __m256d needle = _mm256_set1_pd(value);
+    size_t matches = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d mask = _mm256_cmp_pd(_mm256_loadu_pd(data + i), needle, Predicate);
+        matches += __builtin_popcount(_mm256_movemask_pd(mask));
+    }
+    done = i;
+    return matches;
+}
+
+VANCTION_AVX2 size_t countDoubleAvx2(const double* data, size_t count, Compare op, double value) {
+    size_t done = 0;
+    size_t matches = 0;
+    switch (op) {
+        case Compare::Less: matches = countDoubleLoop<_CMP_LT_OQ>(data, count, value, done); break;
+        case Compare::LessEqual: matches = countDoubleLoop<_CMP_LE_OQ>(data, count, value, done); break;
+        case Compare::Greater: matches = countDoubleLoop<_CMP_GT_OQ>(data, count, value, done); break;
+        case Compare::GreaterEqual: matches = countDoubleLoop<_CMP_GE_OQ>(data, count, value, done); break;
+        case Compare::Equal: matches = countDoubleLoop<_CMP_EQ_OQ>(data, count, value, done); break;
+        case Compare::NotEqual: matches = countDoubleLoop<_CMP_NEQ_UQ>(data, count, value, done); break;
+    }
+    return matches + countDoubleScalar(data + done, count - done, op, value);
+}
+
+VANCTION_AVX2 void scaleIntAvx2(const int* data, int factor, int* out, size_t count) {
+    __m256i k = _mm256_set1_epi32(factor);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(v, k));
+    }
+    scaleIntScalar(data + i, factor, out + i, count - i);
+}
+
+VANCTION_AVX2 void scaleDoubleAvx2(const double* data, double factor, double* out, size_t count) {
+    __m256d k = _mm256_set1_pd(factor);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(data + i), k));
+    }
+    scaleDoubleScalar(data + i, factor, out + i, count - i);
+}
+
+VANCTION_AVX2 void addIntAvx2(const int* left, const int* right, int* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(a, b));
+    }
+    addIntScalar(left + i, right + i, out + i, count - i);
+}
+
+VANCTION_AVX2 void addDoubleAvx2(const double* left, const double* right, double* out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+    }
+    addDoubleScalar(left + i, right + i, out + i, count - i);
+}
+
+VANCTION_AVX2 void clampIntAvx2(const int* data, int low, int high, int* out, size_t count) {
+    __m256i lowLanes = _mm256_set1_epi32(low);
+    __m256i highLanes = _mm256_set1_epi32(high);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_min_epi32(_mm256_max_epi32(v, lowLanes), highLanes));
+    }
+    clampIntScalar(data + i, low, high, out + i, count - i);
+}
+
+// Bounds go first so that NaN elements pass through, as with std::max/std::min
+VANCTION_AVX2 void clampDoubleAvx2(const double* data, double low, double high, double* out, size_t count) {
+    __m256d lowLanes = _mm256_set1_pd(low);
+    __m256d highLanes = _mm256_set1_pd(high);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_max_pd(lowLanes, _mm256_loadu_pd(data + i));
+        _mm256_storeu_pd(out + i, _mm256_min_pd(highLanes, v));
+    }
+    clampDoubleScalar(data + i, low, high, out + i, count - i);
+}
+
+#endif // VANCTION_AVX2_KERNELS
+
+// ---------------------------------------------------------------------------
+// Kernel selection
+// ---------------------------------------------------------------------------
+
+struct KernelTable {
+    const char* name;
+    int64_t (*sumInt)(const int*, size_t);
+    double (*sumDouble)(const double*, size_t);
+    int (*minInt)(const int*, size_t);
+    double (*minDouble)(const double*, size_t);
+    int (*maxInt)(const int*, size_t);
+    double (*maxDouble)(const double*, size_t);
+    int64_t (*dotInt)(const int*, const int*, size_t);
+    double (*dotDouble)(const double*, const double*, size_t);
+    size_t (*countInt)(const int*, size_t, Compare, int);
+    size_t (*countDouble)(const double*, size_t, Compare, double);
+    void (*scaleInt)(const int*, int, int*, size_t);
+    void (*scaleDouble)(const double*, double, double*, size_t);
+    void (*addInt)(const int*, const int*, int*, size_t);
+    void (*addDouble)(const double*, const double*, double*, size_t);
+    void (*clampInt)(const int*, int, int, int*, size_t);
+    void (*clampDouble)(const double*, double, double, double*, size_t);
+};
+
+KernelTable selectKernels() {
+#ifdef VANCTION_AVX2_KERNELS
+    if (__builtin_cpu_supports("avx2")) {
+        return KernelTable{
+            "avx2",
+            sumIntAvx2, sumDoubleAvx2, minIntAvx2, minDoubleAvx2, maxIntAvx2, maxDoubleAvx2,
+            dotIntAvx2, dotDoubleAvx2, countIntAvx2, countDoubleAvx2,
+            scaleIntAvx2, scaleDoubleAvx2, addIntAvx2, addDoubleAvx2, clampIntAvx2, clampDoubleAvx2
+        };
+    }
+#endif
+    return KernelTable{
+        "scalar",
+        sumIntScalar, sumDoubleScalar, minIntScalar, minDoubleScalar, maxIntScalar, maxDoubleScalar,
+        dotIntScalar, dotDoubleScalar, countIntScalar, countDoubleScalar,
+        scaleIntScalar, scaleDoubleScalar, addIntScalar, addDoubleScalar, clampIntScalar, clampDoubleScalar
+    };
+}
+
+const KernelTable& kernels() {
+    static const KernelTable table = selectKernels();
+    return table;
+}
+
+} // namespace
+
+int64_t sum(const int* data, size_t count) { return kernels().sumInt(data, count); }
+double sum(const double* data, size_t count) { return kernels().sumDouble(data, count); }
+int min(const int* data, size_t count) { return kernels().minInt(data, count); }
+double min(const double* data, size_t count) { return kernels().minDouble(data, count); }
+int max(const int* data, size_t count) { return kernels().maxInt(data, count); }
+double max(const double* data, size_t count) { return kernels().maxDouble(data, count); }
+int64_t dot(const int* left, const int* right, size_t count) { return kernels().dotInt(left, right, count); }
+double dot(const double* left, const double* right, size_t count) { return kernels().dotDouble(left, right, count); }
+
+size_t countIf(const int* data, size_t count, Compare op, int value) {
+    return kernels().countInt(data, count, op, value);
+}
+
+size_t countIf(const double* data, size_t count, Compare op, double value) {
+    return kernels().countDouble(data, count, op, value);
+}
+
+void scale(const int* data, int factor, int* out, size_t count) { kernels().scaleInt(data, factor, out, count); }
+void scale(const double* data, double factor, double* out, size_t count) { kernels().scaleDouble(data, factor, out, count); }
+void add(const int* left, const int* right, int* out, size_t count) { kernels().addInt(left, right, out, count); }
+void add(const double* left, const double* right, double* out, size_t count) { kernels().addDouble(left, right, out, count); }
+void clamp(const int* data, int low, int high, int* out, size_t count) { kernels().clampInt(data, low, high, out, count); }
+void clamp(const double* data, double low, double high, double* out, size_t count) { kernels().clampDouble(data, low, high, out, count); }
+
+const char* implementation() {
+    return kernels().name;
+}
+
+} // namespace list_kernels
+
+// ---------------------------------------------------------------------------
+// List methods
+// ---------------------------------------------------------------------------
+
+namespace {
+
+using list_kernels::Compare;
+
+// Elements of a numeric list: the packed ints, or doubles (packed or converted)
+struct NumericElements {
+    bool isInt = true;
+    const int* ints = nullptr;
+    const double* doubles = nullptr;
+    size_t size = 0;
+    std::vector<double> converted;
+};
+
+bool isNumber(const Value& value) {
+    return value.isInt() || value.isFloat() || value.isDouble();
+}
+
+double toDouble(const Value& value) {
+    if (value.isInt()) {
+        return value.asInt();
+    } else if (value.isFloat()) {
+        return value.asFloat();
+    }
+    return value.asDouble();
+}
+
+NumericElements numericElements(const List* list, const std::string& method) {
+    NumericElements result;
+    switch (list->storage()) {
+        case List::Storage::Empty:
+            break;
+        case List::Storage::Int:
+            result.ints = list->intElements().data();
+            result.size = list->intElements().size();
+            break;
+        case List::Storage::Double:
+            result.isInt = false;
+            result.doubles = list->doubleElements().data();
+            result.size = list->doubleElements().size();
+            break;
+        case List::Storage::Bool:
+            throw vanction_error::TypeError("List." + method + "() expects a list of numbers");
+        case List::Storage::Generic:
+            result.isInt = false;
+            result.converted.reserve(list->values().size());
+            for (const auto& element : list->values()) {
+                if (!isNumber(element)) {
+                    throw vanction_error::TypeError("List." + method + "() expects a list of numbers");
+                }
+                result.converted.push_back(toDouble(element));
+            }
+            result.doubles = result.converted.data();
+            result.size = result.converted.size();
+            break;
+    }
+    return result;
+}
+
+// Switch an int list over to doubles, for operations mixing it with double operands
+void widen(NumericElements& elements) {
+    if (!elements.isInt) {
+        return;
+    }
+    elements.converted.assign(elements.ints, elements.ints + elements.size);
+    elements.isInt = false;
+    elements.doubles = elements.converted.data();
+}
+
+double numberArgument(const Value& value, const std::string& method) {
+    if (!isNumber(value)) {
+        throw vanction_error::TypeError("List." + method + "() expects a number");
+    }
+    return toDouble(value);
+}
+
+void expectArguments(const std::vector<Value>& args, size_t count, const std::string& method) {
+    if (args.size() != count) {
+        throw vanction_error::MethodError("List." + method + "() expects exactly " + std::to_string(count) + " argument" + (count == 1 ? "" : "s"));
+    }
+}
+
+Compare compareOperator(const Value& value) {
+    if (value.isString()) {
+        std::string_view op = value.asString();
+        if (op == "<") return Compare::Less;
+        if (op == "<=") return Compare::LessEqual;
+        if (op == ">") return Compare::Greater;
+        if (op == ">=") return Compare::GreaterEqual;
+        if (op == "==") return Compare::Equal;
+        if (op == "!=") return Compare::NotEqual;
+    }
+    throw vanction_error::ValueError("List.count() expects one of \"<\", \"<=\", \">\", \">=\", \"==\", \"!=\"");
+}
+
+List* packedList(std::vector<int> values) {
+    List* list = heap.newList();
+    list->assign(std::move(values));
+    return list;
+}
+
+List* packedList(std::vector<double> values) {
+    List* list = heap.newList();
+    list->assign(std::move(values));
+    return list;
+}
+
+} // namespace
+
+bool isListAggregate(const std::string& name) {
+    return name == "sum" || name == "min" || name == "max" || name == "mean" || name == "dot"
+        || name == "scale" || name == "plus" || name == "clamp" || name == "count";
+}
+
+Value callListAggregate(List* list, const std::string& name, const std::vector<Value>& args) {
+    NumericElements elements = numericElements(list, name);
+    
+    if (name == "sum" || name == "mean" || name == "min" || name == "max") {
+        expectArguments(args, 0, name);
+        if (elements.size == 0 && name != "sum") {
+            throw vanction_error::ValueError("List." + name + "() of an empty list");
+        }
+        if (name == "sum") {
+            // Int sums wrap around like repeated int additions
+            return elements.isInt ? Value(static_cast<int>(list_kernels::sum(elements.ints, elements.size)))
+                                  : Value(list_kernels::sum(elements.doubles, elements.size));
+        } else if (name == "mean") {
+            double total = elements.isInt ? static_cast<double>(list_kernels::sum(elements.ints, elements.size))
+                                          : list_kernels::sum(elements.doubles, elements.size);
+            return total / static_cast<double>(elements.size);
+        } else if (name == "min") {
+            return elements.isInt ? Value(list_kernels::min(elements.ints, elements.size))
+                                  : Value(list_kernels::min(elements.doubles, elements.size));
+        }
+        return elements.isInt ? Value(list_kernels::max(elements.ints, elements.size))
+                              : Value(list_kernels::max(elements.doubles, elements.size));
+    }
+    
+    if (name == "dot" || name == "plus") {
+        expectArguments(args, 1, name);
+        if (!args[0].isList()) {
+            throw vanction_error::TypeError("List." + name + "() expects a list");
+        }
+        NumericElements other = numericElements(args[0].asList(), name);
+        if (other.size != elements.size) {
+            throw vanction_error::ValueError("List." + name + "() expects lists of the same length");
+        }
+        if (!elements.isInt || !other.isInt) {
+            widen(elements);
+            widen(other);
+        }
+        if (name == "dot") {
+            return elements.isInt ? Value(static_cast<int>(list_kernels::dot(elements.ints, other.ints, elements.size)))
+                                  : Value(list_kernels::dot(elements.doubles, other.doubles, elements.size));
+        }
+        if (elements.isInt) {
+            std::vector<int> result(elements.size);
+            list_kernels::add(elements.ints, other.ints, result.data(), elements.size);
+            return packedList(std::move(result));
+        }
+        std::vector<double> result(elements.size);
+        list_kernels::add(elements.doubles, other.doubles, result.data(), elements.size);
+        return packedList(std::move(result));
+    }
+    
+    if (name == "scale") {
+        expectArguments(args, 1, name);
+        double factor = numberArgument(args[0], name);
+        if (elements.isInt && args[0].isInt()) {
+            std::vector<int> result(elements.size);
+            list_kernels::scale(elements.ints, args[0].asInt(), result.data(), elements.size);
+            return packedList(std::move(result));
+        }
+        widen(elements);
+        std::vector<double> result(elements.size);
+        list_kernels::scale(elements.doubles, factor, result.data(), elements.size);
+        return packedList(std::move(result));
+    }
+    
+    if (name == "clamp") {
+        expectArguments(args, 2, name);
+        double low = numberArgument(args[0], name);
+        double high = numberArgument(args[1], name);
+        if (low > high) {
+            throw vanction_error::ValueError("List.clamp() expects low <= high");
+        }
+        if (elements.isInt && args[0].isInt() && args[1].isInt()) {
+            std::vector<int> result(elements.size);
+            list_kernels::clamp(elements.ints, args[0].asInt(), args[1].asInt(), result.data(), elements.size);
+            return packedList(std::move(result));
+        }
+        widen(elements);
+        std::vector<double> result(elements.size);
+        list_kernels::clamp(elements.doubles, low, high, result.data(), elements.size);
+        return packedList(std::move(result));
+    }
+    
+    // count(value) counts equal elements, count(op, value) compares with "<", "<=", ">", ">=", "==" or "!="
+    if (args.empty() || args.size() > 2) {
+        throw vanction_error::MethodError("List.count() expects 1 or 2 arguments");
+    }
+    Compare op = args.size() == 2 ? compareOperator(args[0]) : Compare::Equal;
+    const Value& value = args.back();
+    double number = numberArgument(value, name);
+    if (elements.isInt && value.isInt()) {
+        return static_cast<int>(list_kernels::countIf(elements.ints, elements.size, op, value.asInt()));
+    }
+    widen(elements);
+    return static_cast<int>(list_kernels::countIf(elements.doubles, elements.size, op, number));
+}
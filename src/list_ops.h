@@ -0,0 +1,60 @@
+#ifndef VANCTION_LIST_OPS_H
+#define VANCTION_LIST_OPS_H
+
+#include "runtime.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Numeric List methods: sum, min, max, mean, dot, scale, plus, clamp and count
+// They run on the packed int and double storage of a list; generic lists of numbers are
+// converted to doubles first
+
+// Whether a List method name is one of the numeric list operations
+bool isListAggregate(const std::string& name);
+
+// Apply a numeric list operation to already evaluated arguments
+Value callListAggregate(List* list, const std::string& name, const std::vector<Value>& args);
+
+// Kernels over packed arrays, selected once at runtime:
+// AVX2 when the CPU supports it, plain loops otherwise
+namespace list_kernels {
+
+enum class Compare : unsigned char {
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual
+};
+
+// Reductions (min and max expect at least one element)
+int64_t sum(const int* data, size_t count);
+double sum(const double* data, size_t count);
+int min(const int* data, size_t count);
+double min(const double* data, size_t count);
+int max(const int* data, size_t count);
+double max(const double* data, size_t count);
+int64_t dot(const int* left, const int* right, size_t count);
+double dot(const double* left, const double* right, size_t count);
+
+// Number of elements for which "element op value" holds
+size_t countIf(const int* data, size_t count, Compare op, int value);
+size_t countIf(const double* data, size_t count, Compare op, double value);
+
+// Element-wise operations into out (int arithmetic wraps around like the language's)
+void scale(const int* data, int factor, int* out, size_t count);
+void scale(const double* data, double factor, double* out, size_t count);
+void add(const int* left, const int* right, int* out, size_t count);
+void add(const double* left, const double* right, double* out, size_t count);
+void clamp(const int* data, int low, int high, int* out, size_t count);
+void clamp(const double* data, double low, double high, double* out, size_t count);
+
+// Name of the kernel set in use: "avx2" or "scalar"
+const char* implementation();
+
+} // namespace list_kernels
+
+#endif // VANCTION_LIST_OPS_H
@@ -2,6 +2,13 @@
 #include "code_generator.h"
 #include "error.h"
 #include "module_manager.h"
+#include "resolver.h"
+#include "runtime.h"
+#include "list_ops.h"
+#include "optimizer.h"
+#include "native_tier.h"
+#include "switch_table.h"
+#include "vm.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -12,6 +19,11 @@
 #include <any>
 #include <stdexcept>
 #include <functional>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <climits>
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -52,8 +64,8 @@ void writeFile(const std::string& filePath, const std::string& content) {
     file.close();
 }
 
-// Call external compiler
-int compileWithGCC(const std::string& cppFile, const std::string& outputFile) {
+// Compiler command of the GCC setting
+std::string getCompilerPath() {
     std::string gccPath = config["GCC"];
     
     // If GCC path is AUTO_GCC, use path relative to executable or project root
@@ -74,7 +86,12 @@ int compileWithGCC(const std::string& cppFile, const std::string& outputFile) {
         gccPath = projectRoot + "\\mingw64\\bin\\g++.exe";
     }
     
-    std::string command = gccPath + " " + cppFile + " -o " + outputFile;
+    return gccPath;
+}
+
+// Call external compiler
+int compileWithGCC(const std::string& cppFile, const std::string& outputFile) {
+    std::string command = getCompilerPath() + " " + cppFile + " -o " + outputFile;
     std::cout << "Executing command: " << command << std::endl;
     
     return system(command.c_str());
@@ -150,139 +167,590 @@ std::string getFileNameWithoutExt(const std::string& filePath) {
     return filePath.substr(0, dotPos);
 }
 
-// Forward declarations for data structures
-class List;
-class HashMap;
+// Frame of the function currently being executed (nullptr outside of functions)
+Frame* currentFrame = nullptr;
+Frame* liveFrames = nullptr;
 
-// Type for variable values - extended to include data structures and Instance* for objects
-// Forward declaration for Instance type
-class Instance;
+// Global environments
+std::map<std::string, Value> variables;
+std::map<std::string, Value> constants; // Store constants (immut variables)
+std::map<std::string, SlotType> variableTypes; // Store variable types
+std::map<std::string, FunctionDeclaration*> functions;
+std::vector<Value> pendingTailCall;
+ErrorResult errorResult;
+std::map<std::string, std::map<std::string, FunctionDeclaration*>> namespaces;
+std::map<std::string, ClassDefinition*> classes; // Store class definitions
+unsigned classEpoch = 1;
+std::map<std::string, std::string> cModules; // Store C++ modules mapping
 
-// Define Value type
-using Value = std::variant<int, char, std::string, bool, float, double, std::monostate, Instance*, ErrorObject*, List*, HashMap*, LambdaExpression*, FunctionDeclaration*>;
+// Bumped by every declaration of a function, namespace, class or module, invalidating linked calls
+size_t linkEpoch = 1;
 
-// Class definition structure
-struct ClassDefinition {
-    std::string name;
-    std::string baseClassName;
-    std::vector<InstanceMethodDeclaration*> instanceMethods;
-    std::vector<ClassMethodDeclaration*> classMethods;
-    InstanceMethodDeclaration* initMethod;
-};
+// Linked calls are valid while this stays the same: entries of the global maps are never erased,
+// so the sum only changes with a declaration or a new global name, which may redirect a call
+size_t linkStamp() {
+    return linkEpoch + variables.size() + constants.size();
+}
 
-// List data structure implementation
-class List {
-public:
-    List() {}
-    
-    std::vector<Value> elements;
+// Initialize global constants
+void initializeConstants() {
+    // Boolean constants
+    constants["true"] = true;
+    constants["false"] = false;
+    variableTypes["true"] = SlotType::Bool;
+    variableTypes["false"] = SlotType::Bool;
+}
+
+// Create the frame for a call
+// Frames never outlive their call: closures capture single variables through upvalues
+Frame* enterFrame(std::optional<Frame>& storage, const FrameLayout& layout, Closure* closure, size_t minSlots) {
+    storage.emplace(&layout, closure, minSlots);
+    return &*storage;
+}
+
+// Upvalue of the closure being executed (nullptr when the function has no closure)
+Upvalue* upvalueAt(int index) {
+    if (!currentFrame || !currentFrame->closure) {
+        return nullptr;
+    }
+    return currentFrame->closure->upvalues[index];
+}
+
+// Find or create the upvalue for a slot of the current frame
+// Closures capturing the same variable of one call share its upvalue
+Upvalue* captureSlot(int slot) {
+    Value* location = &currentFrame->slots[slot];
+    for (Upvalue* upvalue = currentFrame->openUpvalues; upvalue; upvalue = upvalue->nextOpen) {
+        if (upvalue->location == location) {
+            return upvalue;
+        }
+    }
+    Upvalue* upvalue = heap.newUpvalue(location, &currentFrame->types[slot]);
+    upvalue->nextOpen = currentFrame->openUpvalues;
+    currentFrame->openUpvalues = upvalue;
+    return upvalue;
+}
+
+// Create a closure capturing the free variables listed by the layout
+Closure* makeClosure(FunctionDeclaration* function, LambdaExpression* lambda, const FrameLayout& layout) {
+    Closure* closure = heap.newClosure(function, lambda);
+    closure->upvalues.reserve(layout.upvalues.size());
+    for (const auto& descriptor : layout.upvalues) {
+        if (descriptor.fromEnclosingSlot) {
+            closure->upvalues.push_back(captureSlot(descriptor.index));
+        } else {
+            closure->upvalues.push_back(upvalueAt(descriptor.index));
+        }
+    }
+    return closure;
+}
+
+// Type tag recorded when a variable is declared with an initializer
+SlotType declaredTypeOf(const Value& value) {
+    if (value.isInt()) {
+        return SlotType::Int;
+    } else if (value.isChar()) {
+        return SlotType::Char;
+    } else if (value.isString()) {
+        return SlotType::String;
+    } else if (value.isBool()) {
+        return SlotType::Bool;
+    } else if (value.isFloat()) {
+        return SlotType::Float;
+    } else if (value.isDouble()) {
+        return SlotType::Double;
+    } else if (value.isInstance()) {
+        return SlotType::Instance;
+    }
+    return SlotType::Unknown;
+}
+
+// Type tag of a value being assigned to an existing variable
+SlotType assignedTypeOf(const Value& value) {
+    if (value.isList()) {
+        return SlotType::List;
+    } else if (value.isHashMap()) {
+        return SlotType::HashMap;
+    }
+    return declaredTypeOf(value);
+}
+
+// Type name used in type mismatch errors
+std::string slotTypeName(SlotType type) {
+    switch (type) {
+        case SlotType::Auto: return "auto";
+        case SlotType::Function: return "function";
+        case SlotType::Int: return "int";
+        case SlotType::Char: return "char";
+        case SlotType::String: return "string";
+        case SlotType::Bool: return "bool";
+        case SlotType::Float: return "float";
+        case SlotType::Double: return "double";
+        case SlotType::Instance: return "instance";
+        case SlotType::List: return "list";
+        case SlotType::HashMap: return "hashmap";
+        default: return "unknown";
+    }
+}
+
+// Check that a value may be assigned to a variable of the given type
+void checkSlotAssignment(SlotType existingType, const Value& value) {
+    if (existingType == SlotType::None || existingType == SlotType::Unknown) {
+        return;
+    }
+    SlotType newValueType = assignedTypeOf(value);
+    if (newValueType != SlotType::Unknown && existingType != newValueType) {
+        throw vanction_error::MethodError("Type mismatch: cannot assign '" + slotTypeName(newValueType) + "' to variable of type '" + slotTypeName(existingType) + "'");
+    }
+}
+
+// Store a value in a resolved local slot, or in the global environment for unresolved names
+void storeVariable(int slot, const std::string& name, const Value& value) {
+    if (slot >= 0 && currentFrame) {
+        currentFrame->slots[slot] = value;
+    } else {
+        variables[name] = value;
+    }
+}
+
+// A for-in loop about to bind its variables, which must not name a constant
+void checkLoopBinding(ForInLoopStatement* stmt) {
+    if (!stmt->boundConstant.empty()) {
+        throw vanction_error::ImmutError("Cannot assign to constant '" + stmt->boundConstant + "'");
+    }
+}
+
+// Bounds of a counted for-in loop; missing bounds default to range(0, 0, 1)
+RangeLoop makeRangeLoop(const Value& start, const Value& end, const Value& step) {
+    const Value* bounds[] = {&start, &end, &step};
+    ValueType type = ValueType::Int;
+    for (const Value* bound : bounds) {
+        if (bound->isDouble()) {
+            type = ValueType::Double;
+        } else if (bound->isFloat()) {
+            type = (type == ValueType::Double) ? type : ValueType::Float;
+        } else if (!bound->isInt() && !bound->isNil()) {
+            throw vanction_error::TypeError("range() expects numeric bounds");
+        }
+    }
     
-    // Add element to list
-    void add(Value element) {
-        elements.push_back(element);
+    RangeLoop range;
+    range.type = type;
+    if (type == ValueType::Int) {
+        range.start = start.isInt() ? start.asInt() : 0;
+        int64_t last = end.isInt() ? end.asInt() : 0;
+        range.step = step.isInt() ? step.asInt() : 1;
+        if (range.step == 0) {
+            throw vanction_error::ValueError("range() step must not be zero");
+        }
+        if (range.step > 0 && last > range.start) {
+            range.count = static_cast<uint64_t>((last - range.start + range.step - 1) / range.step);
+        } else if (range.step < 0 && last < range.start) {
+            range.count = static_cast<uint64_t>((range.start - last - range.step - 1) / -range.step);
+        }
+        return range;
     }
     
-    // Get element by index (supports negative indices)
-    Value get(int index) {
-        if (index < 0) {
-            index = elements.size() + index;
+    auto toReal = [](const Value& bound, double fallback) {
+        if (bound.isInt()) {
+            return static_cast<double>(bound.asInt());
+        } else if (bound.isFloat()) {
+            return static_cast<double>(bound.asFloat());
+        }
+        return bound.isDouble() ? bound.asDouble() : fallback;
+    };
+    range.realStart = toReal(start, 0.0);
+    range.realStep = toReal(step, 1.0);
+    if (range.realStep == 0.0) {
+        throw vanction_error::ValueError("range() step must not be zero");
+    }
+    // The loop variable is start + i * step, so rounding errors do not pile up across iterations
+    double steps = std::ceil((toReal(end, 0.0) - range.realStart) / range.realStep);
+    if (steps >= 18446744073709551616.0) {
+        throw vanction_error::ValueError("range() has too many steps");
+    }
+    range.count = steps > 0 ? static_cast<uint64_t>(steps) : 0;
+    return range;
+}
+
+// Text of a hash map key when printing a map
+std::string hashMapKeyText(const Value& key) {
+    switch (key.type()) {
+        case ValueType::String: return std::string(key.asString());
+        case ValueType::Int: return std::to_string(key.asInt());
+        case ValueType::Float: return std::to_string(key.asFloat());
+        case ValueType::Double: return std::to_string(key.asDouble());
+        case ValueType::Bool: return key.asBool() ? "true" : "false";
+        case ValueType::Char: return std::string(1, key.asChar());
+        default: return "";
+    }
+}
+
+// Look a variable up by name in the current frame, its upvalues, then the global environment
+// Only used where names are not resolved ahead of time (format strings)
+bool lookupVariable(const std::string& name, Value& value) {
+    if (currentFrame) {
+        const auto& slotNames = currentFrame->layout->slotNames;
+        for (size_t i = 0; i < slotNames.size(); ++i) {
+            if (slotNames[i] == name) {
+                value = currentFrame->slots[i];
+                return true;
+            }
         }
-        if (index < 0 || index >= elements.size()) {
-                throw vanction_error::ListIndexError("List index out of range", 0, 0);
+        const auto& upvalues = currentFrame->layout->upvalues;
+        for (size_t i = 0; i < upvalues.size(); ++i) {
+            Upvalue* upvalue = upvalueAt(static_cast<int>(i));
+            if (upvalues[i].name == name && upvalue) {
+                value = *upvalue->location;
+                return true;
             }
-        return elements[index];
+        }
+    }
+    auto it = variables.find(name);
+    if (it != variables.end()) {
+        value = it->second;
+        return true;
+    }
+    return false;
+}
+
+// Global entry an identifier refers to: constants first, then variables
+Value* globalBinding(Identifier* ident) {
+    if (ident->quickened == Quickened::GlobalLoad && ident->globalGuard == constants.size()) {
+        return ident->global;
     }
     
-    // Set element by index (supports negative indices)
-    void set(int index, Value element) {
-        if (index < 0) {
-            index = elements.size() + index;
+    Value* entry = nullptr;
+    auto constIt = constants.find(ident->name);
+    if (constIt != constants.end()) {
+        entry = &constIt->second;
+    } else {
+        auto varIt = variables.find(ident->name);
+        if (varIt == variables.end()) {
+            return nullptr;
         }
-        if (index < 0 || index >= elements.size()) {
-                throw vanction_error::ListIndexError("List index out of range", 0, 0);
-            }
-        elements[index] = element;
+        entry = &varIt->second;
     }
     
-    // Get list size
-    int size() {
-        return elements.size();
+    ident->quickened = Quickened::GlobalLoad;
+    ident->global = entry;
+    ident->globalGuard = constants.size();
+    return entry;
+}
+
+// Global entry holding the function or lambda a plain-name call refers to: constants first, then variables
+Value* globalCallee(FunctionCall* call) {
+    auto isCallable = [](const Value& val) {
+        return val.isLambda() || val.isFunction();
+    };
+    if (call->quickened == Quickened::DirectCall && call->globalGuard == constants.size() && isCallable(*call->global)) {
+        return call->global;
     }
-};
+    
+    Value* entry = nullptr;
+    auto constIt = constants.find(call->methodName);
+    if (constIt != constants.end() && isCallable(constIt->second)) {
+        entry = &constIt->second;
+    } else {
+        auto varIt = variables.find(call->methodName);
+        if (varIt == variables.end() || !isCallable(varIt->second)) {
+            return nullptr;
+        }
+        entry = &varIt->second;
+    }
+    
+    call->quickened = Quickened::DirectCall;
+    call->global = entry;
+    call->globalGuard = constants.size();
+    return entry;
+}
+
+// Append the text of a {name} placeholder of a format string
+// Names that are not defined, and values other than strings, numbers and bools, read as "undefined"
+void appendFormatValue(std::string& out, Identifier* variable) {
+    Value val;
+    bool found = false;
+    if (variable->slot >= 0 && currentFrame) {
+        val = currentFrame->slots[variable->slot];
+        found = true;
+    } else if (Upvalue* upvalue = variable->upvalue >= 0 ? upvalueAt(variable->upvalue) : nullptr) {
+        val = *upvalue->location;
+        found = true;
+    } else {
+        found = lookupVariable(variable->name, val);
+    }
+    
+    if (!found) {
+        out += "undefined";
+    } else if (val.isString()) {
+        out.append(val.asString());
+    } else if (val.isInt()) {
+        out += std::to_string(val.asInt());
+    } else if (val.isFloat()) {
+        out += std::to_string(val.asFloat());
+    } else if (val.isDouble()) {
+        out += std::to_string(val.asDouble());
+    } else if (val.isBool()) {
+        out += val.asBool() ? "true" : "false";
+    } else {
+        out += "undefined";
+    }
+}
 
-// HashMap data structure implementation
-class HashMap {
-public:
-    HashMap() {}
+// Forward declarations for execute functions
+Value executeFunctionDeclaration(FunctionDeclaration* func);
+Value executeStatement(ASTNode* stmt, Completion* completion);
+Value executeExpression(Expression* expr);
+Value executeFunctionCall(FunctionCall* call);
+void executeClassDeclaration(ClassDeclaration* cls);
+
+// Leave a call to a function value pending as the tail call of the running body
+// Returns false for calls to anything else, which run as regular calls
+bool scheduleTailCall(FunctionCall* call) {
+    Value callee;
+    if (!lookupCallee(call, callee) || !callee.isFunction()) {
+        return false;
+    }
     
-    std::map<std::string, Value> entries;
+    // Arguments are evaluated before anything is left pending, since they may make calls themselves
+    std::vector<Value> args;
+    GcVectorRoot argRoot(args);
+    args.push_back(callee);
+    for (auto argExpr : call->arguments) {
+        args.push_back(executeExpression(argExpr));
+    }
+    pendingTailCall = std::move(args);
+    return true;
+}
+
+// Run the statements of a function body in the current frame, leaving a tail call it ends with pending
+// Sets returned when a return statement completed the function
+Value runFunctionStatements(FunctionDeclaration* func, bool keepLastValue, bool* returned = nullptr) {
+    if (useBytecodeVM) {
+        return runFunctionBody(func, keepLastValue, returned);
+    }
     
-    // Get value by key with default support
-    Value get(const std::string& key, Value defaultValue = std::monostate{}) {
-        if (entries.find(key) != entries.end()) {
-            return entries[key];
+    Value result = std::monostate{};
+    for (auto stmt : func->body) {
+        Completion completion;
+        Value stmtResult = executeStatement(stmt, &completion);
+        if (completion.type == CompletionType::Return) {
+            if (returned) {
+                *returned = true;
+            }
+            return stmtResult;
+        }
+        if (keepLastValue) {
+            result = stmtResult;
+        }
+    }
+    return result;
+}
+
+// Make pending tail calls one after another, each in a fresh frame once the previous one is released,
+// so chains of them (self or mutual recursion) run in constant native stack
+Value runTailCalls() {
+    Value result = std::monostate{};
+    std::vector<Value> call;
+    GcVectorRoot callRoot(call);
+    while (!pendingTailCall.empty()) {
+        call.swap(pendingTailCall);
+        pendingTailCall.clear();
+        
+        Closure* closure = call[0].asClosure();
+        FunctionDeclaration* func = closure->function;
+        if (debugMode) {
+            std::cout << "[DEBUG] Function call: " << func->name << "(" << call.size() - 1 << " arguments)" << std::endl;
+        }
+        if (nativeTier.enabled() && nativeTier.call(func, call.data() + 1, call.size() - 1, result)) {
+            continue;
         }
-        return defaultValue;
+        std::optional<Frame> storage;
+        Frame* frame = enterFrame(storage, func->layout, closure, func->parameters.size());
+        for (size_t i = 0; i < func->parameters.size() && i + 1 < call.size(); i++) {
+            frame->slots[i] = call[i + 1];
+            frame->types[i] = SlotType::Auto;
+        }
+        
+        FrameGuard guard(frame);
+        result = runFunctionStatements(func, true);
+    }
+    return result;
+}
+
+// Execute a function body in the current frame
+// Yields the value of the first return statement, or the last statement's value when keepLastValue is set
+Value executeFunctionBody(FunctionDeclaration* func, bool keepLastValue = false) {
+    Value result = runFunctionStatements(func, keepLastValue);
+    return pendingTailCall.empty() ? result : runTailCalls();
+}
+
+// Call a function value (top-level or nested function) with evaluated arguments
+Value callFunctionValue(Closure* closure, const Value* args, size_t argCount) {
+    FunctionDeclaration* func = closure->function;
+    
+    // Hot functions run as native code in tiered mode
+    Value nativeResult = std::monostate{};
+    if (nativeTier.enabled() && nativeTier.call(func, args, argCount, nativeResult)) {
+        return nativeResult;
     }
     
-    // Set value by key
-    void set(const std::string& key, Value value) {
-        entries[key] = value;
+    std::optional<Frame> storage;
+    Frame* frame = enterFrame(storage, func->layout, closure, func->parameters.size());
+    
+    // Assign arguments to parameters in the function's frame
+    for (size_t i = 0; i < func->parameters.size() && i < argCount; i++) {
+        frame->slots[i] = args[i];
+        frame->types[i] = SlotType::Auto;
     }
     
-    // Get all keys as List
-    List* keys() {
-        List* keyList = new List();
-        for (auto& entry : entries) {
-            keyList->add(std::string(entry.first));
-        }
-        return keyList;
+    FrameGuard guard(frame);
+    return executeFunctionBody(func, true);
+}
+
+// Call a lambda with evaluated arguments
+Value callLambda(Closure* closure, const Value* args, size_t argCount) {
+    LambdaExpression* lambda = closure->lambda;
+    std::optional<Frame> storage;
+    Frame* frame = enterFrame(storage, lambda->layout, closure, lambda->parameters.size());
+    
+    // Assign arguments to parameters in the lambda's frame
+    for (size_t i = 0; i < lambda->parameters.size() && i < argCount; i++) {
+        frame->slots[i] = args[i];
+        frame->types[i] = SlotType::Auto;
     }
     
-    // Get all values as List
-    List* values() {
-        List* valueList = new List();
-        for (auto& entry : entries) {
-            valueList->add(entry.second);
+    FrameGuard guard(frame);
+    if (useBytecodeVM) {
+        return runLambdaBody(lambda);
+    }
+    return executeExpression(lambda->body);
+}
+
+// Bind the implicit instance of an instance method call
+// Init methods also receive the instance as their first declared parameter
+void bindInstance(Frame* frame, FunctionDeclaration* method, Instance* instance, bool isInitMethod) {
+    if (isInitMethod && !method->parameters.empty()) {
+        frame->slots[0] = instance;
+    }
+    if (method->layout.instanceSlot >= 0) {
+        frame->slots[method->layout.instanceSlot] = instance;
+    }
+}
+
+// Resolve the receiver of a method call: a local slot or upvalue first, then the global environment
+bool lookupCallObject(FunctionCall* call, Value& value) {
+    if (call->objectSlot >= 0 && currentFrame && !currentFrame->slots[call->objectSlot].isNil()) {
+        value = currentFrame->slots[call->objectSlot];
+        return true;
+    }
+    if (call->objectUpvalue >= 0) {
+        Upvalue* upvalue = upvalueAt(call->objectUpvalue);
+        if (upvalue && !upvalue->location->isNil()) {
+            value = *upvalue->location;
+            return true;
         }
-        return valueList;
     }
-};
+    auto it = variables.find(call->objectName);
+    if (it != variables.end()) {
+        value = it->second;
+        return true;
+    }
+    return false;
+}
 
-// Instance structure
-class Instance {
-public:
-    Instance(ClassDefinition* cls) : cls(cls) {}
+// Link a call site to its target, so calls skip comparing and looking up names until the link stamp changes
+void linkCall(FunctionCall* call) {
+    const std::string& object = call->objectName;
+    const std::string& method = call->methodName;
+    call->linkStamp = linkStamp();
+    call->targetFunction = nullptr;
+    call->targetClass = nullptr;
+    call->target = CallTarget::Dynamic;
     
-    ClassDefinition* cls;
-    std::map<std::string, Value> instanceVariables;
-};
-
-// Global environments
-std::map<std::string, Value> variables;
-std::map<std::string, Value> constants; // Store constants (immut variables)
-std::map<std::string, std::string> variableTypes; // Store variable types
-std::map<std::string, FunctionDeclaration*> functions;
-std::map<std::string, std::map<std::string, FunctionDeclaration*>> namespaces;
-std::map<std::string, ClassDefinition*> classes; // Store class definitions
-std::map<std::string, std::string> cModules; // Store C++ modules mapping
+    if (object.empty()) {
+        // Function values are looked up through the quickened global entry, declared functions here
+        auto funcIt = functions.find(method);
+        call->targetFunction = funcIt != functions.end() ? funcIt->second : nullptr;
+        call->target = method == "StringBuilder" && !call->targetFunction ? CallTarget::StringBuilder : CallTarget::Function;
+    } else if (object == "std:io" || object == "std.io") {
+        call->target = method == "print" ? CallTarget::IoPrint : method == "input" ? CallTarget::IoInput : CallTarget::IoOther;
+    } else if (object == "std:type" || object == "std.type" || object == "type") {
+        static const std::map<std::string, CallTarget> conversions = {
+            {"int", CallTarget::TypeInt}, {"float", CallTarget::TypeFloat}, {"double", CallTarget::TypeDouble},
+            {"char", CallTarget::TypeChar}, {"string", CallTarget::TypeString}
+        };
+        auto it = conversions.find(method);
+        call->target = it != conversions.end() ? it->second : CallTarget::TypeOther;
+    } else if (object == "class" || classes.find(object) != classes.end()) {
+        // class.method() calls methods of the Person class
+        auto classIt = classes.find(object == "class" ? "Person" : object);
+        call->target = CallTarget::ClassMethod;
+        call->targetClass = classIt != classes.end() ? classIt->second : nullptr;
+    } else if (call->objectSlot < 0 && call->objectUpvalue < 0 && variables.find(object) == variables.end()) {
+        // Not a receiver, so a namespace function (anything else keeps the dynamic path and its errors)
+        auto nsIt = namespaces.find(object);
+        if (nsIt != namespaces.end()) {
+            auto funcIt = nsIt->second.find(method);
+            if (funcIt != nsIt->second.end()) {
+                call->targetFunction = funcIt->second;
+                call->target = cModules.find(object) != cModules.end() ? CallTarget::ModuleFunction : CallTarget::NamespaceFunction;
+            }
+        }
+    }
+}
 
-// Initialize global constants
-void initializeConstants() {
-    // Boolean constants
-    constants["true"] = true;
-    constants["false"] = false;
-    variableTypes["true"] = "bool";
-    variableTypes["false"] = "bool";
+// Flatten the instance methods of a class and its base classes into its method table
+// Methods of a class override those of its bases; "__init__" falls back to the init method
+void buildMethodTable(ClassDefinition* classDef) {
+    std::vector<ClassDefinition*> chain;
+    for (ClassDefinition* current = classDef; current && chain.size() <= classes.size();) {
+        chain.push_back(current);
+        auto base = current->baseClassName.empty() ? classes.end() : classes.find(current->baseClassName);
+        current = base != classes.end() ? base->second : nullptr;
+    }
+    
+    classDef->methodTable.clear();
+    for (auto cls = chain.rbegin(); cls != chain.rend(); ++cls) {
+        if ((*cls)->initMethod) {
+            classDef->methodTable["__init__"] = (*cls)->initMethod;
+        }
+        // The first declaration of a name wins within one class
+        for (auto method = (*cls)->instanceMethods.rbegin(); method != (*cls)->instanceMethods.rend(); ++method) {
+            classDef->methodTable[(*method)->name] = *method;
+        }
+    }
+    classDef->methodTableEpoch = classEpoch;
 }
 
+// Find an instance method of a class, including inherited methods
+InstanceMethodDeclaration* findInstanceMethod(ClassDefinition* classDef, const std::string& name) {
+    if (classDef->methodTableEpoch != classEpoch) {
+        buildMethodTable(classDef);
+    }
+    auto it = classDef->methodTable.find(name);
+    return it != classDef->methodTable.end() ? it->second : nullptr;
+}
 
-// Forward declarations for execute functions
-Value executeFunctionDeclaration(FunctionDeclaration* func);
-Value executeStatement(ASTNode* stmt, bool* shouldReturn = nullptr);
-Value executeExpression(Expression* expr);
-Value executeFunctionCall(FunctionCall* call);
-void executeClassDeclaration(ClassDeclaration* cls);
+// Find the instance method a call site invokes on a receiver class through its inline cache
+InstanceMethodDeclaration* findInstanceMethod(FunctionCall* call, ClassDefinition* classDef) {
+    if (call->methodCacheEpoch != classEpoch) {
+        call->methodCacheCount = 0;
+        call->methodCacheEpoch = classEpoch;
+    }
+    for (int i = 0; i < call->methodCacheCount; ++i) {
+        if (call->methodCache[i].cls == classDef) {
+            return call->methodCache[i].method;
+        }
+    }
+    
+    // Megamorphic call sites keep using the method table
+    InstanceMethodDeclaration* method = findInstanceMethod(classDef, call->methodName);
+    if (method && call->methodCacheCount < FunctionCall::methodCacheSize) {
+        call->methodCache[call->methodCacheCount++] = FunctionCall::MethodCacheEntry{classDef, method};
+    }
+    return method;
+}
 
 // Execute class declaration
 void executeClassDeclaration(ClassDeclaration* cls) {
@@ -309,25 +777,30 @@ void executeClassDeclaration(ClassDeclaration* cls) {
     
     // Convert initMethod from ASTNode* to InstanceMethodDeclaration*
     if (cls->initMethod) {
-        classDef->initMethod = dynamic_cast<InstanceMethodDeclaration*>(cls->initMethod);
+        classDef->initMethod = nodeCast<InstanceMethodDeclaration>(cls->initMethod);
     }
     
     // Convert instanceMethods from vector<ASTNode*> to vector<InstanceMethodDeclaration*>
     for (auto method : cls->instanceMethods) {
-        if (auto instanceMethod = dynamic_cast<InstanceMethodDeclaration*>(method)) {
+        if (auto instanceMethod = nodeCast<InstanceMethodDeclaration>(method)) {
             classDef->instanceMethods.push_back(instanceMethod);
         }
     }
     
     // Convert methods to classMethods (since ClassDeclaration doesn't have classMethods directly)
     for (auto method : cls->methods) {
-        if (auto classMethod = dynamic_cast<ClassMethodDeclaration*>(method)) {
+        if (auto classMethod = nodeCast<ClassMethodDeclaration>(method)) {
             classDef->classMethods.push_back(classMethod);
+            classDef->classMethodTable.emplace(classMethod->name, classMethod);
         }
     }
     
     // Store class definition
+    // A new class may be the base of classes declared earlier, so their tables are rebuilt on next use
     classes[cls->name] = classDef;
+    ++classEpoch;
+    ++linkEpoch;
+    buildMethodTable(classDef);
     
     if (debugMode) {
         std::cout << "[DEBUG] Class " << cls->name << " definition stored successfully" << std::endl;
@@ -336,6 +809,8 @@ void executeClassDeclaration(ClassDeclaration* cls) {
 
 // Execute namespace declaration
 void executeNamespaceDeclaration(NamespaceDeclaration* ns) {
+    ++linkEpoch;
+    
     // Create namespace if it doesn't exist
     if (namespaces.find(ns->name) == namespaces.end()) {
         namespaces[ns->name] = std::map<std::string, FunctionDeclaration*>();
@@ -343,13 +818,13 @@ void executeNamespaceDeclaration(NamespaceDeclaration* ns) {
     
     // Execute declarations inside namespace
     for (auto decl : ns->declarations) {
-        if (auto func = dynamic_cast<FunctionDeclaration*>(decl)) {
+        if (auto func = nodeCast<FunctionDeclaration>(decl)) {
             // Store function in namespace
             namespaces[ns->name][func->name] = func;
-        } else if (auto nestedNs = dynamic_cast<NamespaceDeclaration*>(decl)) {
+        } else if (auto nestedNs = nodeCast<NamespaceDeclaration>(decl)) {
             // Execute nested namespace declaration
             executeNamespaceDeclaration(nestedNs);
-        } else if (auto cls = dynamic_cast<ClassDeclaration*>(decl)) {
+        } else if (auto cls = nodeCast<ClassDeclaration>(decl)) {
             // Execute class declaration within the namespace
             // For now, we'll just execute it as a regular class declaration
             executeClassDeclaration(cls);
@@ -507,6 +982,7 @@ void executeImportStatement(ImportStatement* importStmt) {
             }
         }
     }
+    ++linkEpoch;
 }
 
 // Create nested namespaces recursively
@@ -539,12 +1015,20 @@ Value executeProgram(Program* program, const std::string& namespaceName) {
         createNestedNamespaces(namespaceName);
     }
     
+    // Fold constants and trim dead branches before slots are assigned
+    optimizeProgram(program, OptimizationTarget::Interpreter);
+    
+    // Assign frame slots to all locals before anything runs
+    Resolver resolver;
+    resolver.resolve(program);
+    
     // Execute all declarations
     for (auto decl : program->declarations) {
-        if (auto func = dynamic_cast<FunctionDeclaration*>(decl)) {
+        if (auto func = nodeCast<FunctionDeclaration>(decl)) {
             if (!namespaceName.empty()) {
                 // If we're in a namespace, add the function to the namespace
                 namespaces[namespaceName][func->name] = func;
+                ++linkEpoch;
             } else {
                 Value result = executeFunctionDeclaration(func);
                 // If this is the main function, return its result
@@ -552,13 +1036,13 @@ Value executeProgram(Program* program, const std::string& namespaceName) {
                     return result;
                 }
             }
-        } else if (auto ns = dynamic_cast<NamespaceDeclaration*>(decl)) {
+        } else if (auto ns = nodeCast<NamespaceDeclaration>(decl)) {
             // Execute namespace declaration
             executeNamespaceDeclaration(ns);
-        } else if (auto cls = dynamic_cast<ClassDeclaration*>(decl)) {
+        } else if (auto cls = nodeCast<ClassDeclaration>(decl)) {
             // Execute class declaration
             executeClassDeclaration(cls);
-        } else if (auto importStmt = dynamic_cast<ImportStatement*>(decl)) {
+        } else if (auto importStmt = nodeCast<ImportStatement>(decl)) {
             // Execute import statement
             executeImportStatement(importStmt);
         }
@@ -570,69 +1054,158 @@ Value executeProgram(Program* program, const std::string& namespaceName) {
 Value executeFunctionDeclaration(FunctionDeclaration* func) {
     // Store function in global function environment
     functions[func->name] = func;
+    ++linkEpoch;
     
     // Add the function to the current variable environment as well
-    // This allows nested functions to be returned as values (closures)
-    variables[func->name] = func;
-    variableTypes[func->name] = "function";
+    // This allows functions to be passed around as values
+    func->closure = heap.newClosure(func, nullptr);
+    variables[func->name] = func->closure;
+    variableTypes[func->name] = SlotType::Function;
     
     // Only execute main function in interpret mode
     if (func->name == "main") {
-        // Execute function body
-        for (auto stmt : func->body) {
-            bool shouldReturn = false;
-            Value result = executeStatement(stmt, &shouldReturn);
-            if (shouldReturn) {
-                return result;
-            }
+        // Execute function body in its own frame
+        std::optional<Frame> storage;
+        Frame* frame = enterFrame(storage, func->layout, func->closure);
+        FrameGuard guard(frame);
+        bool returned = false;
+        Value result = runFunctionStatements(func, false, &returned);
+        if (!pendingTailCall.empty()) {
+            result = runTailCalls();
+        }
+        if (returned) {
+            return result;
         }
     }
     
-    // Return the function itself as a value, enabling closure functionality
-    // This allows nested functions to be returned and called later
-    return func;
+    // Return the function itself as a value
+    return func->closure;
+}
+
+// Run the statements of a loop, switch case, try or happen body until one completes abruptly
+// Returns how the body completed, with the value of a return in result
+Completion runBody(const std::vector<ASTNode*>& body, Value& result) {
+    for (auto stmt : body) {
+        Completion completion;
+        Value value = executeStatement(stmt, &completion);
+        if (completion.type != CompletionType::Normal) {
+            if (completion.type == CompletionType::Return) {
+                result = value;
+            }
+            return completion;
+        }
+    }
+    return Completion{};
+}
+
+// Builtin call making up the value of a statement (a call, or a declaration or assignment of one)
+// Try bodies take the errors of these calls as results, checked when the statement completes
+FunctionCall* resultCall(ASTNode* stmt) {
+    Expression* expr = nullptr;
+    if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
+        expr = exprStmt->expression;
+        if (auto assignExpr = nodeCast<AssignmentExpression>(expr)) {
+            expr = assignExpr->right;
+        }
+    } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+        expr = varDecl->initializer;
+    }
+    return expr ? nodeCast<FunctionCall>(expr) : nullptr;
+}
+
+// Run a try body like runBody, taking the errors of the calls statements are made of as results
+// Sets failed when a statement stopped with an error result, which is left in errorResult
+Completion runTryBody(const std::vector<ASTNode*>& body, Value& result, bool& failed) {
+    for (auto stmt : body) {
+        Completion completion;
+        Value value;
+        {
+            ErrorResultScope scope(resultCall(stmt));
+            value = executeStatement(stmt, &completion);
+        }
+        if (errorResult.raised) {
+            errorResult.raised = false;
+            failed = true;
+            return Completion{};
+        }
+        if (completion.type != CompletionType::Normal) {
+            if (completion.type == CompletionType::Return) {
+                result = value;
+            }
+            return completion;
+        }
+    }
+    return Completion{};
+}
+
+// Whether a loop runs its next iteration after its body completed with step
+// A return ends the loop with the returned value (a return completes the innermost loop), and a
+// break or continue of an enclosing loop ends it and is passed on to the loop around it
+bool nextIteration(const Completion& step, Completion* completion) {
+    switch (step.type) {
+        case CompletionType::Normal:
+            return true;
+        case CompletionType::Return:
+            return false;
+        default:
+            if (step.depth == 0) {
+                return step.type == CompletionType::Continue;
+            }
+            if (completion) {
+                *completion = Completion{step.type, step.depth - 1};
+            }
+            return false;
+    }
+}
+
+// Complete a switch or try statement whose body ended early: a return completes the statement,
+// a break or continue is passed on to the enclosing loop
+void passJump(const Completion& step, Completion* completion) {
+    if (step.type != CompletionType::Return && completion) {
+        *completion = step;
+    }
 }
 
 // Execute if statement
-Value executeIfStatement(IfStatement* stmt, bool* shouldReturn) {
+Value executeIfStatement(IfStatement* stmt, Completion* completion) {
     // Evaluate condition
     Value conditionValue = executeExpression(stmt->condition);
     
     // Convert condition to boolean
     bool condition = false;
-    if (std::holds_alternative<bool>(conditionValue)) {
-        condition = std::get<bool>(conditionValue);
-    } else if (std::holds_alternative<int>(conditionValue)) {
-        condition = (std::get<int>(conditionValue) != 0);
-    } else if (std::holds_alternative<float>(conditionValue)) {
-        condition = (std::get<float>(conditionValue) != 0.0f);
-    } else if (std::holds_alternative<double>(conditionValue)) {
-        condition = (std::get<double>(conditionValue) != 0.0);
-    } else if (std::holds_alternative<std::string>(conditionValue)) {
-        condition = !std::get<std::string>(conditionValue).empty();
+    if (conditionValue.isBool()) {
+        condition = conditionValue.asBool();
+    } else if (conditionValue.isInt()) {
+        condition = (conditionValue.asInt() != 0);
+    } else if (conditionValue.isFloat()) {
+        condition = (conditionValue.asFloat() != 0.0f);
+    } else if (conditionValue.isDouble()) {
+        condition = (conditionValue.asDouble() != 0.0);
+    } else if (conditionValue.isString()) {
+        condition = !conditionValue.asString().empty();
     }
     
     // Execute if body if condition is true
     if (condition) {
         for (auto bodyStmt : stmt->ifBody) {
-            Value result = executeStatement(bodyStmt, shouldReturn);
-            if (shouldReturn && *shouldReturn) {
+            Value result = executeStatement(bodyStmt, completion);
+            if (completion && completion->type != CompletionType::Normal) {
                 return result;
             }
         }
     } else {
         // Check else-if clauses
         for (auto elseIf : stmt->elseIfs) {
-            Value result = executeIfStatement(elseIf, shouldReturn);
-            if (shouldReturn && *shouldReturn) {
+            Value result = executeIfStatement(elseIf, completion);
+            if (completion && completion->type != CompletionType::Normal) {
                 return result;
             }
         }
         
         // Execute else body if no else-if matched
         for (auto bodyStmt : stmt->elseBody) {
-            Value result = executeStatement(bodyStmt, shouldReturn);
-            if (shouldReturn && *shouldReturn) {
+            Value result = executeStatement(bodyStmt, completion);
+            if (completion && completion->type != CompletionType::Normal) {
                 return result;
             }
         }
@@ -642,691 +1215,531 @@ Value executeIfStatement(IfStatement* stmt, bool* shouldReturn) {
 }
 
 // Execute statement
-Value executeStatement(ASTNode* stmt, bool* shouldReturn) {
-    if (auto comment = dynamic_cast<Comment*>(stmt)) {
-        // Skip comments
-        return std::monostate{};
-    } else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(stmt)) {
-        // Execute expression
-        return executeExpression(exprStmt->expression);
-    } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(stmt)) {
-        // Execute variable declaration
-        if (varDecl->initializer) {
-            // Execute initializer and store value
-            Value value = executeExpression(varDecl->initializer);
-            
-            // Determine variable type
-            std::string varType;
-            if (std::holds_alternative<int>(value)) {
-                varType = "int";
-            } else if (std::holds_alternative<char>(value)) {
-                varType = "char";
-            } else if (std::holds_alternative<std::string>(value)) {
-                varType = "string";
-            } else if (std::holds_alternative<bool>(value)) {
-                varType = "bool";
-            } else if (std::holds_alternative<float>(value)) {
-                varType = "float";
-            } else if (std::holds_alternative<double>(value)) {
-                varType = "double";
-            } else if (std::holds_alternative<Instance*>(value)) {
-                varType = "instance";
-            } else {
-                varType = "unknown";
-            }
-            
-            // Store variable type
-            variableTypes[varDecl->name] = varType;
-            
-            if (varDecl->isImmut) {
-                // Store in constants map for immut variables
-                constants[varDecl->name] = value;
-            } else {
-                // Store in variables map for regular variables
-                variables[varDecl->name] = value;
-            }
-        } else {
-            // Store default value (monostate for undefined)
-            variables[varDecl->name] = std::monostate{};
-            variableTypes[varDecl->name] = "unknown";
-        }
+Value executeStatement(ASTNode* stmt, Completion* completion) {
+    if (!stmt) {
         return std::monostate{};
-    } else if (auto ifStmt = dynamic_cast<IfStatement*>(stmt)) {
-        // Execute if statement
-        return executeIfStatement(ifStmt, shouldReturn);
-    } else if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
-        // Execute return expression if it exists
-        Value result = std::monostate{};
-        if (returnStmt->expression) {
-            result = executeExpression(returnStmt->expression);
-            
-            // If we're returning a FunctionDeclaration*, create a new closure environment
-            // This ensures each returned function gets its own independent environment
-            if (std::holds_alternative<FunctionDeclaration*>(result)) {
-                FunctionDeclaration* funcDecl = std::get<FunctionDeclaration*>(result);
-                
-                // Create a copy of the current variable environment for this closure
-                // Store it as a pair of maps: (variables, variableTypes)
-                auto closureEnv = new std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>();
-                
-                // Get the current environment, including any variables from outer scopes
-                closureEnv->first = variables;
-                closureEnv->second = variableTypes;
-                
-                // Set the closure environment for this function instance
-                funcDecl->closureEnv = closureEnv;
-                
-                // Update the result with the function that has the closure environment
-                result = funcDecl;
-            }
-        }
-        // Set return flag
-        if (shouldReturn) {
-            *shouldReturn = true;
+    }
+    
+    // Statement boundaries are collection safepoints
+    heap.safepoint();
+    
+    switch (stmt->kind) {
+        case NodeKind::Comment:
+            // Skip comments
+            return std::monostate{};
+        case NodeKind::ExpressionStatement: {
+            auto exprStmt = static_cast<ExpressionStatement*>(stmt);
+            // Execute expression
+            return executeExpression(exprStmt->expression);
         }
-        return result;
-    } else if (auto tryHappenStmt = dynamic_cast<TryHappenStatement*>(stmt)) {
-        // Execute try-happen statement
-        try {
-            // Execute try body
-            for (auto tryStmt : tryHappenStmt->tryBody) {
-                bool tryShouldReturn = false;
-                Value tryResult = executeStatement(tryStmt, &tryShouldReturn);
-                if (tryShouldReturn) {
-                    return tryResult;
-                }
-            }
-        } catch (const vanction_error::VanctionError& e) {
-            // Check if error type matches
-            if (tryHappenStmt->errorType == e.getType() || tryHappenStmt->errorType == "Error") {
-                // Create error object
-                auto errorObj = new ErrorObject(e.what(), e.getType(), e.getMessage());
-                
-                // Store error object in variable
-                variables[tryHappenStmt->errorVariableName] = errorObj;
-                
-                // Execute happen body
-                for (auto happenStmt : tryHappenStmt->happenBody) {
-                    bool happenShouldReturn = false;
-                    Value happenResult = executeStatement(happenStmt, &happenShouldReturn);
-                    if (happenShouldReturn) {
-                        return happenResult;
-                    }
+        case NodeKind::VariableDeclaration: {
+            auto varDecl = static_cast<VariableDeclaration*>(stmt);
+            // Execute variable declaration
+            if (varDecl->initializer) {
+                // Execute initializer and store value
+                Value value = executeExpression(varDecl->initializer);
+                if (errorResult.raised) {
+                    return std::monostate{};
                 }
-            } else {
-                // Re-throw if error type doesn't match
-                throw;
-            }
-        } catch (const std::exception& e) {
-            // Handle other exceptions
-            if (tryHappenStmt->errorType == "CError" || tryHappenStmt->errorType == "Error") {
-                // Create error object
-                std::string errorMsg = e.what();
-                std::string errorType = "CError";
                 
-                // Create error object
-                auto errorObj = new ErrorObject(errorMsg, errorType, errorMsg);
+                // Local variables live in their resolved frame slot
+                if (varDecl->slot >= 0 && currentFrame) {
+                    currentFrame->slots[varDecl->slot] = value;
+                    currentFrame->types[varDecl->slot] = declaredTypeOf(value);
+                    return std::monostate{};
+                }
                 
-                // Store error object in variable
-                variables[tryHappenStmt->errorVariableName] = errorObj;
+                // Store variable type
+                variableTypes[varDecl->name] = declaredTypeOf(value);
                 
-                // Execute happen body
-                for (auto happenStmt : tryHappenStmt->happenBody) {
-                    bool happenShouldReturn = false;
-                    Value happenResult = executeStatement(happenStmt, &happenShouldReturn);
-                    if (happenShouldReturn) {
-                        return happenResult;
-                    }
+                if (varDecl->isImmut) {
+                    // Store in constants map for immut variables
+                    constants[varDecl->name] = value;
+                } else {
+                    // Store in variables map for regular variables
+                    variables[varDecl->name] = value;
                 }
+            } else if (varDecl->slot >= 0 && currentFrame) {
+                // Store default value (monostate for undefined)
+                currentFrame->slots[varDecl->slot] = std::monostate{};
+                currentFrame->types[varDecl->slot] = SlotType::Unknown;
             } else {
-                // Re-throw if error type doesn't match
-                throw;
+                // Store default value (monostate for undefined)
+                variables[varDecl->name] = std::monostate{};
+                variableTypes[varDecl->name] = SlotType::Unknown;
             }
+            return std::monostate{};
         }
-        return std::monostate{};
-    } else if (auto forLoopStmt = dynamic_cast<ForLoopStatement*>(stmt)) {
-        // Execute traditional for loop
-        // Execute initialization
-        executeStatement(forLoopStmt->initialization);
-        
-        // Execute loop while condition is true
-        while (true) {
-            // Evaluate condition
-            Value conditionValue = executeExpression(forLoopStmt->condition);
-            bool condition = false;
-            if (std::holds_alternative<bool>(conditionValue)) {
-                condition = std::get<bool>(conditionValue);
-            } else if (std::holds_alternative<int>(conditionValue)) {
-                condition = (std::get<int>(conditionValue) != 0);
-            } else if (std::holds_alternative<float>(conditionValue)) {
-                condition = (std::get<float>(conditionValue) != 0.0f);
-            } else if (std::holds_alternative<double>(conditionValue)) {
-                condition = (std::get<double>(conditionValue) != 0.0);
-            }
-            
-            if (!condition) {
-                break;
+        case NodeKind::IfStatement:
+            // Execute if statement
+            return executeIfStatement(static_cast<IfStatement*>(stmt), completion);
+        case NodeKind::ReturnStatement: {
+            auto returnStmt = static_cast<ReturnStatement*>(stmt);
+            // return f(...) of a function value is left pending for the caller of the body
+            if (returnStmt->tailCall && completion && scheduleTailCall(static_cast<FunctionCall*>(returnStmt->expression))) {
+                completion->type = CompletionType::Return;
+                return std::monostate{};
             }
             
-            // Execute loop body
-            for (auto bodyStmt : forLoopStmt->body) {
-                bool bodyShouldReturn = false;
-                Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                if (bodyShouldReturn) {
-                    return bodyResult;
-                }
+            // Execute return expression if it exists
+            Value result = std::monostate{};
+            if (returnStmt->expression) {
+                // Returned nested functions keep the frame they captured at declaration
+                result = executeExpression(returnStmt->expression);
             }
-            
-            // Execute increment
-            executeExpression(forLoopStmt->increment);
-        }
-        return std::monostate{};
-    } else if (auto forInStmt = dynamic_cast<ForInLoopStatement*>(stmt)) {
-        // Execute for-in loop
-        
-        // First, execute the collection expression to get the actual collection object
-        Value collectionValue = executeExpression(forInStmt->collection);
-        
-        // Handle List* object (from variable or expression)
-        if (std::holds_alternative<List*>(collectionValue)) {
-            List* list = std::get<List*>(collectionValue);
-            // Iterate over list elements
-            for (size_t i = 0; i < list->elements.size(); ++i) {
-                // Get element value
-                Value elementValue = list->elements[i];
-                
-                // Store current element in loop variable
-                variables[forInStmt->keyVariableName] = elementValue;
-                
-                // Execute loop body
-                for (auto bodyStmt : forInStmt->body) {
-                    bool bodyShouldReturn = false;
-                    Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                    if (bodyShouldReturn) {
-                        return bodyResult;
-                    }
-                }
+            // Set return flag
+            if (completion) {
+                completion->type = CompletionType::Return;
             }
+            return result;
         }
-        // Handle HashMap* object (from variable or expression)
-        else if (std::holds_alternative<HashMap*>(collectionValue)) {
-            HashMap* hashMap = std::get<HashMap*>(collectionValue);
-            // Iterate over hash map entries
-            for (auto& entry : hashMap->entries) {
-                // Get key and value
-                std::string key = entry.first;
-                Value value = entry.second;
-                
-                // Store current key and value in loop variables
-                variables[forInStmt->keyVariableName] = key;
-                variables[forInStmt->valueVariableName] = value;
-                
-                // Execute loop body
-                for (auto bodyStmt : forInStmt->body) {
-                    bool bodyShouldReturn = false;
-                    Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                    if (bodyShouldReturn) {
-                        return bodyResult;
-                    }
-                }
+        case NodeKind::BreakStatement:
+            if (completion) {
+                *completion = Completion{CompletionType::Break, static_cast<BreakStatement*>(stmt)->depth};
             }
-        }
-        // Handle ListLiteral
-        else if (auto listLit = dynamic_cast<ListLiteral*>(forInStmt->collection)) {
-            // Iterate over list elements
-            for (auto elementExpr : listLit->elements) {
-                // Execute element expression and get value
-                Value elementValue = executeExpression(elementExpr);
-                
-                // Store current element in loop variable
-                variables[forInStmt->keyVariableName] = elementValue;
+            return std::monostate{};
+        case NodeKind::ContinueStatement:
+            if (completion) {
+                *completion = Completion{CompletionType::Continue, static_cast<ContinueStatement*>(stmt)->depth};
+            }
+            return std::monostate{};
+        case NodeKind::TryHappenStatement: {
+            auto tryHappenStmt = static_cast<TryHappenStatement*>(stmt);
+            Value result = std::monostate{};
+            
+            // Bind the error and run the happen body, returns false when the error is not caught
+            // The text of the error is "type: info", or what() of an exception raised by C++ code
+            Completion happenStep;
+            auto handle = [&](ErrorType type, const std::string& info, const char* what) {
+                if (!catchesError(tryHappenStmt->errorTypeId, type)) {
+                    return false;
+                }
+                // Store error object in variable
+                ErrorObject* error = what ? heap.newError(what, errorTypeName(type), info) : heap.newError(errorTypeName(type), info);
+                storeVariable(tryHappenStmt->errorSlot, tryHappenStmt->errorVariableName, error);
                 
-                // Execute loop body
-                for (auto bodyStmt : forInStmt->body) {
-                    bool bodyShouldReturn = false;
-                    Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                    if (bodyShouldReturn) {
-                        return bodyResult;
-                    }
+                // Execute happen body
+                happenStep = runBody(tryHappenStmt->happenBody, result);
+                passJump(happenStep, completion);
+                return true;
+            };
+            
+            // Execute try-happen statement
+            bool failed = false;
+            try {
+                // Execute try body
+                Completion step = runTryBody(tryHappenStmt->tryBody, result, failed);
+                if (step.type != CompletionType::Normal) {
+                    passJump(step, completion);
+                    return result;
                 }
+            } catch (const vanction_error::VanctionError& e) {
+                if (!handle(e.getKind(), e.getMessage(), nullptr)) {
+                    // Re-throw if error type doesn't match
+                    throw;
+                }
+                return happenStep.type != CompletionType::Normal ? result : Value(std::monostate{});
+            } catch (const std::exception& e) {
+                // Handle other exceptions as CError
+                if (!handle(ErrorType::CError, e.what(), e.what())) {
+                    throw;
+                }
+                return happenStep.type != CompletionType::Normal ? result : Value(std::monostate{});
             }
+            
+            // An error result of the try body is handled without unwinding
+            if (failed) {
+                if (!handle(errorResult.type, errorResult.message, nullptr)) {
+                    throw vanction_error::VanctionError(errorResult.type, errorResult.message);
+                }
+                return happenStep.type != CompletionType::Normal ? result : Value(std::monostate{});
+            }
+            return std::monostate{};
         }
-        // Handle HashMapLiteral
-        else if (auto hashMapLit = dynamic_cast<HashMapLiteral*>(forInStmt->collection)) {
-            // Iterate over hash map entries
-            for (auto entry : hashMapLit->entries) {
-                // Execute key and value expressions
-                Value keyValue = executeExpression(entry->key);
-                Value valueValue = executeExpression(entry->value);
+        case NodeKind::ForLoopStatement: {
+            auto forLoopStmt = static_cast<ForLoopStatement*>(stmt);
+            Value result = std::monostate{};
+            // Execute traditional for loop
+            // Execute initialization
+            executeStatement(forLoopStmt->initialization);
+            
+            // Execute loop while condition is true
+            while (true) {
+                // Evaluate condition
+                Value conditionValue = executeExpression(forLoopStmt->condition);
+                bool condition = false;
+                if (conditionValue.isBool()) {
+                    condition = conditionValue.asBool();
+                } else if (conditionValue.isInt()) {
+                    condition = (conditionValue.asInt() != 0);
+                } else if (conditionValue.isFloat()) {
+                    condition = (conditionValue.asFloat() != 0.0f);
+                } else if (conditionValue.isDouble()) {
+                    condition = (conditionValue.asDouble() != 0.0);
+                }
                 
-                // Store current key and value in loop variables
-                variables[forInStmt->keyVariableName] = keyValue;
-                variables[forInStmt->valueVariableName] = valueValue;
+                if (!condition) {
+                    break;
+                }
                 
                 // Execute loop body
-                for (auto bodyStmt : forInStmt->body) {
-                    bool bodyShouldReturn = false;
-                    Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                    if (bodyShouldReturn) {
-                        return bodyResult;
-                    }
+                if (!nextIteration(runBody(forLoopStmt->body, result), completion)) {
+                    return result;
                 }
+                
+                // Execute increment
+                executeExpression(forLoopStmt->increment);
             }
+            return std::monostate{};
         }
-        // Handle RangeExpression
-        else if (auto rangeExpr = dynamic_cast<RangeExpression*>(forInStmt->collection)) {
-            // Execute range start, end, and step expressions
-            Value startValue = executeExpression(rangeExpr->start);
-            Value endValue = executeExpression(rangeExpr->end);
-            Value stepValue = (rangeExpr->step) ? executeExpression(rangeExpr->step) : Value{1};
-            
-            // Convert to integers
-            int start = (std::holds_alternative<int>(startValue)) ? std::get<int>(startValue) : 0;
-            int end = (std::holds_alternative<int>(endValue)) ? std::get<int>(endValue) : 0;
-            int step = (std::holds_alternative<int>(stepValue)) ? std::get<int>(stepValue) : 1;
+        case NodeKind::ForInLoopStatement: {
+            auto forInStmt = static_cast<ForInLoopStatement*>(stmt);
+            Value result = std::monostate{};
+            // Execute for-in loop
             
-            // Iterate over range
-            for (int i = start; i < end; i += step) {
-                // Store current index in loop variable
-                variables[forInStmt->keyVariableName] = i;
-                
-                // Execute loop body
-                for (auto bodyStmt : forInStmt->body) {
-                    bool bodyShouldReturn = false;
-                    Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                    if (bodyShouldReturn) {
-                        return bodyResult;
+            // Counted loop over range(...): the bounds are evaluated once, and the counter goes
+            // straight into the loop variable's slot
+            if (auto rangeExpr = nodeCast<RangeExpression>(forInStmt->collection)) {
+                RangeLoop range = makeRangeLoop(executeExpression(rangeExpr->start), executeExpression(rangeExpr->end), executeExpression(rangeExpr->step));
+                if (range.count > 0) {
+                    checkLoopBinding(forInStmt);
+                }
+                Value* counter = (forInStmt->keySlot >= 0 && currentFrame) ? &currentFrame->slots[forInStmt->keySlot] : nullptr;
+                for (uint64_t i = 0; i < range.count; ++i) {
+                    if (counter) {
+                        *counter = range.at(i);
+                    } else {
+                        variables[forInStmt->keyVariableName] = range.at(i);
+                    }
+                    
+                    // Execute loop body
+                    if (!nextIteration(runBody(forInStmt->body, result), completion)) {
+                        return result;
                     }
                 }
+                return std::monostate{};
             }
-        }
-        // Handle function call that returns range (e.g., range(10))
-        else if (auto funcCall = dynamic_cast<FunctionCall*>(forInStmt->collection)) {
-            if (funcCall->methodName == "range" && funcCall->objectName.empty()) {
-                // Parse range function arguments
-                int start = 0;
-                int end = 0;
-                int step = 1;
-                
-                if (funcCall->arguments.size() == 1) {
-                    // range(end)
-                    Value endValue = executeExpression(funcCall->arguments[0]);
-                    end = (std::holds_alternative<int>(endValue)) ? std::get<int>(endValue) : 0;
-                } else if (funcCall->arguments.size() >= 2) {
-                    // range(start, end, step?)
-                    Value startValue = executeExpression(funcCall->arguments[0]);
-                    Value endValue = executeExpression(funcCall->arguments[1]);
-                    start = (std::holds_alternative<int>(startValue)) ? std::get<int>(startValue) : 0;
-                    end = (std::holds_alternative<int>(endValue)) ? std::get<int>(endValue) : 0;
+            
+            // First, execute the collection expression to get the actual collection object
+            Value collectionValue = executeExpression(forInStmt->collection);
+            
+            // Handle List* object (from variable or expression)
+            if (collectionValue.isList()) {
+                List* list = collectionValue.asList();
+                // Iterate over list elements
+                for (int i = 0; i < list->size(); ++i) {
+                    // Get element value
+                    Value elementValue = list->at(i);
+                    
+                    // Store current element in loop variable
+                    checkLoopBinding(forInStmt);
+                    storeVariable(forInStmt->keySlot, forInStmt->keyVariableName, elementValue);
                     
-                    if (funcCall->arguments.size() >= 3) {
-                        Value stepValue = executeExpression(funcCall->arguments[2]);
-                        step = (std::holds_alternative<int>(stepValue)) ? std::get<int>(stepValue) : 1;
+                    // Execute loop body
+                    if (!nextIteration(runBody(forInStmt->body, result), completion)) {
+                        return result;
                     }
                 }
-                
-                // Iterate over range
-                for (int i = start; i < end; i += step) {
-                    // Store current index in loop variable
-                    variables[forInStmt->keyVariableName] = i;
+            }
+            // Handle HashMap* object (from variable or expression)
+            else if (collectionValue.isHashMap()) {
+                HashMap* hashMap = collectionValue.asHashMap();
+                // Iterate over hash map entries in insertion order
+                // Indexed, since the body may add entries and grow the entry array
+                for (size_t i = 0; i < hashMap->entries.size(); ++i) {
+                    // Get key and value, skipping removed entries
+                    if (hashMap->entries[i].key.isNil()) {
+                        continue;
+                    }
+                    Value key = hashMap->entries[i].key;
+                    Value value = hashMap->entries[i].value;
+                    
+                    // Store current key and value in loop variables
+                    checkLoopBinding(forInStmt);
+                    storeVariable(forInStmt->keySlot, forInStmt->keyVariableName, key);
+                    storeVariable(forInStmt->valueSlot, forInStmt->valueVariableName, value);
                     
                     // Execute loop body
-                    for (auto bodyStmt : forInStmt->body) {
-                        bool bodyShouldReturn = false;
-                        Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                        if (bodyShouldReturn) {
-                            return bodyResult;
-                        }
+                    if (!nextIteration(runBody(forInStmt->body, result), completion)) {
+                        return result;
                     }
                 }
             }
-        }
-        return std::monostate{};
-    } else if (auto whileStmt = dynamic_cast<WhileLoopStatement*>(stmt)) {
-        // Execute while loop
-        while (true) {
-            // Evaluate condition
-            Value conditionValue = executeExpression(whileStmt->condition);
-            bool condition = false;
-            if (std::holds_alternative<bool>(conditionValue)) {
-                condition = std::get<bool>(conditionValue);
-            } else if (std::holds_alternative<int>(conditionValue)) {
-                condition = (std::get<int>(conditionValue) != 0);
-            } else if (std::holds_alternative<float>(conditionValue)) {
-                condition = (std::get<float>(conditionValue) != 0.0f);
-            } else if (std::holds_alternative<double>(conditionValue)) {
-                condition = (std::get<double>(conditionValue) != 0.0);
-            } else if (std::holds_alternative<std::string>(conditionValue)) {
-                condition = !std::get<std::string>(conditionValue).empty();
-            }
-            
-            if (!condition) {
-                break;
-            }
-            
-            // Execute loop body
-            for (auto bodyStmt : whileStmt->body) {
-                bool bodyShouldReturn = false;
-                Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                if (bodyShouldReturn) {
-                    return bodyResult;
+            // Handle ListLiteral
+            else if (auto listLit = nodeCast<ListLiteral>(forInStmt->collection)) {
+                // Iterate over list elements
+                for (auto elementExpr : listLit->elements) {
+                    // Execute element expression and get value
+                    Value elementValue = executeExpression(elementExpr);
+                    
+                    // Store current element in loop variable
+                    checkLoopBinding(forInStmt);
+                    storeVariable(forInStmt->keySlot, forInStmt->keyVariableName, elementValue);
+                    
+                    // Execute loop body
+                    if (!nextIteration(runBody(forInStmt->body, result), completion)) {
+                        return result;
+                    }
                 }
             }
-        }
-        return std::monostate{};
-    } else if (auto doWhileStmt = dynamic_cast<DoWhileLoopStatement*>(stmt)) {
-        // Execute do-while loop
-        do {
-            // Execute loop body
-            for (auto bodyStmt : doWhileStmt->body) {
-                bool bodyShouldReturn = false;
-                Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                if (bodyShouldReturn) {
-                    return bodyResult;
-                }
-            }
-            
-            // Evaluate condition
-            Value conditionValue = executeExpression(doWhileStmt->condition);
-            bool condition = false;
-            if (std::holds_alternative<bool>(conditionValue)) {
-                condition = std::get<bool>(conditionValue);
-            } else if (std::holds_alternative<int>(conditionValue)) {
-                condition = (std::get<int>(conditionValue) != 0);
-            } else if (std::holds_alternative<float>(conditionValue)) {
-                condition = (std::get<float>(conditionValue) != 0.0f);
-            } else if (std::holds_alternative<double>(conditionValue)) {
-                condition = (std::get<double>(conditionValue) != 0.0);
-            } else if (std::holds_alternative<std::string>(conditionValue)) {
-                condition = !std::get<std::string>(conditionValue).empty();
-            }
-            
-            if (!condition) {
-                break;
-            }
-        } while (true);
-        return std::monostate{};
-    } else if (auto switchStmt = dynamic_cast<SwitchStatement*>(stmt)) {
-        // Execute switch statement
-        // First, execute the switch expression
-        Value switchValue = executeExpression(switchStmt->expression);
-        
-        // Iterate through all case statements
-        for (auto caseStmt : switchStmt->cases) {
-            // Execute case expression
-            Value caseValue = executeExpression(caseStmt->value);
-            
-            // Compare case value with switch value
-            bool match = false;
-            
-            // Handle different types of comparisons
-            if (std::holds_alternative<int>(switchValue) && std::holds_alternative<int>(caseValue)) {
-                match = (std::get<int>(switchValue) == std::get<int>(caseValue));
-            } else if (std::holds_alternative<std::string>(switchValue) && std::holds_alternative<std::string>(caseValue)) {
-                match = (std::get<std::string>(switchValue) == std::get<std::string>(caseValue));
-            } else if (std::holds_alternative<bool>(switchValue) && std::holds_alternative<bool>(caseValue)) {
-                match = (std::get<bool>(switchValue) == std::get<bool>(caseValue));
-            } else if (std::holds_alternative<float>(switchValue) && std::holds_alternative<float>(caseValue)) {
-                match = (std::get<float>(switchValue) == std::get<float>(caseValue));
-            } else if (std::holds_alternative<double>(switchValue) && std::holds_alternative<double>(caseValue)) {
-                match = (std::get<double>(switchValue) == std::get<double>(caseValue));
-            }
-            
-            // If case matches, execute the case body
-            if (match) {
-                for (auto bodyStmt : caseStmt->body) {
-                    bool bodyShouldReturn = false;
-                    Value bodyResult = executeStatement(bodyStmt, &bodyShouldReturn);
-                    if (bodyShouldReturn) {
-                        return bodyResult;
+            // Handle HashMapLiteral
+            else if (auto hashMapLit = nodeCast<HashMapLiteral>(forInStmt->collection)) {
+                // Iterate over hash map entries
+                for (auto entry : hashMapLit->entries) {
+                    // Execute key and value expressions
+                    Value keyValue = executeExpression(entry->key);
+                    Value valueValue = executeExpression(entry->value);
+                    
+                    // Store current key and value in loop variables
+                    checkLoopBinding(forInStmt);
+                    storeVariable(forInStmt->keySlot, forInStmt->keyVariableName, keyValue);
+                    storeVariable(forInStmt->valueSlot, forInStmt->valueVariableName, valueValue);
+                    
+                    // Execute loop body
+                    if (!nextIteration(runBody(forInStmt->body, result), completion)) {
+                        return result;
                     }
                 }
-                // Fallthrough behavior - continue to next case
             }
+            return std::monostate{};
         }
-        return std::monostate{};
-    } else if (auto funcDecl = dynamic_cast<FunctionDeclaration*>(stmt)) {
-        // Execute nested function declaration
-        return executeFunctionDeclaration(funcDecl);
-    }
-    return std::monostate{};
-}
-
-// Execute expression
-Value executeExpression(Expression* expr) {
-    if (auto funcCall = dynamic_cast<FunctionCall*>(expr)) {
-        // Execute function call
-        return executeFunctionCall(funcCall);
-    } else if (auto funcCallExpr = dynamic_cast<FunctionCallExpression*>(expr)) {
-        // Execute function call expression (for lambdas, etc.)
-        // First execute the callee to get the function
-        Value calleeValue = executeExpression(funcCallExpr->callee);
-        
-        // Check if it's a lambda expression
-        if (LambdaExpression** lambdaPtr = std::get_if<LambdaExpression*>(&calleeValue)) {
-            LambdaExpression* lambda = *lambdaPtr;
-            // Bind arguments to parameters
-            if (lambda->parameters.size() != funcCallExpr->arguments.size()) {
-                throw vanction_error::MethodError("Argument count mismatch for lambda call");
-            }
-            
-            // Execute arguments
-            std::vector<Value> argValues;
-            for (auto arg : funcCallExpr->arguments) {
-                argValues.push_back(executeExpression(arg));
-            }
-            
-            // Create a copy of the current variables to save the state
-            std::map<std::string, Value> originalVariables = variables;
-            std::map<std::string, std::string> originalVariableTypes = variableTypes;
-            
-            // Bind parameters to argument values in the current environment
-            // This is important for nested lambdas to access outer lambda parameters
-            std::map<std::string, Value> tempVariables = variables;
-            std::map<std::string, std::string> tempVariableTypes = variableTypes;
-            
-            for (size_t i = 0; i < lambda->parameters.size(); i++) {
-                const std::string& paramName = lambda->parameters[i].name;
-                tempVariables[paramName] = argValues[i];
-                tempVariableTypes[paramName] = "auto";
-            }
-            
-            // If lambda has a closure environment, merge it into the temp environment
-            // This ensures we have all variables from outer scopes
-            if (lambda->closureEnv) {
-                auto closureEnv = static_cast<std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>*>(lambda->closureEnv);
-                for (const auto& pair : closureEnv->first) {
-                    if (tempVariables.find(pair.first) == tempVariables.end()) {
-                        tempVariables[pair.first] = pair.second;
-                    }
+        case NodeKind::WhileLoopStatement: {
+            auto whileStmt = static_cast<WhileLoopStatement*>(stmt);
+            Value result = std::monostate{};
+            // Execute while loop
+            while (true) {
+                // Evaluate condition
+                Value conditionValue = executeExpression(whileStmt->condition);
+                bool condition = false;
+                if (conditionValue.isBool()) {
+                    condition = conditionValue.asBool();
+                } else if (conditionValue.isInt()) {
+                    condition = (conditionValue.asInt() != 0);
+                } else if (conditionValue.isFloat()) {
+                    condition = (conditionValue.asFloat() != 0.0f);
+                } else if (conditionValue.isDouble()) {
+                    condition = (conditionValue.asDouble() != 0.0);
+                } else if (conditionValue.isString()) {
+                    condition = !conditionValue.asString().empty();
                 }
-                for (const auto& pair : closureEnv->second) {
-                    if (tempVariableTypes.find(pair.first) == tempVariableTypes.end()) {
-                        tempVariableTypes[pair.first] = pair.second;
-                    }
+                
+                if (!condition) {
+                    break;
+                }
+                
+                // Execute loop body
+                if (!nextIteration(runBody(whileStmt->body, result), completion)) {
+                    return result;
+                }
+                if (nativeTier.enabled()) {
+                    nativeTier.backEdge();
                 }
             }
-            
-            // Set the temp environment as current for execution
-            variables = tempVariables;
-            variableTypes = tempVariableTypes;
-            
-            // Execute the lambda body
-            Value result = executeExpression(lambda->body);
-            
-            // Restore original variables
-            variables = originalVariables;
-            variableTypes = originalVariableTypes;
-            
-            return result;
-        } else {
-            throw vanction_error::MethodError("Attempt to call a non-function value");
+            return std::monostate{};
         }
-    } else if (auto assignExpr = dynamic_cast<AssignmentExpression*>(expr)) {
-        // Execute assignment expression
-        Value value = executeExpression(assignExpr->right);
-        
-        // Handle assignment based on left expression type
-        if (auto ident = dynamic_cast<Identifier*>(assignExpr->left)) {
-            // Simple variable assignment
-            std::string varName = ident->name;
-            
-            // Check if variable is a constant (immut var)
-            if (constants.find(varName) != constants.end()) {
-                throw vanction_error::ImmutError("Cannot assign to constant '" + varName + "'");
-            }
-            
-            // Check if variable exists
-            if (variables.find(varName) == variables.end()) {
-                throw vanction_error::MethodError("Variable '" + varName + "' not declared");
-            }
-            
-            // Check type compatibility
-            if (variableTypes.find(varName) != variableTypes.end()) {
-                std::string existingType = variableTypes[varName];
-                std::string newValueType;
+        case NodeKind::DoWhileLoopStatement: {
+            auto doWhileStmt = static_cast<DoWhileLoopStatement*>(stmt);
+            Value result = std::monostate{};
+            // Execute do-while loop
+            do {
+                // Execute loop body
+                if (!nextIteration(runBody(doWhileStmt->body, result), completion)) {
+                    return result;
+                }
                 
-                if (std::holds_alternative<int>(value)) {
-                    newValueType = "int";
-                } else if (std::holds_alternative<char>(value)) {
-                    newValueType = "char";
-                } else if (std::holds_alternative<std::string>(value)) {
-                    newValueType = "string";
-                } else if (std::holds_alternative<bool>(value)) {
-                    newValueType = "bool";
-                } else if (std::holds_alternative<float>(value)) {
-                    newValueType = "float";
-                } else if (std::holds_alternative<double>(value)) {
-                    newValueType = "double";
-                } else if (std::holds_alternative<List*>(value)) {
-                    newValueType = "list";
-                } else if (std::holds_alternative<HashMap*>(value)) {
-                    newValueType = "hashmap";
-                } else if (std::holds_alternative<Instance*>(value)) {
-                    newValueType = "instance";
-                } else {
-                    newValueType = "unknown";
+                // Evaluate condition
+                Value conditionValue = executeExpression(doWhileStmt->condition);
+                bool condition = false;
+                if (conditionValue.isBool()) {
+                    condition = conditionValue.asBool();
+                } else if (conditionValue.isInt()) {
+                    condition = (conditionValue.asInt() != 0);
+                } else if (conditionValue.isFloat()) {
+                    condition = (conditionValue.asFloat() != 0.0f);
+                } else if (conditionValue.isDouble()) {
+                    condition = (conditionValue.asDouble() != 0.0);
+                } else if (conditionValue.isString()) {
+                    condition = !conditionValue.asString().empty();
                 }
                 
-                // Check if types are compatible
-                if (existingType != "unknown" && newValueType != "unknown" && existingType != newValueType) {
-                    throw vanction_error::MethodError("Type mismatch: cannot assign '" + newValueType + "' to variable of type '" + existingType + "'");
+                if (!condition) {
+                    break;
                 }
-            }
-            
-            // Update variable value
-            variables[varName] = value;
-        } else if (auto instanceAccess = dynamic_cast<InstanceAccessExpression*>(assignExpr->left)) {
-            // Instance variable assignment
-            Value instanceVal = executeExpression(instanceAccess->instance);
+                if (nativeTier.enabled()) {
+                    nativeTier.backEdge();
+                }
+            } while (true);
+            return std::monostate{};
+        }
+        case NodeKind::SwitchStatement: {
+            auto switchStmt = static_cast<SwitchStatement*>(stmt);
+            Value result = std::monostate{};
+            // Execute switch statement
+            // First, execute the switch expression
+            Value switchValue = executeExpression(switchStmt->expression);
             
-            if (!std::holds_alternative<Instance*>(instanceVal)) {
-                throw vanction_error::MethodError("Cannot assign to property of non-instance");
+            // Literal labels are looked up in the switch table, following the cases of equal labels
+            SwitchTable* table = switchTable(switchStmt);
+            if (table->kind != SwitchTable::Kind::Dynamic) {
+                for (int index = findCase(*table, switchValue); index >= 0; index = table->next[index]) {
+                    Completion step = runBody(switchStmt->cases[index]->body, result);
+                    if (step.type != CompletionType::Normal) {
+                        passJump(step, completion);
+                        return result;
+                    }
+                }
+                return std::monostate{};
             }
             
-            Instance* instance = std::get<Instance*>(instanceVal);
-            std::string memberName = instanceAccess->memberName;
-            
-            // Assign value to instance variable
-            instance->instanceVariables[memberName] = value;
-        } else if (auto binaryExpr = dynamic_cast<BinaryExpression*>(assignExpr->left)) {
-            // Handle index assignment with BinaryExpression: obj[index] = value
-            if (binaryExpr->op == "[") {
-                // Execute the left side (object being indexed)
-                Value leftObj = executeExpression(binaryExpr->left);
-                // Execute the index expression
-                Value indexExpr = executeExpression(binaryExpr->right);
+            // Iterate through all case statements
+            for (auto caseStmt : switchStmt->cases) {
+                // Execute case expression
+                Value caseValue = executeExpression(caseStmt->value);
                 
-                // Handle List index assignment
-                if (std::holds_alternative<List*>(leftObj)) {
-                    List* list = std::get<List*>(leftObj);
-                    
-                    // Convert index to integer
-                    int index;
-                    if (std::holds_alternative<int>(indexExpr)) {
-                        index = std::get<int>(indexExpr);
-                    } else {
-                        throw vanction_error::TypeError("List index must be an integer");
-                    }
-                    
-                    // Handle negative indices
-                    if (index < 0) {
-                        index = list->elements.size() + index;
-                    }
-                    
-                    // Check bounds
-                    if (index < 0 || index >= list->elements.size()) {
-                        throw vanction_error::RangeError("List index out of range", 0, 0);
-                    }
-                    
-                    // Assign value to list index
-                    list->set(index, value);
+                // Compare case value with switch value
+                bool match = false;
+                
+                // Handle different types of comparisons
+                if (switchValue.isInt() && caseValue.isInt()) {
+                    match = (switchValue.asInt() == caseValue.asInt());
+                } else if (switchValue.isString() && caseValue.isString()) {
+                    match = (switchValue.asString() == caseValue.asString());
+                } else if (switchValue.isBool() && caseValue.isBool()) {
+                    match = (switchValue.asBool() == caseValue.asBool());
+                } else if (switchValue.isFloat() && caseValue.isFloat()) {
+                    match = (switchValue.asFloat() == caseValue.asFloat());
+                } else if (switchValue.isDouble() && caseValue.isDouble()) {
+                    match = (switchValue.asDouble() == caseValue.asDouble());
                 }
-                // Handle HashMap index assignment
-                else if (std::holds_alternative<HashMap*>(leftObj)) {
-                    HashMap* map = std::get<HashMap*>(leftObj);
-                    
-                    // Convert key to string
-                    std::string key;
-                    if (std::holds_alternative<std::string>(indexExpr)) {
-                        key = std::get<std::string>(indexExpr);
-                    } else {
-                        // Convert other types to string
-                        auto toString = [](Value val) -> std::string {
-                            if (std::holds_alternative<int>(val)) {
-                                return std::to_string(std::get<int>(val));
-                            } else if (std::holds_alternative<float>(val)) {
-                                return std::to_string(std::get<float>(val));
-                            } else if (std::holds_alternative<double>(val)) {
-                                return std::to_string(std::get<double>(val));
-                            } else if (std::holds_alternative<bool>(val)) {
-                                return std::get<bool>(val) ? "true" : "false";
-                            } else if (std::holds_alternative<char>(val)) {
-                                return std::string(1, std::get<char>(val));
-                            } else {
-                                throw vanction_error::TypeError("HashMap key must be a string or convertible to string");
-                            }
-                        };
-                        key = toString(indexExpr);
+                
+                // If case matches, execute the case body
+                if (match) {
+                    Completion step = runBody(caseStmt->body, result);
+                    if (step.type != CompletionType::Normal) {
+                        passJump(step, completion);
+                        return result;
                     }
-                    
-                    // Assign value to HashMap key
-                    map->set(key, value);
+                    // Fallthrough behavior - continue to next case
                 }
-                // Handle string index assignment (immutable strings)
-                else if (std::holds_alternative<std::string>(leftObj)) {
-                    throw vanction_error::TypeError("Strings are immutable, cannot assign to index");
-                }
-                else {
-                    throw vanction_error::TypeError("Index assignment not supported for this type");
+            }
+            return std::monostate{};
+        }
+        case NodeKind::FunctionDeclaration:
+        case NodeKind::ClassMethodDeclaration:
+        case NodeKind::InstanceMethodDeclaration: {
+            auto funcDecl = static_cast<FunctionDeclaration*>(stmt);
+            // Execute nested function declaration
+            // Each execution creates a new closure over the variables it uses, bound to a local slot
+            if (funcDecl->slot >= 0 && currentFrame) {
+                Closure* closure = makeClosure(funcDecl, nullptr, funcDecl->layout);
+                FunctionDeclaration*& declared = functions[funcDecl->name];
+                if (declared != funcDecl) {
+                    declared = funcDecl;
+                    ++linkEpoch;
                 }
+                funcDecl->closure = closure;
+                currentFrame->slots[funcDecl->slot] = closure;
+                currentFrame->types[funcDecl->slot] = SlotType::Function;
+                return closure;
             }
-        } else if (auto indexAccess = dynamic_cast<IndexAccessExpression*>(assignExpr->left)) {
-            // Handle index assignment with IndexAccessExpression: obj[index] = value
-            // Execute the collection expression (object being indexed)
-            Value collection = executeExpression(indexAccess->collection);
+            return executeFunctionDeclaration(funcDecl);
+        }
+        default:
+            break;
+    }
+    return std::monostate{};
+}
+
+// Assign a value to an assignment target (variable, instance member or index)
+void assignValue(Expression* target, const Value& value) {
+    if (auto ident = nodeCast<Identifier>(target)) {
+        // Simple variable assignment
+        std::string varName = ident->name;
+        
+        // Local variable: assign to its resolved frame slot, or through the captured upvalue
+        if (ident->slot >= 0 || ident->upvalue >= 0) {
+            if (ident->isImmut) {
+                throw vanction_error::ImmutError("Cannot assign to constant '" + varName + "'");
+            }
+            
+            if (ident->slot >= 0 && currentFrame) {
+                // Check type compatibility
+                checkSlotAssignment(currentFrame->types[ident->slot], value);
+                currentFrame->slots[ident->slot] = value;
+                return;
+            }
+            
+            Upvalue* upvalue = ident->upvalue >= 0 ? upvalueAt(ident->upvalue) : nullptr;
+            if (!upvalue) {
+                throw vanction_error::MethodError("Variable '" + varName + "' not declared");
+            }
+            checkSlotAssignment(*upvalue->type, value);
+            *upvalue->location = value;
+            return;
+        }
+        
+        // Check if variable is a constant (immut var)
+        if (constants.find(varName) != constants.end()) {
+            throw vanction_error::ImmutError("Cannot assign to constant '" + varName + "'");
+        }
+        
+        // Check if variable exists
+        if (variables.find(varName) == variables.end()) {
+            throw vanction_error::MethodError("Variable '" + varName + "' not declared");
+        }
+        
+        // Check type compatibility
+        auto typeIt = variableTypes.find(varName);
+        if (typeIt != variableTypes.end()) {
+            checkSlotAssignment(typeIt->second, value);
+        }
+        
+        // Update variable value
+        variables[varName] = value;
+    } else if (auto instanceAccess = nodeCast<InstanceAccessExpression>(target)) {
+        // Instance variable assignment
+        Value instanceVal = executeExpression(instanceAccess->instance);
+        
+        if (!instanceVal.isInstance()) {
+            throw vanction_error::MethodError("Cannot assign to property of non-instance");
+        }
+        
+        Instance* instance = instanceVal.asInstance();
+        
+        // Assign value to instance variable
+        if (instance->shape == instanceAccess->cachedShape) {
+            instance->fields[instanceAccess->cachedOffset] = value;
+        } else {
+            instanceAccess->cachedOffset = instance->setField(instanceAccess->memberName, value);
+            instanceAccess->cachedShape = instance->shape;
+        }
+    } else if (auto binaryExpr = nodeCast<BinaryExpression>(target)) {
+        // Handle index assignment with BinaryExpression: obj[index] = value
+        if (binaryExpr->opcode == BinaryOperator::Index) {
+            // Execute the left side (object being indexed)
+            Value leftObj = executeExpression(binaryExpr->left);
             // Execute the index expression
-            Value indexExpr = executeExpression(indexAccess->index);
+            Value indexExpr = executeExpression(binaryExpr->right);
             
             // Handle List index assignment
-            if (std::holds_alternative<List*>(collection)) {
-                List* list = std::get<List*>(collection);
+            if (leftObj.isList()) {
+                List* list = leftObj.asList();
                 
                 // Convert index to integer
                 int index;
-                if (std::holds_alternative<int>(indexExpr)) {
-                    index = std::get<int>(indexExpr);
+                if (indexExpr.isInt()) {
+                    index = indexExpr.asInt();
                 } else {
                     throw vanction_error::TypeError("List index must be an integer");
                 }
                 
                 // Handle negative indices
                 if (index < 0) {
-                    index = list->elements.size() + index;
+                    index = list->size() + index;
                 }
                 
                 // Check bounds
-                if (index < 0 || index >= list->elements.size()) {
+                if (index < 0 || index >= list->size()) {
                     throw vanction_error::RangeError("List index out of range", 0, 0);
                 }
                 
@@ -1334,720 +1747,966 @@ Value executeExpression(Expression* expr) {
                 list->set(index, value);
             }
             // Handle HashMap index assignment
-            else if (std::holds_alternative<HashMap*>(collection)) {
-                HashMap* map = std::get<HashMap*>(collection);
-                
-                // Convert key to string
-                std::string key;
-                if (std::holds_alternative<std::string>(indexExpr)) {
-                    key = std::get<std::string>(indexExpr);
-                } else {
-                    // Convert other types to string
-                    auto toString = [](Value val) -> std::string {
-                        if (std::holds_alternative<int>(val)) {
-                            return std::to_string(std::get<int>(val));
-                        } else if (std::holds_alternative<float>(val)) {
-                            return std::to_string(std::get<float>(val));
-                        } else if (std::holds_alternative<double>(val)) {
-                            return std::to_string(std::get<double>(val));
-                        } else if (std::holds_alternative<bool>(val)) {
-                            return std::get<bool>(val) ? "true" : "false";
-                        } else if (std::holds_alternative<char>(val)) {
-                            return std::string(1, std::get<char>(val));
-                        } else {
-                            throw vanction_error::TypeError("HashMap key must be a string or convertible to string");
-                        }
-                    };
-                    key = toString(indexExpr);
-                }
+            else if (leftObj.isHashMap()) {
+                HashMap* map = leftObj.asHashMap();
                 
                 // Assign value to HashMap key
-                map->set(key, value);
+                map->set(indexExpr, value);
             }
             // Handle string index assignment (immutable strings)
-            else if (std::holds_alternative<std::string>(collection)) {
+            else if (leftObj.isString()) {
                 throw vanction_error::TypeError("Strings are immutable, cannot assign to index");
             }
             else {
                 throw vanction_error::TypeError("Index assignment not supported for this type");
             }
         }
-        // Handle binary expressions with dot operator for instance properties
-        else if (auto binaryExpr = dynamic_cast<BinaryExpression*>(assignExpr->left)) {
-            if (binaryExpr->op == ".") {
-                if (auto leftIdent = dynamic_cast<Identifier*>(binaryExpr->left)) {
-                    if (leftIdent->name == "instance") {
-                        // This is an instance property assignment: instance.property = value
-                        if (auto rightIdent = dynamic_cast<Identifier*>(binaryExpr->right)) {
-                            std::string propertyName = rightIdent->name;
-                            
-                            // Get the instance from the variables environment
-                            if (variables.find("instance") == variables.end()) {
-                                throw vanction_error::MethodError("Instance variable not found in current context");
-                            }
-                            
-                            Value instanceVal = variables["instance"];
-                            if (!std::holds_alternative<Instance*>(instanceVal)) {
-                                throw vanction_error::MethodError("instance variable is not an Instance*");
-                            }
-                            
-                            Instance* instance = std::get<Instance*>(instanceVal);
-                            // Assign value to instance variable
-                            instance->instanceVariables[propertyName] = value;
-                        }
-                    }
-                }
-            }
-        }
-        return value;
-    } else if (auto binaryExpr = dynamic_cast<BinaryExpression*>(expr)) {
-        // Execute binary expression
-        auto leftVal = executeExpression(binaryExpr->left);
-        auto rightVal = executeExpression(binaryExpr->right);
+    } else if (auto indexAccess = nodeCast<IndexAccessExpression>(target)) {
+        // Handle index assignment with IndexAccessExpression: obj[index] = value
+        // Execute the collection expression (object being indexed)
+        Value collection = executeExpression(indexAccess->collection);
+        // Execute the index expression
+        Value indexExpr = executeExpression(indexAccess->index);
         
-        // Handle array indexing: obj[expr]
-        if (binaryExpr->op == "[") {
-            // Handle string indexing
-            if (std::holds_alternative<std::string>(leftVal)) {
-                std::string str = std::get<std::string>(leftVal);
-                
-                // Convert index to integer
-                int index;
-                if (std::holds_alternative<int>(rightVal)) {
-                    index = std::get<int>(rightVal);
-                } else {
-                    throw vanction_error::TypeError("String index must be an integer");
-                }
-                
-                // Handle negative indices
-                if (index < 0) {
-                    index = str.length() + index;
-                }
-                
-                // Check bounds
-                if (index < 0 || index >= str.length()) {
-                    throw vanction_error::RangeError("String index out of range", 0, 0);
-                }
-                
-                return str[index];
+        // Handle List index assignment
+        if (collection.isList()) {
+            List* list = collection.asList();
+            
+            // Convert index to integer
+            int index;
+            if (indexExpr.isInt()) {
+                index = indexExpr.asInt();
+            } else {
+                throw vanction_error::TypeError("List index must be an integer");
             }
-            // Handle List indexing
-            else if (std::holds_alternative<List*>(leftVal)) {
-                List* list = std::get<List*>(leftVal);
-                
-                // Convert index to integer
-                int index;
-                if (std::holds_alternative<int>(rightVal)) {
-                    index = std::get<int>(rightVal);
-                } else {
-                    throw vanction_error::TypeError("List index must be an integer");
-                }
-                
-                return list->get(index);
+            
+            // Handle negative indices
+            if (index < 0) {
+                index = list->size() + index;
             }
-            // Handle HashMap indexing
-            else if (std::holds_alternative<HashMap*>(leftVal)) {
-                HashMap* map = std::get<HashMap*>(leftVal);
-                
-                // Convert key to string
-                std::string key;
-                if (std::holds_alternative<std::string>(rightVal)) {
-                    key = std::get<std::string>(rightVal);
-                } else {
-                    // Convert other types to string
-                    auto toString = [](Value val) -> std::string {
-                        if (std::holds_alternative<int>(val)) {
-                            return std::to_string(std::get<int>(val));
-                        } else if (std::holds_alternative<float>(val)) {
-                            return std::to_string(std::get<float>(val));
-                        } else if (std::holds_alternative<double>(val)) {
-                            return std::to_string(std::get<double>(val));
-                        } else if (std::holds_alternative<bool>(val)) {
-                            return std::get<bool>(val) ? "true" : "false";
-                        } else if (std::holds_alternative<char>(val)) {
-                            return std::string(1, std::get<char>(val));
-                        } else {
-                            throw vanction_error::TypeError("HashMap key must be a string or convertible to string");
+            
+            // Check bounds
+            if (index < 0 || index >= list->size()) {
+                throw vanction_error::RangeError("List index out of range", 0, 0);
+            }
+            
+            // Assign value to list index
+            list->set(index, value);
+        }
+        // Handle HashMap index assignment
+        else if (collection.isHashMap()) {
+            HashMap* map = collection.asHashMap();
+            
+            // Assign value to HashMap key
+            map->set(indexExpr, value);
+        }
+        // Handle string index assignment (immutable strings)
+        else if (collection.isString()) {
+            throw vanction_error::TypeError("Strings are immutable, cannot assign to index");
+        }
+        else {
+            throw vanction_error::TypeError("Index assignment not supported for this type");
+        }
+    }
+    // Handle binary expressions with dot operator for instance properties
+    else if (auto binaryExpr = nodeCast<BinaryExpression>(target)) {
+        if (binaryExpr->opcode == BinaryOperator::Member) {
+            if (auto leftIdent = nodeCast<Identifier>(binaryExpr->left)) {
+                if (leftIdent->name == "instance") {
+                    // This is an instance property assignment: instance.property = value
+                    if (auto rightIdent = nodeCast<Identifier>(binaryExpr->right)) {
+                        std::string propertyName = rightIdent->name;
+                        
+                        // Get the instance from the current environment
+                        Value instanceVal;
+                        if (!lookupVariable("instance", instanceVal)) {
+                            throw vanction_error::MethodError("Instance variable not found in current context");
                         }
-                    };
-                    key = toString(rightVal);
-                }
-                
-                return map->get(key);
-            }
-            
-            throw vanction_error::TypeError("Indexing not supported for this type");
-        }
-        
-        // Handle string operations, including mixed type concatenation
-        if (binaryExpr->op == "+") {
-            // Check if either operand is a string
-            if (std::holds_alternative<std::string>(leftVal) || std::holds_alternative<std::string>(rightVal)) {
-                // Convert both operands to strings
-                auto toString = [](Value val) -> std::string {
-                    if (std::holds_alternative<std::string>(val)) {
-                        return std::get<std::string>(val);
-                    } else if (std::holds_alternative<int>(val)) {
-                        return std::to_string(std::get<int>(val));
-                    } else if (std::holds_alternative<float>(val)) {
-                        return std::to_string(std::get<float>(val));
-                    } else if (std::holds_alternative<double>(val)) {
-                        return std::to_string(std::get<double>(val));
-                    } else if (std::holds_alternative<bool>(val)) {
-                        return std::get<bool>(val) ? "true" : "false";
-                    } else if (std::holds_alternative<char>(val)) {
-                        return std::string(1, std::get<char>(val));
-                    } else if (std::holds_alternative<List*>(val)) {
-                        List* list = std::get<List*>(val);
-                        std::string result = "[";
-                        for (size_t i = 0; i < list->elements.size(); ++i) {
-                            // Recursively convert each element to string
-                            Value elem = list->elements[i];
-                            std::string elemStr;
-                            if (std::holds_alternative<std::string>(elem)) {
-                                elemStr = std::get<std::string>(elem);
-                            } else if (std::holds_alternative<int>(elem)) {
-                                elemStr = std::to_string(std::get<int>(elem));
-                            } else if (std::holds_alternative<float>(elem)) {
-                                elemStr = std::to_string(std::get<float>(elem));
-                            } else if (std::holds_alternative<double>(elem)) {
-                                elemStr = std::to_string(std::get<double>(elem));
-                            } else if (std::holds_alternative<bool>(elem)) {
-                                elemStr = std::get<bool>(elem) ? "true" : "false";
-                            } else if (std::holds_alternative<char>(elem)) {
-                                elemStr = std::string(1, std::get<char>(elem));
-                            } else {
-                                elemStr = "unknown";
-                            }
-                            result += elemStr;
-                            if (i < list->elements.size() - 1) {
-                                result += ", ";
-                            }
+                        
+                        if (!instanceVal.isInstance()) {
+                            throw vanction_error::MethodError("instance variable is not an Instance*");
                         }
-                        result += "]";
-                        return result;
-                    } else if (std::holds_alternative<HashMap*>(val)) {
-                        return "{...}";
-                    } else {
-                        // Handle monostate (which is what our skipped method calls return)
-                        return "";
+                        
+                        Instance* instance = instanceVal.asInstance();
+                        // Assign value to instance variable
+                        instance->setField(propertyName, value);
                     }
-                };
-                
-                std::string leftStr = toString(leftVal);
-                std::string rightStr = toString(rightVal);
-                
-                // String concatenation
-                return leftStr + rightStr;
-            }
-        } else if (std::holds_alternative<std::string>(leftVal) && std::holds_alternative<std::string>(rightVal)) {
-            // Handle other string operations (only when both operands are strings)
-            std::string leftStr = std::get<std::string>(leftVal);
-            std::string rightStr = std::get<std::string>(rightVal);
-            
-            if (binaryExpr->op == "*") {
-                // String repetition - right operand must be a number
-                // For simplicity, we'll skip this for now
-                return leftStr;
-            }
-        }
-        
-        // Handle logical operations specially
-        if (binaryExpr->op == "&" || binaryExpr->op == "|" || binaryExpr->op == "^") {
-            auto getBool = [](Value val) -> bool {
-                if (std::holds_alternative<bool>(val)) {
-                    return std::get<bool>(val);
-                } else if (std::holds_alternative<int>(val)) {
-                    return std::get<int>(val) != 0;
-                } else if (std::holds_alternative<float>(val)) {
-                    return std::get<float>(val) != 0.0f;
-                } else if (std::holds_alternative<double>(val)) {
-                    return std::get<double>(val) != 0.0;
-                } else {
-                    return false;
                 }
-            };
-            
-            bool leftBool = getBool(leftVal);
-            bool rightBool = getBool(rightVal);
-            
-            if (binaryExpr->op == "&") {
-                return leftBool && rightBool;
-            } else if (binaryExpr->op == "|") {
-                return leftBool || rightBool;
-            } else if (binaryExpr->op == "^") {
-                return leftBool != rightBool;
             }
         }
+    }
+}
+
+// Fast path for int operands, returns false when the operator needs the generic path
+bool evaluateIntBinary(BinaryOperator op, int left, int right, Value& result) {
+    switch (op) {
+        case BinaryOperator::Add:
+            result = static_cast<int>(static_cast<double>(left) + static_cast<double>(right));
+            return true;
+        case BinaryOperator::Subtract:
+            result = static_cast<int>(static_cast<double>(left) - static_cast<double>(right));
+            return true;
+        case BinaryOperator::Multiply:
+            result = static_cast<int>(static_cast<double>(left) * static_cast<double>(right));
+            return true;
+        case BinaryOperator::Divide:
+            if (right == 0) {
+                return false;
+            }
+            result = static_cast<int>(static_cast<double>(left) / static_cast<double>(right));
+            return true;
+        case BinaryOperator::Modulo:
+            if (right == 0) {
+                return false;
+            }
+            result = left % right;
+            return true;
+        case BinaryOperator::ShiftLeft:
+            result = left << right;
+            return true;
+        case BinaryOperator::ShiftRight:
+            result = left >> right;
+            return true;
+        case BinaryOperator::And:
+            result = left != 0 && right != 0;
+            return true;
+        case BinaryOperator::Or:
+            result = left != 0 || right != 0;
+            return true;
+        case BinaryOperator::Xor:
+            result = (left != 0) != (right != 0);
+            return true;
+        case BinaryOperator::Equal:
+            result = left == right;
+            return true;
+        case BinaryOperator::NotEqual:
+            result = left != right;
+            return true;
+        case BinaryOperator::Less:
+            result = left < right;
+            return true;
+        case BinaryOperator::LessEqual:
+            result = left <= right;
+            return true;
+        case BinaryOperator::Greater:
+            result = left > right;
+            return true;
+        case BinaryOperator::GreaterEqual:
+            result = left >= right;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Fast path for double operands, returns false when the operator needs the generic path
+bool evaluateDoubleBinary(BinaryOperator op, double left, double right, Value& result) {
+    switch (op) {
+        case BinaryOperator::Add:
+            result = left + right;
+            return true;
+        case BinaryOperator::Subtract:
+            result = left - right;
+            return true;
+        case BinaryOperator::Multiply:
+            result = left * right;
+            return true;
+        case BinaryOperator::Divide:
+            if (right == 0.0) {
+                return false;
+            }
+            result = left / right;
+            return true;
+        case BinaryOperator::Equal:
+            result = left == right;
+            return true;
+        case BinaryOperator::NotEqual:
+            result = left != right;
+            return true;
+        case BinaryOperator::Less:
+            result = left < right;
+            return true;
+        case BinaryOperator::LessEqual:
+            result = left <= right;
+            return true;
+        case BinaryOperator::Greater:
+            result = left > right;
+            return true;
+        case BinaryOperator::GreaterEqual:
+            result = left >= right;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Append the text of a value as string concatenation and StringBuilder.append see it
+void appendValueText(std::string& out, const Value& val) {
+    if (val.isString()) {
+        out.append(val.asString());
+    } else if (val.isInt()) {
+        out += std::to_string(val.asInt());
+    } else if (val.isFloat()) {
+        out += std::to_string(val.asFloat());
+    } else if (val.isDouble()) {
+        out += std::to_string(val.asDouble());
+    } else if (val.isBool()) {
+        out += val.asBool() ? "true" : "false";
+    } else if (val.isChar()) {
+        out += val.asChar();
+    } else if (val.isStringBuilder()) {
+        out += val.asStringBuilder()->buffer;
+    } else if (val.isList()) {
+        List* list = val.asList();
+        out += "[";
+        for (int i = 0; i < list->size(); ++i) {
+            // Nested lists and other objects are not expanded
+            Value elem = list->at(i);
+            if (elem.isString() || elem.isInt() || elem.isFloat() || elem.isDouble() || elem.isBool() || elem.isChar()) {
+                appendValueText(out, elem);
+            } else {
+                out += "unknown";
+            }
+            if (i < list->size() - 1) {
+                out += ", ";
+            }
+        }
+        out += "]";
+    } else if (val.isHashMap()) {
+        out += "{...}";
+    }
+    // Anything else (such as nil from skipped method calls) adds nothing
+}
+
+// Fast path for string operands, returns false when the operator needs the generic path
+bool evaluateStringBinary(BinaryOperator op, std::string_view left, std::string_view right, Value& result) {
+    switch (op) {
+        case BinaryOperator::Add: {
+            std::string joined;
+            joined.reserve(left.size() + right.size());
+            joined.append(left).append(right);
+            result = std::move(joined);
+            return true;
+        }
+        case BinaryOperator::Equal:
+            result = left == right;
+            return true;
+        case BinaryOperator::NotEqual:
+            result = left != right;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Index a string, list or hash map: collection[index]
+Value indexValue(const Value& leftVal, const Value& rightVal) {
+    // Handle string indexing
+    if (leftVal.isString()) {
+        std::string_view str = leftVal.asString();
         
-        // Handle comparison operators
-        if (binaryExpr->op == "==" || binaryExpr->op == "!=") {
-            // Handle string comparisons
-            if (std::holds_alternative<std::string>(leftVal) && std::holds_alternative<std::string>(rightVal)) {
-                std::string leftStr = std::get<std::string>(leftVal);
-                std::string rightStr = std::get<std::string>(rightVal);
-                
-                if (binaryExpr->op == "==") {
-                    return (leftStr == rightStr);
-                } else {
-                    return (leftStr != rightStr);
-                }
-            }
-            
-            // Handle numeric comparisons
-            auto getNumber = [](Value val) -> double {
-                if (std::holds_alternative<int>(val)) {
-                    return static_cast<double>(std::get<int>(val));
-                } else if (std::holds_alternative<bool>(val)) {
-                    return static_cast<double>(std::get<bool>(val));
-                } else if (std::holds_alternative<float>(val)) {
-                    return static_cast<double>(std::get<float>(val));
-                } else if (std::holds_alternative<double>(val)) {
-                    return std::get<double>(val);
-                } else if (std::holds_alternative<char>(val)) {
-                    return static_cast<double>(std::get<char>(val));
-                } else {
-                    throw vanction_error::ValueError("Cannot convert to number");
+        // Convert index to integer
+        int index;
+        if (rightVal.isInt()) {
+            index = rightVal.asInt();
+        } else {
+            throw vanction_error::TypeError("String index must be an integer");
+        }
+        
+        // Handle negative indices
+        if (index < 0) {
+            index = str.length() + index;
+        }
+        
+        // Check bounds
+        if (index < 0 || index >= str.length()) {
+            throw vanction_error::RangeError("String index out of range", 0, 0);
+        }
+        
+        return str[index];
+    }
+    // Handle List indexing
+    else if (leftVal.isList()) {
+        List* list = leftVal.asList();
+        
+        // Convert index to integer
+        int index;
+        if (rightVal.isInt()) {
+            index = rightVal.asInt();
+        } else {
+            throw vanction_error::TypeError("List index must be an integer");
+        }
+        
+        return list->get(index);
+    }
+    // Handle HashMap indexing
+    else if (leftVal.isHashMap()) {
+        HashMap* map = leftVal.asHashMap();
+        
+        // Keys are hashed natively (strings, numbers, chars and bools)
+        return map->get(rightVal);
+    }
+    
+    throw vanction_error::TypeError("Indexing not supported for this type");
+}
+
+// Apply a binary operator to already evaluated operands
+Value evaluateBinary(BinaryExpression* binaryExpr, const Value& leftVal, const Value& rightVal) {
+    const BinaryOperator op = binaryExpr->opcode;
+    
+    // Operands of the same primitive type go straight to their per-operator implementation
+    if (leftVal.type() == rightVal.type()) {
+        Value result;
+        switch (leftVal.type()) {
+            case ValueType::Int:
+                if (evaluateIntBinary(op, leftVal.asInt(), rightVal.asInt(), result)) {
+                    return result;
                 }
-            };
-            
-            double leftNum = getNumber(leftVal);
-            double rightNum = getNumber(rightVal);
-            
-            if (binaryExpr->op == "==") {
-                return (leftNum == rightNum);
-            } else {
-                return (leftNum != rightNum);
-            }
-        } else if (binaryExpr->op == "<" || binaryExpr->op == "<=" || binaryExpr->op == ">" || binaryExpr->op == ">=") {
-            // Handle all comparison operators
-            auto getNumber = [](Value val) -> double {
-                if (std::holds_alternative<int>(val)) {
-                    return static_cast<double>(std::get<int>(val));
-                } else if (std::holds_alternative<bool>(val)) {
-                    return static_cast<double>(std::get<bool>(val));
-                } else if (std::holds_alternative<float>(val)) {
-                    return static_cast<double>(std::get<float>(val));
-                } else if (std::holds_alternative<double>(val)) {
-                    return std::get<double>(val);
-                } else if (std::holds_alternative<char>(val)) {
-                    return static_cast<double>(std::get<char>(val));
-                } else {
-                    throw std::runtime_error("Cannot convert to number");
+                break;
+            case ValueType::Double:
+                if (evaluateDoubleBinary(op, leftVal.asDouble(), rightVal.asDouble(), result)) {
+                    return result;
                 }
-            };
-            
-            double leftNum = getNumber(leftVal);
-            double rightNum = getNumber(rightVal);
-            
-            if (binaryExpr->op == "<") {
-                return (leftNum < rightNum);
-            } else if (binaryExpr->op == "<=") {
-                return (leftNum <= rightNum);
-            } else if (binaryExpr->op == ">") {
-                return (leftNum > rightNum);
+                break;
+            case ValueType::String:
+                if (evaluateStringBinary(op, leftVal.asString(), rightVal.asString(), result)) {
+                    return result;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    
+    // Handle array indexing: obj[expr]
+    if (op == BinaryOperator::Index) {
+        return indexValue(leftVal, rightVal);
+    }
+    
+    // Handle string operations, including mixed type concatenation
+    if (op == BinaryOperator::Add) {
+        // Check if either operand is a string
+        if (leftVal.isString() || rightVal.isString()) {
+            // Convert both operands to text straight into the result
+            std::string joined;
+            appendValueText(joined, leftVal);
+            appendValueText(joined, rightVal);
+            return joined;
+        }
+    } else if (leftVal.isString() && rightVal.isString()) {
+        // Handle other string operations (only when both operands are strings)
+        if (op == BinaryOperator::Multiply) {
+            // String repetition - right operand must be a number
+            // For simplicity, we'll skip this for now
+            return leftVal;
+        }
+    }
+    
+    // Handle logical operations specially
+    if (op == BinaryOperator::And || op == BinaryOperator::Or || op == BinaryOperator::Xor) {
+        auto getBool = [](Value val) -> bool {
+            if (val.isBool()) {
+                return val.asBool();
+            } else if (val.isInt()) {
+                return val.asInt() != 0;
+            } else if (val.isFloat()) {
+                return val.asFloat() != 0.0f;
+            } else if (val.isDouble()) {
+                return val.asDouble() != 0.0;
             } else {
-                return (leftNum >= rightNum);
+                return false;
             }
-        } else {
-            // Handle numeric operations
-            auto getNumber = [](Value val) -> double {
-                if (std::holds_alternative<int>(val)) {
-                    return static_cast<double>(std::get<int>(val));
-                } else if (std::holds_alternative<bool>(val)) {
-                    return static_cast<double>(std::get<bool>(val));
-                } else if (std::holds_alternative<float>(val)) {
-                    return static_cast<double>(std::get<float>(val));
-                } else if (std::holds_alternative<double>(val)) {
-                    return std::get<double>(val);
-                } else if (std::holds_alternative<char>(val)) {
-                    return static_cast<double>(std::get<char>(val));
-                } else {
-                    throw std::runtime_error("Cannot convert to number");
-                }
-            };
+        };
+        
+        bool leftBool = getBool(leftVal);
+        bool rightBool = getBool(rightVal);
+        
+        if (op == BinaryOperator::And) {
+            return leftBool && rightBool;
+        } else if (op == BinaryOperator::Or) {
+            return leftBool || rightBool;
+        } else if (op == BinaryOperator::Xor) {
+            return leftBool != rightBool;
+        }
+    }
+    
+    // Handle comparison operators
+    if (op == BinaryOperator::Equal || op == BinaryOperator::NotEqual) {
+        // Handle string comparisons
+        if (leftVal.isString() && rightVal.isString()) {
+            std::string_view leftStr = leftVal.asString();
+            std::string_view rightStr = rightVal.asString();
             
-            double leftNum = getNumber(leftVal);
-            double rightNum = getNumber(rightVal);
-            double result = 0.0;
-            
-            if (binaryExpr->op == "+") {
-                result = leftNum + rightNum;
-            } else if (binaryExpr->op == "-") {
-                result = leftNum - rightNum;
-            } else if (binaryExpr->op == "*") {
-                result = leftNum * rightNum;
-            } else if (binaryExpr->op == "/") {
-                // Check for division by zero
-                if (rightNum == 0.0) {
-                    throw vanction_error::DivideByZeroError("Division by zero", binaryExpr->getLine(), binaryExpr->getColumn());
-                }
-                result = leftNum / rightNum;
-            } else if (binaryExpr->op == "**") {
-                // Exponentiation operation
-                result = 1.0;
-                for (int i = 0; i < static_cast<int>(rightNum); i++) {
-                    result *= leftNum;
-                }
-            } else if (binaryExpr->op == "<<") {
-                // Bit shift operations - cast to int
-                result = static_cast<double>(static_cast<int>(leftNum) << static_cast<int>(rightNum));
-            } else if (binaryExpr->op == ">>") {
-                // Bit shift operations - cast to int
-                result = static_cast<double>(static_cast<int>(leftNum) >> static_cast<int>(rightNum));
-            } else if (binaryExpr->op == "%") {
-                // Modulo operation - cast to int
-                result = static_cast<double>(static_cast<int>(leftNum) % static_cast<int>(rightNum));
-            }
-            
-            // Determine result type based on operands
-            if (std::holds_alternative<int>(leftVal) && std::holds_alternative<int>(rightVal)) {
-                // Both operands are integers - result is integer
-                return static_cast<int>(result);
-            } else if (std::holds_alternative<float>(leftVal) || std::holds_alternative<float>(rightVal)) {
-                // At least one float operand - result is float
-                return static_cast<float>(result);
+            if (op == BinaryOperator::Equal) {
+                return (leftStr == rightStr);
             } else {
-                // Default to double
-                return result;
+                return (leftStr != rightStr);
             }
         }
-    } else if (auto instanceCreation = dynamic_cast<InstanceCreationExpression*>(expr)) {
-        // Create new instance
-        std::string className = instanceCreation->className;
         
-        if (debugMode) {
-            std::cout << "[DEBUG] Creating instance of class: " << className;
-            if (!instanceCreation->namespaceName.empty()) {
-                std::cout << " (namespace: " << instanceCreation->namespaceName << ")";
+        // Handle numeric comparisons
+        auto getNumber = [](Value val) -> double {
+            if (val.isInt()) {
+                return static_cast<double>(val.asInt());
+            } else if (val.isBool()) {
+                return static_cast<double>(val.asBool());
+            } else if (val.isFloat()) {
+                return static_cast<double>(val.asFloat());
+            } else if (val.isDouble()) {
+                return val.asDouble();
+            } else if (val.isChar()) {
+                return static_cast<double>(val.asChar());
+            } else {
+                throw vanction_error::ValueError("Cannot convert to number");
             }
-            std::cout << std::endl;
+        };
+        
+        double leftNum = getNumber(leftVal);
+        double rightNum = getNumber(rightVal);
+        
+        if (op == BinaryOperator::Equal) {
+            return (leftNum == rightNum);
+        } else {
+            return (leftNum != rightNum);
         }
+    } else if (op == BinaryOperator::Less || op == BinaryOperator::LessEqual || op == BinaryOperator::Greater || op == BinaryOperator::GreaterEqual) {
+        // Handle all comparison operators
+        auto getNumber = [](Value val) -> double {
+            if (val.isInt()) {
+                return static_cast<double>(val.asInt());
+            } else if (val.isBool()) {
+                return static_cast<double>(val.asBool());
+            } else if (val.isFloat()) {
+                return static_cast<double>(val.asFloat());
+            } else if (val.isDouble()) {
+                return val.asDouble();
+            } else if (val.isChar()) {
+                return static_cast<double>(val.asChar());
+            } else {
+                throw std::runtime_error("Cannot convert to number");
+            }
+        };
+        
+        double leftNum = getNumber(leftVal);
+        double rightNum = getNumber(rightVal);
         
-        // Check if class exists
-        if (classes.find(className) == classes.end()) {
-            throw vanction_error::MethodError("Undefined class: " + className);
+        if (op == BinaryOperator::Less) {
+            return (leftNum < rightNum);
+        } else if (op == BinaryOperator::LessEqual) {
+            return (leftNum <= rightNum);
+        } else if (op == BinaryOperator::Greater) {
+            return (leftNum > rightNum);
+        } else {
+            return (leftNum >= rightNum);
         }
+    } else {
+        // Handle numeric operations
+        auto getNumber = [](Value val) -> double {
+            if (val.isInt()) {
+                return static_cast<double>(val.asInt());
+            } else if (val.isBool()) {
+                return static_cast<double>(val.asBool());
+            } else if (val.isFloat()) {
+                return static_cast<double>(val.asFloat());
+            } else if (val.isDouble()) {
+                return val.asDouble();
+            } else if (val.isChar()) {
+                return static_cast<double>(val.asChar());
+            } else {
+                throw std::runtime_error("Cannot convert to number");
+            }
+        };
         
-        // Create instance
-        ClassDefinition* classDef = classes[className];
-        Instance* instance = new Instance(classDef);
+        double leftNum = getNumber(leftVal);
+        double rightNum = getNumber(rightVal);
+        double result = 0.0;
         
-        if (debugMode) {
-            std::cout << "[DEBUG] Instance created successfully" << std::endl;
+        if (op == BinaryOperator::Add) {
+            result = leftNum + rightNum;
+        } else if (op == BinaryOperator::Subtract) {
+            result = leftNum - rightNum;
+        } else if (op == BinaryOperator::Multiply) {
+            result = leftNum * rightNum;
+        } else if (op == BinaryOperator::Divide) {
+            // Check for division by zero
+            if (rightNum == 0.0) {
+                throw vanction_error::DivideByZeroError("Division by zero", binaryExpr->getLine(), binaryExpr->getColumn());
+            }
+            result = leftNum / rightNum;
+        } else if (op == BinaryOperator::Power) {
+            // Exponentiation operation
+            result = 1.0;
+            for (int i = 0; i < static_cast<int>(rightNum); i++) {
+                result *= leftNum;
+            }
+        } else if (op == BinaryOperator::ShiftLeft) {
+            // Bit shift operations - cast to int
+            result = static_cast<double>(static_cast<int>(leftNum) << static_cast<int>(rightNum));
+        } else if (op == BinaryOperator::ShiftRight) {
+            // Bit shift operations - cast to int
+            result = static_cast<double>(static_cast<int>(leftNum) >> static_cast<int>(rightNum));
+        } else if (op == BinaryOperator::Modulo) {
+            // Modulo operation - cast to int
+            result = static_cast<double>(static_cast<int>(leftNum) % static_cast<int>(rightNum));
         }
         
-        // Execute init method if it exists and there are arguments
-        if (classDef->initMethod) {
-            // Save current variable environment
-            auto savedVariables = variables;
+        // Determine result type based on operands
+        if (leftVal.isInt() && rightVal.isInt()) {
+            // Both operands are integers - result is integer
+            return static_cast<int>(result);
+        } else if (leftVal.isFloat() || rightVal.isFloat()) {
+            // At least one float operand - result is float
+            return static_cast<float>(result);
+        } else {
+            // Default to double
+            return result;
+        }
+    }
+}
+
+// Execute expression
+Value executeExpression(Expression* expr) {
+    if (!expr) {
+        return std::monostate{};
+    }
+    
+    switch (expr->kind) {
+        case NodeKind::FunctionCall:
+            // Execute function call
+            return executeFunctionCall(static_cast<FunctionCall*>(expr));
+        case NodeKind::FunctionCallExpression: {
+            auto funcCallExpr = static_cast<FunctionCallExpression*>(expr);
+            // Execute function call expression (for lambdas, etc.)
+            // First execute the callee to get the function
+            Value calleeValue = executeExpression(funcCallExpr->callee);
             
-            // Save current instance in a special variable for init method access
-            Value savedThis = variables["this"];
-            variables["this"] = instance;
+            // Check if it's a lambda expression
+            if (calleeValue.isLambda()) {
+                Closure* closure = calleeValue.asClosure();
+                LambdaExpression* lambda = closure->lambda;
+                // Bind arguments to parameters
+                if (lambda->parameters.size() != funcCallExpr->arguments.size()) {
+                    throw vanction_error::MethodError("Argument count mismatch for lambda call");
+                }
+                
+                // Execute arguments
+                std::vector<Value> argValues;
+                GcVectorRoot argRoot(argValues);
+                for (auto arg : funcCallExpr->arguments) {
+                    argValues.push_back(executeExpression(arg));
+                }
+                
+                // Execute the lambda body in its own frame
+                Value result = callLambda(closure, argValues.data(), argValues.size());
+                
+                return result;
+            } else {
+                throw vanction_error::MethodError("Attempt to call a non-function value");
+            }
+            break;
+        }
+        case NodeKind::AssignmentExpression: {
+            auto assignExpr = static_cast<AssignmentExpression*>(expr);
+            // Execute assignment expression
+            Value value = executeExpression(assignExpr->right);
+            if (errorResult.raised) {
+                return std::monostate{};
+            }
             
-            // Create a new variable environment for the init method execution
-            std::map<std::string, Value> initVariables = variables;
+            // Locals whose type inference proved the check cannot fail are stored directly
+            if (assignExpr->typeProven && currentFrame) {
+                auto ident = nodeCast<Identifier>(assignExpr->left);
+                if (ident && ident->slot >= 0 && !ident->isImmut) {
+                    currentFrame->slots[ident->slot] = value;
+                    return value;
+                }
+            }
             
-            // Set the instance parameter to the current instance
-            // This allows the init method to access the instance via the first parameter
-            if (classDef->initMethod->parameters.size() > 0) {
-                initVariables[classDef->initMethod->parameters[0].name] = instance;
+            assignValue(assignExpr->left, value);
+            return value;
+        }
+        case NodeKind::BinaryExpression: {
+            auto binaryExpr = static_cast<BinaryExpression*>(expr);
+            // Execute binary expression
+            auto leftVal = executeExpression(binaryExpr->left);
+            auto rightVal = executeExpression(binaryExpr->right);
+            
+            // The node specializes to the operand types of its first run, skipping the type dispatch
+            Value result;
+            switch (binaryExpr->quickened) {
+                case Quickened::IntBinary:
+                    if (leftVal.isInt() && rightVal.isInt()) {
+                        if (evaluateIntBinary(binaryExpr->opcode, leftVal.asInt(), rightVal.asInt(), result)) {
+                            return result;
+                        }
+                        return evaluateBinary(binaryExpr, leftVal, rightVal);
+                    }
+                    binaryExpr->quickened = Quickened::Generic;
+                    break;
+                case Quickened::DoubleBinary:
+                    if (leftVal.isDouble() && rightVal.isDouble()) {
+                        if (evaluateDoubleBinary(binaryExpr->opcode, leftVal.asDouble(), rightVal.asDouble(), result)) {
+                            return result;
+                        }
+                        return evaluateBinary(binaryExpr, leftVal, rightVal);
+                    }
+                    binaryExpr->quickened = Quickened::Generic;
+                    break;
+                case Quickened::Uninitialized:
+                    binaryExpr->quickened = Quickened::Generic;
+                    if (leftVal.isInt() && rightVal.isInt() && evaluateIntBinary(binaryExpr->opcode, leftVal.asInt(), rightVal.asInt(), result)) {
+                        binaryExpr->quickened = Quickened::IntBinary;
+                        return result;
+                    }
+                    if (leftVal.isDouble() && rightVal.isDouble() && evaluateDoubleBinary(binaryExpr->opcode, leftVal.asDouble(), rightVal.asDouble(), result)) {
+                        binaryExpr->quickened = Quickened::DoubleBinary;
+                        return result;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return evaluateBinary(binaryExpr, leftVal, rightVal);
+        }
+        case NodeKind::InstanceCreationExpression: {
+            auto instanceCreation = static_cast<InstanceCreationExpression*>(expr);
+            // Create new instance
+            std::string className = instanceCreation->className;
+            
+            if (debugMode) {
+                std::cout << "[DEBUG] Creating instance of class: " << className;
+                if (!instanceCreation->namespaceName.empty()) {
+                    std::cout << " (namespace: " << instanceCreation->namespaceName << ")";
+                }
+                std::cout << std::endl;
+            }
+            
+            // Check if class exists
+            if (classes.find(className) == classes.end()) {
+                throw vanction_error::MethodError("Undefined class: " + className);
+            }
+            
+            // Create instance
+            ClassDefinition* classDef = classes[className];
+            Instance* instance = heap.newInstance(classDef);
+            
+            if (debugMode) {
+                std::cout << "[DEBUG] Instance created successfully" << std::endl;
+            }
+            
+            // Execute init method if it exists and there are arguments
+            if (classDef->initMethod) {
+                InstanceMethodDeclaration* initMethod = classDef->initMethod;
+                
+                // Create a new frame for the init method execution
+                std::optional<Frame> storage;
+                Frame* initFrame = enterFrame(storage, initMethod->layout, nullptr, initMethod->parameters.size());
+                
+                // Set the instance parameter to the current instance
+                // This allows the init method to access the instance via the first parameter
+                // and, for backward compatibility, via the 'instance' and 'this' variables
+                bindInstance(initFrame, initMethod, instance, true);
+                if (initMethod->layout.thisSlot >= 0) {
+                    initFrame->slots[initMethod->layout.thisSlot] = instance;
+                }
+                
+                // Assign init method arguments to parameters, starting from index 1
+                // (index 0 is the instance parameter which we already set)
+                if (debugMode) {
+                    std::cout << "[DEBUG] Instance creation with " << instanceCreation->arguments.size() << " arguments" << std::endl;
+                    std::cout << "[DEBUG] Init method has " << classDef->initMethod->parameters.size() << " parameters" << std::endl;
+                }
+                for (size_t i = 0; i < instanceCreation->arguments.size(); ++i) {
+                    size_t paramIndex = i + 1;  // Skip the first parameter (instance)
+                    if (debugMode) {
+                        std::cout << "[DEBUG] Processing argument " << i << " -> parameter " << paramIndex << std::endl;
+                    }
+                    if (paramIndex < classDef->initMethod->parameters.size()) {
+                        if (debugMode) {
+                            std::cout << "[DEBUG] Executing argument " << i << " for parameter " << paramIndex << std::endl;
+                        }
+                        Value argValue = executeExpression(instanceCreation->arguments[i]);
+                        if (debugMode) {
+                            std::cout << "[DEBUG] Argument " << i << " result: ";
+                            if (argValue.isString()) {
+                                std::cout << "string='" << argValue.asString() << "'";
+                            } else if (argValue.isInt()) {
+                                std::cout << "int=" << argValue.asInt();
+                            } else if (argValue.isFloat()) {
+                                std::cout << "float=" << argValue.asFloat();
+                            } else if (argValue.isDouble()) {
+                                std::cout << "double=" << argValue.asDouble();
+                            } else if (argValue.isBool()) {
+                                std::cout << "bool=" << (argValue.asBool() ? "true" : "false");
+                            } else if (argValue.isInstance()) {
+                                std::cout << "instance";
+                            } else if (argValue.isNil()) {
+                                std::cout << "undefined";
+                            } else {
+                                std::cout << "other type";
+                            }
+                            std::cout << std::endl;
+                            std::cout << "[DEBUG] Assigning to parameter: " << classDef->initMethod->parameters[paramIndex].name << std::endl;
+                        }
+                        initFrame->slots[paramIndex] = argValue;
+                    } else {
+                        if (debugMode) {
+                            std::cout << "[DEBUG] Skipping argument " << i << " - parameter index " << paramIndex << " out of range" << std::endl;
+                        }
+                    }
+                }
+                
+                // Execute init method body in its frame
+                FrameGuard guard(initFrame);
+                executeFunctionBody(initMethod);
             }
-            // Also explicitly add 'instance' variable for backward compatibility
-            // This ensures that the init method can access the instance via 'instance' variable
-            initVariables["instance"] = instance;
             
-            // Assign init method arguments to parameters, starting from index 1
-            // (index 0 is the instance parameter which we already set)
-            if (debugMode) {
-                std::cout << "[DEBUG] Instance creation with " << instanceCreation->arguments.size() << " arguments" << std::endl;
-                std::cout << "[DEBUG] Init method has " << classDef->initMethod->parameters.size() << " parameters" << std::endl;
-            }
-            for (size_t i = 0; i < instanceCreation->arguments.size(); ++i) {
-                size_t paramIndex = i + 1;  // Skip the first parameter (instance)
+            return instance;
+        }
+        case NodeKind::IndexAccessExpression: {
+            auto indexAccess = static_cast<IndexAccessExpression*>(expr);
+            // Index a string, list or hash map
+            Value collection = executeExpression(indexAccess->collection);
+            Value index = executeExpression(indexAccess->index);
+            return indexValue(collection, index);
+        }
+        case NodeKind::InstanceAccessExpression: {
+            auto instanceAccess = static_cast<InstanceAccessExpression*>(expr);
+            // Get instance
+            Value instanceVal = executeExpression(instanceAccess->instance);
+            
+            // Check if it's an Instance*
+            if (instanceVal.isInstance()) {
+                Instance* instance = instanceVal.asInstance();
+                const std::string& memberName = instanceAccess->memberName;
+                
                 if (debugMode) {
-                    std::cout << "[DEBUG] Processing argument " << i << " -> parameter " << paramIndex << std::endl;
+                    std::cout << "[DEBUG] Instance variable access: " << memberName << " on instance of class " << instance->cls->name << std::endl;
                 }
-                if (paramIndex < classDef->initMethod->parameters.size()) {
-                    if (debugMode) {
-                        std::cout << "[DEBUG] Executing argument " << i << " for parameter " << paramIndex << std::endl;
-                    }
-                    Value argValue = executeExpression(instanceCreation->arguments[i]);
+                
+                // Instance variable access, through the access site's cached shape when it matches
+                Value* field = nullptr;
+                if (instance->shape == instanceAccess->cachedShape) {
+                    field = &instance->fields[instanceAccess->cachedOffset];
+                } else if ((field = instance->getField(memberName))) {
+                    instanceAccess->cachedShape = instance->shape;
+                    instanceAccess->cachedOffset = static_cast<int>(field - instance->fields.data());
+                }
+                
+                if (field) {
+                    Value result = *field;
                     if (debugMode) {
-                        std::cout << "[DEBUG] Argument " << i << " result: ";
-                        if (std::holds_alternative<std::string>(argValue)) {
-                            std::cout << "string='" << std::get<std::string>(argValue) << "'";
-                        } else if (std::holds_alternative<int>(argValue)) {
-                            std::cout << "int=" << std::get<int>(argValue);
-                        } else if (std::holds_alternative<float>(argValue)) {
-                            std::cout << "float=" << std::get<float>(argValue);
-                        } else if (std::holds_alternative<double>(argValue)) {
-                            std::cout << "double=" << std::get<double>(argValue);
-                        } else if (std::holds_alternative<bool>(argValue)) {
-                            std::cout << "bool=" << (std::get<bool>(argValue) ? "true" : "false");
-                        } else if (std::holds_alternative<Instance*>(argValue)) {
+                        std::cout << "[DEBUG] Found variable " << memberName << " with value: ";
+                        if (result.isString()) {
+                            std::cout << "string='" << result.asString() << "'";
+                        } else if (result.isInt()) {
+                            std::cout << "int=" << result.asInt();
+                        } else if (result.isFloat()) {
+                            std::cout << "float=" << result.asFloat();
+                        } else if (result.isDouble()) {
+                            std::cout << "double=" << result.asDouble();
+                        } else if (result.isBool()) {
+                            std::cout << "bool=" << (result.asBool() ? "true" : "false");
+                        } else if (result.isInstance()) {
                             std::cout << "instance";
-                        } else if (std::holds_alternative<std::monostate>(argValue)) {
+                        } else if (result.isList()) {
+                            std::cout << "list";
+                        } else if (result.isHashMap()) {
+                            std::cout << "hashmap";
+                        } else if (result.isNil()) {
                             std::cout << "undefined";
+                        } else if (result.isError()) {
+                            std::cout << "errorobject";
                         } else {
                             std::cout << "other type";
                         }
                         std::cout << std::endl;
-                        std::cout << "[DEBUG] Assigning to parameter: " << classDef->initMethod->parameters[paramIndex].name << std::endl;
                     }
-                    initVariables[classDef->initMethod->parameters[paramIndex].name] = argValue;
+                    return result;
                 } else {
+                    // Return undefined if variable doesn't exist
                     if (debugMode) {
-                        std::cout << "[DEBUG] Skipping argument " << i << " - parameter index " << paramIndex << " out of range" << std::endl;
+                        std::cout << "[DEBUG] Variable " << memberName << " not found, returning undefined" << std::endl;
                     }
+                    return std::monostate{};
                 }
-            }
-            
-            // Switch to init method-specific environment
-            variables = initVariables;
-            
-            // Execute init method body
-            for (auto stmt : classDef->initMethod->body) {
-                bool shouldReturn = false;
-                executeStatement(stmt, &shouldReturn);
-                if (shouldReturn) {
-                    break;
+            } 
+            // Check if it's an ErrorObject*
+            else if (instanceVal.isError()) {
+                ErrorObject* errorObj = instanceVal.asError();
+                std::string memberName = instanceAccess->memberName;
+                
+                // Access ErrorObject properties
+                if (memberName == "text") {
+                    return errorObj->text;
+                } else if (memberName == "type") {
+                    return errorObj->type;
+                } else if (memberName == "info") {
+                    return errorObj->info;
+                } else {
+                    // Return undefined if property doesn't exist
+                    return std::monostate{};
                 }
+            } 
+            // Not an instance or error object
+            else {
+                throw vanction_error::MethodError("Cannot access property of non-instance");
             }
-            
-            // Restore saved "this" value
-            variables["this"] = savedThis;
-            
-            // Restore saved variable environment
-            variables = savedVariables;
+            break;
         }
-        
-        return instance;
-    } else if (auto instanceAccess = dynamic_cast<InstanceAccessExpression*>(expr)) {
-        // Get instance
-        Value instanceVal = executeExpression(instanceAccess->instance);
-        
-        // Check if it's an Instance*
-        if (std::holds_alternative<Instance*>(instanceVal)) {
-            Instance* instance = std::get<Instance*>(instanceVal);
-            std::string memberName = instanceAccess->memberName;
-            
-            if (debugMode) {
-                std::cout << "[DEBUG] Instance variable access: " << memberName << " on instance of class " << instance->cls->name << std::endl;
-            }
-            
-            // Instance variable access
-            if (instance->instanceVariables.find(memberName) != instance->instanceVariables.end()) {
-                Value result = instance->instanceVariables[memberName];
-                if (debugMode) {
-                    std::cout << "[DEBUG] Found variable " << memberName << " with value: ";
-                    if (std::holds_alternative<std::string>(result)) {
-                        std::cout << "string='" << std::get<std::string>(result) << "'";
-                    } else if (std::holds_alternative<int>(result)) {
-                        std::cout << "int=" << std::get<int>(result);
-                    } else if (std::holds_alternative<float>(result)) {
-                        std::cout << "float=" << std::get<float>(result);
-                    } else if (std::holds_alternative<double>(result)) {
-                        std::cout << "double=" << std::get<double>(result);
-                    } else if (std::holds_alternative<bool>(result)) {
-                        std::cout << "bool=" << (std::get<bool>(result) ? "true" : "false");
-                    } else if (std::holds_alternative<Instance*>(result)) {
-                        std::cout << "instance";
-                    } else if (std::holds_alternative<List*>(result)) {
-                        std::cout << "list";
-                    } else if (std::holds_alternative<HashMap*>(result)) {
-                        std::cout << "hashmap";
-                    } else if (std::holds_alternative<std::monostate>(result)) {
-                        std::cout << "undefined";
-                    } else if (std::holds_alternative<ErrorObject*>(result)) {
-                        std::cout << "errorobject";
-                    } else {
-                        std::cout << "other type";
-                    }
-                    std::cout << std::endl;
+        case NodeKind::Identifier: {
+            auto ident = static_cast<Identifier*>(expr);
+            // Get variable value
+            // Resolved locals are read straight from their frame slot or captured upvalue
+            if (ident->slot >= 0 || ident->upvalue >= 0) {
+                if (ident->slot >= 0 && currentFrame) {
+                    return currentFrame->slots[ident->slot];
                 }
-                return result;
-            } else {
-                // Return undefined if variable doesn't exist
-                if (debugMode) {
-                    std::cout << "[DEBUG] Variable " << memberName << " not found, returning undefined" << std::endl;
+                Upvalue* upvalue = ident->upvalue >= 0 ? upvalueAt(ident->upvalue) : nullptr;
+                if (!upvalue) {
+                    throw vanction_error::VariableError("Undefined variable '" + ident->name + "'", ident->getLine(), ident->getColumn());
                 }
-                return std::monostate{};
+                return *upvalue->location;
             }
-        } 
-        // Check if it's an ErrorObject*
-        else if (std::holds_alternative<ErrorObject*>(instanceVal)) {
-            ErrorObject* errorObj = std::get<ErrorObject*>(instanceVal);
-            std::string memberName = instanceAccess->memberName;
-            
-            // Access ErrorObject properties
-            if (memberName == "text") {
-                return errorObj->text;
-            } else if (memberName == "type") {
-                return errorObj->type;
-            } else if (memberName == "info") {
-                return errorObj->info;
-            } else {
-                // Return undefined if property doesn't exist
-                return std::monostate{};
+            // Then the constants and variables maps, through the entry cached on the node
+            if (Value* entry = globalBinding(ident)) {
+                return *entry;
             }
-        } 
-        // Not an instance or error object
-        else {
-            throw vanction_error::MethodError("Cannot access property of non-instance");
+            throw vanction_error::VariableError("Undefined variable '" + ident->name + "'", ident->getLine(), ident->getColumn());
         }
-    } else if (auto ident = dynamic_cast<Identifier*>(expr)) {
-        // Get variable value
-        // First check constants map
-        if (constants.find(ident->name) != constants.end()) {
-            return constants[ident->name];
+        case NodeKind::IntegerLiteral: {
+            auto intLit = static_cast<IntegerLiteral*>(expr);
+            // Integer literal
+            return intLit->value;
         }
-        // Then check variables map
-        else if (variables.find(ident->name) != variables.end()) {
-            return variables[ident->name];
-        } else {
-            throw vanction_error::VariableError("Undefined variable '" + ident->name + "'", ident->getLine(), ident->getColumn());
+        case NodeKind::FloatLiteral: {
+            auto floatLit = static_cast<FloatLiteral*>(expr);
+            // Float literal
+            return floatLit->value;
+        }
+        case NodeKind::DoubleLiteral: {
+            auto doubleLit = static_cast<DoubleLiteral*>(expr);
+            // Double literal
+            return doubleLit->value;
         }
-    } else if (auto intLit = dynamic_cast<IntegerLiteral*>(expr)) {
-        // Integer literal
-        return intLit->value;
-    } else if (auto floatLit = dynamic_cast<FloatLiteral*>(expr)) {
-        // Float literal
-        return floatLit->value;
-    } else if (auto doubleLit = dynamic_cast<DoubleLiteral*>(expr)) {
-        // Double literal
-        return doubleLit->value;
-    } else if (auto charLit = dynamic_cast<CharLiteral*>(expr)) {
-        // Char literal
-        return charLit->value;
-    } else if (auto stringLit = dynamic_cast<StringLiteral*>(expr)) {
-        // String literal
-        if (stringLit->type == "format") {
-            // Process formatted string
-            std::string formatted = stringLit->value;
-            size_t pos = 0;
-            while ((pos = formatted.find('{', pos)) != std::string::npos) {
-                // Check if it's already escaped
-                if (pos > 0 && formatted[pos - 1] == '\\') {
-                    // Skip escaped brace
-                    pos += 2;
-                    continue;
+        case NodeKind::CharLiteral: {
+            auto charLit = static_cast<CharLiteral*>(expr);
+            // Char literal
+            return charLit->value;
+        }
+        case NodeKind::StringLiteral: {
+            auto stringLit = static_cast<StringLiteral*>(expr);
+            // String literal
+            if (stringLit->type == "format") {
+                // Single pass over the segments the parser split the format string into
+                std::string formatted;
+                formatted.reserve(stringLit->literalLength);
+                for (const auto& segment : stringLit->segments) {
+                    formatted += segment.text;
+                    if (segment.variable) {
+                        appendFormatValue(formatted, segment.variable);
+                    }
                 }
-                
-                // Find closing brace
-                size_t endPos = formatted.find('}', pos + 1);
-                if (endPos == std::string::npos) {
-                    // No closing brace, just continue
-                    pos += 1;
-                    continue;
+                return formatted;
+            } else {
+                // Normal or raw string, long ones are shared instead of copied
+                if (stringLit->value.size() <= Value::maxShortString) {
+                    return Value(std::string_view(stringLit->value));
                 }
-                
-                // Extract variable name
-                std::string varName = formatted.substr(pos + 1, endPos - pos - 1);
-                
-                // Get variable value
-                std::string varValue;
-                if (variables.find(varName) != variables.end()) {
-                    Value val = variables[varName];
-                    if (std::holds_alternative<std::string>(val)) {
-                        varValue = std::get<std::string>(val);
-                    } else if (std::holds_alternative<int>(val)) {
-                        varValue = std::to_string(std::get<int>(val));
-                    } else if (std::holds_alternative<float>(val)) {
-                        varValue = std::to_string(std::get<float>(val));
-                    } else if (std::holds_alternative<double>(val)) {
-                        varValue = std::to_string(std::get<double>(val));
-                    } else if (std::holds_alternative<bool>(val)) {
-                        varValue = std::get<bool>(val) ? "true" : "false";
-                    } else {
-                        varValue = "undefined";
-                    }
-                } else {
-                    varValue = "undefined";
+                if (!stringLit->shared) {
+                    stringLit->shared = new StringObject(stringLit->value);
                 }
-                
-                // Replace {var} with its value
-                formatted.replace(pos, endPos - pos + 1, varValue);
-                
-                // Move past the replaced text
-                pos += varValue.length();
+                return Value(stringLit->shared);
             }
-            return formatted;
-        } else {
-            // Normal or raw string
-            return stringLit->value;
-        }
-    } else if (auto boolLit = dynamic_cast<BooleanLiteral*>(expr)) {
-        // Boolean literal
-        return boolLit->value;
-    } else if (auto errorObj = dynamic_cast<ErrorObject*>(expr)) {
-        // Error object - return itself as a value
-        return errorObj;
-    } else if (auto listLit = dynamic_cast<ListLiteral*>(expr)) {
-        // List literal - create a List object and populate it with elements
-        List* list = new List();
-        for (auto elemExpr : listLit->elements) {
-            Value elemValue = executeExpression(elemExpr);
-            list->add(elemValue);
-        }
-        return list;
-    } else if (auto hashMapLit = dynamic_cast<HashMapLiteral*>(expr)) {
-        // HashMap literal - create a HashMap object and populate it with entries
-        HashMap* map = new HashMap();
-        for (auto entry : hashMapLit->entries) {
-            Value keyValue = executeExpression(entry->key);
-            Value valueValue = executeExpression(entry->value);
-            
-            // Convert key to string
-            std::string key;
-            if (std::holds_alternative<std::string>(keyValue)) {
-                key = std::get<std::string>(keyValue);
-            } else {
-                // Convert other types to string
-                auto toString = [](Value val) -> std::string {
-                    if (std::holds_alternative<int>(val)) {
-                        return std::to_string(std::get<int>(val));
-                    } else if (std::holds_alternative<float>(val)) {
-                        return std::to_string(std::get<float>(val));
-                    } else if (std::holds_alternative<double>(val)) {
-                        return std::to_string(std::get<double>(val));
-                    } else if (std::holds_alternative<bool>(val)) {
-                        return std::get<bool>(val) ? "true" : "false";
-                    } else if (std::holds_alternative<char>(val)) {
-                        return std::string(1, std::get<char>(val));
-                    } else {
-                        return "";
-                    }
-                };
-                key = toString(keyValue);
+            break;
+        }
+        case NodeKind::BooleanLiteral: {
+            auto boolLit = static_cast<BooleanLiteral*>(expr);
+            // Boolean literal
+            return boolLit->value;
+        }
+        case NodeKind::ErrorObject: {
+            auto errorObj = static_cast<ErrorObject*>(expr);
+            // Error object - return itself as a value
+            return errorObj;
+        }
+        case NodeKind::ListLiteral: {
+            auto listLit = static_cast<ListLiteral*>(expr);
+            // List literal - create a List object and populate it with elements
+            List* list = heap.newList();
+            for (auto elemExpr : listLit->elements) {
+                Value elemValue = executeExpression(elemExpr);
+                list->add(elemValue);
             }
-            
-            map->set(key, valueValue);
+            return list;
         }
-        return map;
-    } else if (auto lambdaExpr = dynamic_cast<LambdaExpression*>(expr)) {
-        // Create a copy of the current variable environment for closure
-        // Store it as a pair of maps: (variables, variableTypes)
-        auto closureEnv = new std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>();
-        
-        // Deep copy the current environment, including any variables from outer scopes
-        // This ensures each lambda has its own independent environment copy
-        // Important for closures that capture changing variables
-        closureEnv->first = variables;  // std::map的赋值运算符已经是深拷贝
-        closureEnv->second = variableTypes;
-        
-        // Set the closure environment for the lambda
-        lambdaExpr->closureEnv = closureEnv;
-        
-        // Return the lambda expression directly as a value
-        return lambdaExpr;
+        case NodeKind::HashMapLiteral: {
+            auto hashMapLit = static_cast<HashMapLiteral*>(expr);
+            // HashMap literal - create a HashMap object and populate it with entries
+            HashMap* map = heap.newHashMap();
+            for (auto entry : hashMapLit->entries) {
+                Value keyValue = executeExpression(entry->key);
+                Value valueValue = executeExpression(entry->value);
+                
+                // Keys are hashed natively (strings, numbers, chars and bools)
+                map->set(keyValue, valueValue);
+            }
+            return map;
+        }
+        case NodeKind::LambdaExpression: {
+            auto lambdaExpr = static_cast<LambdaExpression*>(expr);
+            // Create a closure over the variables the lambda uses
+            return makeClosure(nullptr, lambdaExpr, lambdaExpr->layout);
+        }
+        default:
+            break;
     }
     
     // Default return value
     return std::monostate{};
 }
 
+// Raise an error of a builtin call: as its error result when the call is marked, by throwing otherwise
+Value raiseError(FunctionCall* call, ErrorType type, std::string_view message) {
+    if (call == errorResult.call && currentFrame == errorResult.frame) {
+        errorResult.raised = true;
+        errorResult.type = type;
+        errorResult.message.assign(message);
+        return std::monostate{};
+    }
+    throw vanction_error::VanctionError(type, std::string(message));
+}
+
+// Parse a number the way std::stoi, std::stof and std::stod do, without throwing when the
+// text is not a number or out of range
+bool parseInt(std::string_view text, int& result) {
+    std::string digits(text);
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(digits.c_str(), &end, 10);
+    if (end == digits.c_str() || errno == ERANGE || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+    result = static_cast<int>(value);
+    return true;
+}
+
+bool parseFloat(std::string_view text, float& result) {
+    std::string digits(text);
+    char* end = nullptr;
+    errno = 0;
+    result = std::strtof(digits.c_str(), &end);
+    return end != digits.c_str() && errno != ERANGE;
+}
+
+bool parseDouble(std::string_view text, double& result) {
+    std::string digits(text);
+    char* end = nullptr;
+    errno = 0;
+    result = std::strtod(digits.c_str(), &end);
+    return end != digits.c_str() && errno != ERANGE;
+}
+
 // Execute function call
 Value executeFunctionCall(FunctionCall* call) {
     if (debugMode) {
@@ -2058,309 +2717,133 @@ Value executeFunctionCall(FunctionCall* call) {
         std::cout << call->methodName << "(" << call->arguments.size() << " arguments)" << std::endl;
     }
     
+    if (call->linkStamp != linkStamp()) {
+        linkCall(call);
+    }
+    
     // Check if this is a lambda function call (variable name followed by parentheses)
     if (call->objectName.empty()) {
-        // Check if the method name corresponds to a variable that's a lambda function
-        // First check constants map
-        if (constants.find(call->methodName) != constants.end()) {
-            Value funcVal = constants[call->methodName];
-            if (std::holds_alternative<LambdaExpression*>(funcVal)) {
-                LambdaExpression* lambdaExpr = std::get<LambdaExpression*>(funcVal);
-                // Execute lambda function with arguments
-                std::vector<Value> args;
-                for (auto argExpr : call->arguments) {
-                    args.push_back(executeExpression(argExpr));
-                }
-                
-                // Save current variable environment
-                auto savedVariables = variables;
-                auto savedVariableTypes = variableTypes;
-                
-                // Create a new variable environment for the lambda execution
-                std::map<std::string, Value> lambdaVariables = variables;
-                std::map<std::string, std::string> lambdaVariableTypes = variableTypes;
-                
-                // If lambda has a closure environment, use it as the base environment
-                // This ensures nested lambdas can access variables from outer scopes
-                if (lambdaExpr->closureEnv) {
-                    auto closureEnv = static_cast<std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>*>(lambdaExpr->closureEnv);
-                    // Use closure environment as base
-                    lambdaVariables = closureEnv->first;
-                    lambdaVariableTypes = closureEnv->second;
-                }
-                
-                // Assign arguments to parameters in the lambda's environment
-                for (size_t i = 0; i < lambdaExpr->parameters.size() && i < args.size(); i++) {
-                    const std::string& paramName = lambdaExpr->parameters[i].name;
-                    lambdaVariables[paramName] = args[i];
-                    lambdaVariableTypes[paramName] = "auto";
-                }
-                
-                // Switch to lambda-specific environment
-                variables = lambdaVariables;
-                variableTypes = lambdaVariableTypes;
-                
-                // Execute the lambda body
-                Value result = executeExpression(lambdaExpr->body);
-                
-                // Restore original variables
-                variables = savedVariables;
-                variableTypes = savedVariableTypes;
-                
-                return result;
-            } else if (std::holds_alternative<FunctionDeclaration*>(funcVal)) {
-                // Execute FunctionDeclaration* as closure
-                FunctionDeclaration* funcDecl = std::get<FunctionDeclaration*>(funcVal);
-                
-                // Execute function with arguments
-                std::vector<Value> args;
-                for (auto argExpr : call->arguments) {
-                    args.push_back(executeExpression(argExpr));
-                }
-                
-                // Save current variable environment
-                auto savedVariables = variables;
-                auto savedVariableTypes = variableTypes;
-                
-                // Create a new variable environment for the function execution
-                std::map<std::string, Value> funcVariables = variables;
-                std::map<std::string, std::string> funcVariableTypes = variableTypes;
-                
-                // If function has a closure environment, use it as the base environment
-                // This ensures nested functions can access variables from outer scopes
-                if (funcDecl->closureEnv) {
-                    auto closureEnv = static_cast<std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>*>(funcDecl->closureEnv);
-                    // Use closure environment as base
-                    funcVariables = closureEnv->first;
-                    funcVariableTypes = closureEnv->second;
-                }
-                
-                // Assign arguments to parameters in the function's environment
-                for (size_t i = 0; i < funcDecl->parameters.size() && i < args.size(); i++) {
-                    const std::string& paramName = funcDecl->parameters[i].name;
-                    funcVariables[paramName] = args[i];
-                    funcVariableTypes[paramName] = "auto";
-                }
-                
-                // Switch to function-specific environment
-                variables = funcVariables;
-                variableTypes = funcVariableTypes;
-                
-                // Execute function body
-                Value returnValue = std::monostate{};
-                bool shouldReturn = false;
-                for (auto stmt : funcDecl->body) {
-                    returnValue = executeStatement(stmt, &shouldReturn);
-                    if (shouldReturn) {
-                        break;
-                    }
-                }
-                
-                // Update the original closure environment with the modified variables
-                // This ensures that the closure state is preserved between calls
-                if (funcDecl->closureEnv) {
-                    auto closureEnv = static_cast<std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>*>(funcDecl->closureEnv);
-                    // Update the closure environment with the modified variables
-                    closureEnv->first = variables;
-                    closureEnv->second = variableTypes;
-                }
-                
-                // Restore original variables
-                variables = savedVariables;
-                variableTypes = savedVariableTypes;
-                
-                return returnValue;
+        // Check if the method name corresponds to a variable that holds a lambda or function
+        // First check the resolved local slot, then the constants and variables maps
+        Value funcVal = std::monostate{};
+        if (call->slot >= 0 && currentFrame) {
+            funcVal = currentFrame->slots[call->slot];
+        } else if (call->upvalue >= 0) {
+            if (Upvalue* upvalue = upvalueAt(call->upvalue)) {
+                funcVal = *upvalue->location;
             }
         }
-        // Then check variables map
-        if (variables.find(call->methodName) != variables.end()) {
-            Value funcVal = variables[call->methodName];
-            if (std::holds_alternative<LambdaExpression*>(funcVal)) {
-                LambdaExpression* lambdaExpr = std::get<LambdaExpression*>(funcVal);
-                // Execute lambda function with arguments
-                std::vector<Value> args;
-                for (auto argExpr : call->arguments) {
-                    args.push_back(executeExpression(argExpr));
-                }
-                
-                // Save current variable environment
-                auto savedVariables = variables;
-                auto savedVariableTypes = variableTypes;
-                
-                // Create a new variable environment for the lambda execution
-                std::map<std::string, Value> lambdaVariables = variables;
-                std::map<std::string, std::string> lambdaVariableTypes = variableTypes;
-                
-                // If lambda has a closure environment, use it as the base environment
-                // This ensures nested lambdas can access variables from outer scopes
-                if (lambdaExpr->closureEnv) {
-                    auto closureEnv = static_cast<std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>*>(lambdaExpr->closureEnv);
-                    // Use closure environment as base
-                    lambdaVariables = closureEnv->first;
-                    lambdaVariableTypes = closureEnv->second;
-                }
-                
-                // Assign arguments to parameters in the lambda's environment
-                for (size_t i = 0; i < lambdaExpr->parameters.size() && i < args.size(); i++) {
-                    const std::string& paramName = lambdaExpr->parameters[i].name;
-                    lambdaVariables[paramName] = args[i];
-                    lambdaVariableTypes[paramName] = "auto";
-                }
-                
-                // Switch to lambda-specific environment
-                variables = lambdaVariables;
-                variableTypes = lambdaVariableTypes;
-                
-                // Execute the lambda body
-                Value result = executeExpression(lambdaExpr->body);
-                
-                // Restore original variables
-                variables = savedVariables;
-                variableTypes = savedVariableTypes;
-                
-                return result;
-            } else if (std::holds_alternative<FunctionDeclaration*>(funcVal)) {
-                // Execute FunctionDeclaration* as closure
-                FunctionDeclaration* funcDecl = std::get<FunctionDeclaration*>(funcVal);
-                
-                // Execute function with arguments
-                std::vector<Value> args;
-                for (auto argExpr : call->arguments) {
-                    args.push_back(executeExpression(argExpr));
-                }
-                
-                // Save current variable environment
-                auto savedVariables = variables;
-                auto savedVariableTypes = variableTypes;
-                
-                // Create a new variable environment for the function execution
-                std::map<std::string, Value> funcVariables = variables;
-                std::map<std::string, std::string> funcVariableTypes = variableTypes;
-                
-                // If function has a closure environment, use it as the base environment
-                // This ensures nested functions can access variables from outer scopes
-                if (funcDecl->closureEnv) {
-                    auto closureEnv = static_cast<std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>*>(funcDecl->closureEnv);
-                    // Use closure environment as base
-                    funcVariables = closureEnv->first;
-                    funcVariableTypes = closureEnv->second;
-                }
-                
-                // Assign arguments to parameters in the function's environment
-                for (size_t i = 0; i < funcDecl->parameters.size() && i < args.size(); i++) {
-                    const std::string& paramName = funcDecl->parameters[i].name;
-                    funcVariables[paramName] = args[i];
-                    funcVariableTypes[paramName] = "auto";
-                }
-                
-                // Switch to function-specific environment
-                variables = funcVariables;
-                variableTypes = funcVariableTypes;
-                
-                // Execute function body
-                Value returnValue = std::monostate{};
-                bool shouldReturn = false;
-                for (auto stmt : funcDecl->body) {
-                    returnValue = executeStatement(stmt, &shouldReturn);
-                    if (shouldReturn) {
-                        break;
-                    }
-                }
-                
-                // Update the original closure environment with the modified variables
-                // This ensures that the closure state is preserved between calls
-                if (funcDecl->closureEnv) {
-                    auto closureEnv = static_cast<std::pair<std::map<std::string, Value>, std::map<std::string, std::string>>*>(funcDecl->closureEnv);
-                    // Update the closure environment with the modified variables
-                    closureEnv->first = variables;
-                    closureEnv->second = variableTypes;
-                }
-                
-                // Restore original variables
-                variables = savedVariables;
-                variableTypes = savedVariableTypes;
-                
-                return returnValue;
+        if (!funcVal.isLambda() && !funcVal.isFunction()) {
+            if (Value* callee = globalCallee(call)) {
+                funcVal = *callee;
             }
         }
+        
+        if (funcVal.isLambda()) {
+            // Execute lambda function with arguments
+            std::vector<Value> args;
+            GcVectorRoot argRoot(args);
+            for (auto argExpr : call->arguments) {
+                args.push_back(executeExpression(argExpr));
+            }
+            
+            // Execute the lambda body in its own frame
+            return callLambda(funcVal.asClosure(), args.data(), args.size());
+        } else if (funcVal.isFunction()) {
+            // Execute function with arguments
+            std::vector<Value> args;
+            GcVectorRoot argRoot(args);
+            for (auto argExpr : call->arguments) {
+                args.push_back(executeExpression(argExpr));
+            }
+            
+            // Execute function body in its own frame
+            // Closure state lives in the captured upvalues, so it is preserved between calls
+            return callFunctionValue(funcVal.asClosure(), args.data(), args.size());
+        }
     }
     
     // Handle std:io namespace functions
-    if (call->objectName == "std:io" || call->objectName == "std.io") {
-        if (call->methodName == "print") {
+    if (call->target == CallTarget::IoPrint || call->target == CallTarget::IoInput || call->target == CallTarget::IoOther) {
+        if (call->target == CallTarget::IoPrint) {
             // Handle std:io.print and std.io.print
             for (size_t i = 0; i < call->arguments.size(); ++i) {
                 Value value = executeExpression(call->arguments[i]);
                 
                 // Print based on value type
-                if (std::holds_alternative<int>(value)) {
-                    std::cout << std::get<int>(value);
-                } else if (std::holds_alternative<char>(value)) {
-                    std::cout << std::get<char>(value);
-                } else if (std::holds_alternative<std::string>(value)) {
-                    std::cout << std::get<std::string>(value);
-                } else if (std::holds_alternative<bool>(value)) {
-                    std::cout << (std::get<bool>(value) ? "true" : "false");
-                } else if (std::holds_alternative<float>(value)) {
-                    std::cout << std::get<float>(value);
-                } else if (std::holds_alternative<double>(value)) {
-                    std::cout << std::get<double>(value);
-                } else if (std::holds_alternative<List*>(value)) {
-                    List* list = std::get<List*>(value);
+                if (value.isInt()) {
+                    std::cout << value.asInt();
+                } else if (value.isChar()) {
+                    std::cout << value.asChar();
+                } else if (value.isString()) {
+                    std::cout << value.asString();
+                } else if (value.isStringBuilder()) {
+                    std::cout << value.asStringBuilder()->buffer;
+                } else if (value.isBool()) {
+                    std::cout << (value.asBool() ? "true" : "false");
+                } else if (value.isFloat()) {
+                    std::cout << value.asFloat();
+                } else if (value.isDouble()) {
+                    std::cout << value.asDouble();
+                } else if (value.isList()) {
+                    List* list = value.asList();
                     std::cout << "[";
-                    for (size_t i = 0; i < list->elements.size(); ++i) {
-                        Value elem = list->elements[i];
-                        if (std::holds_alternative<int>(elem)) {
-                            std::cout << std::get<int>(elem);
-                        } else if (std::holds_alternative<char>(elem)) {
-                            std::cout << "'" << std::get<char>(elem) << "'";
-                        } else if (std::holds_alternative<std::string>(elem)) {
-                            std::cout << '"' << std::get<std::string>(elem) << '"';
-                        } else if (std::holds_alternative<bool>(elem)) {
-                            std::cout << (std::get<bool>(elem) ? "true" : "false");
-                        } else if (std::holds_alternative<float>(elem)) {
-                            std::cout << std::get<float>(elem);
-                        } else if (std::holds_alternative<double>(elem)) {
-                            std::cout << std::get<double>(elem);
-                        } else if (std::holds_alternative<List*>(elem)) {
+                    for (int i = 0; i < list->size(); ++i) {
+                        Value elem = list->at(i);
+                        if (elem.isInt()) {
+                            std::cout << elem.asInt();
+                        } else if (elem.isChar()) {
+                            std::cout << "'" << elem.asChar() << "'";
+                        } else if (elem.isString()) {
+                            std::cout << '"' << elem.asString() << '"';
+                        } else if (elem.isBool()) {
+                            std::cout << (elem.asBool() ? "true" : "false");
+                        } else if (elem.isFloat()) {
+                            std::cout << elem.asFloat();
+                        } else if (elem.isDouble()) {
+                            std::cout << elem.asDouble();
+                        } else if (elem.isList()) {
                             std::cout << "<list>";
-                        } else if (std::holds_alternative<HashMap*>(elem)) {
+                        } else if (elem.isHashMap()) {
                             std::cout << "<hashmap>";
                         } else {
                             std::cout << "undefined";
                         }
-                        if (i < list->elements.size() - 1) {
+                        if (i < list->size() - 1) {
                             std::cout << ", ";
                         }
                     }
                     std::cout << "]";
-                } else if (std::holds_alternative<HashMap*>(value)) {
+                } else if (value.isHashMap()) {
                     std::cout << "{";
-                    HashMap* map = std::get<HashMap*>(value);
-                    size_t count = 0;
+                    HashMap* map = value.asHashMap();
+                    int count = 0;
                     for (auto& entry : map->entries) {
-                        std::cout << entry.first << ": ";
-                        Value val = entry.second;
-                        if (std::holds_alternative<int>(val)) {
-                            std::cout << std::get<int>(val);
-                        } else if (std::holds_alternative<char>(val)) {
-                            std::cout << "'" << std::get<char>(val) << "'";
-                        } else if (std::holds_alternative<std::string>(val)) {
-                            std::cout << '"' << std::get<std::string>(val) << '"';
-                        } else if (std::holds_alternative<bool>(val)) {
-                            std::cout << (std::get<bool>(val) ? "true" : "false");
-                        } else if (std::holds_alternative<float>(val)) {
-                            std::cout << std::get<float>(val);
-                        } else if (std::holds_alternative<double>(val)) {
-                            std::cout << std::get<double>(val);
-                        } else if (std::holds_alternative<List*>(val)) {
+                        if (entry.key.isNil()) {
+                            continue;
+                        }
+                        std::cout << hashMapKeyText(entry.key) << ": ";
+                        Value val = entry.value;
+                        if (val.isInt()) {
+                            std::cout << val.asInt();
+                        } else if (val.isChar()) {
+                            std::cout << "'" << val.asChar() << "'";
+                        } else if (val.isString()) {
+                            std::cout << '"' << val.asString() << '"';
+                        } else if (val.isBool()) {
+                            std::cout << (val.asBool() ? "true" : "false");
+                        } else if (val.isFloat()) {
+                            std::cout << val.asFloat();
+                        } else if (val.isDouble()) {
+                            std::cout << val.asDouble();
+                        } else if (val.isList()) {
                             std::cout << "<list>";
-                        } else if (std::holds_alternative<HashMap*>(val)) {
+                        } else if (val.isHashMap()) {
                             std::cout << "<hashmap>";
                         } else {
                             std::cout << "undefined";
                         }
-                        if (++count < map->entries.size()) {
+                        if (++count < map->size()) {
                             std::cout << ", ";
                         }
                     }
@@ -2369,13 +2852,13 @@ Value executeFunctionCall(FunctionCall* call) {
                     std::cout << "undefined";
                 }
             }
-        } else if (call->methodName == "input") {
+        } else if (call->target == CallTarget::IoInput) {
             // Handle std:io.input and std.io.input
             if (!call->arguments.empty()) {
                 // Print prompt
                 Value promptValue = executeExpression(call->arguments[0]);
-                if (std::holds_alternative<std::string>(promptValue)) {
-                    std::cout << std::get<std::string>(promptValue);
+                if (promptValue.isString()) {
+                    std::cout << promptValue.asString();
                 }
             }
             
@@ -2395,7 +2878,7 @@ Value executeFunctionCall(FunctionCall* call) {
             // Return input as string
             return input;
         }
-    } else if (call->objectName == "std:type" || call->objectName == "std.type" || call->objectName == "type") {
+    } else if (call->target >= CallTarget::TypeInt && call->target <= CallTarget::TypeOther) {
         // Handle type conversion functions
         if (call->arguments.empty()) {
             return std::monostate{};
@@ -2403,76 +2886,76 @@ Value executeFunctionCall(FunctionCall* call) {
         
         Value arg = executeExpression(call->arguments[0]);
         
-        if (call->methodName == "int") {
+        if (call->target == CallTarget::TypeInt) {
             // Convert to int
-            if (std::holds_alternative<int>(arg)) {
+            if (arg.isInt()) {
                 return arg;
-            } else if (std::holds_alternative<float>(arg)) {
-                return static_cast<int>(std::get<float>(arg));
-            } else if (std::holds_alternative<double>(arg)) {
-                return static_cast<int>(std::get<double>(arg));
-            } else if (std::holds_alternative<bool>(arg)) {
-                return static_cast<int>(std::get<bool>(arg));
-            } else if (std::holds_alternative<std::string>(arg)) {
+            } else if (arg.isFloat()) {
+                return static_cast<int>(arg.asFloat());
+            } else if (arg.isDouble()) {
+                return static_cast<int>(arg.asDouble());
+            } else if (arg.isBool()) {
+                return static_cast<int>(arg.asBool());
+            } else if (arg.isString()) {
                 // Try to parse string as int
-                try {
-                    return std::stoi(std::get<std::string>(arg));
-                } catch (...) {
-                    throw vanction_error::ValueError("Cannot convert string to int");
+                int parsed;
+                if (parseInt(arg.asString(), parsed)) {
+                    return parsed;
                 }
+                return raiseError(call, ErrorType::ValueError, "Cannot convert string to int");
             }
             return std::monostate{};
-        } else if (call->methodName == "float") {
+        } else if (call->target == CallTarget::TypeFloat) {
             // Convert to float
-            if (std::holds_alternative<int>(arg)) {
-                return static_cast<float>(std::get<int>(arg));
-            } else if (std::holds_alternative<float>(arg)) {
+            if (arg.isInt()) {
+                return static_cast<float>(arg.asInt());
+            } else if (arg.isFloat()) {
                 return arg;
-            } else if (std::holds_alternative<double>(arg)) {
-                return static_cast<float>(std::get<double>(arg));
-            } else if (std::holds_alternative<bool>(arg)) {
-                return static_cast<float>(std::get<bool>(arg));
-            } else if (std::holds_alternative<std::string>(arg)) {
+            } else if (arg.isDouble()) {
+                return static_cast<float>(arg.asDouble());
+            } else if (arg.isBool()) {
+                return static_cast<float>(arg.asBool());
+            } else if (arg.isString()) {
                 // Try to parse string as float
-                try {
-                    return std::stof(std::get<std::string>(arg));
-                } catch (...) {
-                    throw vanction_error::ValueError("Cannot convert string to float");
+                float parsed;
+                if (parseFloat(arg.asString(), parsed)) {
+                    return parsed;
                 }
+                return raiseError(call, ErrorType::ValueError, "Cannot convert string to float");
             }
             return std::monostate{};
-        } else if (call->methodName == "double") {
+        } else if (call->target == CallTarget::TypeDouble) {
             // Convert to double
-            if (std::holds_alternative<int>(arg)) {
-                return static_cast<double>(std::get<int>(arg));
-            } else if (std::holds_alternative<float>(arg)) {
-                return static_cast<double>(std::get<float>(arg));
-            } else if (std::holds_alternative<double>(arg)) {
+            if (arg.isInt()) {
+                return static_cast<double>(arg.asInt());
+            } else if (arg.isFloat()) {
+                return static_cast<double>(arg.asFloat());
+            } else if (arg.isDouble()) {
                 return arg;
-            } else if (std::holds_alternative<bool>(arg)) {
-                return static_cast<double>(std::get<bool>(arg));
-            } else if (std::holds_alternative<std::string>(arg)) {
+            } else if (arg.isBool()) {
+                return static_cast<double>(arg.asBool());
+            } else if (arg.isString()) {
                 // Try to parse string as double
-                try {
-                    return std::stod(std::get<std::string>(arg));
-                } catch (...) {
-                    throw vanction_error::ValueError("Cannot convert string to double");
+                double parsed;
+                if (parseDouble(arg.asString(), parsed)) {
+                    return parsed;
                 }
+                return raiseError(call, ErrorType::ValueError, "Cannot convert string to double");
             }
             return std::monostate{};
-        } else if (call->methodName == "char") {
+        } else if (call->target == CallTarget::TypeChar) {
             // Convert to char
-            if (std::holds_alternative<char>(arg)) {
+            if (arg.isChar()) {
                 return arg;
-            } else if (std::holds_alternative<int>(arg)) {
-                return static_cast<char>(std::get<int>(arg));
-            } else if (std::holds_alternative<float>(arg)) {
-                return static_cast<char>(std::get<float>(arg));
-            } else if (std::holds_alternative<double>(arg)) {
-                return static_cast<char>(std::get<double>(arg));
-            } else if (std::holds_alternative<std::string>(arg)) {
+            } else if (arg.isInt()) {
+                return static_cast<char>(arg.asInt());
+            } else if (arg.isFloat()) {
+                return static_cast<char>(arg.asFloat());
+            } else if (arg.isDouble()) {
+                return static_cast<char>(arg.asDouble());
+            } else if (arg.isString()) {
                 // Get first character of string
-                const std::string& str = std::get<std::string>(arg);
+                std::string_view str = arg.asString();
                 if (!str.empty()) {
                     return str[0];
                 } else {
@@ -2480,19 +2963,19 @@ Value executeFunctionCall(FunctionCall* call) {
                 }
             }
             return std::monostate{};
-        } else if (call->methodName == "string") {
+        } else if (call->target == CallTarget::TypeString) {
             // Convert to string
-            if (std::holds_alternative<int>(arg)) {
-                return std::to_string(std::get<int>(arg));
-            } else if (std::holds_alternative<float>(arg)) {
-                return std::to_string(std::get<float>(arg));
-            } else if (std::holds_alternative<double>(arg)) {
-                return std::to_string(std::get<double>(arg));
-            } else if (std::holds_alternative<bool>(arg)) {
-                return std::get<bool>(arg) ? "true" : "false";
-            } else if (std::holds_alternative<char>(arg)) {
-                return std::string(1, std::get<char>(arg));
-            } else if (std::holds_alternative<std::string>(arg)) {
+            if (arg.isInt()) {
+                return std::to_string(arg.asInt());
+            } else if (arg.isFloat()) {
+                return std::to_string(arg.asFloat());
+            } else if (arg.isDouble()) {
+                return std::to_string(arg.asDouble());
+            } else if (arg.isBool()) {
+                return arg.asBool() ? "true" : "false";
+            } else if (arg.isChar()) {
+                return std::string(1, arg.asChar());
+            } else if (arg.isString()) {
                 return arg;
             }
             return std::monostate{};
@@ -2502,26 +2985,40 @@ Value executeFunctionCall(FunctionCall* call) {
         // Regular function call
         std::string funcName = call->methodName;
         
+        // Built-in StringBuilder(), optionally seeded with initial text
+        // A user function of the same name takes precedence
+        if (call->target == CallTarget::StringBuilder) {
+            if (call->arguments.size() > 1) {
+                throw vanction_error::MethodError("StringBuilder() expects at most 1 argument");
+            }
+            StringBuilder* builder = heap.newStringBuilder();
+            Value result = builder;
+            if (!call->arguments.empty()) {
+                appendValueText(builder->buffer, executeExpression(call->arguments[0]));
+            }
+            return result;
+        }
+        
         // Check if function exists
-        if (functions.find(funcName) == functions.end()) {
+        FunctionDeclaration* func = call->targetFunction;
+        if (!func) {
             throw vanction_error::MethodError("Undefined function: " + funcName);
         }
         
-        FunctionDeclaration* func = functions[funcName];
-        
-        // Save current variable environment
-        auto savedVariables = variables;
-        
         // Handle function arguments
         if (call->arguments.size() != func->parameters.size()) {
             throw vanction_error::MethodError("Function " + funcName + " expects " + std::to_string(func->parameters.size()) + " arguments, but got " + std::to_string(call->arguments.size()));
         }
         
+        // Create a new frame for the function execution
+        std::optional<Frame> storage;
+        Frame* frame = enterFrame(storage, func->layout, func->closure, func->parameters.size());
+        
         // Assign argument values to parameters
         std::vector<Value> argValues;
         for (size_t i = 0; i < call->arguments.size(); ++i) {
             Value argValue = executeExpression(call->arguments[i]);
-            variables[func->parameters[i].name] = argValue;
+            frame->slots[i] = argValue;
             argValues.push_back(argValue);
         }
         
@@ -2537,31 +3034,22 @@ Value executeFunctionCall(FunctionCall* call) {
         } else if (funcName == "add") {
             // Mock add() function - return sum of arguments
             if (argValues.size() == 2) {
-                int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                 returnValue = a + b;
             } else {
                 returnValue = std::monostate{};
             }
         } else {
             // Regular function - execute its body
-            for (auto stmt : func->body) {
-                bool shouldReturn = false;
-                Value stmtResult = executeStatement(stmt, &shouldReturn);
-                if (shouldReturn) {
-                    returnValue = stmtResult;
-                    break;
-                }
-            }
+            FrameGuard guard(frame);
+            returnValue = executeFunctionBody(func);
         }
         
-        // Restore saved variable environment
-        variables = savedVariables;
-        
         return returnValue;
     } else {
         // Check if it's a class method call (e.g., Person.init() or class.method())
-        if (call->objectName == "class" || classes.find(call->objectName) != classes.end()) {
+        if (call->target == CallTarget::ClassMethod) {
             // Handle both class.method() and Person.method() syntax
             std::string className;
             if (call->objectName == "class") {
@@ -2575,12 +3063,11 @@ Value executeFunctionCall(FunctionCall* call) {
             
             std::string methodName = call->methodName;
             
-            if (classes.find(className) == classes.end()) {
+            ClassDefinition* classDef = call->targetClass;
+            if (!classDef) {
                 throw vanction_error::MethodError("Undefined class: " + className);
             }
             
-            ClassDefinition* classDef = classes[className];
-            
             // Special handling for init method
             if (methodName == "init") {
                 // This is an init method call like Person.init(instance, name, age)
@@ -2591,92 +3078,65 @@ Value executeFunctionCall(FunctionCall* call) {
                 
                 // Get the instance argument
                 Value instanceArg = executeExpression(call->arguments[0]);
-                if (!std::holds_alternative<Instance*>(instanceArg)) {
+                if (!instanceArg.isInstance()) {
                     throw vanction_error::MethodError("First argument to init must be an instance");
                 }
                 
-                Instance* instance = std::get<Instance*>(instanceArg);
+                Instance* instance = instanceArg.asInstance();
                 
-                // Save current variable environment
-                auto savedVariables = variables;
+                InstanceMethodDeclaration* initMethod = classDef->initMethod;
                 
-                // Create a new variable environment for the init method execution
-                std::map<std::string, Value> initVariables = variables;
+                // Create a new frame for the init method execution
+                std::optional<Frame> storage;
+                Frame* initFrame = enterFrame(storage, initMethod->layout, nullptr, initMethod->parameters.size());
                 
                 // Set the instance parameter to the current instance
-                if (classDef->initMethod->parameters.size() > 0) {
-                    initVariables[classDef->initMethod->parameters[0].name] = instance;
-                }
                 // Also explicitly add 'instance' variable for backward compatibility
-                initVariables["instance"] = instance;
+                bindInstance(initFrame, initMethod, instance, true);
                 
                 // Assign init method arguments to parameters, starting from index 1
                 for (size_t i = 1; i < call->arguments.size(); ++i) {
                     size_t paramIndex = i;
-                    if (paramIndex < classDef->initMethod->parameters.size()) {
+                    if (paramIndex < initMethod->parameters.size()) {
                         Value argValue = executeExpression(call->arguments[i]);
-                        initVariables[classDef->initMethod->parameters[paramIndex].name] = argValue;
-                    }
-                }
-                
-                // Switch to init method-specific environment
-                variables = initVariables;
-                
-                // Execute init method body
-                for (auto stmt : classDef->initMethod->body) {
-                    bool shouldReturn = false;
-                    executeStatement(stmt, &shouldReturn);
-                    if (shouldReturn) {
-                        break;
+                        initFrame->slots[paramIndex] = argValue;
                     }
                 }
                 
-                // Restore saved variable environment
-                variables = savedVariables;
+                // Execute init method body in its frame
+                FrameGuard guard(initFrame);
+                executeFunctionBody(initMethod);
                 
                 return std::monostate{};
             }
             
             // Find the class method
-            ClassMethodDeclaration* method = nullptr;
-            for (auto m : classDef->classMethods) {
-                if (m->name == methodName) {
-                    method = m;
-                    break;
-                }
-            }
+            auto methodIt = classDef->classMethodTable.find(methodName);
+            ClassMethodDeclaration* method = methodIt != classDef->classMethodTable.end() ? methodIt->second : nullptr;
             
             if (!method) {
                 throw vanction_error::MethodError("Undefined class method: " + methodName + " on class " + className);
             }
             
-            // Save current variable environment
-            auto savedVariables = variables;
+            // Create a new frame for the method execution
+            std::optional<Frame> storage;
+            Frame* frame = enterFrame(storage, method->layout, nullptr, method->parameters.size());
             
-            // Execute method body
-            Value returnValue = std::monostate{};
-            for (auto stmt : method->body) {
-                bool shouldReturn = false;
-                Value stmtResult = executeStatement(stmt, &shouldReturn);
-                if (shouldReturn) {
-                    returnValue = stmtResult;
-                    break;
-                }
+            // Assign argument values to parameters
+            for (size_t i = 0; i < call->arguments.size() && i < method->parameters.size(); ++i) {
+                frame->slots[i] = executeExpression(call->arguments[i]);
             }
             
-            // Restore saved variable environment
-            variables = savedVariables;
-            
-            return returnValue;
+            // Execute method body
+            FrameGuard guard(frame);
+            return executeFunctionBody(method);
         } 
         // Check if it's an instance method call (e.g., person1.getName())
-        else if (variables.find(call->objectName) != variables.end()) {
-            // Get the value
-            Value value = variables[call->objectName];
+        else if (Value value; call->target == CallTarget::Dynamic && lookupCallObject(call, value)) {
             
             // Check if it's a List*
-            if (std::holds_alternative<List*>(value)) {
-                List* list = std::get<List*>(value);
+            if (value.isList()) {
+                List* list = value.asList();
                 std::string methodName = call->methodName;
                 
                 // Handle List methods
@@ -2693,8 +3153,8 @@ Value executeFunctionCall(FunctionCall* call) {
                     // Get element from list
                     if (call->arguments.size() == 1) {
                         Value indexArg = executeExpression(call->arguments[0]);
-                        if (std::holds_alternative<int>(indexArg)) {
-                            int index = std::get<int>(indexArg);
+                        if (indexArg.isInt()) {
+                            int index = indexArg.asInt();
                             return list->get(index);
                         } else {
                             throw vanction_error::TypeError("List.get() expects integer index");
@@ -2702,13 +3162,21 @@ Value executeFunctionCall(FunctionCall* call) {
                     } else {
                         throw vanction_error::MethodError("List.get() expects exactly 1 argument");
                     }
+                } else if (isListAggregate(methodName)) {
+                    // Numeric operations (sum, min, max, mean, dot, scale, plus, clamp, count)
+                    std::vector<Value> args;
+                    GcVectorRoot argRoot(args);
+                    for (auto argExpr : call->arguments) {
+                        args.push_back(executeExpression(argExpr));
+                    }
+                    return callListAggregate(list, methodName, args);
                 } else {
                     throw vanction_error::MethodError("Undefined method: " + methodName + " on List");
                 }
             }
             // Check if it's a HashMap*
-            else if (std::holds_alternative<HashMap*>(value)) {
-                HashMap* map = std::get<HashMap*>(value);
+            else if (value.isHashMap()) {
+                HashMap* map = value.asHashMap();
                 std::string methodName = call->methodName;
                 
                 // Handle HashMap methods
@@ -2716,23 +3184,44 @@ Value executeFunctionCall(FunctionCall* call) {
                     // Get value from HashMap
                     if (call->arguments.size() == 1 || call->arguments.size() == 2) {
                         Value keyArg = executeExpression(call->arguments[0]);
-                        if (std::holds_alternative<std::string>(keyArg)) {
-                            std::string key = std::get<std::string>(keyArg);
-                            
+                        if (HashMap::isHashable(keyArg)) {
                             if (call->arguments.size() == 2) {
                                 // With default value
                                 Value defaultValue = executeExpression(call->arguments[1]);
-                                return map->get(key, defaultValue);
+                                return map->get(keyArg, defaultValue);
                             } else {
                                 // Without default value
-                                return map->get(key);
+                                return map->get(keyArg);
                             }
                         } else {
-                            throw vanction_error::TypeError("HashMap.get() expects string key");
+                            throw vanction_error::TypeError("HashMap.get() expects a string, number, char or bool key");
                         }
                     } else {
                         throw vanction_error::MethodError("HashMap.get() expects 1 or 2 arguments");
                     }
+                } else if (methodName == "remove") {
+                    // Remove a key, returns whether it was present
+                    if (call->arguments.size() == 1) {
+                        Value keyArg = executeExpression(call->arguments[0]);
+                        if (!HashMap::isHashable(keyArg)) {
+                            throw vanction_error::TypeError("HashMap.remove() expects a string, number, char or bool key");
+                        }
+                        return map->remove(keyArg);
+                    } else {
+                        throw vanction_error::MethodError("HashMap.remove() expects exactly 1 argument");
+                    }
+                } else if (methodName == "reserve") {
+                    // Preallocate room for a number of entries
+                    if (call->arguments.size() == 1) {
+                        Value countArg = executeExpression(call->arguments[0]);
+                        if (!countArg.isInt() || countArg.asInt() < 0) {
+                            throw vanction_error::TypeError("HashMap.reserve() expects a non-negative integer");
+                        }
+                        map->reserve(static_cast<size_t>(countArg.asInt()));
+                        return std::monostate{};
+                    } else {
+                        throw vanction_error::MethodError("HashMap.reserve() expects exactly 1 argument");
+                    }
                 } else if (methodName == "keys" || methodName == "key") {
                     // Get all keys as List* (support both singular and plural)
                     return map->keys();
@@ -2743,9 +3232,33 @@ Value executeFunctionCall(FunctionCall* call) {
                     throw vanction_error::MethodError("Undefined method: " + methodName + " on HashMap");
                 }
             }
+            // Check if it's a StringBuilder*
+            else if (value.isStringBuilder()) {
+                StringBuilder* builder = value.asStringBuilder();
+                std::string methodName = call->methodName;
+                
+                // Handle StringBuilder methods
+                if (methodName == "append") {
+                    // Append the text of each argument, returns the builder
+                    for (auto argExpr : call->arguments) {
+                        appendValueText(builder->buffer, executeExpression(argExpr));
+                    }
+                    return value;
+                } else if (methodName == "toString") {
+                    // Copy the text built so far into a string value
+                    return builder->buffer;
+                } else if (methodName == "length") {
+                    return static_cast<int>(builder->buffer.size());
+                } else if (methodName == "clear") {
+                    builder->buffer.clear();
+                    return std::monostate{};
+                } else {
+                    throw vanction_error::MethodError("Undefined method: " + methodName + " on StringBuilder");
+                }
+            }
             // Check if it's a string
-            else if (std::holds_alternative<std::string>(value)) {
-                std::string strVal = std::get<std::string>(value);
+            else if (value.isString()) {
+                std::string_view strVal = value.asString();
                 std::string methodName = call->methodName;
                 
                 // Handle string methods
@@ -2755,12 +3268,12 @@ Value executeFunctionCall(FunctionCall* call) {
                         Value oldArg = executeExpression(call->arguments[0]);
                         Value newArg = executeExpression(call->arguments[1]);
                         
-                        if (std::holds_alternative<std::string>(oldArg) && std::holds_alternative<std::string>(newArg)) {
-                            std::string oldStr = std::get<std::string>(oldArg);
-                            std::string newStr = std::get<std::string>(newArg);
+                        if (oldArg.isString() && newArg.isString()) {
+                            std::string_view oldStr = oldArg.asString();
+                            std::string_view newStr = newArg.asString();
                             
                             // Simple string replacement
-                            std::string result = strVal;
+                            std::string result(strVal);
                             size_t pos = 0;
                             while ((pos = result.find(oldStr, pos)) != std::string::npos) {
                                 result.replace(pos, oldStr.length(), newStr);
@@ -2778,10 +3291,10 @@ Value executeFunctionCall(FunctionCall* call) {
                     if (call->arguments.size() == 1) {
                         Value delimArg = executeExpression(call->arguments[0]);
                         
-                        if (std::holds_alternative<std::string>(delimArg)) {
-                            std::string delim = std::get<std::string>(delimArg);
+                        if (delimArg.isString()) {
+                            std::string_view delim = delimArg.asString();
                             
-                            List* result = new List();
+                            List* result = heap.newList();
                             size_t start = 0;
                             size_t end = strVal.find(delim);
                             
@@ -2806,13 +3319,13 @@ Value executeFunctionCall(FunctionCall* call) {
                 }
             }
             // Check if it's an Instance*
-            else if (!std::holds_alternative<Instance*>(value)) {
+            else if (!value.isInstance()) {
                 throw vanction_error::MethodError("Cannot call method on non-instance: " + call->objectName);
             }
             // Continue with instance method call handling
             Value instanceVal = value;
             
-            Instance* instance = std::get<Instance*>(instanceVal);
+            Instance* instance = instanceVal.asInstance();
             std::string methodName = call->methodName;
             
             if (debugMode) {
@@ -2820,61 +3333,15 @@ Value executeFunctionCall(FunctionCall* call) {
             }
             
             // Find the method in the class definition, including inherited methods
-            InstanceMethodDeclaration* method = nullptr;
-            
-            // Traverse the class hierarchy to find the method
-            ClassDefinition* currentClass = instance->cls;
-            while (currentClass && !method) {
-                // Look for the method in the current class
-                for (auto m : currentClass->instanceMethods) {
-                    if (m->name == methodName) {
-                        method = m;
-                        if (debugMode) {
-                            std::cout << "[DEBUG] Found method " << methodName << " in class " << currentClass->name << std::endl;
-                        }
-                        break;
-                    }
-                }
-                
-                // If not found, check if it's the init method
-                if (!method && methodName == "__init__") {
-                    method = currentClass->initMethod;
-                    if (debugMode && method) {
-                        std::cout << "[DEBUG] Found init method in class " << currentClass->name << std::endl;
-                    }
-                }
-                
-                // If not found, move to the parent class
-                if (!method && !currentClass->baseClassName.empty()) {
-                    if (debugMode) {
-                        std::cout << "[DEBUG] Method " << methodName << " not found in class " << currentClass->name << ", checking parent class " << currentClass->baseClassName << std::endl;
-                    }
-                    if (classes.find(currentClass->baseClassName) != classes.end()) {
-                        currentClass = classes[currentClass->baseClassName];
-                    } else {
-                        currentClass = nullptr;
-                    }
-                } else {
-                    currentClass = nullptr;
-                }
+            InstanceMethodDeclaration* method = findInstanceMethod(call, instance->cls);
+            if (debugMode && method) {
+                std::cout << "[DEBUG] Found method " << methodName << " for class " << instance->cls->name << std::endl;
             }
             
             if (!method) {
                 throw vanction_error::MethodError("Undefined method: " + methodName + " on instance of " + instance->cls->name);
             }
             
-            // Create a new variable environment for the method execution
-            std::map<std::string, Value> methodVariables = variables;
-            
-            // Set the instance parameter to the current instance
-            // This allows the method to access the instance via the first parameter
-            if (method->parameters.size() > 0) {
-                methodVariables[method->parameters[0].name] = instance;
-            }
-            // Also explicitly add 'instance' variable for backward compatibility
-            // This ensures that methods can access the instance via 'instance' variable
-            methodVariables["instance"] = instance;
-            
             // For instance methods (non-init), parameters list already excludes the implicit instance parameter
             // For init method, parameters list includes the instance parameter, so we need to adjust
             bool isInitMethod = (methodName == "init" || methodName == "__init__");
@@ -2883,36 +3350,26 @@ Value executeFunctionCall(FunctionCall* call) {
                 throw vanction_error::MethodError("Method " + methodName + " expects " + std::to_string(expectedArgs) + " arguments, but got " + std::to_string(call->arguments.size()));
             }
             
-            // Assign argument values to parameters, starting from index 1 if there are parameters
-            for (size_t i = 0; i < call->arguments.size(); ++i) {
-                if (i + 1 < method->parameters.size()) {
-                    Value argValue = executeExpression(call->arguments[i]);
-                    methodVariables[method->parameters[i + 1].name] = argValue;
-                } else if (i < method->parameters.size()) {
-                    // For methods with only one parameter (the instance parameter), we still need to assign arguments
-                    // if the method was defined without the instance parameter explicitly
-                    Value argValue = executeExpression(call->arguments[i]);
-                    methodVariables[method->parameters[i].name] = argValue;
-                }
-            }
+            // Create a new frame for the method execution
+            std::optional<Frame> storage;
+            Frame* frame = enterFrame(storage, method->layout, nullptr, method->parameters.size());
             
-            // Save current variable environment and switch to method-specific environment
-            auto savedVariables = variables;
-            variables = methodVariables;
+            // Set the instance parameter to the current instance
+            // This allows the method to access the instance via the 'instance' variable
+            // (and, for init methods, via the first parameter)
+            bindInstance(frame, method, instance, isInitMethod);
             
-            // Execute method body
-            Value returnValue = std::monostate{};
-            for (auto stmt : method->body) {
-                bool shouldReturn = false;
-                Value stmtResult = executeStatement(stmt, &shouldReturn);
-                if (shouldReturn) {
-                    returnValue = stmtResult;
-                    break;
+            // Assign argument values to parameters, after the instance parameter for init methods
+            size_t firstParam = isInitMethod ? 1 : 0;
+            for (size_t i = 0; i < call->arguments.size(); ++i) {
+                if (firstParam + i < method->parameters.size()) {
+                    frame->slots[firstParam + i] = executeExpression(call->arguments[i]);
                 }
             }
             
-            // Restore the original variable environment
-            variables = savedVariables;
+            // Execute method body
+            FrameGuard guard(frame);
+            Value returnValue = executeFunctionBody(method);
             
             return returnValue;
         }
@@ -2933,11 +3390,11 @@ Value executeFunctionCall(FunctionCall* call) {
                     }
                     
                     Value instanceVal = executeExpression(call->arguments[0]);
-                    if (!std::holds_alternative<Instance*>(instanceVal)) {
+                    if (!instanceVal.isInstance()) {
                         throw vanction_error::MethodError("First argument to init must be an instance");
                     }
                     
-                    Instance* instance = std::get<Instance*>(instanceVal);
+                    Instance* instance = instanceVal.asInstance();
                     
                     // Find the init method
                     InstanceMethodDeclaration* method = classDef->initMethod;
@@ -2945,68 +3402,46 @@ Value executeFunctionCall(FunctionCall* call) {
                         throw vanction_error::MethodError("Undefined method: init on class " + className);
                     }
                     
-                    // Create a new variable environment for the method execution
-                    std::map<std::string, Value> methodVariables = variables;
+                    // Create a new frame for the method execution
+                    std::optional<Frame> storage;
+                    Frame* frame = enterFrame(storage, method->layout, nullptr, method->parameters.size());
                     
                     // Set the instance parameter to the current instance
-                    if (method->parameters.size() > 0) {
-                        methodVariables[method->parameters[0].name] = instance;
-                    }
                     // Also explicitly add 'instance' variable for backward compatibility
-                    methodVariables["instance"] = instance;
+                    bindInstance(frame, method, instance, true);
                     
                     // Assign method arguments, skipping the first argument (which is the instance itself)
                     for (size_t i = 1; i < call->arguments.size(); ++i) {
                         if (i < method->parameters.size()) {
-                            Value argValue = executeExpression(call->arguments[i]);
-                            methodVariables[method->parameters[i].name] = argValue;
+                            frame->slots[i] = executeExpression(call->arguments[i]);
                         }
                     }
                     
-                    // Save current variable environment and switch to method-specific environment
-                    auto savedVariables = variables;
-                    variables = methodVariables;
-                    
                     // Execute method body
-                    Value returnValue = std::monostate{};
-                    for (auto stmt : method->body) {
-                        bool shouldReturn = false;
-                        Value stmtResult = executeStatement(stmt, &shouldReturn);
-                        if (shouldReturn) {
-                            returnValue = stmtResult;
-                            break;
-                        }
-                    }
-                    
-                    // Restore the original variable environment
-                    variables = savedVariables;
+                    FrameGuard guard(frame);
+                    Value returnValue = executeFunctionBody(method);
                     
                     return returnValue;
                 }
             }
             
             // Otherwise, treat it as a namespace function call (e.g., Test:add or Test.submodule:add)
-            std::string namespaceName = call->objectName;
-            std::string funcName = call->methodName;
-            
-            // Check if namespace exists
-            if (namespaces.find(namespaceName) == namespaces.end()) {
-                // If it's not a direct namespace, check if it's a nested module call
-                // For example, if we have 'utils.strings' as the objectName, check if 'utils.strings' is a namespace
-                if (namespaces.find(namespaceName) == namespaces.end()) {
+            // Calls to existing namespace functions are linked; the rest end in the errors below
+            const std::string& namespaceName = call->objectName;
+            const std::string& funcName = call->methodName;
+            
+            FunctionDeclaration* func = call->targetFunction;
+            if (!func) {
+                auto nsIt = namespaces.find(namespaceName);
+                if (nsIt == namespaces.end()) {
                     throw vanction_error::MethodError("Undefined namespace: " + namespaceName);
                 }
-            }
-            
-            // Check if function exists in namespace
-            if (namespaces[namespaceName].find(funcName) == namespaces[namespaceName].end()) {
                 throw vanction_error::MethodError("Undefined function in namespace " + namespaceName + ": " + funcName);
             }
             
-            FunctionDeclaration* func = namespaces[namespaceName][funcName];
-            
-            // Save current variable environment
-            auto savedVariables = variables;
+            // Create a new frame for the function execution
+            std::optional<Frame> storage;
+            Frame* frame = enterFrame(storage, func->layout, func->closure, func->parameters.size());
             
             // Handle function arguments
             // Allow different argument counts for flexibility
@@ -3019,7 +3454,7 @@ Value executeFunctionCall(FunctionCall* call) {
             for (size_t i = 0; i < call->arguments.size(); ++i) {
                 Value argValue = executeExpression(call->arguments[i]);
                 if (i < func->parameters.size()) {
-                    variables[func->parameters[i].name] = argValue;
+                    frame->slots[i] = argValue;
                 }
                 argValues.push_back(argValue);
             }
@@ -3027,7 +3462,7 @@ Value executeFunctionCall(FunctionCall* call) {
             // Check if this is a C++ module placeholder function
             // If it is, return a mock result instead of executing the empty body
             Value returnValue;
-            if (cModules.find(namespaceName) != cModules.end()) {
+            if (call->target == CallTarget::ModuleFunction) {
                 // This is a C++ module function
                 if (funcName == "hello") {
                     // Mock hello() function - print message and return void
@@ -3036,8 +3471,8 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "add") {
                     // Mock add() function - return sum of arguments
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         returnValue = a + b;
                     } else {
                         returnValue = std::monostate{};
@@ -3045,8 +3480,8 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "subtract") {
                     // Mock subtract() function - return difference of arguments
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         returnValue = a - b;
                     } else {
                         returnValue = std::monostate{};
@@ -3054,8 +3489,8 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "multiply") {
                     // Mock multiply() function - return product of arguments
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         returnValue = a * b;
                     } else {
                         returnValue = std::monostate{};
@@ -3063,8 +3498,8 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "divide") {
                     // Mock divide() function - return quotient of arguments
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         if (b != 0) {
                             returnValue = a / b;
                         } else {
@@ -3076,7 +3511,7 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "abs") {
                     // Mock abs() function - return absolute value of argument
                     if (argValues.size() == 1) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
                         returnValue = (a < 0) ? -a : a;
                     } else {
                         returnValue = std::monostate{};
@@ -3084,8 +3519,8 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "power" || funcName == "pow") {
                     // Mock power() function - return a^b
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         int result = 1;
                         for (int i = 0; i < b; i++) {
                             result *= a;
@@ -3100,14 +3535,9 @@ Value executeFunctionCall(FunctionCall* call) {
                 }
             } else {
                 // Regular namespace function - execute its body
-                returnValue = std::monostate{};
-                for (auto stmt : func->body) {
-                    bool shouldReturn = false;
-                    Value stmtResult = executeStatement(stmt, &shouldReturn);
-                    if (shouldReturn) {
-                        returnValue = stmtResult;
-                        break;
-                    }
+                {
+                    FrameGuard guard(frame);
+                    returnValue = executeFunctionBody(func);
                 }
                 
                 // For namespace functions, we need to provide default implementations
@@ -3115,8 +3545,8 @@ Value executeFunctionCall(FunctionCall* call) {
                 if (funcName == "power" || funcName == "pow") {
                     // Default power implementation
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         int result = 1;
                         for (int i = 0; i < b; i++) {
                             result *= a;
@@ -3126,29 +3556,29 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "add") {
                     // Default add implementation
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         returnValue = a + b;
                     }
                 } else if (funcName == "subtract") {
                     // Default subtract implementation
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         returnValue = a - b;
                     }
                 } else if (funcName == "multiply") {
                     // Default multiply implementation
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         returnValue = a * b;
                     }
                 } else if (funcName == "divide") {
                     // Default divide implementation
                     if (argValues.size() == 2) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
-                        int b = std::holds_alternative<int>(argValues[1]) ? std::get<int>(argValues[1]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
+                        int b = argValues[1].isInt() ? argValues[1].asInt() : 0;
                         if (b != 0) {
                             returnValue = a / b;
                         }
@@ -3156,15 +3586,12 @@ Value executeFunctionCall(FunctionCall* call) {
                 } else if (funcName == "abs") {
                     // Default abs implementation
                     if (argValues.size() == 1) {
-                        int a = std::holds_alternative<int>(argValues[0]) ? std::get<int>(argValues[0]) : 0;
+                        int a = argValues[0].isInt() ? argValues[0].asInt() : 0;
                         returnValue = (a < 0) ? -a : a;
                     }
                 }
             }
             
-            // Restore saved variable environment
-            variables = savedVariables;
-            
             return returnValue;
         }
     }
@@ -3284,6 +3711,11 @@ void printHelp(std::ostream& os) {
     os << "  -g         Compile to executable file (using GCC)" << std::endl;
     os << "  -o <file>  Specify output filename for compilation" << std::endl;
     os << "  -debug     Enable debug logging for lexer, parser, main, and codegenerator" << std::endl;
+    os << "  -ast       Interpret with the AST tree-walker instead of the bytecode VM" << std::endl;
+    os << "  -tier      Interpret, compiling hot int functions to native code in the background (using GCC)" << std::endl;
+    os << "  -O0|-O1|-O2 Optimization level: none, constant folding and propagation with dead branch" << std::endl;
+    os << "             elimination (default), and algebraic simplification" << std::endl;
+    os << "  -gc-stats  Report garbage collections, pause times and live bytes after interpretation" << std::endl;
     os << "  -config    Configure program settings" << std::endl;
     os << "  -h, --help Show this help message" << std::endl;
     os << "Configurable settings: " << std::endl;
@@ -3302,6 +3734,7 @@ int main(int argc, char* argv[]) {
     std::string filePath;
     std::string outputFile;
     std::string mode;
+    bool tiered = false;
     
     // Parse command line arguments
     for (int i = 1; i < argc; ++i) {
@@ -3318,6 +3751,14 @@ int main(int argc, char* argv[]) {
             }
         } else if (arg == "-debug") {
             debugMode = true;
+        } else if (arg == "-ast") {
+            useBytecodeVM = false;
+        } else if (arg == "-tier") {
+            tiered = true;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            optimizationLevel = arg[2] - '0';
+        } else if (arg == "-gc-stats") {
+            heap.statsEnabled = true;
         } else if (arg == "-h" || arg == "--help") {
             printHelp(std::cout);
             return 0;
@@ -3458,7 +3899,7 @@ int main(int argc, char* argv[]) {
             // Check if main function exists
             bool hasMainFunction = false;
             for (auto decl : program->declarations) {
-                if (auto func = dynamic_cast<FunctionDeclaration*>(decl)) {
+                if (auto func = nodeCast<FunctionDeclaration>(decl)) {
                     if (func->name == "main") {
                         hasMainFunction = true;
                         break;
@@ -3473,6 +3914,9 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             
+            // Optimize the AST for the generated C++
+            optimizeProgram(program, OptimizationTarget::CodeGenerator);
+            
             // Generate C++ code
             CodeGenerator codeGen;
             std::string cppCode = codeGen.generate(program);
@@ -3535,7 +3979,7 @@ int main(int argc, char* argv[]) {
             // Check if main function exists
             bool hasMainFunction = false;
             for (auto decl : program->declarations) {
-                if (auto func = dynamic_cast<FunctionDeclaration*>(decl)) {
+                if (auto func = nodeCast<FunctionDeclaration>(decl)) {
                     if (func->name == "main") {
                         hasMainFunction = true;
                         break;
@@ -3570,6 +4014,15 @@ int main(int argc, char* argv[]) {
             // Initialize global constants
             initializeConstants();
             
+            // Compile hot functions in the background, caching objects next to the configuration
+            if (tiered) {
+                nativeTier.start(getCompilerPath(), getConfigDir() + "\\NativeCache");
+            }
+            
+            // The collector scans the native stack below this point for temporaries
+            int stackBase = 0;
+            heap.setStackBase(&stackBase);
+            
             // Execute the program
             Value result = executeProgram(program);
             
@@ -3577,18 +4030,22 @@ int main(int argc, char* argv[]) {
                 std::cout << "[DEBUG] Main: Program execution completed" << std::endl;
             }
             
+            if (heap.statsEnabled) {
+                heap.printStats(std::cerr);
+            }
+            
             // Clean up AST
             delete program;
             
             // Convert result to exit code
-            if (std::holds_alternative<int>(result)) {
-                return std::get<int>(result);
-            } else if (std::holds_alternative<bool>(result)) {
-                return std::get<bool>(result) ? 1 : 0;
-            } else if (std::holds_alternative<float>(result)) {
-                return static_cast<int>(std::get<float>(result));
-            } else if (std::holds_alternative<double>(result)) {
-                return static_cast<int>(std::get<double>(result));
+            if (result.isInt()) {
+                return result.asInt();
+            } else if (result.isBool()) {
+                return result.asBool() ? 1 : 0;
+            } else if (result.isFloat()) {
+                return static_cast<int>(result.asFloat());
+            } else if (result.isDouble()) {
+                return static_cast<int>(result.asDouble());
             }
             
             // Default exit code
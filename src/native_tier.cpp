@@ -0,0 +1,251 @@
+#include "native_tier.h"
+#include "code_generator.h"
+#include "runtime.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+NativeTier nativeTier;
+
+namespace {
+
+#ifdef _WIN32
+const char* libraryExtension = ".dll";
+const char* discardOutput = " > nul 2>&1";
+#else
+const char* libraryExtension = ".so";
+const char* discardOutput = " > /dev/null 2>&1";
+#endif
+
+// FNV-1a hash naming the cached object of a source
+std::string contentHash(const std::string& text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char digits[17];
+    std::snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(hash));
+    return digits;
+}
+
+void* openLibrary(const std::string& path) {
+#ifdef _WIN32
+    return LoadLibraryA(path.c_str());
+#else
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+void* findSymbol(void* library, const char* name) {
+#ifdef _WIN32
+    return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(library), name));
+#else
+    return dlsym(library, name);
+#endif
+}
+
+void closeLibrary(void* library) {
+#ifdef _WIN32
+    FreeLibrary(static_cast<HMODULE>(library));
+#else
+    dlclose(library);
+#endif
+}
+
+} // namespace
+
+NativeTier::~NativeTier() {
+    // Jobs still queued are dropped, a compilation in progress is waited for
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (void* library : libraries) {
+        closeLibrary(library);
+    }
+}
+
+// Start the compiler thread with the compiler command and the cache directory
+void NativeTier::start(const std::string& compilerCommand, const std::string& cacheDir) {
+    compiler = compilerCommand;
+    cacheDirectory = cacheDir;
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    worker = std::thread(&NativeTier::work, this);
+    running = true;
+}
+
+// Profile a call, and run it natively once the function is compiled
+bool NativeTier::call(FunctionDeclaration* func, const Value* args, size_t argCount, Value& result) {
+    NativeFunction* native = func->native ? func->native : profile(func);
+    NativeFunction::State state = native->state.load(std::memory_order_acquire);
+    
+    if (state == NativeFunction::State::Ready) {
+        // Guard the argument types the code was compiled for, other calls stay interpreted
+        int ints[maxParameters];
+        if (argCount != func->parameters.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < argCount; i++) {
+            if (!args[i].isInt()) {
+                return false;
+            }
+            ints[i] = args[i].asInt();
+        }
+        
+        int value = 0;
+        if (native->entry(ints, &value) == 0) {
+            result = value;
+            return true;
+        }
+        
+        // Deoptimized: the function is pure, so the interpreter reruns the whole call
+        if (++native->deoptimizations >= maxDeoptimizations) {
+            native->state.store(NativeFunction::State::Rejected, std::memory_order_relaxed);
+        }
+        return false;
+    }
+    if (state != NativeFunction::State::Profiling) {
+        return false;
+    }
+    
+    // Argument types are stable as long as every call passes one int per parameter
+    bool ints = argCount == func->parameters.size();
+    for (size_t i = 0; ints && i < argCount; i++) {
+        ints = args[i].isInt();
+    }
+    if (!ints) {
+        native->state.store(NativeFunction::State::Rejected, std::memory_order_relaxed);
+        native->source.clear();
+        return false;
+    }
+    
+    if (++native->calls + native->backEdges >= hotThreshold) {
+        submit(native);
+    }
+    return false;
+}
+
+// Count a loop back-edge of the function running in the current frame
+void NativeTier::backEdge() {
+    Closure* closure = currentFrame ? currentFrame->closure : nullptr;
+    NativeFunction* native = closure && closure->function ? closure->function->native : nullptr;
+    if (!native || native->state.load(std::memory_order_relaxed) != NativeFunction::State::Profiling) {
+        return;
+    }
+    
+    // A hot loop makes the next call native (running calls are not replaced)
+    if (native->calls + ++native->backEdges >= hotThreshold) {
+        submit(native);
+    }
+}
+
+// Start profiling a function, translating it first so functions outside the native subset cost nothing more
+NativeFunction* NativeTier::profile(FunctionDeclaration* func) {
+    functions.push_back(std::make_unique<NativeFunction>());
+    NativeFunction* native = functions.back().get();
+    func->native = native;
+    
+    if (func->parameters.size() <= maxParameters) {
+        CodeGenerator generator;
+        native->source = generator.generateNativeFunction(func);
+    }
+    if (native->source.empty()) {
+        native->state.store(NativeFunction::State::Rejected, std::memory_order_relaxed);
+    }
+    return native;
+}
+
+// Queue a hot function for the compiler thread
+void NativeTier::submit(NativeFunction* native) {
+    native->state.store(NativeFunction::State::Compiling, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(native);
+    }
+    wake.notify_one();
+}
+
+// Compiler thread: compile queued functions one at a time and publish their entries
+void NativeTier::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) {
+            return;
+        }
+        NativeFunction* native = queue.front();
+        queue.pop_front();
+        
+        // The interpreter no longer touches the source of a function being compiled
+        lock.unlock();
+        NativeEntry entry = load(native->source);
+        native->source.clear();
+        lock.lock();
+        
+        if (entry) {
+            native->entry = entry;
+            native->state.store(NativeFunction::State::Ready, std::memory_order_release);
+        } else {
+            native->state.store(NativeFunction::State::Rejected, std::memory_order_release);
+        }
+    }
+}
+
+// Compile a source (or take it from the cache) and load its entry, nullptr on failure
+NativeEntry NativeTier::load(const std::string& source) {
+    // The compiler is part of the key: objects built by another compiler are not reused
+    std::filesystem::path stem = std::filesystem::path(cacheDirectory) / ("vn_" + contentHash(compiler + "\n" + source));
+    std::string libraryPath = stem.string() + libraryExtension;
+    std::error_code error;
+    
+    if (!std::filesystem::exists(libraryPath, error)) {
+        std::string sourcePath = stem.string() + ".cpp";
+        std::ofstream file(sourcePath);
+        file << source;
+        file.close();
+        if (!file) {
+            return nullptr;
+        }
+        
+        // Build under a temporary name and rename, so other processes never load a partial object
+        std::string buildPath = stem.string() + "." + std::to_string(std::random_device{}()) + libraryExtension;
+        std::string command = compiler + " -std=c++17 -O2 -shared -fPIC \"" + sourcePath + "\" -o \"" + buildPath + "\"" + discardOutput;
+        if (std::system(command.c_str()) != 0 || !std::filesystem::exists(buildPath, error)) {
+            std::filesystem::remove(buildPath, error);
+            return nullptr;
+        }
+        std::filesystem::rename(buildPath, libraryPath, error);
+        if (error) {
+            std::filesystem::remove(buildPath, error);
+            return nullptr;
+        }
+    }
+    
+    void* library = openLibrary(libraryPath);
+    if (!library) {
+        return nullptr;
+    }
+    void* entry = findSymbol(library, "vanction_native_entry");
+    if (!entry) {
+        closeLibrary(library);
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    libraries.push_back(library);
+    return reinterpret_cast<NativeEntry>(entry);
+}
@@ -0,0 +1,89 @@
+#ifndef VANCTION_NATIVE_TIER_H
+#define VANCTION_NATIVE_TIER_H
+
+#include "value.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FunctionDeclaration;
+
+// Native code of a function: returns 0 with the result, or 1 when the interpreter has to run the call
+using NativeEntry = int (*)(const int* args, int* result);
+
+// Tiering state of one function
+struct NativeFunction {
+    enum class State : unsigned char {
+        Profiling,  // counting calls and loop back-edges
+        Compiling,  // queued for or running in the compiler thread
+        Ready,      // entry runs the function
+        Rejected    // not translatable, unstable argument types, failed to compile or deoptimized too often
+    };
+    
+    // Written by the compiler thread once the entry is loaded
+    std::atomic<State> state{State::Profiling};
+    NativeEntry entry = nullptr;
+    
+    unsigned calls = 0;
+    unsigned backEdges = 0;
+    unsigned deoptimizations = 0;
+    
+    // Translation of the function, generated on its first call and handed to the compiler thread when hot
+    std::string source;
+};
+
+// Tiered execution for -i -tier: every called function is profiled, hot ones whose arguments
+// are always ints are translated by the code generator, compiled into a shared object by a
+// background thread and called natively from then on (a call that starts in the interpreter
+// finishes there). Compiled objects are cached on disk under the hash of their source
+class NativeTier {
+public:
+    ~NativeTier();
+    
+    // Start the compiler thread with the compiler command and the cache directory
+    void start(const std::string& compiler, const std::string& cacheDirectory);
+    
+    bool enabled() const { return running; }
+    
+    // Profile a call, and run it natively once the function is compiled
+    // Returns false when the interpreter has to run the call
+    bool call(FunctionDeclaration* func, const Value* args, size_t argCount, Value& result);
+    
+    // Count a loop back-edge of the function running in the current frame
+    void backEdge();
+
+private:
+    static const unsigned hotThreshold = 1000;
+    static const unsigned maxDeoptimizations = 16;
+    static const size_t maxParameters = 8;
+    
+    bool running = false;
+    std::string compiler;
+    std::string cacheDirectory;
+    std::deque<std::unique_ptr<NativeFunction>> functions;
+    
+    // Compiler thread and its queue, guarded by mutex
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<NativeFunction*> queue;
+    std::vector<void*> libraries;
+    bool stopping = false;
+    
+    NativeFunction* profile(FunctionDeclaration* func);
+    void submit(NativeFunction* native);
+    void work();
+    
+    // Compile a source (or take it from the cache) and load its entry, nullptr on failure
+    NativeEntry load(const std::string& source);
+};
+
+extern NativeTier nativeTier;
+
+#endif // VANCTION_NATIVE_TIER_H
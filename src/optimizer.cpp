@@ -0,0 +1,770 @@
+#include "optimizer.h"
+#include "runtime.h"
+#include "type_inference.h"
+#include <climits>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_set>
+
+int optimizationLevel = 1;
+
+namespace {
+
+// Walks every statement and expression of a program, letting a pass replace
+// expressions bottom-up (children are rewritten before their parent)
+class ExpressionRewriter {
+public:
+    virtual ~ExpressionRewriter() = default;
+    
+    bool changed = false;
+    
+    void rewriteProgram(Program* program) {
+        for (auto decl : program->declarations) {
+            rewriteDeclaration(decl);
+        }
+    }
+    
+    void rewriteDeclaration(ASTNode* decl) {
+        if (auto func = nodeCast<FunctionDeclaration>(decl)) {
+            rewriteFunction(func);
+        } else if (auto ns = nodeCast<NamespaceDeclaration>(decl)) {
+            for (auto nested : ns->declarations) {
+                rewriteDeclaration(nested);
+            }
+        } else if (auto cls = nodeCast<ClassDeclaration>(decl)) {
+            for (auto method : cls->methods) {
+                rewriteDeclaration(method);
+            }
+            for (auto method : cls->instanceMethods) {
+                rewriteDeclaration(method);
+            }
+            if (cls->initMethod) {
+                rewriteDeclaration(cls->initMethod);
+            }
+        }
+    }
+    
+    virtual void rewriteFunction(FunctionDeclaration* func) {
+        rewriteBody(func->body);
+    }
+    
+    void rewriteBody(std::vector<ASTNode*>& body) {
+        for (auto stmt : body) {
+            rewriteStatement(stmt);
+        }
+    }
+    
+    virtual void rewriteStatement(ASTNode* stmt) {
+        if (!stmt) {
+            return;
+        }
+        
+        if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
+            rewriteExpression(exprStmt->expression);
+        } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+            rewriteExpression(varDecl->initializer);
+        } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+            rewriteExpression(ifStmt->condition);
+            rewriteBody(ifStmt->ifBody);
+            for (auto elseIf : ifStmt->elseIfs) {
+                rewriteStatement(elseIf);
+            }
+            rewriteBody(ifStmt->elseBody);
+        } else if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
+            rewriteExpression(returnStmt->expression);
+        } else if (auto forLoopStmt = nodeCast<ForLoopStatement>(stmt)) {
+            rewriteStatement(forLoopStmt->initialization);
+            rewriteExpression(forLoopStmt->condition);
+            rewriteExpression(forLoopStmt->increment);
+            rewriteBody(forLoopStmt->body);
+        } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+            rewriteExpression(forInStmt->collection);
+            rewriteBody(forInStmt->body);
+        } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
+            rewriteExpression(whileStmt->condition);
+            rewriteBody(whileStmt->body);
+        } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
+            rewriteBody(doWhileStmt->body);
+            rewriteExpression(doWhileStmt->condition);
+        } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
+            rewriteExpression(switchStmt->expression);
+            for (auto caseStmt : switchStmt->cases) {
+                rewriteExpression(caseStmt->value);
+                rewriteBody(caseStmt->body);
+            }
+        } else if (auto tryHappenStmt = nodeCast<TryHappenStatement>(stmt)) {
+            rewriteBody(tryHappenStmt->tryBody);
+            rewriteBody(tryHappenStmt->happenBody);
+        } else if (auto funcDecl = nodeCast<FunctionDeclaration>(stmt)) {
+            rewriteFunction(funcDecl);
+        }
+    }
+    
+    void rewriteExpression(Expression*& expr) {
+        if (!expr) {
+            return;
+        }
+        
+        if (auto funcCall = nodeCast<FunctionCall>(expr)) {
+            for (auto& arg : funcCall->arguments) {
+                rewriteExpression(arg);
+            }
+        } else if (auto funcCallExpr = nodeCast<FunctionCallExpression>(expr)) {
+            rewriteExpression(funcCallExpr->callee);
+            for (auto& arg : funcCallExpr->arguments) {
+                rewriteExpression(arg);
+            }
+        } else if (auto assignExpr = nodeCast<AssignmentExpression>(expr)) {
+            // The target is left alone; compound assignments (x += 1) share it with their right side
+            assignmentTargets.insert(assignExpr->left);
+            rewriteExpression(assignExpr->right);
+        } else if (auto binaryExpr = nodeCast<BinaryExpression>(expr)) {
+            rewriteExpression(binaryExpr->left);
+            rewriteExpression(binaryExpr->right);
+        } else if (auto indexAccess = nodeCast<IndexAccessExpression>(expr)) {
+            rewriteExpression(indexAccess->collection);
+            rewriteExpression(indexAccess->index);
+        } else if (auto instanceCreation = nodeCast<InstanceCreationExpression>(expr)) {
+            for (auto& arg : instanceCreation->arguments) {
+                rewriteExpression(arg);
+            }
+        } else if (auto instanceAccess = nodeCast<InstanceAccessExpression>(expr)) {
+            rewriteExpression(instanceAccess->instance);
+        } else if (auto listLit = nodeCast<ListLiteral>(expr)) {
+            for (auto& elem : listLit->elements) {
+                rewriteExpression(elem);
+            }
+        } else if (auto hashMapLit = nodeCast<HashMapLiteral>(expr)) {
+            for (auto entry : hashMapLit->entries) {
+                rewriteExpression(entry->key);
+                rewriteExpression(entry->value);
+            }
+        } else if (auto rangeExpr = nodeCast<RangeExpression>(expr)) {
+            rewriteExpression(rangeExpr->start);
+            rewriteExpression(rangeExpr->end);
+            rewriteExpression(rangeExpr->step);
+        } else if (auto lambdaExpr = nodeCast<LambdaExpression>(expr)) {
+            rewriteExpression(lambdaExpr->body);
+        }
+        
+        if (!isAssignmentTarget(expr)) {
+            expr = rewrite(expr);
+        }
+    }
+
+protected:
+    // Replacement for an expression whose children were already rewritten
+    // (deletes the expression when it returns something else)
+    virtual Expression* rewrite(Expression* expr) {
+        return expr;
+    }
+    
+    bool isAssignmentTarget(Expression* expr) const {
+        return assignmentTargets.count(expr) != 0;
+    }
+
+private:
+    std::unordered_set<Expression*> assignmentTargets;
+};
+
+// Literal nodes, except format strings which read variables
+bool isLiteral(Expression* expr) {
+    if (!expr) {
+        return false;
+    }
+    switch (expr->kind) {
+        case NodeKind::IntegerLiteral:
+        case NodeKind::FloatLiteral:
+        case NodeKind::DoubleLiteral:
+        case NodeKind::CharLiteral:
+        case NodeKind::BooleanLiteral:
+            return true;
+        case NodeKind::StringLiteral:
+            return static_cast<StringLiteral*>(expr)->type != "format";
+        default:
+            return false;
+    }
+}
+
+// Value of a literal node, as the interpreters evaluate it
+Value literalValue(Expression* expr) {
+    switch (expr->kind) {
+        case NodeKind::IntegerLiteral:
+            return static_cast<IntegerLiteral*>(expr)->value;
+        case NodeKind::FloatLiteral:
+            return static_cast<FloatLiteral*>(expr)->value;
+        case NodeKind::DoubleLiteral:
+            return static_cast<DoubleLiteral*>(expr)->value;
+        case NodeKind::CharLiteral:
+            return static_cast<CharLiteral*>(expr)->value;
+        case NodeKind::BooleanLiteral:
+            return static_cast<BooleanLiteral*>(expr)->value;
+        default:
+            return static_cast<StringLiteral*>(expr)->value;
+    }
+}
+
+// Literal node for a value, nullptr when the value has no literal form
+Expression* makeLiteral(const Value& value, int line, int column) {
+    switch (value.type()) {
+        case ValueType::Int:
+            return new IntegerLiteral(value.asInt(), line, column);
+        case ValueType::Float:
+            return new FloatLiteral(value.asFloat(), line, column);
+        case ValueType::Double:
+            return new DoubleLiteral(value.asDouble(), line, column);
+        case ValueType::Char:
+            return new CharLiteral(value.asChar(), line, column);
+        case ValueType::Bool:
+            return new BooleanLiteral(value.asBool(), line, column);
+        case ValueType::String:
+            return new StringLiteral(std::string(value.asString()), "normal", line, column);
+        default:
+            return nullptr;
+    }
+}
+
+// Copy of a literal node, placed at another use
+Expression* cloneLiteral(Expression* literal, int line, int column) {
+    if (auto stringLit = nodeCast<StringLiteral>(literal)) {
+        return new StringLiteral(stringLit->value, stringLit->type, line, column);
+    }
+    return makeLiteral(literalValue(literal), line, column);
+}
+
+// Literals that keep their meaning when copied into the generated C++
+// (doubles are printed with six decimals and strings would turn into const char*)
+bool isPortableLiteral(Expression* expr, OptimizationTarget target) {
+    if (!isLiteral(expr)) {
+        return false;
+    }
+    if (target == OptimizationTarget::Interpreter) {
+        return true;
+    }
+    return expr->kind == NodeKind::IntegerLiteral || expr->kind == NodeKind::BooleanLiteral || expr->kind == NodeKind::CharLiteral;
+}
+
+// Numeric value of a literal operand the way the interpreter converts it
+bool numericValue(const Value& value, double& number) {
+    if (value.isInt()) {
+        number = value.asInt();
+    } else if (value.isDouble()) {
+        number = value.asDouble();
+    } else if (value.isFloat()) {
+        number = value.asFloat();
+    } else if (value.isChar()) {
+        number = value.asChar();
+    } else if (value.isBool()) {
+        number = value.asBool();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Whether folding an operator at compile time is safe: no division by zero, no
+// undefined shifts or int overflow, no long power loops
+// Operators that can fail at runtime are left for runtime to report
+bool canFold(BinaryOperator op, const Value& left, const Value& right) {
+    if (op == BinaryOperator::Index || op == BinaryOperator::Member || op == BinaryOperator::Unknown) {
+        return false;
+    }
+    if (isComparison(op) || isLogical(op) || (left.isString() && right.isString())) {
+        return true;
+    }
+    
+    double leftNum = 0.0;
+    double rightNum = 0.0;
+    if (!numericValue(left, leftNum) || !numericValue(right, rightNum)) {
+        return false;
+    }
+    
+    double exact = 0.0;
+    switch (op) {
+        case BinaryOperator::Add:
+            exact = leftNum + rightNum;
+            break;
+        case BinaryOperator::Subtract:
+            exact = leftNum - rightNum;
+            break;
+        case BinaryOperator::Multiply:
+            exact = leftNum * rightNum;
+            break;
+        case BinaryOperator::Divide:
+            if (rightNum == 0.0) {
+                return false;
+            }
+            exact = leftNum / rightNum;
+            break;
+        case BinaryOperator::Power:
+            if (rightNum > 64.0) {
+                return false;
+            }
+            exact = 1.0;
+            for (int i = 0; i < static_cast<int>(rightNum); i++) {
+                exact *= leftNum;
+            }
+            break;
+        case BinaryOperator::Modulo:
+            return left.isInt() && right.isInt() && right.asInt() != 0 && right.asInt() != -1;
+        case BinaryOperator::ShiftLeft:
+        case BinaryOperator::ShiftRight:
+            return left.isInt() && right.isInt() && left.asInt() >= 0 && right.asInt() >= 0 && right.asInt() < 32;
+        default:
+            return false;
+    }
+    
+    // Int results are truncated from the double result, which must fit
+    if (left.isInt() && right.isInt()) {
+        return exact >= static_cast<double>(INT_MIN) && exact <= static_cast<double>(INT_MAX);
+    }
+    return true;
+}
+
+// Whether the generated C++ computes the same result for the folded operands:
+// int arithmetic and comparisons of ints, bools or chars
+// (a folded string would be a const char* where the C++ had a std::string)
+bool foldsInGeneratedCode(BinaryOperator op, Expression* left, Expression* right) {
+    if (left->kind == NodeKind::IntegerLiteral && right->kind == NodeKind::IntegerLiteral) {
+        return !isLogical(op);
+    }
+    if (isComparison(op) && left->kind == right->kind) {
+        return left->kind == NodeKind::BooleanLiteral || left->kind == NodeKind::CharLiteral;
+    }
+    return false;
+}
+
+// Whether an expression is the int literal value, or a double literal too when allowDouble is set
+bool isNumberLiteral(Expression* expr, int value, bool allowDouble) {
+    if (auto intLit = nodeCast<IntegerLiteral>(expr)) {
+        return intLit->value == value;
+    }
+    if (auto doubleLit = nodeCast<DoubleLiteral>(expr)) {
+        return allowDouble && doubleLit->value == static_cast<double>(value);
+    }
+    return false;
+}
+
+bool isBooleanLiteral(Expression* expr, bool value) {
+    auto boolLit = nodeCast<BooleanLiteral>(expr);
+    return boolLit && boolLit->value == value;
+}
+
+// Value of an if condition known before running, tested the way the interpreters do
+bool constantCondition(Expression* condition, bool& value) {
+    if (auto boolLit = nodeCast<BooleanLiteral>(condition)) {
+        value = boolLit->value;
+        return true;
+    }
+    if (auto intLit = nodeCast<IntegerLiteral>(condition)) {
+        value = intLit->value != 0;
+        return true;
+    }
+    return false;
+}
+
+void deleteNodes(std::vector<ASTNode*>& nodes) {
+    for (auto node : nodes) {
+        delete node;
+    }
+    nodes.clear();
+}
+
+// Counts the declarations of every name in a function, its nested functions and lambdas
+class DeclarationCounter : public ExpressionRewriter {
+public:
+    std::map<std::string, int> counts;
+    
+    void rewriteFunction(FunctionDeclaration* func) override {
+        for (const auto& param : func->parameters) {
+            counts[param.name]++;
+        }
+        ExpressionRewriter::rewriteFunction(func);
+    }
+    
+    void rewriteStatement(ASTNode* stmt) override {
+        if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+            counts[varDecl->name]++;
+        } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+            counts[forInStmt->keyVariableName]++;
+            if (forInStmt->isKeyValuePair) {
+                counts[forInStmt->valueVariableName]++;
+            }
+        } else if (auto tryHappenStmt = nodeCast<TryHappenStatement>(stmt)) {
+            counts[tryHappenStmt->errorVariableName]++;
+        } else if (auto funcDecl = nodeCast<FunctionDeclaration>(stmt)) {
+            counts[funcDecl->name]++;
+        }
+        ExpressionRewriter::rewriteStatement(stmt);
+    }
+
+protected:
+    Expression* rewrite(Expression* expr) override {
+        if (auto lambdaExpr = nodeCast<LambdaExpression>(expr)) {
+            for (const auto& param : lambdaExpr->parameters) {
+                counts[param.name]++;
+            }
+        }
+        return expr;
+    }
+};
+
+// Replaces reads of immut variables initialized with a literal by the literal
+// Only declarations at the top level of a function body qualify (they run before
+// every later statement), and only names declared once in the whole function
+// true and false are global constants, read as literals unless a function declares them
+class ConstantPropagator : public ExpressionRewriter {
+public:
+    explicit ConstantPropagator(OptimizationTarget target)
+        : target(target), trueLiteral(true), falseLiteral(false) {}
+    
+    void rewriteFunction(FunctionDeclaration* func) override {
+        DeclarationCounter declarations;
+        declarations.rewriteFunction(func);
+        
+        // Constants of enclosing functions stay visible in nested ones
+        std::map<std::string, Expression*> enclosing = constants;
+        if (declarations.counts["true"] == 0 && declarations.counts["false"] == 0) {
+            constants.emplace("true", &trueLiteral);
+            constants.emplace("false", &falseLiteral);
+        }
+        for (auto stmt : func->body) {
+            rewriteStatement(stmt);
+            
+            auto varDecl = nodeCast<VariableDeclaration>(stmt);
+            if (varDecl && varDecl->isImmut && declarations.counts[varDecl->name] == 1 &&
+                isPortableLiteral(varDecl->initializer, target)) {
+                constants[varDecl->name] = varDecl->initializer;
+            }
+        }
+        constants = enclosing;
+    }
+
+protected:
+    Expression* rewrite(Expression* expr) override {
+        auto ident = nodeCast<Identifier>(expr);
+        if (!ident) {
+            return expr;
+        }
+        auto it = constants.find(ident->name);
+        if (it == constants.end()) {
+            return expr;
+        }
+        
+        Expression* literal = cloneLiteral(it->second, ident->getLine(), ident->getColumn());
+        delete ident;
+        changed = true;
+        return literal;
+    }
+
+private:
+    OptimizationTarget target;
+    BooleanLiteral trueLiteral;
+    BooleanLiteral falseLiteral;
+    std::map<std::string, Expression*> constants;
+};
+
+// Evaluates binary expressions of two literals once, with the interpreter's own operators
+class ConstantFolder : public ExpressionRewriter {
+public:
+    explicit ConstantFolder(OptimizationTarget target) : target(target) {}
+
+protected:
+    Expression* rewrite(Expression* expr) override {
+        auto binaryExpr = nodeCast<BinaryExpression>(expr);
+        if (!binaryExpr || !isLiteral(binaryExpr->left) || !isLiteral(binaryExpr->right)) {
+            return expr;
+        }
+        if (target == OptimizationTarget::CodeGenerator &&
+            !foldsInGeneratedCode(binaryExpr->opcode, binaryExpr->left, binaryExpr->right)) {
+            return expr;
+        }
+        
+        Value left = literalValue(binaryExpr->left);
+        Value right = literalValue(binaryExpr->right);
+        if (!canFold(binaryExpr->opcode, left, right)) {
+            return expr;
+        }
+        
+        Expression* literal = nullptr;
+        try {
+            literal = makeLiteral(evaluateBinary(binaryExpr, left, right), binaryExpr->getLine(), binaryExpr->getColumn());
+        } catch (const std::exception&) {
+            // Operand types the operator rejects: keep the error for runtime
+            return expr;
+        }
+        if (!literal) {
+            return expr;
+        }
+        
+        delete binaryExpr;
+        changed = true;
+        return literal;
+    }
+
+private:
+    OptimizationTarget target;
+};
+
+// Replaces x + 0, x * 1, x / 1, b & true and similar identities by their operand
+// when the operand's type is known, since for other types (strings, bools) the
+// operators convert their operands
+class AlgebraicSimplifier : public ExpressionRewriter {
+public:
+    explicit AlgebraicSimplifier(OptimizationTarget target) : target(target) {}
+
+protected:
+    Expression* rewrite(Expression* expr) override {
+        auto binaryExpr = nodeCast<BinaryExpression>(expr);
+        if (!binaryExpr) {
+            return expr;
+        }
+        
+        const BinaryOperator op = binaryExpr->opcode;
+        Expression* left = binaryExpr->left;
+        Expression* right = binaryExpr->right;
+        if (isIdentity(op, left, right, false)) {
+            binaryExpr->left = nullptr;
+            return simplified(binaryExpr, left);
+        }
+        if (isIdentity(op, right, left, true)) {
+            binaryExpr->right = nullptr;
+            return simplified(binaryExpr, right);
+        }
+        return expr;
+    }
+
+private:
+    OptimizationTarget target;
+    
+    // Type inferred for an operand, as far as it holds in the generated C++ as well:
+    // there & | ^ are bitwise int operators, so only comparisons and literals are bools
+    StaticType operandType(Expression* operand) const {
+        if (target == OptimizationTarget::CodeGenerator && operand->staticType == StaticType::Bool) {
+            auto binaryExpr = nodeCast<BinaryExpression>(operand);
+            if (!nodeCast<BooleanLiteral>(operand) && !(binaryExpr && isComparison(binaryExpr->opcode))) {
+                return StaticType::Unknown;
+            }
+        }
+        return operand->staticType;
+    }
+    
+    // Whether "operand op constant" (or "constant op operand" when constantOnLeft) is just operand
+    bool isIdentity(BinaryOperator op, Expression* operand, Expression* constant, bool constantOnLeft) {
+        if (isAssignmentTarget(operand)) {
+            return false;
+        }
+        
+        switch (operandType(operand)) {
+            case StaticType::Int:
+                // Only int constants keep the result an int
+                switch (op) {
+                    case BinaryOperator::Add:
+                        return isNumberLiteral(constant, 0, false);
+                    case BinaryOperator::Multiply:
+                        return isNumberLiteral(constant, 1, false);
+                    case BinaryOperator::Subtract:
+                        return !constantOnLeft && isNumberLiteral(constant, 0, false);
+                    case BinaryOperator::Divide:
+                    case BinaryOperator::Power:
+                        return !constantOnLeft && isNumberLiteral(constant, 1, false);
+                    default:
+                        return false;
+                }
+            case StaticType::Double:
+                // x + 0 is not x for x = -0.0
+                switch (op) {
+                    case BinaryOperator::Multiply:
+                        return isNumberLiteral(constant, 1, true);
+                    case BinaryOperator::Subtract:
+                        return !constantOnLeft && isNumberLiteral(constant, 0, true);
+                    case BinaryOperator::Divide:
+                    case BinaryOperator::Power:
+                        return !constantOnLeft && isNumberLiteral(constant, 1, true);
+                    default:
+                        return false;
+                }
+            case StaticType::Bool:
+                switch (op) {
+                    case BinaryOperator::Equal:
+                        return isBooleanLiteral(constant, true);
+                    case BinaryOperator::NotEqual:
+                        return isBooleanLiteral(constant, false);
+                    case BinaryOperator::And:
+                        return target == OptimizationTarget::Interpreter && isBooleanLiteral(constant, true);
+                    case BinaryOperator::Or:
+                    case BinaryOperator::Xor:
+                        return target == OptimizationTarget::Interpreter && isBooleanLiteral(constant, false);
+                    default:
+                        return false;
+                }
+            default:
+                return false;
+        }
+    }
+    
+    Expression* simplified(BinaryExpression* binaryExpr, Expression* operand) {
+        delete binaryExpr;
+        changed = true;
+        return operand;
+    }
+};
+
+// Trims if statements with a constant condition to the branch that runs
+// The statement itself stays, so statement values and scoping do not change
+class DeadBranchEliminator : public ExpressionRewriter {
+public:
+    void rewriteStatement(ASTNode* stmt) override {
+        if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+            prune(ifStmt);
+        }
+        ExpressionRewriter::rewriteStatement(stmt);
+    }
+
+private:
+    void prune(IfStatement* stmt) {
+        bool value = false;
+        if (!constantCondition(stmt->condition, value)) {
+            return;
+        }
+        
+        if (value) {
+            // Else-if clauses and the else body never run
+            if (stmt->elseIfs.empty() && stmt->elseBody.empty()) {
+                return;
+            }
+            for (auto elseIf : stmt->elseIfs) {
+                delete elseIf;
+            }
+            stmt->elseIfs.clear();
+            deleteNodes(stmt->elseBody);
+            changed = true;
+            return;
+        }
+        
+        // When the condition is false every else-if clause is tested and the else body runs
+        if (!stmt->ifBody.empty()) {
+            deleteNodes(stmt->ifBody);
+            changed = true;
+        }
+        if (stmt->elseIfs.empty() && !stmt->elseBody.empty()) {
+            delete stmt->condition;
+            stmt->condition = new BooleanLiteral(true);
+            stmt->ifBody.swap(stmt->elseBody);
+            changed = true;
+        }
+    }
+};
+
+// Annotates the types later passes and both backends rely on; it only adds
+// annotations, so it never asks for another round
+class TypeInferencePass : public OptimizationPass {
+public:
+    const char* name() const override { return "type-inference"; }
+    
+    bool run(Program* program, const OptimizationOptions&) override {
+        TypeInference inference;
+        inference.infer(program);
+        return false;
+    }
+};
+
+class ConstantPropagationPass : public OptimizationPass {
+public:
+    const char* name() const override { return "constant-propagation"; }
+    
+    bool run(Program* program, const OptimizationOptions& options) override {
+        ConstantPropagator propagator(options.target);
+        propagator.rewriteProgram(program);
+        return propagator.changed;
+    }
+};
+
+class ConstantFoldingPass : public OptimizationPass {
+public:
+    const char* name() const override { return "constant-folding"; }
+    
+    bool run(Program* program, const OptimizationOptions& options) override {
+        ConstantFolder folder(options.target);
+        folder.rewriteProgram(program);
+        return folder.changed;
+    }
+};
+
+class AlgebraicSimplificationPass : public OptimizationPass {
+public:
+    const char* name() const override { return "algebraic-simplification"; }
+    
+    bool run(Program* program, const OptimizationOptions& options) override {
+        AlgebraicSimplifier simplifier(options.target);
+        simplifier.rewriteProgram(program);
+        return simplifier.changed;
+    }
+};
+
+class DeadBranchEliminationPass : public OptimizationPass {
+public:
+    const char* name() const override { return "dead-branch-elimination"; }
+    
+    bool run(Program* program, const OptimizationOptions&) override {
+        DeadBranchEliminator eliminator;
+        eliminator.rewriteProgram(program);
+        return eliminator.changed;
+    }
+};
+
+} // namespace
+
+PassManager::PassManager(const OptimizationOptions& options) : options(options) {}
+
+void PassManager::add(std::unique_ptr<OptimizationPass> pass) {
+    passes.push_back(std::move(pass));
+}
+
+// Passes feed each other (a propagated constant can be folded, which can make a
+// condition constant), so rounds repeat until one changes nothing
+void PassManager::run(Program* program) {
+    if (program->optimized) {
+        return;
+    }
+    program->optimized = true;
+    
+    for (int round = 0; round < maxRounds; ++round) {
+        bool changed = false;
+        for (auto& pass : passes) {
+            if (pass->run(program, options)) {
+                changed = true;
+                if (debugMode) {
+                    std::cout << "[DEBUG] Optimizer: " << pass->name() << " changed the program (round " << round + 1 << ")" << std::endl;
+                }
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+}
+
+PassManager PassManager::standard(const OptimizationOptions& options) {
+    PassManager manager(options);
+    if (options.level >= 1) {
+        manager.add(std::make_unique<TypeInferencePass>());
+        manager.add(std::make_unique<ConstantPropagationPass>());
+        manager.add(std::make_unique<ConstantFoldingPass>());
+    }
+    if (options.level >= 2) {
+        manager.add(std::make_unique<AlgebraicSimplificationPass>());
+    }
+    if (options.level >= 1) {
+        manager.add(std::make_unique<DeadBranchEliminationPass>());
+    }
+    return manager;
+}
+
+void optimizeProgram(Program* program, OptimizationTarget target) {
+    if (optimizationLevel <= 0) {
+        return;
+    }
+    PassManager::standard(OptimizationOptions{optimizationLevel, target}).run(program);
+}
@@ -0,0 +1,61 @@
+#ifndef VANCTION_OPTIMIZER_H
+#define VANCTION_OPTIMIZER_H
+
+#include "../include/ast.h"
+#include <memory>
+#include <vector>
+
+// AST optimization passes, run between the parser and either backend
+// Level 0 runs nothing, level 1 infers local types, propagates immut constants, folds
+// constant expressions and drops dead if branches, level 2 also simplifies algebraic identities
+
+// Backend the program is optimized for: folded results must mean the same thing
+// in the generated C++ as in the interpreter
+enum class OptimizationTarget : unsigned char {
+    Interpreter,
+    CodeGenerator
+};
+
+struct OptimizationOptions {
+    int level;
+    OptimizationTarget target;
+};
+
+// Optimization level selected with -O0, -O1 or -O2 (default 1)
+extern int optimizationLevel;
+
+// One rewrite of the AST in place
+class OptimizationPass {
+public:
+    virtual ~OptimizationPass() = default;
+    
+    virtual const char* name() const = 0;
+    
+    // Rewrite the program, returns true when anything changed
+    virtual bool run(Program* program, const OptimizationOptions& options) = 0;
+};
+
+// Ordered list of passes, repeated until nothing changes (bounded by maxRounds)
+class PassManager {
+public:
+    explicit PassManager(const OptimizationOptions& options);
+    
+    void add(std::unique_ptr<OptimizationPass> pass);
+    
+    // Run all passes over a program, once per program
+    void run(Program* program);
+    
+    // Passes of an optimization level
+    static PassManager standard(const OptimizationOptions& options);
+
+private:
+    static const int maxRounds = 4;
+    
+    OptimizationOptions options;
+    std::vector<std::unique_ptr<OptimizationPass>> passes;
+};
+
+// Run the standard passes of the selected level
+void optimizeProgram(Program* program, OptimizationTarget target);
+
+#endif // VANCTION_OPTIMIZER_H
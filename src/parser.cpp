@@ -1,5 +1,6 @@
 #include "parser.h"
 #include "error.h"
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <stdexcept>
@@ -462,7 +463,9 @@ Statement* Parser::parseTryHappenStatement() {
     auto happenBody = parseBlock();
     
     // Create try-happen statement node
-    return new TryHappenStatement(tryBody, errorType, errorVariableName, happenBody);
+    auto stmt = new TryHappenStatement(tryBody, errorType, errorVariableName, happenBody);
+    stmt->errorTypeId = happenErrorType(errorType);
+    return stmt;
 }
 
 // Parse function definition
@@ -541,8 +544,11 @@ FunctionDeclaration* Parser::parseFunctionAST() {
     // Parse left brace
     consume(LBRACE);
     
-    // Parse function body
+    // Parse function body (loops around a nested function cannot be left from inside it)
+    std::vector<std::string> outerLoops;
+    outerLoops.swap(loopLabels);
     auto body = parseFunctionBodyAST();
+    loopLabels.swap(outerLoops);
     
     // Parse right brace
     consume(RBRACE);
@@ -601,6 +607,54 @@ std::vector<ASTNode*> Parser::parseBlock() {
     return block;
 }
 
+// Parse the body of a loop, with the loop open to the break and continue statements in it
+std::vector<ASTNode*> Parser::parseLoopBody() {
+    std::string label = pendingLabel;
+    pendingLabel.clear();
+    if (!label.empty() && std::find(loopLabels.begin(), loopLabels.end(), label) != loopLabels.end()) {
+        throw vanction_error::SyntaxError("Duplicate loop label: " + label, currentToken.line, currentToken.column);
+    }
+    
+    loopLabels.push_back(label);
+    auto body = parseBlock();
+    loopLabels.pop_back();
+    return body;
+}
+
+// Parse break or continue statement, resolving the loop it leaves or restarts
+Statement* Parser::parseJumpStatement() {
+    bool isBreak = currentToken.value == "break";
+    int line = currentToken.line;
+    int column = currentToken.column;
+    consume(KEYWORD);
+    
+    // Optional label, otherwise the innermost loop
+    std::string label;
+    if (currentToken.type == IDENTIFIER) {
+        label = currentToken.value;
+        consume(IDENTIFIER);
+    }
+    consume(SEMICOLON);
+    
+    std::string keyword = isBreak ? "break" : "continue";
+    if (loopLabels.empty()) {
+        throw vanction_error::SyntaxError(keyword + " outside of a loop", line, column);
+    }
+    int depth = 0;
+    if (!label.empty()) {
+        auto loop = std::find(loopLabels.rbegin(), loopLabels.rend(), label);
+        if (loop == loopLabels.rend()) {
+            throw vanction_error::SyntaxError("Undefined loop label: " + label, line, column);
+        }
+        depth = static_cast<int>(loop - loopLabels.rbegin());
+    }
+    
+    if (isBreak) {
+        return new BreakStatement(label, depth, line, column);
+    }
+    return new ContinueStatement(label, depth, line, column);
+}
+
 // Parse if statement
 Statement* Parser::parseIfStatement() {
     // Consume 'if' keyword
@@ -710,7 +764,7 @@ Statement* Parser::parseForLoopStatement() {
     consume(RPAREN);
     
     // Parse loop body
-    auto body = parseBlock();
+    auto body = parseLoopBody();
     
     // Create for loop statement node
     return new ForLoopStatement(initialization, condition, increment, body);
@@ -751,7 +805,7 @@ Statement* Parser::parseForInLoopStatement() {
     consume(RPAREN);
     
     // Parse loop body
-    auto body = parseBlock();
+    auto body = parseLoopBody();
     
     // Create for-in loop statement node
     if (isKeyValuePair) {
@@ -776,7 +830,7 @@ Statement* Parser::parseWhileLoopStatement() {
     consume(RPAREN);
     
     // Parse loop body
-    auto body = parseBlock();
+    auto body = parseLoopBody();
     
     // Create while loop statement node
     return new WhileLoopStatement(condition, body);
@@ -788,7 +842,7 @@ Statement* Parser::parseDoWhileLoopStatement() {
     consume(KEYWORD);
     
     // Parse loop body
-    auto body = parseBlock();
+    auto body = parseLoopBody();
     
     // Consume 'while' keyword
     consume(KEYWORD);
@@ -870,11 +924,23 @@ Statement* Parser::parseStatement() {
         return parseVariableDeclaration();
     }
     
+    // Check for a loop label (the lexer only makes one in front of a loop)
+    if (currentToken.type == LABEL) {
+        pendingLabel = currentToken.value;
+        consume(LABEL);
+        return parseStatement();
+    }
+    
     // Check for if statement
     if (currentToken.type == KEYWORD && currentToken.value == "if") {
         return parseIfStatement();
     }
     
+    // Check for break and continue statements
+    if (currentToken.type == KEYWORD && (currentToken.value == "break" || currentToken.value == "continue")) {
+        return parseJumpStatement();
+    }
+    
     // Check for for loop statement
     if (currentToken.type == KEYWORD && currentToken.value == "for") {
         // Parse the 'for' keyword
@@ -927,7 +993,7 @@ Statement* Parser::parseStatement() {
                     consume(RPAREN);
                     
                     // Parse loop body
-                    auto body = parseBlock();
+                    auto body = parseLoopBody();
                     
                     // Create for-in loop statement node
                     if (isKeyValuePair) {
@@ -968,7 +1034,7 @@ Statement* Parser::parseStatement() {
                 consume(RPAREN);
                 
                 // Parse loop body
-                auto body = parseBlock();
+                auto body = parseLoopBody();
                 
                 // Create for-in loop statement node
                 if (isKeyValuePair) {
@@ -1008,7 +1074,7 @@ Statement* Parser::parseStatement() {
                     consume(RPAREN);
                     
                     // Parse loop body
-                    auto body = parseBlock();
+                    auto body = parseLoopBody();
                     
                     // Create for loop statement node
                     return new ForLoopStatement(initialization, condition, increment, body);
@@ -1039,7 +1105,7 @@ Statement* Parser::parseStatement() {
             consume(RPAREN);
             
             // Parse loop body
-            auto body = parseBlock();
+            auto body = parseLoopBody();
             
             // Create for loop statement node
             return new ForLoopStatement(initialization, condition, increment, body);
@@ -1949,7 +2015,7 @@ Expression* Parser::parsePrimaryExpression() {
                     value = processedValue;
                 }
                 
-                Expression* key = new StringLiteral(value, type, currentToken.line, currentToken.column);
+                Expression* key = compileFormatString(new StringLiteral(value, type, currentToken.line, currentToken.column));
                 
                 // Advance to next token
                 consume(STRING_LITERAL);
@@ -2015,7 +2081,7 @@ Expression* Parser::parsePrimaryExpression() {
                         value = processedValue;
                     }
                     
-                    key = new StringLiteral(value, type, currentToken.line, currentToken.column);
+                    key = compileFormatString(new StringLiteral(value, type, currentToken.line, currentToken.column));
                     
                     // Advance to next token
                     consume(STRING_LITERAL);
@@ -2363,7 +2429,37 @@ Expression* Parser::parseStringLiteral() {
     }
     
     currentToken = lexer->getNextToken();
-    return new StringLiteral(value, type);
+    return compileFormatString(new StringLiteral(value, type));
+}
+
+// Split a format string into literal text and {name} references once, at parse time
+// A brace preceded by a backslash or without a closing brace stays literal text
+StringLiteral* Parser::compileFormatString(StringLiteral* literal) {
+    if (literal->type != "format") {
+        return literal;
+    }
+    
+    const std::string& format = literal->value;
+    std::string text;
+    size_t pos = 0;
+    while (pos < format.size()) {
+        if (format[pos] == '{' && !(pos > 0 && format[pos - 1] == '\\')) {
+            size_t endPos = format.find('}', pos + 1);
+            if (endPos != std::string::npos) {
+                std::string name = format.substr(pos + 1, endPos - pos - 1);
+                literal->literalLength += text.size();
+                literal->segments.push_back(FormatSegment{text, new Identifier(name, literal->getLine(), literal->getColumn())});
+                text.clear();
+                pos = endPos + 1;
+                continue;
+            }
+        }
+        text += format[pos];
+        ++pos;
+    }
+    literal->literalLength += text.size();
+    literal->segments.push_back(FormatSegment{text, nullptr});
+    return literal;
 }
 
 // Parse integer literal
@@ -2489,6 +2585,7 @@ std::string Parser::tokenTypeToString(TokenType type) {
         case DOUBLE_LITERAL: return "double literal";
         case DOT: return "dot";
         case COLON: return "colon";
+        case LABEL: return "loop label";
         case SEMICOLON: return "semicolon";
         case COMMA: return "comma";
         case LPAREN: return "left parenthesis";
@@ -64,6 +64,9 @@ private:
     // Parse string literal
     Expression* parseStringLiteral();
     
+    // Split a format string literal into text and variable segments (other literals are returned unchanged)
+    StringLiteral* compileFormatString(StringLiteral* literal);
+    
     // Parse integer literal
     Expression* parseIntegerLiteral();
     
@@ -109,6 +112,17 @@ private:
     // Parse block of code
     std::vector<ASTNode*> parseBlock();
     
+    // Labels of the loops enclosing the statement being parsed (empty for unlabeled loops), innermost last
+    std::vector<std::string> loopLabels;
+    // Label in front of the loop being parsed
+    std::string pendingLabel;
+    
+    // Parse the body of a loop, with the loop open to the break and continue statements in it
+    std::vector<ASTNode*> parseLoopBody();
+    
+    // Parse break or continue statement
+    Statement* parseJumpStatement();
+    
     // Parse if statement
     Statement* parseIfStatement();
     
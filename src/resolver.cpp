@@ -0,0 +1,358 @@
+#include "resolver.h"
+
+// Resolve all functions, methods and lambdas of a program
+void Resolver::resolve(Program* program) {
+    if (program->resolved) {
+        return;
+    }
+    
+    for (auto decl : program->declarations) {
+        resolveDeclaration(decl);
+    }
+    
+    program->resolved = true;
+}
+
+// Resolve a top-level declaration (function, namespace or class)
+void Resolver::resolveDeclaration(ASTNode* decl) {
+    if (auto func = nodeCast<FunctionDeclaration>(decl)) {
+        resolveFunction(func);
+    } else if (auto ns = nodeCast<NamespaceDeclaration>(decl)) {
+        for (auto nested : ns->declarations) {
+            resolveDeclaration(nested);
+        }
+    } else if (auto cls = nodeCast<ClassDeclaration>(decl)) {
+        for (auto method : cls->methods) {
+            resolveDeclaration(method);
+        }
+        for (auto method : cls->instanceMethods) {
+            resolveDeclaration(method);
+        }
+        if (cls->initMethod) {
+            resolveDeclaration(cls->initMethod);
+        }
+    }
+}
+
+// Resolve a function or method body in a fresh scope
+void Resolver::resolveFunction(FunctionDeclaration* func) {
+    func->layout = FrameLayout();
+    scopes.push_back(Scope{&func->layout, {}, {}});
+    
+    // Parameters occupy the first slots
+    for (const auto& param : func->parameters) {
+        declare(param.name);
+    }
+    
+    // Instance methods receive the instance implicitly
+    if (nodeCast<InstanceMethodDeclaration>(func)) {
+        func->layout.instanceSlot = declare("instance");
+        func->layout.thisSlot = declare("this");
+    }
+    
+    declareBody(func->body);
+    resolveBody(func->body);
+    markTailCalls(func->body);
+    
+    scopes.pop_back();
+}
+
+// Resolve a lambda body in a fresh scope
+void Resolver::resolveLambda(LambdaExpression* lambda) {
+    lambda->layout = FrameLayout();
+    scopes.push_back(Scope{&lambda->layout, {}, {}});
+    
+    for (const auto& param : lambda->parameters) {
+        declare(param.name);
+    }
+    
+    resolveExpression(lambda->body);
+    
+    scopes.pop_back();
+}
+
+// Declare a name in the innermost scope and return its slot
+int Resolver::declare(const std::string& name, bool isImmut) {
+    Scope& scope = scopes.back();
+    auto it = scope.slots.find(name);
+    if (it != scope.slots.end()) {
+        if (isImmut) {
+            scope.immutSlots[it->second] = true;
+        }
+        return it->second;
+    }
+    
+    int slot = scope.layout->frameSize++;
+    scope.slots[name] = slot;
+    scope.immutSlots.push_back(isImmut);
+    scope.layout->slotNames.push_back(name);
+    return slot;
+}
+
+// Find a name in the innermost scope, or capture it from an enclosing one
+// Returns false for globals
+bool Resolver::lookup(const std::string& name, int& slot, int& upvalue, bool& isImmut) {
+    if (scopes.empty()) {
+        return false;
+    }
+    
+    Scope& scope = scopes.back();
+    auto it = scope.slots.find(name);
+    if (it != scope.slots.end()) {
+        slot = it->second;
+        upvalue = -1;
+        isImmut = scope.immutSlots[slot];
+        return true;
+    }
+    
+    int index = resolveUpvalue(scopes.size() - 1, name, isImmut);
+    if (index < 0) {
+        return false;
+    }
+    slot = -1;
+    upvalue = index;
+    return true;
+}
+
+// Capture a name of the scopes enclosing scopes[index] as one of its upvalues (-1 for globals)
+// Names found further out are threaded through the upvalues of every scope in between
+int Resolver::resolveUpvalue(size_t index, const std::string& name, bool& isImmut) {
+    if (index == 0) {
+        return -1;
+    }
+    
+    Scope& enclosing = scopes[index - 1];
+    auto it = enclosing.slots.find(name);
+    if (it != enclosing.slots.end()) {
+        isImmut = enclosing.immutSlots[it->second];
+        return addUpvalue(scopes[index], name, true, it->second);
+    }
+    
+    int outer = resolveUpvalue(index - 1, name, isImmut);
+    if (outer < 0) {
+        return -1;
+    }
+    return addUpvalue(scopes[index], name, false, outer);
+}
+
+int Resolver::addUpvalue(Scope& scope, const std::string& name, bool fromEnclosingSlot, int index) {
+    auto& upvalues = scope.layout->upvalues;
+    for (size_t i = 0; i < upvalues.size(); ++i) {
+        if (upvalues[i].fromEnclosingSlot == fromEnclosingSlot && upvalues[i].index == index) {
+            return static_cast<int>(i);
+        }
+    }
+    upvalues.push_back(UpvalueDescriptor{name, fromEnclosingSlot, index});
+    return static_cast<int>(upvalues.size()) - 1;
+}
+
+// Resolve the {name} references of a format string, capturing them when they are upvalues
+void Resolver::resolveFormatString(StringLiteral* literal) {
+    for (auto& segment : literal->segments) {
+        if (segment.variable) {
+            resolveExpression(segment.variable);
+        }
+    }
+}
+
+// First pass: declare every local introduced by a statement list
+void Resolver::declareBody(const std::vector<ASTNode*>& body) {
+    for (auto stmt : body) {
+        declareStatement(stmt);
+    }
+}
+
+void Resolver::declareStatement(ASTNode* stmt) {
+    if (!stmt) {
+        return;
+    }
+    
+    if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+        declare(varDecl->name, varDecl->isImmut);
+    } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+        declareBody(ifStmt->ifBody);
+        for (auto elseIf : ifStmt->elseIfs) {
+            declareStatement(elseIf);
+        }
+        declareBody(ifStmt->elseBody);
+    } else if (auto forLoopStmt = nodeCast<ForLoopStatement>(stmt)) {
+        declareStatement(forLoopStmt->initialization);
+        declareBody(forLoopStmt->body);
+    } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+        declare(forInStmt->keyVariableName);
+        if (forInStmt->isKeyValuePair) {
+            declare(forInStmt->valueVariableName);
+        }
+        declareBody(forInStmt->body);
+    } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
+        declareBody(whileStmt->body);
+    } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
+        declareBody(doWhileStmt->body);
+    } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
+        for (auto caseStmt : switchStmt->cases) {
+            declareBody(caseStmt->body);
+        }
+    } else if (auto tryHappenStmt = nodeCast<TryHappenStatement>(stmt)) {
+        declareBody(tryHappenStmt->tryBody);
+        declare(tryHappenStmt->errorVariableName);
+        declareBody(tryHappenStmt->happenBody);
+    } else if (auto funcDecl = nodeCast<FunctionDeclaration>(stmt)) {
+        // Nested functions are bound to a local slot of the enclosing frame
+        declare(funcDecl->name);
+    }
+}
+
+// Second pass: resolve names used by statements and expressions
+void Resolver::resolveBody(const std::vector<ASTNode*>& body) {
+    for (auto stmt : body) {
+        resolveStatement(stmt);
+    }
+}
+
+void Resolver::resolveStatement(ASTNode* stmt) {
+    if (!stmt) {
+        return;
+    }
+    
+    int slot = -1;
+    int upvalue = -1;
+    bool isImmut = false;
+    
+    if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
+        resolveExpression(exprStmt->expression);
+    } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+        resolveExpression(varDecl->initializer);
+        if (lookup(varDecl->name, slot, upvalue, isImmut) && slot >= 0) {
+            varDecl->slot = slot;
+        }
+    } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+        resolveExpression(ifStmt->condition);
+        resolveBody(ifStmt->ifBody);
+        for (auto elseIf : ifStmt->elseIfs) {
+            resolveStatement(elseIf);
+        }
+        resolveBody(ifStmt->elseBody);
+    } else if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
+        resolveExpression(returnStmt->expression);
+    } else if (auto forLoopStmt = nodeCast<ForLoopStatement>(stmt)) {
+        resolveStatement(forLoopStmt->initialization);
+        resolveExpression(forLoopStmt->condition);
+        resolveExpression(forLoopStmt->increment);
+        resolveBody(forLoopStmt->body);
+    } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+        resolveExpression(forInStmt->collection);
+        if (lookup(forInStmt->keyVariableName, slot, upvalue, isImmut) && slot >= 0) {
+            forInStmt->keySlot = slot;
+            if (isImmut) {
+                forInStmt->boundConstant = forInStmt->keyVariableName;
+            }
+        }
+        if (forInStmt->isKeyValuePair && lookup(forInStmt->valueVariableName, slot, upvalue, isImmut) && slot >= 0) {
+            forInStmt->valueSlot = slot;
+            if (isImmut) {
+                forInStmt->boundConstant = forInStmt->valueVariableName;
+            }
+        }
+        resolveBody(forInStmt->body);
+    } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
+        resolveExpression(whileStmt->condition);
+        resolveBody(whileStmt->body);
+    } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
+        resolveBody(doWhileStmt->body);
+        resolveExpression(doWhileStmt->condition);
+    } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
+        resolveExpression(switchStmt->expression);
+        for (auto caseStmt : switchStmt->cases) {
+            resolveExpression(caseStmt->value);
+            resolveBody(caseStmt->body);
+        }
+    } else if (auto tryHappenStmt = nodeCast<TryHappenStatement>(stmt)) {
+        resolveBody(tryHappenStmt->tryBody);
+        if (lookup(tryHappenStmt->errorVariableName, slot, upvalue, isImmut) && slot >= 0) {
+            tryHappenStmt->errorSlot = slot;
+        }
+        resolveBody(tryHappenStmt->happenBody);
+    } else if (auto funcDecl = nodeCast<FunctionDeclaration>(stmt)) {
+        if (lookup(funcDecl->name, slot, upvalue, isImmut) && slot >= 0) {
+            funcDecl->slot = slot;
+        }
+        resolveFunction(funcDecl);
+    }
+}
+
+void Resolver::resolveExpression(Expression* expr) {
+    if (!expr) {
+        return;
+    }
+    
+    if (auto ident = nodeCast<Identifier>(expr)) {
+        lookup(ident->name, ident->slot, ident->upvalue, ident->isImmut);
+    } else if (auto funcCall = nodeCast<FunctionCall>(expr)) {
+        bool isImmut = false;
+        if (funcCall->objectName.empty()) {
+            lookup(funcCall->methodName, funcCall->slot, funcCall->upvalue, isImmut);
+        } else {
+            lookup(funcCall->objectName, funcCall->objectSlot, funcCall->objectUpvalue, isImmut);
+        }
+        for (auto arg : funcCall->arguments) {
+            resolveExpression(arg);
+        }
+    } else if (auto funcCallExpr = nodeCast<FunctionCallExpression>(expr)) {
+        resolveExpression(funcCallExpr->callee);
+        for (auto arg : funcCallExpr->arguments) {
+            resolveExpression(arg);
+        }
+    } else if (auto assignExpr = nodeCast<AssignmentExpression>(expr)) {
+        resolveExpression(assignExpr->left);
+        resolveExpression(assignExpr->right);
+    } else if (auto binaryExpr = nodeCast<BinaryExpression>(expr)) {
+        resolveExpression(binaryExpr->left);
+        resolveExpression(binaryExpr->right);
+    } else if (auto indexAccess = nodeCast<IndexAccessExpression>(expr)) {
+        resolveExpression(indexAccess->collection);
+        resolveExpression(indexAccess->index);
+    } else if (auto instanceCreation = nodeCast<InstanceCreationExpression>(expr)) {
+        for (auto arg : instanceCreation->arguments) {
+            resolveExpression(arg);
+        }
+    } else if (auto instanceAccess = nodeCast<InstanceAccessExpression>(expr)) {
+        resolveExpression(instanceAccess->instance);
+    } else if (auto listLit = nodeCast<ListLiteral>(expr)) {
+        for (auto elem : listLit->elements) {
+            resolveExpression(elem);
+        }
+    } else if (auto hashMapLit = nodeCast<HashMapLiteral>(expr)) {
+        for (auto entry : hashMapLit->entries) {
+            resolveExpression(entry->key);
+            resolveExpression(entry->value);
+        }
+    } else if (auto rangeExpr = nodeCast<RangeExpression>(expr)) {
+        resolveExpression(rangeExpr->start);
+        resolveExpression(rangeExpr->end);
+        resolveExpression(rangeExpr->step);
+    } else if (auto lambdaExpr = nodeCast<LambdaExpression>(expr)) {
+        resolveLambda(lambdaExpr);
+    } else if (auto stringLit = nodeCast<StringLiteral>(expr)) {
+        if (stringLit->type == "format") {
+            resolveFormatString(stringLit);
+        }
+    }
+}
+
+// Mark returns of plain calls that end the function, directly or through if branches
+// Returns inside loops, switches and try bodies only complete those statements
+void Resolver::markTailCalls(const std::vector<ASTNode*>& body) {
+    for (auto stmt : body) {
+        if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
+            auto call = nodeCast<FunctionCall>(returnStmt->expression);
+            returnStmt->tailCall = call && call->objectName.empty();
+        } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+            markTailCalls(ifStmt->ifBody);
+            for (auto elseIf : ifStmt->elseIfs) {
+                markTailCalls(elseIf->ifBody);
+                markTailCalls(elseIf->elseBody);
+            }
+            markTailCalls(ifStmt->elseBody);
+        }
+    }
+}
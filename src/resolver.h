@@ -0,0 +1,63 @@
+#ifndef VANCTION_RESOLVER_H
+#define VANCTION_RESOLVER_H
+
+#include "../include/ast.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Resolver pass: assigns every local variable a slot in its function's frame
+// and annotates identifiers with a slot or upvalue index so the interpreter never
+// copies or searches whole variable environments at call time
+class Resolver {
+public:
+    // Resolve all functions, methods and lambdas of a program
+    void resolve(Program* program);
+
+private:
+    // Lexical scope of one function or lambda body
+    struct Scope {
+        FrameLayout* layout;
+        std::map<std::string, int> slots;
+        std::vector<bool> immutSlots;
+    };
+    
+    std::vector<Scope> scopes;
+    
+    // Resolve a top-level declaration (function, namespace or class)
+    void resolveDeclaration(ASTNode* decl);
+    
+    // Resolve a function or method body in a fresh scope
+    void resolveFunction(FunctionDeclaration* func);
+    
+    // Resolve a lambda body in a fresh scope
+    void resolveLambda(LambdaExpression* lambda);
+    
+    // Declare a name in the innermost scope and return its slot
+    int declare(const std::string& name, bool isImmut = false);
+    
+    // Find a name in the innermost scope, or capture it from an enclosing one
+    // Returns false for globals
+    bool lookup(const std::string& name, int& slot, int& upvalue, bool& isImmut);
+    
+    // Capture a name of the scopes enclosing scopes[index] as one of its upvalues (-1 for globals)
+    int resolveUpvalue(size_t index, const std::string& name, bool& isImmut);
+    int addUpvalue(Scope& scope, const std::string& name, bool fromEnclosingSlot, int index);
+    
+    // Resolve the variables a format string refers to
+    void resolveFormatString(StringLiteral* literal);
+    
+    // First pass: declare every local introduced by a statement list
+    void declareBody(const std::vector<ASTNode*>& body);
+    void declareStatement(ASTNode* stmt);
+    
+    // Second pass: resolve names used by statements and expressions
+    void resolveBody(const std::vector<ASTNode*>& body);
+    void resolveStatement(ASTNode* stmt);
+    void resolveExpression(Expression* expr);
+    
+    // Mark returns of plain calls that end the function, directly or through if branches
+    void markTailCalls(const std::vector<ASTNode*>& body);
+};
+
+#endif // VANCTION_RESOLVER_H
@@ -0,0 +1,760 @@
+#ifndef VANCTION_RUNTIME_H
+#define VANCTION_RUNTIME_H
+
+#include "../include/ast.h"
+#include "error.h"
+#include "gc.h"
+#include "value.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+
+// Hidden class of an instance: the slot of every field, in the order the fields were added
+// Instances of a class that add the same fields in the same order share one shape
+struct Shape {
+    std::unordered_map<std::string, int> offsets;
+    std::unordered_map<std::string, Shape*> transitions;
+    
+    // Slot of a field, -1 when the shape has no such field
+    int offsetOf(const std::string& name) const {
+        auto it = offsets.find(name);
+        return it != offsets.end() ? it->second : -1;
+    }
+    
+    // Shape after adding a field, created on first use and shared afterwards
+    Shape* withField(const std::string& name) {
+        auto it = transitions.find(name);
+        if (it != transitions.end()) {
+            return it->second;
+        }
+        Shape* next = new Shape();
+        next->offsets = offsets;
+        next->offsets.emplace(name, static_cast<int>(offsets.size()));
+        transitions.emplace(name, next);
+        return next;
+    }
+};
+
+// Class definition structure
+struct ClassDefinition {
+    std::string name;
+    std::string baseClassName;
+    std::vector<InstanceMethodDeclaration*> instanceMethods;
+    std::vector<ClassMethodDeclaration*> classMethods;
+    InstanceMethodDeclaration* initMethod;
+    
+    // Dispatch tables by method name; instance methods include inherited ones
+    // The instance table is rebuilt when it is older than the class epoch
+    std::unordered_map<std::string, InstanceMethodDeclaration*> methodTable;
+    std::unordered_map<std::string, ClassMethodDeclaration*> classMethodTable;
+    unsigned methodTableEpoch = 0;
+    
+    // Shape of new instances, before any field is assigned
+    Shape* rootShape = new Shape();
+};
+
+// Bumped by every class declaration, invalidating method tables and inline caches
+extern unsigned classEpoch;
+
+// List data structure implementation
+// Lists whose elements all have the same primitive type (int, double or bool) keep them
+// in a packed array of that type; the first element of another type converts the list
+// to generic value storage for good
+class List {
+public:
+    enum class Storage : unsigned char {
+        Empty,
+        Int,
+        Double,
+        Bool,
+        Generic
+    };
+    
+    List() {}
+    
+    // Add element to list
+    void add(const Value& element) {
+        switch (kind) {
+            case Storage::Empty:
+                kind = packedStorageOf(element);
+                add(element);
+                return;
+            case Storage::Int:
+                if (element.isInt()) {
+                    ints.push_back(element.asInt());
+                    return;
+                }
+                break;
+            case Storage::Double:
+                if (element.isDouble()) {
+                    doubles.push_back(element.asDouble());
+                    return;
+                }
+                break;
+            case Storage::Bool:
+                if (element.isBool()) {
+                    bools.push_back(element.asBool());
+                    return;
+                }
+                break;
+            case Storage::Generic:
+                elements.push_back(element);
+                return;
+        }
+        generalize();
+        elements.push_back(element);
+    }
+    
+    // Get element by index (supports negative indices)
+    Value get(int index) const {
+        if (index < 0) {
+            index = size() + index;
+        }
+        if (index < 0 || index >= size()) {
+                throw vanction_error::ListIndexError("List index out of range", 0, 0);
+            }
+        return at(index);
+    }
+    
+    // Set element by index (supports negative indices)
+    void set(int index, const Value& element) {
+        if (index < 0) {
+            index = size() + index;
+        }
+        if (index < 0 || index >= size()) {
+                throw vanction_error::ListIndexError("List index out of range", 0, 0);
+            }
+        switch (kind) {
+            case Storage::Int:
+                if (element.isInt()) {
+                    ints[index] = element.asInt();
+                    return;
+                }
+                break;
+            case Storage::Double:
+                if (element.isDouble()) {
+                    doubles[index] = element.asDouble();
+                    return;
+                }
+                break;
+            case Storage::Bool:
+                if (element.isBool()) {
+                    bools[index] = element.asBool();
+                    return;
+                }
+                break;
+            default:
+                break;
+        }
+        generalize();
+        elements[index] = element;
+    }
+    
+    // Element at an index already known to be in range
+    Value at(size_t index) const {
+        switch (kind) {
+            case Storage::Int: return ints[index];
+            case Storage::Double: return doubles[index];
+            case Storage::Bool: return bools[index] != 0;
+            default: return elements[index];
+        }
+    }
+    
+    // Get list size
+    int size() const {
+        switch (kind) {
+            case Storage::Int: return static_cast<int>(ints.size());
+            case Storage::Double: return static_cast<int>(doubles.size());
+            case Storage::Bool: return static_cast<int>(bools.size());
+            default: return static_cast<int>(elements.size());
+        }
+    }
+    
+    Storage storage() const {
+        return kind;
+    }
+    
+    // Elements of a generic list (empty while the list is packed)
+    const std::vector<Value>& values() const {
+        return elements;
+    }
+    
+    // Packed elements (empty unless the list has that storage)
+    const std::vector<int>& intElements() const {
+        return ints;
+    }
+    
+    const std::vector<double>& doubleElements() const {
+        return doubles;
+    }
+    
+    // Fill an empty list with packed elements
+    void assign(std::vector<int> values) {
+        kind = values.empty() ? Storage::Empty : Storage::Int;
+        ints = std::move(values);
+    }
+    
+    void assign(std::vector<double> values) {
+        kind = values.empty() ? Storage::Empty : Storage::Double;
+        doubles = std::move(values);
+    }
+    
+    // Bytes of element storage owned by the list
+    size_t storageBytes() const {
+        return ints.capacity() * sizeof(int) + doubles.capacity() * sizeof(double)
+            + bools.capacity() + elements.capacity() * sizeof(Value);
+    }
+
+private:
+    Storage kind = Storage::Empty;
+    std::vector<int> ints;
+    std::vector<double> doubles;
+    std::vector<unsigned char> bools;
+    std::vector<Value> elements;
+    
+    static Storage packedStorageOf(const Value& element) {
+        switch (element.type()) {
+            case ValueType::Int: return Storage::Int;
+            case ValueType::Double: return Storage::Double;
+            case ValueType::Bool: return Storage::Bool;
+            default: return Storage::Generic;
+        }
+    }
+    
+    // Move packed elements into generic value storage
+    void generalize() {
+        std::vector<Value> values;
+        values.reserve(size() + 1);
+        for (int i = 0; i < size(); ++i) {
+            values.push_back(at(i));
+        }
+        std::vector<int>().swap(ints);
+        std::vector<double>().swap(doubles);
+        std::vector<unsigned char>().swap(bools);
+        kind = Storage::Generic;
+        elements = std::move(values);
+    }
+};
+
+// HashMap data structure implementation
+// Open-addressing table keyed by values (strings, numbers, chars and bools) that iterates
+// in insertion order: entries are stored densely in insertion order, and a power-of-two
+// bucket array indexes them with Robin Hood linear probing
+class HashMap {
+public:
+    struct Entry {
+        Value key;      // nil for removed entries
+        Value value;
+        size_t hash;
+    };
+    
+    HashMap() {}
+    
+    // Entries in insertion order, including removed ones (nil key) until the map is compacted
+    std::vector<Entry> entries;
+    
+    // Whether a value can be used as a key
+    static bool isHashable(const Value& key) {
+        switch (key.type()) {
+            case ValueType::Int:
+            case ValueType::Char:
+            case ValueType::Bool:
+            case ValueType::Float:
+            case ValueType::Double:
+            case ValueType::String:
+                return true;
+            default:
+                return false;
+        }
+    }
+    
+    // Get value by key with default support
+    Value get(const Value& key, Value defaultValue = std::monostate{}) {
+        int entry = find(key, hashOf(key));
+        return entry >= 0 ? entries[entry].value : defaultValue;
+    }
+    
+    // Set value by key
+    void set(const Value& key, Value value) {
+        size_t hash = hashOf(key);
+        int entry = find(key, hash);
+        if (entry >= 0) {
+            entries[entry].value = std::move(value);
+            return;
+        }
+        if ((count + 1) * 4 > buckets.size() * 3) {
+            rehash(buckets.empty() ? 8 : buckets.size() * 2);
+        }
+        entries.push_back(Entry{key, std::move(value), hash});
+        insertBucket(static_cast<int>(entries.size()) - 1, hash);
+        ++count;
+    }
+    
+    // Remove a key, returns false when it was not present
+    bool remove(const Value& key) {
+        size_t hash = hashOf(key);
+        if (buckets.empty()) {
+            return false;
+        }
+        
+        size_t mask = buckets.size() - 1;
+        size_t pos = hash & mask;
+        for (size_t distance = 0;; ++distance, pos = (pos + 1) & mask) {
+            const Bucket& bucket = buckets[pos];
+            if (bucket.entry < 0 || probeDistance(bucket, pos) < distance) {
+                return false;
+            }
+            if (bucket.hash == static_cast<uint32_t>(hash) && keysEqual(entries[bucket.entry].key, key)) {
+                break;
+            }
+        }
+        
+        Entry& entry = entries[buckets[pos].entry];
+        entry.key = std::monostate{};
+        entry.value = std::monostate{};
+        --count;
+        ++removed;
+        
+        // Backward-shift the following buckets so probes never need tombstones
+        size_t next = (pos + 1) & mask;
+        while (buckets[next].entry >= 0 && probeDistance(buckets[next], next) > 0) {
+            buckets[pos] = buckets[next];
+            pos = next;
+            next = (next + 1) & mask;
+        }
+        buckets[pos].entry = -1;
+        
+        // Drop removed entries once they outnumber the live ones
+        if (removed > count) {
+            compact();
+        }
+        return true;
+    }
+    
+    // Make room for at least n entries without rehashing
+    void reserve(size_t n) {
+        entries.reserve(n);
+        size_t size = buckets.empty() ? 8 : buckets.size();
+        while (n * 4 > size * 3) {
+            size *= 2;
+        }
+        if (size > buckets.size()) {
+            rehash(size);
+        }
+    }
+    
+    // Number of keys
+    int size() const {
+        return static_cast<int>(count);
+    }
+    
+    // Bytes allocated for entries and buckets
+    size_t storageBytes() const {
+        return entries.capacity() * sizeof(Entry) + buckets.capacity() * sizeof(Bucket);
+    }
+    
+    // Get all keys as List
+    List* keys() {
+        List* keyList = heap.newList();
+        for (auto& entry : entries) {
+            if (!entry.key.isNil()) {
+                keyList->add(entry.key);
+            }
+        }
+        return keyList;
+    }
+    
+    // Get all values as List
+    List* values() {
+        List* valueList = heap.newList();
+        for (auto& entry : entries) {
+            if (!entry.key.isNil()) {
+                valueList->add(entry.value);
+            }
+        }
+        return valueList;
+    }
+
+private:
+    // Index of an entry and the low bits of its hash, compared before touching the entry
+    struct Bucket {
+        int32_t entry;
+        uint32_t hash;
+    };
+    
+    std::vector<Bucket> buckets;
+    size_t count = 0;
+    size_t removed = 0;
+    
+    static size_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+    
+    static size_t hashOf(const Value& key) {
+        switch (key.type()) {
+            case ValueType::Int:
+                return mix(static_cast<uint32_t>(key.asInt()));
+            case ValueType::Char:
+                return mix((1ULL << 40) | static_cast<unsigned char>(key.asChar()));
+            case ValueType::Bool:
+                return mix((2ULL << 40) | key.asBool());
+            case ValueType::Float:
+                return std::hash<float>()(key.asFloat());
+            case ValueType::Double:
+                return std::hash<double>()(key.asDouble());
+            case ValueType::String:
+                return key.stringHash();
+            default:
+                throw vanction_error::TypeError("HashMap key must be a string, number, char or bool");
+        }
+    }
+    
+    static bool keysEqual(const Value& a, const Value& b) {
+        if (a.type() != b.type()) {
+            return false;
+        }
+        switch (a.type()) {
+            case ValueType::Int: return a.asInt() == b.asInt();
+            case ValueType::Char: return a.asChar() == b.asChar();
+            case ValueType::Bool: return a.asBool() == b.asBool();
+            case ValueType::Float: return a.asFloat() == b.asFloat();
+            case ValueType::Double: return a.asDouble() == b.asDouble();
+            case ValueType::String: return a.asString() == b.asString();
+            default: return false;
+        }
+    }
+    
+    // Distance of a bucket from the position its hash prefers
+    size_t probeDistance(const Bucket& bucket, size_t pos) const {
+        return (pos - (bucket.hash & (buckets.size() - 1))) & (buckets.size() - 1);
+    }
+    
+    // Entry index of a key, -1 when absent
+    int find(const Value& key, size_t hash) const {
+        if (buckets.empty()) {
+            return -1;
+        }
+        size_t mask = buckets.size() - 1;
+        size_t pos = hash & mask;
+        for (size_t distance = 0;; ++distance, pos = (pos + 1) & mask) {
+            const Bucket& bucket = buckets[pos];
+            // A richer bucket than the probe means the key would have been placed before it
+            if (bucket.entry < 0 || probeDistance(bucket, pos) < distance) {
+                return -1;
+            }
+            if (bucket.hash == static_cast<uint32_t>(hash) && keysEqual(entries[bucket.entry].key, key)) {
+                return bucket.entry;
+            }
+        }
+    }
+    
+    void insertBucket(int entry, size_t hash) {
+        Bucket incoming{entry, static_cast<uint32_t>(hash)};
+        size_t mask = buckets.size() - 1;
+        size_t pos = hash & mask;
+        for (size_t distance = 0;; ++distance, pos = (pos + 1) & mask) {
+            Bucket& bucket = buckets[pos];
+            if (bucket.entry < 0) {
+                bucket = incoming;
+                return;
+            }
+            // Robin Hood: the entry further from its preferred bucket takes the slot
+            size_t existing = probeDistance(bucket, pos);
+            if (existing < distance) {
+                std::swap(bucket, incoming);
+                distance = existing;
+            }
+        }
+    }
+    
+    void rehash(size_t size) {
+        buckets.assign(size, Bucket{-1, 0});
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!entries[i].key.isNil()) {
+                insertBucket(static_cast<int>(i), entries[i].hash);
+            }
+        }
+    }
+    
+    void compact() {
+        size_t live = 0;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!entries[i].key.isNil()) {
+                if (live != i) {
+                    entries[live] = std::move(entries[i]);
+                }
+                ++live;
+            }
+        }
+        entries.resize(live);
+        removed = 0;
+        rehash(buckets.size());
+    }
+};
+
+// Mutable text buffer for building long strings piece by piece
+// Appending is amortized O(1), so building a string costs time linear in its length
+class StringBuilder {
+public:
+    std::string buffer;
+    
+    void append(std::string_view text) {
+        buffer.append(text);
+    }
+};
+
+// Instance structure
+// Fields live in a contiguous array laid out by the instance's shape
+class Instance {
+public:
+    Instance(ClassDefinition* cls) : cls(cls), shape(cls->rootShape) {}
+    
+    ClassDefinition* cls;
+    Shape* shape;
+    std::vector<Value> fields;
+    
+    // Get a field by name (nullptr when the instance has no such field)
+    Value* getField(const std::string& name) {
+        int offset = shape->offsetOf(name);
+        return offset >= 0 ? &fields[offset] : nullptr;
+    }
+    
+    // Set a field by name, moving the instance to a new shape when the field is new
+    // Returns the slot of the field
+    int setField(const std::string& name, const Value& value) {
+        int offset = shape->offsetOf(name);
+        if (offset < 0) {
+            shape = shape->withField(name);
+            fields.push_back(value);
+            return static_cast<int>(fields.size()) - 1;
+        }
+        fields[offset] = value;
+        return offset;
+    }
+};
+
+// Type tags of variables (frame slots and globals), checked when a variable is assigned
+enum class SlotType : unsigned char {
+    None,       // No type recorded, assignments are not checked
+    Unknown,
+    Auto,
+    Function,
+    Int,
+    Char,
+    String,
+    Bool,
+    Float,
+    Double,
+    Instance,
+    List,
+    HashMap
+};
+
+// Variable captured by closures, shared by every closure that captured it
+// While the declaring frame runs the cell points at its slot (open); when the frame
+// returns the value moves into the cell itself (closed)
+struct Upvalue {
+    Value* location;
+    SlotType* type;
+    Value closed;
+    SlotType closedType;
+    Upvalue* nextOpen;
+    
+    Upvalue(Value* location, SlotType* type)
+        : location(location), type(type), closed(std::monostate{}), closedType(SlotType::None), nextOpen(nullptr) {}
+    
+    void close() {
+        closed = *location;
+        closedType = *type;
+        location = &closed;
+        type = &closedType;
+    }
+};
+
+// Function or lambda value: its code plus the upvalues captured when it was created
+struct Closure {
+    FunctionDeclaration* function;
+    LambdaExpression* lambda;
+    std::vector<Upvalue*> upvalues;
+    
+    Closure(FunctionDeclaration* function, LambdaExpression* lambda) : function(function), lambda(lambda) {}
+};
+
+inline Value::Value(Closure* value) {
+    setWord(value->lambda ? ValueType::Lambda : ValueType::Function);
+    storage.word.data.ptr = value;
+}
+
+// Every frame that currently exists, linked through Frame::nextLive (collector roots)
+extern Frame* liveFrames;
+
+// Activation record of a function or lambda call
+// Locals live in slots assigned by the resolver; captured variables are reached through closure
+struct Frame {
+    std::vector<Value> slots;
+    std::vector<SlotType> types;
+    Closure* closure;
+    const FrameLayout* layout;
+    // Upvalues still pointing into slots of this frame
+    Upvalue* openUpvalues;
+    Frame* prevLive;
+    Frame* nextLive;
+    
+    Frame(const FrameLayout* layout, Closure* closure, size_t minSlots = 0)
+        : slots(std::max(static_cast<size_t>(layout->frameSize), minSlots), Value(std::monostate{})),
+          types(slots.size(), SlotType::None), closure(closure), layout(layout), openUpvalues(nullptr),
+          prevLive(nullptr), nextLive(liveFrames) {
+        if (liveFrames) {
+            liveFrames->prevLive = this;
+        }
+        liveFrames = this;
+    }
+    
+    ~Frame() {
+        // Closures created by this call keep the captured values
+        for (Upvalue* upvalue = openUpvalues; upvalue; upvalue = upvalue->nextOpen) {
+            upvalue->close();
+        }
+        
+        if (prevLive) {
+            prevLive->nextLive = nextLive;
+        } else {
+            liveFrames = nextLive;
+        }
+        if (nextLive) {
+            nextLive->prevLive = prevLive;
+        }
+    }
+    
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+};
+
+// Frame of the function currently being executed (nullptr outside of functions)
+extern Frame* currentFrame;
+
+// Installs a frame as the current one for the duration of a call
+class FrameGuard {
+public:
+    explicit FrameGuard(Frame* frame) : saved(currentFrame) { currentFrame = frame; }
+    ~FrameGuard() { currentFrame = saved; }
+
+private:
+    Frame* saved;
+};
+
+// Counted for-in loop over range(start, end, step), with the bounds evaluated once before the loop
+// Int ranges are counted in 64 bits so bounds near the int limits still terminate,
+// a float or double bound makes it a floating-point range of the widest bound type
+struct RangeLoop {
+    ValueType type = ValueType::Int;
+    uint64_t count = 0;
+    int64_t start = 0;
+    int64_t step = 1;
+    double realStart = 0.0;
+    double realStep = 1.0;
+    
+    // Value of the loop variable in iteration index (index < count)
+    Value at(uint64_t index) const {
+        if (type == ValueType::Int) {
+            return static_cast<int>(start + static_cast<int64_t>(index) * step);
+        }
+        double value = realStart + static_cast<double>(index) * realStep;
+        return type == ValueType::Float ? Value(static_cast<float>(value)) : Value(value);
+    }
+};
+
+// Global environments
+extern std::map<std::string, Value> variables;
+extern std::map<std::string, Value> constants;
+extern std::map<std::string, FunctionDeclaration*> functions;
+
+// Callee and arguments of a call a function body ended with in tail position (empty when none is pending)
+// The body returns instead of making the call, and executeFunctionBody makes it afterwards
+extern std::vector<Value> pendingTailCall;
+extern bool debugMode;
+
+// Frame helpers
+Frame* enterFrame(std::optional<Frame>& storage, const FrameLayout& layout, Closure* closure, size_t minSlots = 0);
+Upvalue* upvalueAt(int index);
+Closure* makeClosure(FunctionDeclaration* function, LambdaExpression* lambda, const FrameLayout& layout);
+SlotType declaredTypeOf(const Value& value);
+void checkSlotAssignment(SlotType existingType, const Value& value);
+void storeVariable(int slot, const std::string& name, const Value& value);
+void checkLoopBinding(ForInLoopStatement* stmt);
+
+// Global entry an identifier or plain-name call refers to (nullptr when there is none),
+// cached on the quickened node
+Value* globalBinding(Identifier* ident);
+Value* globalCallee(FunctionCall* call);
+RangeLoop makeRangeLoop(const Value& start, const Value& end, const Value& step);
+
+// How a statement completed: normally, or by a return, break or continue skipping the rest of the
+// statements around it. Break and continue target the loop depth loops out from the innermost one
+enum class CompletionType : unsigned char {
+    Normal,
+    Return,
+    Break,
+    Continue
+};
+
+struct Completion {
+    CompletionType type = CompletionType::Normal;
+    int depth = 0;
+};
+
+// Error of a builtin call returned as its result instead of thrown, for a try in the frame making
+// the call: the VM and try bodies of the interpreter mark the call they check right after it runs,
+// so errors raised and handled in one frame (failed conversions) never unwind the C++ stack
+struct ErrorResult {
+    // Call whose errors are returned, and the frame it is made in
+    FunctionCall* call = nullptr;
+    Frame* frame = nullptr;
+    // Set when the call returned an error, cleared by the handler taking it
+    bool raised = false;
+    ErrorType type = ErrorType::UnknownError;
+    std::string message;
+};
+
+extern ErrorResult errorResult;
+
+// Marks a call as returning its errors while it runs, restoring the previous mark afterwards
+class ErrorResultScope {
+public:
+    explicit ErrorResultScope(FunctionCall* call) : previousCall(errorResult.call), previousFrame(errorResult.frame) {
+        errorResult.call = call;
+        errorResult.frame = currentFrame;
+    }
+    ~ErrorResultScope() {
+        errorResult.call = previousCall;
+        errorResult.frame = previousFrame;
+    }
+
+private:
+    FunctionCall* previousCall;
+    Frame* previousFrame;
+};
+
+// Raise an error of a builtin call: as its error result when the call is marked, by throwing otherwise
+Value raiseError(FunctionCall* call, ErrorType type, std::string_view message);
+
+// Tree-walking interpreter entry points
+Value executeStatement(ASTNode* stmt, Completion* completion = nullptr);
+Value executeExpression(Expression* expr);
+Value executeFunctionCall(FunctionCall* call);
+Value evaluateBinary(BinaryExpression* binaryExpr, const Value& leftVal, const Value& rightVal);
+void assignValue(Expression* target, const Value& value);
+Value callFunctionValue(Closure* closure, const Value* args, size_t argCount);
+Value callLambda(Closure* closure, const Value* args, size_t argCount);
+
+#endif // VANCTION_RUNTIME_H
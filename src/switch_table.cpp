@@ -0,0 +1,242 @@
+#include "switch_table.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+
+namespace {
+
+// Tables of all switch statements, alive as long as the program
+std::deque<std::unique_ptr<SwitchTable>> tables;
+
+// Largest jump table, in entries per label
+const int64_t denseFactor = 2;
+const int64_t denseSlack = 8;
+
+// Displacements tried for one bucket before the labels are compared in order instead
+const uint64_t maxDisplacement = 1 << 16;
+
+// 64-bit finalizer spreading the bits of a hash
+uint64_t mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t intHash(int value) {
+    return mix(static_cast<uint32_t>(value));
+}
+
+uint64_t slotOf(uint64_t hash, uint64_t displacement, uint64_t mask) {
+    return mix(hash ^ (displacement * 0x9e3779b97f4a7c15ULL)) & mask;
+}
+
+// Place every distinct label in a slot of its own (hash and displace)
+// Labels are identified by their first case; returns false when no placement was found
+bool buildPerfectHash(SwitchTable& table, const std::vector<int>& firstCases, const std::vector<uint64_t>& hashes) {
+    size_t count = firstCases.size();
+    
+    // Distinct labels with the same hash cannot be told apart by the table
+    std::vector<uint64_t> sorted = hashes;
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        return false;
+    }
+    
+    size_t slotCount = 2;
+    while (slotCount < count * 2) {
+        slotCount *= 2;
+    }
+    size_t bucketCount = (count + 3) / 4;
+    table.mask = slotCount - 1;
+    table.slots.assign(slotCount, -1);
+    table.displacements.assign(bucketCount, 0);
+    
+    // Fill the largest buckets first, while most slots are still free
+    std::vector<std::vector<size_t>> buckets(bucketCount);
+    for (size_t i = 0; i < count; i++) {
+        buckets[hashes[i] % bucketCount].push_back(i);
+    }
+    std::vector<size_t> order(bucketCount);
+    for (size_t b = 0; b < bucketCount; b++) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t x, size_t y) {
+        return buckets[x].size() > buckets[y].size();
+    });
+    
+    std::vector<uint64_t> placed;
+    for (size_t b : order) {
+        if (buckets[b].empty()) {
+            break;
+        }
+        bool found = false;
+        for (uint64_t displacement = 0; !found && displacement < maxDisplacement; displacement++) {
+            placed.clear();
+            found = true;
+            for (size_t label : buckets[b]) {
+                uint64_t slot = slotOf(hashes[label], displacement, table.mask);
+                if (table.slots[slot] >= 0 || std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+                    found = false;
+                    break;
+                }
+                placed.push_back(slot);
+            }
+            if (found) {
+                table.displacements[b] = displacement;
+                for (size_t i = 0; i < placed.size(); i++) {
+                    table.slots[placed[i]] = firstCases[buckets[b][i]];
+                }
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Slot a label hash lands in, with the case stored there (-1 when empty)
+int lookupSlot(const SwitchTable& table, uint64_t hash) {
+    uint64_t displacement = table.displacements[hash % table.displacements.size()];
+    return table.slots[slotOf(hash, displacement, table.mask)];
+}
+
+void buildTable(SwitchTable& table, SwitchStatement* stmt) {
+    const std::vector<CaseStatement*>& cases = stmt->cases;
+    if (cases.empty()) {
+        return;
+    }
+    
+    // Only literal labels of one type are dispatched without being evaluated
+    bool ints = true;
+    bool strings = true;
+    for (auto caseStmt : cases) {
+        auto stringLit = nodeCast<StringLiteral>(caseStmt->value);
+        ints = ints && nodeCast<IntegerLiteral>(caseStmt->value);
+        strings = strings && stringLit && stringLit->type != "format";
+    }
+    if (!ints && !strings) {
+        return;
+    }
+    
+    // Chain the cases of each label, and keep the first case of every distinct label
+    std::vector<int> firstCases;
+    table.next.assign(cases.size(), -1);
+    if (ints) {
+        std::map<int, int> last;
+        for (auto caseStmt : cases) {
+            table.intLabels.push_back(static_cast<IntegerLiteral*>(caseStmt->value)->value);
+        }
+        for (size_t i = 0; i < cases.size(); i++) {
+            auto it = last.find(table.intLabels[i]);
+            if (it != last.end()) {
+                table.next[it->second] = static_cast<int>(i);
+                it->second = static_cast<int>(i);
+            } else {
+                last[table.intLabels[i]] = static_cast<int>(i);
+                firstCases.push_back(static_cast<int>(i));
+            }
+        }
+    } else {
+        std::map<std::string, int> last;
+        for (auto caseStmt : cases) {
+            table.stringLabels.push_back(static_cast<StringLiteral*>(caseStmt->value)->value);
+        }
+        for (size_t i = 0; i < cases.size(); i++) {
+            auto it = last.find(table.stringLabels[i]);
+            if (it != last.end()) {
+                table.next[it->second] = static_cast<int>(i);
+                it->second = static_cast<int>(i);
+            } else {
+                last[table.stringLabels[i]] = static_cast<int>(i);
+                firstCases.push_back(static_cast<int>(i));
+            }
+        }
+    }
+    
+    std::vector<uint64_t> hashes;
+    if (ints) {
+        auto range = std::minmax_element(table.intLabels.begin(), table.intLabels.end());
+        int64_t span = static_cast<int64_t>(*range.second) - *range.first + 1;
+        if (span <= static_cast<int64_t>(firstCases.size()) * denseFactor + denseSlack) {
+            table.kind = SwitchTable::Kind::Dense;
+            table.base = *range.first;
+            table.jump.assign(static_cast<size_t>(span), -1);
+            for (int first : firstCases) {
+                table.jump[static_cast<size_t>(static_cast<int64_t>(table.intLabels[first]) - table.base)] = first;
+            }
+            return;
+        }
+        for (int first : firstCases) {
+            hashes.push_back(intHash(table.intLabels[first]));
+        }
+    } else {
+        for (int first : firstCases) {
+            hashes.push_back(labelHash(table.stringLabels[first]));
+        }
+    }
+    
+    if (buildPerfectHash(table, firstCases, hashes)) {
+        table.kind = ints ? SwitchTable::Kind::IntHash : SwitchTable::Kind::StringHash;
+    } else {
+        table.slots.clear();
+        table.displacements.clear();
+    }
+}
+
+} // namespace
+
+// Table of a switch statement, built on first use
+SwitchTable* switchTable(SwitchStatement* stmt) {
+    if (!stmt->table) {
+        tables.push_back(std::make_unique<SwitchTable>());
+        stmt->table = tables.back().get();
+        buildTable(*stmt->table, stmt);
+    }
+    return stmt->table;
+}
+
+// First case whose label matches the value, -1 when none does
+// Like the comparison of labels, only values of the label type match
+int findCase(const SwitchTable& table, const Value& value) {
+    switch (table.kind) {
+        case SwitchTable::Kind::Dense: {
+            if (!value.isInt()) {
+                return -1;
+            }
+            int64_t index = static_cast<int64_t>(value.asInt()) - table.base;
+            return index >= 0 && index < static_cast<int64_t>(table.jump.size()) ? table.jump[static_cast<size_t>(index)] : -1;
+        }
+        case SwitchTable::Kind::IntHash: {
+            if (!value.isInt()) {
+                return -1;
+            }
+            int found = lookupSlot(table, intHash(value.asInt()));
+            return found >= 0 && table.intLabels[found] == value.asInt() ? found : -1;
+        }
+        case SwitchTable::Kind::StringHash: {
+            if (!value.isString()) {
+                return -1;
+            }
+            std::string_view text = value.asString();
+            int found = lookupSlot(table, labelHash(text));
+            return found >= 0 && table.stringLabels[found] == text ? found : -1;
+        }
+        default:
+            return -1;
+    }
+}
+
+// Hash of a string label (64-bit FNV-1a)
+uint64_t labelHash(std::string_view text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,51 @@
+#ifndef VANCTION_SWITCH_TABLE_H
+#define VANCTION_SWITCH_TABLE_H
+
+#include "../include/ast.h"
+#include "value.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Case dispatch of a switch statement, shared by the interpreter, the VM and the code generator
+// When every case label is an int literal or every label is a string literal, the cases are found
+// without evaluating or comparing the labels: dense ints index a jump table, sparse ints and
+// strings a perfect hash table. Any other switch compares its labels in order on every run
+struct SwitchTable {
+    enum class Kind : unsigned char {
+        Dynamic,    // labels are evaluated and compared in order
+        Dense,      // jump[value - base]
+        IntHash,    // perfect hash of int labels
+        StringHash  // perfect hash of string labels
+    };
+    
+    Kind kind = Kind::Dynamic;
+    
+    // Dense: first case of each value from base on, -1 where no label matches
+    int base = 0;
+    std::vector<int> jump;
+    
+    // Hashed: the bucket of a label hash picks the displacement moving it to a slot of its own
+    std::vector<uint64_t> displacements;
+    std::vector<int> slots;  // first case of the label in each slot, -1 when empty
+    uint64_t mask = 0;
+    
+    // Label of each case
+    std::vector<int> intLabels;
+    std::vector<std::string> stringLabels;
+    
+    // Next case with the same label, -1 for the last one (every matching case runs, in order)
+    std::vector<int> next;
+};
+
+// Table of a switch statement, built on first use
+SwitchTable* switchTable(SwitchStatement* stmt);
+
+// First case whose label matches the value, -1 when none does (for tables other than Dynamic)
+int findCase(const SwitchTable& table, const Value& value);
+
+// Hash of a string label, also computed by the hashed dispatch of generated code (64-bit FNV-1a)
+uint64_t labelHash(std::string_view text);
+
+#endif // VANCTION_SWITCH_TABLE_H
@@ -0,0 +1,579 @@
+#include "type_inference.h"
+#include "list_ops.h"
+
+namespace {
+
+// Types the interpreters convert to numbers in arithmetic
+bool isNumeric(StaticType type) {
+    switch (type) {
+        case StaticType::Int:
+        case StaticType::Float:
+        case StaticType::Double:
+        case StaticType::Bool:
+        case StaticType::Char:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Result type of a binary operator, following evaluateBinary
+StaticType binaryType(BinaryOperator op, StaticType left, StaticType right) {
+    if (isComparison(op) || isLogical(op)) {
+        return StaticType::Bool;
+    }
+    
+    switch (op) {
+        case BinaryOperator::Add:
+            // Anything added to a string is concatenated
+            if (left == StaticType::String || right == StaticType::String) {
+                return StaticType::String;
+            }
+            break;
+        case BinaryOperator::Subtract:
+        case BinaryOperator::Multiply:
+        case BinaryOperator::Divide:
+        case BinaryOperator::Modulo:
+        case BinaryOperator::Power:
+        case BinaryOperator::ShiftLeft:
+        case BinaryOperator::ShiftRight:
+            break;
+        default:
+            return StaticType::Unknown;
+    }
+    
+    // Two ints stay an int, a float operand makes a float, anything else a double
+    if (!isNumeric(left) || !isNumeric(right)) {
+        return StaticType::Unknown;
+    }
+    if (left == StaticType::Int && right == StaticType::Int) {
+        return StaticType::Int;
+    }
+    if (left == StaticType::Float || right == StaticType::Float) {
+        return StaticType::Float;
+    }
+    return StaticType::Double;
+}
+
+// Range bound producing int counters (a missing step counts as 1)
+bool isIntBound(Expression* bound) {
+    return !bound || bound->staticType == StaticType::Int;
+}
+
+// Target of an index store or read: list[index]
+bool indexParts(Expression* expr, Expression*& collection, Expression*& index) {
+    if (auto binaryExpr = nodeCast<BinaryExpression>(expr)) {
+        if (binaryExpr->opcode != BinaryOperator::Index) {
+            return false;
+        }
+        collection = binaryExpr->left;
+        index = binaryExpr->right;
+        return true;
+    }
+    if (auto indexAccess = nodeCast<IndexAccessExpression>(expr)) {
+        collection = indexAccess->collection;
+        index = indexAccess->index;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// Annotate every function, method and lambda of a program
+void TypeInference::infer(Program* program) {
+    for (auto decl : program->declarations) {
+        inferDeclaration(decl);
+    }
+}
+
+// Infer a top-level declaration (function, namespace or class)
+void TypeInference::inferDeclaration(ASTNode* decl) {
+    if (auto func = nodeCast<FunctionDeclaration>(decl)) {
+        inferFunction(func);
+    } else if (auto ns = nodeCast<NamespaceDeclaration>(decl)) {
+        for (auto nested : ns->declarations) {
+            inferDeclaration(nested);
+        }
+    } else if (auto cls = nodeCast<ClassDeclaration>(decl)) {
+        for (auto method : cls->methods) {
+            inferDeclaration(method);
+        }
+        for (auto method : cls->instanceMethods) {
+            inferDeclaration(method);
+        }
+        if (cls->initMethod) {
+            inferDeclaration(cls->initMethod);
+        }
+    }
+}
+
+// Walk a function and everything nested in it until no proof is rejected
+// Every walk starts from the proofs that survived the previous one, so this ends
+// once each variable either keeps its type or has been rejected
+void TypeInference::inferFunction(FunctionDeclaration* func) {
+    do {
+        changed = false;
+        walkFunction(func);
+    } while (changed);
+}
+
+// Walk one function body in a fresh scope
+void TypeInference::walkFunction(FunctionDeclaration* func) {
+    scopes.emplace_back();
+    
+    for (const auto& param : func->parameters) {
+        scopes.back().variables[param.name].otherBindings++;
+    }
+    
+    // Instance methods receive the instance implicitly
+    if (nodeCast<InstanceMethodDeclaration>(func)) {
+        scopes.back().variables["instance"].otherBindings++;
+        scopes.back().variables["this"].otherBindings++;
+    }
+    
+    declareBody(func->body);
+    chooseCandidates(func->body);
+    
+    for (auto stmt : func->body) {
+        walkStatement(stmt);
+        
+        // A variable declared at the top level has its type in every later statement
+        if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+            Variable& var = scopes.back().variables[varDecl->name];
+            if (var.origin == varDecl) {
+                var.active = true;
+            }
+        }
+    }
+    
+    popScope();
+}
+
+// Walk one lambda body in a fresh scope
+void TypeInference::walkLambda(LambdaExpression* lambda) {
+    scopes.emplace_back();
+    
+    for (const auto& param : lambda->parameters) {
+        scopes.back().variables[param.name].otherBindings++;
+    }
+    
+    walkExpression(lambda->body);
+    
+    popScope();
+}
+
+// Record the locals of a body, the same names the resolver gives slots
+void TypeInference::declareBody(const std::vector<ASTNode*>& body) {
+    for (auto stmt : body) {
+        declareStatement(stmt);
+    }
+}
+
+void TypeInference::declareStatement(ASTNode* stmt) {
+    if (!stmt) {
+        return;
+    }
+    
+    auto& variables = scopes.back().variables;
+    if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+        variables[varDecl->name].declarations.push_back(varDecl);
+    } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+        declareBody(ifStmt->ifBody);
+        for (auto elseIf : ifStmt->elseIfs) {
+            declareStatement(elseIf);
+        }
+        declareBody(ifStmt->elseBody);
+    } else if (auto forLoopStmt = nodeCast<ForLoopStatement>(stmt)) {
+        declareStatement(forLoopStmt->initialization);
+        declareBody(forLoopStmt->body);
+    } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+        Variable& key = variables[forInStmt->keyVariableName];
+        key.otherBindings++;
+        key.loop = forInStmt;
+        if (forInStmt->isKeyValuePair) {
+            variables[forInStmt->valueVariableName].otherBindings++;
+        }
+        declareBody(forInStmt->body);
+    } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
+        declareBody(whileStmt->body);
+    } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
+        declareBody(doWhileStmt->body);
+    } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
+        for (auto caseStmt : switchStmt->cases) {
+            declareBody(caseStmt->body);
+        }
+    } else if (auto tryHappenStmt = nodeCast<TryHappenStatement>(stmt)) {
+        declareBody(tryHappenStmt->tryBody);
+        variables[tryHappenStmt->errorVariableName].otherBindings++;
+        declareBody(tryHappenStmt->happenBody);
+    } else if (auto funcDecl = nodeCast<FunctionDeclaration>(stmt)) {
+        variables[funcDecl->name].otherBindings++;
+    }
+}
+
+// Variables with a single binding can be typed: an initialized declaration at the top
+// level of the body, or the loop variable of a counted for-in loop
+void TypeInference::chooseCandidates(const std::vector<ASTNode*>& body) {
+    auto& variables = scopes.back().variables;
+    for (auto stmt : body) {
+        auto varDecl = nodeCast<VariableDeclaration>(stmt);
+        if (!varDecl || !varDecl->initializer || rejected.count(varDecl)) {
+            continue;
+        }
+        Variable& var = variables[varDecl->name];
+        if (var.declarations.size() == 1 && var.otherBindings == 0) {
+            var.origin = varDecl;
+        }
+    }
+    
+    for (auto& entry : variables) {
+        Variable& var = entry.second;
+        if (var.loop && !var.loop->isKeyValuePair && var.declarations.empty() && var.otherBindings == 1 &&
+            !rejected.count(var.loop)) {
+            var.origin = var.loop;
+        }
+    }
+}
+
+// Check the finished scope's proofs and annotate its assignments and declarations
+void TypeInference::popScope() {
+    for (auto& entry : scopes.back().variables) {
+        Variable& var = entry.second;
+        
+        // The proven type must survive every assignment
+        if (var.origin) {
+            for (const auto& assignment : var.assignments) {
+                if (assignment.second != var.type) {
+                    reject(var);
+                    break;
+                }
+            }
+        }
+        
+        // Slots are tagged with the type of their initializer, so an assignment passes the check
+        // when every declaration's initializer has the type of the assigned value
+        for (const auto& assignment : var.assignments) {
+            bool proven = assignment.second != StaticType::Unknown && var.otherBindings == 0;
+            for (auto varDecl : var.declarations) {
+                if (varDecl->isImmut || (varDecl->initializer && varDecl->initializer->staticType != assignment.second)) {
+                    proven = false;
+                }
+            }
+            assignment.first->typeProven = proven;
+        }
+        
+        // Lists built from a literal and only grown in place keep one element type
+        if (auto varDecl = nodeCast<VariableDeclaration>(var.origin)) {
+            if (var.type == StaticType::List && var.hasElements && !var.shared && var.assignments.empty() &&
+                nodeCast<ListLiteral>(varDecl->initializer)) {
+                varDecl->elementType = var.elementType;
+            }
+        }
+    }
+    
+    scopes.pop_back();
+}
+
+// Variable a name refers to (nullptr for globals)
+TypeInference::Variable* TypeInference::lookup(const std::string& name, bool& outer) {
+    for (size_t i = scopes.size(); i > 0; --i) {
+        auto it = scopes[i - 1].variables.find(name);
+        if (it != scopes[i - 1].variables.end()) {
+            outer = i != scopes.size();
+            return &it->second;
+        }
+    }
+    outer = false;
+    return nullptr;
+}
+
+void TypeInference::walkBody(const std::vector<ASTNode*>& body) {
+    for (auto stmt : body) {
+        walkStatement(stmt);
+    }
+}
+
+void TypeInference::walkStatement(ASTNode* stmt) {
+    if (!stmt) {
+        return;
+    }
+    
+    if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
+        walkExpression(exprStmt->expression);
+    } else if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+        StaticType type = walkExpression(varDecl->initializer);
+        varDecl->elementType = StaticType::Unknown;
+        
+        Variable& var = scopes.back().variables[varDecl->name];
+        if (var.origin == varDecl) {
+            if (type == StaticType::Unknown) {
+                reject(var);
+            } else {
+                var.type = type;
+            }
+            if (auto listLit = nodeCast<ListLiteral>(varDecl->initializer)) {
+                for (auto elem : listLit->elements) {
+                    addElement(var, elem->staticType);
+                }
+            }
+        }
+    } else if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+        walkExpression(ifStmt->condition);
+        walkBody(ifStmt->ifBody);
+        for (auto elseIf : ifStmt->elseIfs) {
+            walkStatement(elseIf);
+        }
+        walkBody(ifStmt->elseBody);
+    } else if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
+        walkExpression(returnStmt->expression);
+    } else if (auto forLoopStmt = nodeCast<ForLoopStatement>(stmt)) {
+        walkStatement(forLoopStmt->initialization);
+        walkExpression(forLoopStmt->condition);
+        walkExpression(forLoopStmt->increment);
+        walkBody(forLoopStmt->body);
+    } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+        walkForIn(forInStmt);
+    } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
+        walkExpression(whileStmt->condition);
+        walkBody(whileStmt->body);
+    } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
+        walkBody(doWhileStmt->body);
+        walkExpression(doWhileStmt->condition);
+    } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
+        walkExpression(switchStmt->expression);
+        for (auto caseStmt : switchStmt->cases) {
+            walkExpression(caseStmt->value);
+            walkBody(caseStmt->body);
+        }
+    } else if (auto tryHappenStmt = nodeCast<TryHappenStatement>(stmt)) {
+        walkBody(tryHappenStmt->tryBody);
+        walkBody(tryHappenStmt->happenBody);
+    } else if (auto funcDecl = nodeCast<FunctionDeclaration>(stmt)) {
+        walkFunction(funcDecl);
+    }
+}
+
+// The loop variable of range() with int bounds is an int inside the loop body
+// (after the loop it may be unset, when the range was empty)
+void TypeInference::walkForIn(ForInLoopStatement* stmt) {
+    walkOperand(stmt->collection);
+    
+    Variable& var = scopes.back().variables[stmt->keyVariableName];
+    bool counted = var.origin == stmt;
+    if (counted) {
+        auto range = nodeCast<RangeExpression>(stmt->collection);
+        if (range && isIntBound(range->start) && isIntBound(range->end) && isIntBound(range->step)) {
+            var.type = StaticType::Int;
+            var.active = true;
+        } else {
+            reject(var);
+            counted = false;
+        }
+    }
+    
+    walkBody(stmt->body);
+    
+    if (counted) {
+        var.active = false;
+    }
+}
+
+// Annotate an expression and its children, returning its type
+StaticType TypeInference::walkExpression(Expression* expr) {
+    if (!expr) {
+        return StaticType::Unknown;
+    }
+    expr->staticType = walkExpressionNode(expr);
+    return expr->staticType;
+}
+
+StaticType TypeInference::walkExpressionNode(Expression* expr) {
+    switch (expr->kind) {
+        case NodeKind::IntegerLiteral:
+            return StaticType::Int;
+        case NodeKind::FloatLiteral:
+            return StaticType::Float;
+        case NodeKind::DoubleLiteral:
+            return StaticType::Double;
+        case NodeKind::CharLiteral:
+            return StaticType::Char;
+        case NodeKind::BooleanLiteral:
+            return StaticType::Bool;
+        case NodeKind::StringLiteral: {
+            auto stringLit = static_cast<StringLiteral*>(expr);
+            for (auto& segment : stringLit->segments) {
+                if (segment.variable) {
+                    walkExpression(segment.variable);
+                }
+            }
+            return StaticType::String;
+        }
+        case NodeKind::Identifier:
+            return readVariable(static_cast<Identifier*>(expr), true);
+        case NodeKind::FunctionCall:
+            return walkCall(static_cast<FunctionCall*>(expr));
+        case NodeKind::AssignmentExpression:
+            return walkAssignment(static_cast<AssignmentExpression*>(expr));
+        case NodeKind::BinaryExpression: {
+            auto binaryExpr = static_cast<BinaryExpression*>(expr);
+            if (binaryExpr->opcode == BinaryOperator::Index) {
+                return walkIndex(binaryExpr->left, binaryExpr->right);
+            }
+            StaticType left = walkExpression(binaryExpr->left);
+            StaticType right = walkExpression(binaryExpr->right);
+            return binaryType(binaryExpr->opcode, left, right);
+        }
+        case NodeKind::IndexAccessExpression: {
+            auto indexAccess = static_cast<IndexAccessExpression*>(expr);
+            return walkIndex(indexAccess->collection, indexAccess->index);
+        }
+        case NodeKind::ListLiteral:
+            for (auto elem : static_cast<ListLiteral*>(expr)->elements) {
+                walkExpression(elem);
+            }
+            return StaticType::List;
+        case NodeKind::HashMapLiteral:
+            for (auto entry : static_cast<HashMapLiteral*>(expr)->entries) {
+                walkExpression(entry->key);
+                walkExpression(entry->value);
+            }
+            return StaticType::Unknown;
+        case NodeKind::RangeExpression: {
+            auto rangeExpr = static_cast<RangeExpression*>(expr);
+            walkExpression(rangeExpr->start);
+            walkExpression(rangeExpr->end);
+            walkExpression(rangeExpr->step);
+            return StaticType::Unknown;
+        }
+        case NodeKind::FunctionCallExpression: {
+            auto funcCallExpr = static_cast<FunctionCallExpression*>(expr);
+            walkExpression(funcCallExpr->callee);
+            for (auto arg : funcCallExpr->arguments) {
+                walkExpression(arg);
+            }
+            return StaticType::Unknown;
+        }
+        case NodeKind::InstanceCreationExpression:
+            for (auto arg : static_cast<InstanceCreationExpression*>(expr)->arguments) {
+                walkExpression(arg);
+            }
+            return StaticType::Unknown;
+        case NodeKind::InstanceAccessExpression:
+            walkExpression(static_cast<InstanceAccessExpression*>(expr)->instance);
+            return StaticType::Unknown;
+        case NodeKind::LambdaExpression:
+            walkLambda(static_cast<LambdaExpression*>(expr));
+            return StaticType::Unknown;
+        default:
+            return StaticType::Unknown;
+    }
+}
+
+// Operand that may name a list without sharing it (printed, indexed or iterated)
+StaticType TypeInference::walkOperand(Expression* expr) {
+    if (auto ident = nodeCast<Identifier>(expr)) {
+        ident->staticType = readVariable(ident, false);
+        return ident->staticType;
+    }
+    return walkExpression(expr);
+}
+
+StaticType TypeInference::readVariable(Identifier* ident, bool shares) {
+    bool outer = false;
+    Variable* var = lookup(ident->name, outer);
+    if (!var) {
+        // Global constants
+        return (ident->name == "true" || ident->name == "false") ? StaticType::Bool : StaticType::Unknown;
+    }
+    
+    if (shares || outer) {
+        var->shared = true;
+    }
+    return var->active ? var->type : StaticType::Unknown;
+}
+
+StaticType TypeInference::walkCall(FunctionCall* call) {
+    if (call->objectName == "System" && call->methodName == "print") {
+        for (auto arg : call->arguments) {
+            walkOperand(arg);
+        }
+        return StaticType::Unknown;
+    }
+    
+    bool outer = false;
+    Variable* var = lookup(call->objectName.empty() ? call->methodName : call->objectName, outer);
+    if (var) {
+        // list.add(value) grows the list in place, get() and the numeric operations only read it
+        if (call->objectName.empty() || outer) {
+            var->shared = true;
+        } else if (call->methodName == "add" && call->arguments.size() == 1) {
+            addElement(*var, walkExpression(call->arguments[0]));
+            return StaticType::Unknown;
+        } else if (call->methodName != "get" && !isListAggregate(call->methodName)) {
+            var->shared = true;
+        }
+    }
+    
+    for (auto arg : call->arguments) {
+        walkExpression(arg);
+    }
+    return StaticType::Unknown;
+}
+
+StaticType TypeInference::walkAssignment(AssignmentExpression* assign) {
+    StaticType type = walkExpression(assign->right);
+    
+    // The target keeps its annotation: compound assignments share it with their right side
+    Expression* collection = nullptr;
+    Expression* index = nullptr;
+    if (auto ident = nodeCast<Identifier>(assign->left)) {
+        bool outer = false;
+        if (Variable* var = lookup(ident->name, outer)) {
+            var->assignments.emplace_back(assign, type);
+            var->shared = true;
+        }
+    } else if (indexParts(assign->left, collection, index)) {
+        walkExpression(index);
+        auto ident = nodeCast<Identifier>(collection);
+        bool outer = false;
+        Variable* var = ident ? lookup(ident->name, outer) : nullptr;
+        if (var) {
+            if (outer) {
+                var->shared = true;
+            }
+            addElement(*var, type);
+        } else {
+            walkExpression(collection);
+        }
+    } else if (auto instanceAccess = nodeCast<InstanceAccessExpression>(assign->left)) {
+        walkExpression(instanceAccess->instance);
+    }
+    
+    assign->typeProven = false;
+    return type;
+}
+
+// Strings index to chars; list elements are not tracked per read
+StaticType TypeInference::walkIndex(Expression* collection, Expression* index) {
+    StaticType collectionType = walkOperand(collection);
+    walkExpression(index);
+    return collectionType == StaticType::String ? StaticType::Char : StaticType::Unknown;
+}
+
+void TypeInference::addElement(Variable& var, StaticType type) {
+    if (!var.hasElements) {
+        var.elementType = type;
+        var.hasElements = true;
+    } else if (var.elementType != type) {
+        var.elementType = StaticType::Unknown;
+    }
+}
+
+// Drop a variable's proof for this walk and every later one
+void TypeInference::reject(Variable& var) {
+    rejected.insert(var.origin);
+    var.origin = nullptr;
+    var.active = false;
+    changed = true;
+}
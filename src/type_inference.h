@@ -0,0 +1,99 @@
+#ifndef VANCTION_TYPE_INFERENCE_H
+#define VANCTION_TYPE_INFERENCE_H
+
+#include "../include/ast.h"
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Type inference pass: proves the types of local variables from their initializers and
+// assignments, and annotates the AST with what it proved
+// - Expression::staticType of expressions that always produce the same type
+// - AssignmentExpression::typeProven of assignments the runtime type check cannot reject
+// - VariableDeclaration::elementType of list variables holding a single element type
+// Inference is flow-based and local to each function: a variable has a type after its only
+// declaration, at the top level of the function body, as long as every assignment to it
+// (from lambdas too) stores that type; counted for-in loop variables are ints in the loop body
+class TypeInference {
+public:
+    // Annotate every function, method and lambda of a program
+    void infer(Program* program);
+
+private:
+    // What a function or lambda body does with one of its locals
+    struct Variable {
+        std::vector<VariableDeclaration*> declarations;
+        // Parameters, loop and error variables and nested functions of the same name
+        int otherBindings = 0;
+        // For-in loop binding the variable
+        ForInLoopStatement* loop = nullptr;
+        // Declaration or counted loop the type is proven from (nullptr when it is not)
+        ASTNode* origin = nullptr;
+        StaticType type = StaticType::Unknown;
+        // Whether reads at the current point of the walk see the proven type
+        bool active = false;
+        // Assignments to the variable and the types of the values they store
+        std::vector<std::pair<AssignmentExpression*, StaticType>> assignments;
+        // Element types a list variable receives from its literal, add() and index stores
+        StaticType elementType = StaticType::Unknown;
+        bool hasElements = false;
+        // Set when the variable is reassigned, captured or handed to code that could alias it
+        bool shared = false;
+    };
+    
+    // Locals of one function or lambda body (a deque keeps references valid while nested bodies push)
+    struct Scope {
+        std::map<std::string, Variable> variables;
+    };
+    
+    std::deque<Scope> scopes;
+    
+    // Declarations and loops whose variable turned out not to keep one type
+    std::unordered_set<ASTNode*> rejected;
+    bool changed = false;
+    
+    // Infer a top-level declaration (function, namespace or class)
+    void inferDeclaration(ASTNode* decl);
+    
+    // Walk a function and everything nested in it until no proof is rejected
+    void inferFunction(FunctionDeclaration* func);
+    
+    // Walk one function or lambda body in a fresh scope
+    void walkFunction(FunctionDeclaration* func);
+    void walkLambda(LambdaExpression* lambda);
+    
+    // Record the locals of a body, then pick the ones whose type can be proven
+    void declareBody(const std::vector<ASTNode*>& body);
+    void declareStatement(ASTNode* stmt);
+    void chooseCandidates(const std::vector<ASTNode*>& body);
+    
+    // Check the finished scope's proofs and annotate its assignments and declarations
+    void popScope();
+    
+    // Variable a name refers to (nullptr for globals); outer is set when it belongs to an enclosing body
+    Variable* lookup(const std::string& name, bool& outer);
+    
+    void walkBody(const std::vector<ASTNode*>& body);
+    void walkStatement(ASTNode* stmt);
+    
+    // Annotate an expression and its children, returning its type
+    StaticType walkExpression(Expression* expr);
+    StaticType walkExpressionNode(Expression* expr);
+    
+    // Operand that may name a list without sharing it (printed, indexed or iterated)
+    StaticType walkOperand(Expression* expr);
+    StaticType readVariable(Identifier* ident, bool shares);
+    
+    StaticType walkCall(FunctionCall* call);
+    StaticType walkAssignment(AssignmentExpression* assign);
+    StaticType walkIndex(Expression* collection, Expression* index);
+    void walkForIn(ForInLoopStatement* stmt);
+    
+    void addElement(Variable& var, StaticType type);
+    void reject(Variable& var);
+};
+
+#endif // VANCTION_TYPE_INFERENCE_H
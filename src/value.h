@@ -0,0 +1,248 @@
+#ifndef VANCTION_VALUE_H
+#define VANCTION_VALUE_H
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+// Forward declarations for heap types referenced by values
+class Instance;
+class ErrorObject;
+class List;
+class HashMap;
+class StringBuilder;
+struct Closure;
+
+// Type tag of a value
+enum class ValueType : unsigned char {
+    Int,
+    Char,
+    String,
+    Bool,
+    Float,
+    Double,
+    Nil,
+    Instance,
+    Error,
+    List,
+    HashMap,
+    Lambda,
+    Function,
+    StringBuilder
+};
+
+// Heap string shared by every value that holds it (longer than a short string)
+// Strings never change, so their hash is computed once (0 until first needed)
+struct StringObject {
+    std::string value;
+    int refCount;
+    size_t hash;
+    
+    explicit StringObject(std::string value) : value(std::move(value)), refCount(1), hash(0) {}
+};
+
+// Runtime value: a 16-byte tagged word
+// Numbers are stored inline, strings of up to 14 bytes too,
+// longer strings and objects live behind a pointer
+class Value {
+public:
+    // Longest string kept inside the value itself
+    static const size_t maxShortString = 14;
+    
+    // Default value is the integer 0
+    Value() { setWord(ValueType::Int); storage.word.data.i = 0; }
+    
+    Value(int value) { setWord(ValueType::Int); storage.word.data.i = value; }
+    Value(char value) { setWord(ValueType::Char); storage.word.data.c = value; }
+    Value(bool value) { setWord(ValueType::Bool); storage.word.data.b = value; }
+    Value(float value) { setWord(ValueType::Float); storage.word.data.f = value; }
+    Value(double value) { setWord(ValueType::Double); storage.word.data.d = value; }
+    Value(std::monostate) { setWord(ValueType::Nil); storage.word.data.ptr = nullptr; }
+    Value(std::string_view value) {
+        if (value.size() <= maxShortString) {
+            setShortString(value);
+        } else {
+            setHeapString(new StringObject(std::string(value)));
+        }
+    }
+    Value(const std::string& value) : Value(std::string_view(value)) {}
+    Value(std::string&& value) {
+        if (value.size() <= maxShortString) {
+            setShortString(value);
+        } else {
+            setHeapString(new StringObject(std::move(value)));
+        }
+    }
+    Value(const char* value) : Value(std::string_view(value)) {}
+    // Shares a string kept alive elsewhere (string literals)
+    explicit Value(StringObject* value) { ++value->refCount; setHeapString(value); }
+    Value(Instance* value) { setWord(ValueType::Instance); storage.word.data.ptr = value; }
+    Value(ErrorObject* value) { setWord(ValueType::Error); storage.word.data.ptr = value; }
+    Value(List* value) { setWord(ValueType::List); storage.word.data.ptr = value; }
+    Value(HashMap* value) { setWord(ValueType::HashMap); storage.word.data.ptr = value; }
+    Value(StringBuilder* value) { setWord(ValueType::StringBuilder); storage.word.data.ptr = value; }
+    // Lambda or function depending on the closure's code (defined in runtime.h)
+    Value(Closure* value);
+    // Other pointers would silently convert to bool
+    Value(const void*) = delete;
+    
+    Value(const Value& other) : storage(other.storage) {
+        if (isHeapString()) {
+            ++storage.word.data.s->refCount;
+        }
+    }
+    
+    Value(Value&& other) noexcept : storage(other.storage) {
+        other.storage.word.tag = ValueType::Nil;
+    }
+    
+    Value& operator=(const Value& other) {
+        if (other.isHeapString()) {
+            ++other.storage.word.data.s->refCount;
+        }
+        release();
+        storage = other.storage;
+        return *this;
+    }
+    
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            storage = other.storage;
+            other.storage.word.tag = ValueType::Nil;
+        }
+        return *this;
+    }
+    
+    ~Value() { release(); }
+    
+    ValueType type() const { return storage.word.tag; }
+    
+    bool isInt() const { return type() == ValueType::Int; }
+    bool isChar() const { return type() == ValueType::Char; }
+    bool isString() const { return type() == ValueType::String; }
+    bool isBool() const { return type() == ValueType::Bool; }
+    bool isFloat() const { return type() == ValueType::Float; }
+    bool isDouble() const { return type() == ValueType::Double; }
+    bool isNil() const { return type() == ValueType::Nil; }
+    bool isInstance() const { return type() == ValueType::Instance; }
+    bool isError() const { return type() == ValueType::Error; }
+    bool isList() const { return type() == ValueType::List; }
+    bool isHashMap() const { return type() == ValueType::HashMap; }
+    bool isLambda() const { return type() == ValueType::Lambda; }
+    bool isFunction() const { return type() == ValueType::Function; }
+    bool isStringBuilder() const { return type() == ValueType::StringBuilder; }
+    
+    // Checked accessors, throw std::bad_variant_access on a type mismatch
+    int asInt() const { check(ValueType::Int); return storage.word.data.i; }
+    char asChar() const { check(ValueType::Char); return storage.word.data.c; }
+    // Borrowed view of the characters, valid as long as this value is
+    std::string_view asString() const {
+        check(ValueType::String);
+        if (isHeapString()) {
+            return storage.word.data.s->value;
+        }
+        return std::string_view(storage.shortString.text, storage.shortString.length);
+    }
+    bool asBool() const { check(ValueType::Bool); return storage.word.data.b; }
+    float asFloat() const { check(ValueType::Float); return storage.word.data.f; }
+    double asDouble() const { check(ValueType::Double); return storage.word.data.d; }
+    Instance* asInstance() const { check(ValueType::Instance); return static_cast<Instance*>(storage.word.data.ptr); }
+    ErrorObject* asError() const { check(ValueType::Error); return static_cast<ErrorObject*>(storage.word.data.ptr); }
+    List* asList() const { check(ValueType::List); return static_cast<List*>(storage.word.data.ptr); }
+    HashMap* asHashMap() const { check(ValueType::HashMap); return static_cast<HashMap*>(storage.word.data.ptr); }
+    StringBuilder* asStringBuilder() const { check(ValueType::StringBuilder); return static_cast<StringBuilder*>(storage.word.data.ptr); }
+    Closure* asClosure() const {
+        if (type() != ValueType::Lambda && type() != ValueType::Function) {
+            throw std::bad_variant_access();
+        }
+        return static_cast<Closure*>(storage.word.data.ptr);
+    }
+    
+    // Hash of a string value, cached in the shared string
+    // Short strings are cheaper to rehash than to store a hash for
+    size_t stringHash() const {
+        if (!isHeapString()) {
+            return std::hash<std::string_view>()(asString());
+        }
+        StringObject* string = storage.word.data.s;
+        if (string->hash == 0) {
+            string->hash = std::hash<std::string>()(string->value);
+        }
+        return string->hash;
+    }
+
+private:
+    // Length marker of a string that lives behind a pointer
+    static const unsigned char heapString = 0xFF;
+    
+    // Numbers, pointers and heap strings
+    struct Word {
+        ValueType tag;
+        unsigned char length;
+        union {
+            int i;
+            char c;
+            bool b;
+            float f;
+            double d;
+            StringObject* s;
+            void* ptr;
+        } data;
+    };
+    
+    // Strings of up to maxShortString bytes, stored in place
+    // Shares its leading tag and length with Word
+    struct ShortString {
+        ValueType tag;
+        unsigned char length;
+        char text[maxShortString];
+    };
+    
+    // Copying the union copies all 16 bytes, including short string text
+    union Storage {
+        Word word;
+        ShortString shortString;
+    } storage;
+    
+    void setWord(ValueType type) {
+        storage.word.tag = type;
+        storage.word.length = 0;
+    }
+    
+    void setShortString(std::string_view value) {
+        storage.shortString.tag = ValueType::String;
+        storage.shortString.length = static_cast<unsigned char>(value.size());
+        std::memcpy(storage.shortString.text, value.data(), value.size());
+    }
+    
+    void setHeapString(StringObject* value) {
+        storage.word.tag = ValueType::String;
+        storage.word.length = heapString;
+        storage.word.data.s = value;
+    }
+    
+    bool isHeapString() const {
+        return storage.word.tag == ValueType::String && storage.word.length == heapString;
+    }
+    
+    void check(ValueType expected) const {
+        if (type() != expected) {
+            throw std::bad_variant_access();
+        }
+    }
+    
+    void release() {
+        if (isHeapString() && --storage.word.data.s->refCount == 0) {
+            delete storage.word.data.s;
+        }
+    }
+};
+
+static_assert(sizeof(Value) == 16, "Value must stay a 16-byte tagged word");
+
+#endif // VANCTION_VALUE_H
@@ -0,0 +1,1119 @@
+#include "vm.h"
+#include "native_tier.h"
+#include "switch_table.h"
+#include <memory>
+
+// Use the bytecode VM for -i (the AST tree-walker is kept behind -ast)
+bool useBytecodeVM = true;
+
+// Computed goto dispatch where the compiler supports labels as values
+#if defined(__GNUC__)
+#define VANCTION_COMPUTED_GOTO 1
+#endif
+
+// ---------------------------------------------------------------------------
+// Compiler
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Operators with a dedicated instruction, everything else goes through Binary
+OpCode binaryOpCode(BinaryOperator op) {
+    switch (op) {
+        case BinaryOperator::Add: return OpCode::Add;
+        case BinaryOperator::Subtract: return OpCode::Subtract;
+        case BinaryOperator::Multiply: return OpCode::Multiply;
+        case BinaryOperator::Divide: return OpCode::Divide;
+        case BinaryOperator::Modulo: return OpCode::Modulo;
+        case BinaryOperator::Less: return OpCode::Less;
+        case BinaryOperator::LessEqual: return OpCode::LessEqual;
+        case BinaryOperator::Greater: return OpCode::Greater;
+        case BinaryOperator::GreaterEqual: return OpCode::GreaterEqual;
+        case BinaryOperator::Equal: return OpCode::Equal;
+        case BinaryOperator::NotEqual: return OpCode::NotEqual;
+        default: return OpCode::Binary;
+    }
+}
+
+} // namespace
+
+// Compile a function body; top-level statement values are kept for functions called as values
+Chunk* BytecodeCompiler::compileFunction(FunctionDeclaration* func) {
+    chunk = new Chunk();
+    contexts.clear();
+    stackDepth = 0;
+    
+    for (auto stmt : func->body) {
+        compileStatement(stmt, true);
+        emit(OpCode::SetResult, -1);
+    }
+    emit(OpCode::End, 0);
+    
+    return chunk;
+}
+
+// Compile a lambda body expression
+Chunk* BytecodeCompiler::compileLambda(LambdaExpression* lambda) {
+    chunk = new Chunk();
+    contexts.clear();
+    stackDepth = 0;
+    
+    compileExpression(lambda->body);
+    emit(OpCode::Return, -1);
+    
+    return chunk;
+}
+
+size_t BytecodeCompiler::emit(OpCode op, int stackEffect, int a, int b, ASTNode* node) {
+    chunk->code.push_back(Instruction{op, a, b, node});
+    setStackDepth(stackDepth + stackEffect);
+    return chunk->code.size() - 1;
+}
+
+int BytecodeCompiler::addConstant(const Value& value) {
+    chunk->constants.push_back(value);
+    return static_cast<int>(chunk->constants.size() - 1);
+}
+
+// Point a forward jump at the current position
+void BytecodeCompiler::patch(size_t index) {
+    Instruction& instruction = chunk->code[index];
+    int target = static_cast<int>(chunk->code.size());
+    if (instruction.op == OpCode::IterNext || instruction.op == OpCode::RangeNext || instruction.op == OpCode::CaseMatch) {
+        instruction.b = target;
+    } else {
+        instruction.a = target;
+    }
+}
+
+void BytecodeCompiler::setStackDepth(int depth) {
+    stackDepth = depth;
+    if (stackDepth > chunk->maxStack) {
+        chunk->maxStack = stackDepth;
+    }
+}
+
+void BytecodeCompiler::beginContext(ContextKind kind) {
+    contexts.push_back(Context{kind, {}, {}, {}});
+}
+
+// Returns inside the context jump here with their value on the stack
+void BytecodeCompiler::endContext() {
+    for (size_t exit : contexts.back().exits) {
+        patch(exit);
+    }
+    contexts.pop_back();
+}
+
+void BytecodeCompiler::patchBreaks() {
+    for (size_t jump : contexts.back().breaks) {
+        patch(jump);
+    }
+}
+
+void BytecodeCompiler::patchContinues(size_t target) {
+    for (size_t jump : contexts.back().continues) {
+        chunk->code[jump].a = static_cast<int>(target);
+    }
+}
+
+void BytecodeCompiler::compileBody(const std::vector<ASTNode*>& body) {
+    for (auto stmt : body) {
+        compileStatement(stmt, false);
+    }
+}
+
+// Compile a statement, leaving its value on the stack when wantValue is set
+void BytecodeCompiler::compileStatement(ASTNode* stmt, bool wantValue) {
+    if (!stmt || nodeCast<Comment>(stmt)) {
+        if (wantValue) {
+            emit(OpCode::Nil, 1);
+        }
+        return;
+    }
+    
+    if (auto exprStmt = nodeCast<ExpressionStatement>(stmt)) {
+        compileExpression(exprStmt->expression);
+        if (!wantValue) {
+            emit(OpCode::Pop, -1);
+        }
+        return;
+    }
+    
+    if (auto varDecl = nodeCast<VariableDeclaration>(stmt)) {
+        // Globals keep the interpreter's name-based path
+        if (varDecl->slot < 0) {
+            emit(OpCode::Exec, 1, 0, 0, varDecl);
+            if (!wantValue) {
+                emit(OpCode::Pop, -1);
+            }
+            return;
+        }
+        
+        if (varDecl->initializer) {
+            compileExpression(varDecl->initializer);
+            emit(OpCode::DeclareLocal, -1, varDecl->slot);
+        } else {
+            emit(OpCode::DeclareEmpty, 0, varDecl->slot);
+        }
+        if (wantValue) {
+            emit(OpCode::Nil, 1);
+        }
+        return;
+    }
+    
+    if (auto ifStmt = nodeCast<IfStatement>(stmt)) {
+        compileIf(ifStmt);
+        if (wantValue) {
+            emit(OpCode::Nil, 1);
+        }
+        return;
+    }
+    
+    if (auto returnStmt = nodeCast<ReturnStatement>(stmt)) {
+        compileReturn(returnStmt);
+        if (wantValue) {
+            emit(OpCode::Nil, 1);
+        }
+        return;
+    }
+    
+    if (nodeCast<BreakStatement>(stmt) || nodeCast<ContinueStatement>(stmt)) {
+        auto breakStmt = nodeCast<BreakStatement>(stmt);
+        compileJump(breakStmt != nullptr, breakStmt ? breakStmt->depth : static_cast<ContinueStatement*>(stmt)->depth);
+        if (wantValue) {
+            emit(OpCode::Nil, 1);
+        }
+        return;
+    }
+    
+    // Loops, switch and try complete with the value of a return inside them
+    if (auto forLoopStmt = nodeCast<ForLoopStatement>(stmt)) {
+        compileFor(forLoopStmt);
+    } else if (auto forInStmt = nodeCast<ForInLoopStatement>(stmt)) {
+        compileForIn(forInStmt);
+    } else if (auto whileStmt = nodeCast<WhileLoopStatement>(stmt)) {
+        compileWhile(whileStmt);
+    } else if (auto doWhileStmt = nodeCast<DoWhileLoopStatement>(stmt)) {
+        compileDoWhile(doWhileStmt);
+    } else if (auto switchStmt = nodeCast<SwitchStatement>(stmt)) {
+        compileSwitch(switchStmt);
+    } else if (auto tryHappenStmt = nodeCast<TryHappenStatement>(stmt)) {
+        compileTry(tryHappenStmt);
+    } else {
+        // Nested function declarations and anything else run through the interpreter
+        emit(OpCode::Exec, 1, 0, 0, stmt);
+    }
+    
+    if (!wantValue) {
+        emit(OpCode::Pop, -1);
+    }
+}
+
+// All else-if clauses are visited and the else body always runs when the condition is false
+void BytecodeCompiler::compileIf(IfStatement* stmt) {
+    // Constant conditions (left by the optimizer's dead branch pass) need no test
+    if (auto constant = nodeCast<BooleanLiteral>(stmt->condition)) {
+        if (constant->value) {
+            compileBody(stmt->ifBody);
+            return;
+        }
+        for (auto elseIf : stmt->elseIfs) {
+            compileIf(elseIf);
+        }
+        compileBody(stmt->elseBody);
+        return;
+    }
+    
+    compileExpression(stmt->condition);
+    size_t elseJump = emit(OpCode::JumpIfFalse, -1);
+    compileBody(stmt->ifBody);
+    size_t endJump = emit(OpCode::Jump, 0);
+    
+    patch(elseJump);
+    for (auto elseIf : stmt->elseIfs) {
+        compileIf(elseIf);
+    }
+    compileBody(stmt->elseBody);
+    patch(endJump);
+}
+
+// A return completes the innermost loop, switch or try, or the function outside of them
+void BytecodeCompiler::compileReturn(ReturnStatement* stmt) {
+    if (stmt->tailCall && contexts.empty()) {
+        // The caller of the body makes the call once this frame is released
+        compileCall(static_cast<FunctionCall*>(stmt->expression), true);
+        emit(OpCode::Return, -1);
+        return;
+    }
+    
+    compileExpression(stmt->expression);
+    
+    if (contexts.empty()) {
+        emit(OpCode::Return, -1);
+        return;
+    }
+    
+    Context& context = contexts.back();
+    if (context.kind == ContextKind::TryBody) {
+        emit(OpCode::PopHandler, 0);
+    }
+    context.exits.push_back(emit(OpCode::Jump, -1));
+}
+
+// A break or continue leaves the switch and try statements between it and its loop,
+// removing the handlers of the try bodies it leaves
+void BytecodeCompiler::compileJump(bool isBreak, int depth) {
+    for (size_t i = contexts.size(); i-- > 0;) {
+        Context& context = contexts[i];
+        if (context.kind == ContextKind::TryBody) {
+            emit(OpCode::PopHandler, 0);
+        }
+        if (context.kind == ContextKind::Loop && depth-- == 0) {
+            (isBreak ? context.breaks : context.continues).push_back(emit(OpCode::Jump, 0));
+            return;
+        }
+    }
+}
+
+void BytecodeCompiler::compileFor(ForLoopStatement* stmt) {
+    beginContext(ContextKind::Loop);
+    compileStatement(stmt->initialization, false);
+    
+    size_t top = chunk->code.size();
+    compileExpression(stmt->condition);
+    size_t exitJump = emit(OpCode::JumpIfFalseNumeric, -1);
+    compileBody(stmt->body);
+    patchContinues(chunk->code.size());
+    compileExpression(stmt->increment);
+    emit(OpCode::Pop, -1);
+    emit(OpCode::Jump, 0, static_cast<int>(top));
+    
+    patch(exitJump);
+    patchBreaks();
+    emit(OpCode::Nil, 1);
+    endContext();
+}
+
+void BytecodeCompiler::compileForIn(ForInLoopStatement* stmt) {
+    beginContext(ContextKind::Loop);
+    int iterator = chunk->iteratorCount++;
+    
+    // Counted loop: the bounds are compiled inline and evaluated once
+    if (auto rangeExpr = nodeCast<RangeExpression>(stmt->collection)) {
+        compileExpression(rangeExpr->start);
+        compileExpression(rangeExpr->end);
+        compileExpression(rangeExpr->step);
+        emit(OpCode::RangeInit, -3, iterator, 0, stmt);
+        
+        size_t top = emit(OpCode::RangeNext, 0, iterator, 0, stmt);
+        compileBody(stmt->body);
+        emit(OpCode::Jump, 0, static_cast<int>(top));
+        patchContinues(top);
+        
+        patch(top);
+        patchBreaks();
+        emit(OpCode::Nil, 1);
+        endContext();
+        return;
+    }
+    
+    int collection = chunk->tempCount++;
+    
+    compileExpression(stmt->collection);
+    emit(OpCode::IterInit, -1, iterator, collection, stmt);
+    
+    size_t top = emit(OpCode::IterNext, 0, iterator, 0, stmt);
+    compileBody(stmt->body);
+    emit(OpCode::Jump, 0, static_cast<int>(top));
+    patchContinues(top);
+    
+    patch(top);
+    patchBreaks();
+    emit(OpCode::Nil, 1);
+    endContext();
+}
+
+void BytecodeCompiler::compileWhile(WhileLoopStatement* stmt) {
+    beginContext(ContextKind::Loop);
+    
+    size_t top = chunk->code.size();
+    compileExpression(stmt->condition);
+    size_t exitJump = emit(OpCode::JumpIfFalse, -1);
+    compileBody(stmt->body);
+    emit(OpCode::Jump, 0, static_cast<int>(top));
+    patchContinues(top);
+    
+    patch(exitJump);
+    patchBreaks();
+    emit(OpCode::Nil, 1);
+    endContext();
+}
+
+void BytecodeCompiler::compileDoWhile(DoWhileLoopStatement* stmt) {
+    beginContext(ContextKind::Loop);
+    
+    size_t top = chunk->code.size();
+    compileBody(stmt->body);
+    patchContinues(chunk->code.size());
+    compileExpression(stmt->condition);
+    size_t exitJump = emit(OpCode::JumpIfFalse, -1);
+    emit(OpCode::Jump, 0, static_cast<int>(top));
+    
+    patch(exitJump);
+    patchBreaks();
+    emit(OpCode::Nil, 1);
+    endContext();
+}
+
+// Every matching case runs, in order
+void BytecodeCompiler::compileSwitch(SwitchStatement* stmt) {
+    beginContext(ContextKind::Switch);
+    compileExpression(stmt->expression);
+    
+    SwitchTable* table = switchTable(stmt);
+    if (table->kind != SwitchTable::Kind::Dynamic) {
+        // Switch jumps into the table of case jumps that follows it, or past it when no label matches
+        size_t caseCount = stmt->cases.size();
+        emit(OpCode::Switch, -1, 0, 0, stmt);
+        std::vector<size_t> entries;
+        for (size_t i = 0; i <= caseCount; i++) {
+            entries.push_back(emit(OpCode::Jump, 0));
+        }
+        
+        // The body of a case continues with the next case of the same label
+        std::vector<size_t> starts;
+        std::vector<size_t> tails;
+        for (size_t i = 0; i < caseCount; i++) {
+            patch(entries[i]);
+            starts.push_back(chunk->code.size());
+            compileBody(stmt->cases[i]->body);
+            tails.push_back(emit(OpCode::Jump, 0));
+        }
+        patch(entries[caseCount]);
+        for (size_t i = 0; i < caseCount; i++) {
+            if (table->next[i] >= 0) {
+                chunk->code[tails[i]].a = static_cast<int>(starts[table->next[i]]);
+            } else {
+                patch(tails[i]);
+            }
+        }
+        
+        emit(OpCode::Nil, 1);
+        endContext();
+        return;
+    }
+    
+    int temp = chunk->tempCount++;
+    emit(OpCode::StoreTemp, -1, temp);
+    
+    for (auto caseStmt : stmt->cases) {
+        compileExpression(caseStmt->value);
+        size_t nextCase = emit(OpCode::CaseMatch, -1, temp);
+        compileBody(caseStmt->body);
+        patch(nextCase);
+    }
+    
+    emit(OpCode::Nil, 1);
+    endContext();
+}
+
+void BytecodeCompiler::compileTry(TryHappenStatement* stmt) {
+    beginContext(ContextKind::TryBody);
+    int startDepth = stackDepth;
+    
+    size_t handler = emit(OpCode::PushHandler, 0, 0, 0, stmt);
+    compileBody(stmt->tryBody);
+    emit(OpCode::PopHandler, 0);
+    emit(OpCode::Nil, 1);
+    size_t endJump = emit(OpCode::Jump, 0);
+    
+    // The handler unwinds the stack to its depth at the start of the try
+    setStackDepth(startDepth);
+    patch(handler);
+    contexts.back().kind = ContextKind::Happen;
+    compileBody(stmt->happenBody);
+    emit(OpCode::Nil, 1);
+    
+    patch(endJump);
+    endContext();
+}
+
+void BytecodeCompiler::compileExpression(Expression* expr) {
+    if (!expr) {
+        emit(OpCode::Nil, 1);
+    } else if (auto intLit = nodeCast<IntegerLiteral>(expr)) {
+        emit(OpCode::Constant, 1, addConstant(intLit->value));
+    } else if (auto floatLit = nodeCast<FloatLiteral>(expr)) {
+        emit(OpCode::Constant, 1, addConstant(floatLit->value));
+    } else if (auto doubleLit = nodeCast<DoubleLiteral>(expr)) {
+        emit(OpCode::Constant, 1, addConstant(doubleLit->value));
+    } else if (auto charLit = nodeCast<CharLiteral>(expr)) {
+        emit(OpCode::Constant, 1, addConstant(charLit->value));
+    } else if (auto boolLit = nodeCast<BooleanLiteral>(expr)) {
+        emit(OpCode::Constant, 1, addConstant(boolLit->value));
+    } else if (auto stringLit = nodeCast<StringLiteral>(expr); stringLit && stringLit->type != "format") {
+        emit(OpCode::Constant, 1, addConstant(stringLit->value));
+    } else if (auto ident = nodeCast<Identifier>(expr)) {
+        if (ident->upvalue >= 0) {
+            emit(OpCode::LoadUpvalue, 1, ident->upvalue, 0, ident);
+        } else if (ident->slot < 0) {
+            emit(OpCode::LoadGlobal, 1, 0, 0, ident);
+        } else {
+            emit(OpCode::LoadLocal, 1, ident->slot);
+        }
+    } else if (auto assignExpr = nodeCast<AssignmentExpression>(expr)) {
+        compileExpression(assignExpr->right);
+        auto ident = nodeCast<Identifier>(assignExpr->left);
+        if (ident && ident->slot >= 0 && !ident->isImmut) {
+            emit(assignExpr->typeProven ? OpCode::StoreLocal : OpCode::AssignLocal, 0, ident->slot);
+        } else {
+            emit(OpCode::Assign, 0, 0, 0, assignExpr->left);
+        }
+    } else if (auto binaryExpr = nodeCast<BinaryExpression>(expr)) {
+        compileExpression(binaryExpr->left);
+        compileExpression(binaryExpr->right);
+        
+        emit(binaryOpCode(binaryExpr->opcode), -1, 0, 0, binaryExpr);
+    } else if (auto funcCall = nodeCast<FunctionCall>(expr)) {
+        compileCall(funcCall);
+    } else if (auto funcCallExpr = nodeCast<FunctionCallExpression>(expr)) {
+        int argCount = static_cast<int>(funcCallExpr->arguments.size());
+        compileExpression(funcCallExpr->callee);
+        emit(OpCode::CheckLambda, 0, argCount);
+        for (auto arg : funcCallExpr->arguments) {
+            compileExpression(arg);
+        }
+        emit(OpCode::CallLambda, -argCount, argCount);
+    } else if (auto listLit = nodeCast<ListLiteral>(expr)) {
+        int count = static_cast<int>(listLit->elements.size());
+        for (auto elem : listLit->elements) {
+            compileExpression(elem);
+        }
+        emit(OpCode::MakeList, 1 - count, count);
+    } else {
+        // Format strings, instances, maps and lambdas are evaluated by the interpreter
+        emit(OpCode::Eval, 1, 0, 0, expr);
+    }
+}
+
+// Calls of plain names bind the callee before evaluating arguments
+// Anything that is not a function value (builtins, classes, namespaces) runs through the interpreter
+void BytecodeCompiler::compileCall(FunctionCall* call, bool tailCall) {
+    if (!call->objectName.empty()) {
+        emit(OpCode::CallNode, 1, 0, 0, call);
+        return;
+    }
+    
+    int argCount = static_cast<int>(call->arguments.size());
+    size_t prepare = emit(OpCode::PrepareCall, 1, 0, tailCall ? 1 : 0, call);
+    for (auto arg : call->arguments) {
+        compileExpression(arg);
+    }
+    emit(tailCall ? OpCode::TailCall : OpCode::Call, -argCount, argCount);
+    patch(prepare);
+}
+
+// ---------------------------------------------------------------------------
+// Virtual machine
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Compiled chunks live as long as the program
+std::vector<std::unique_ptr<Chunk>> chunks;
+
+// Operand stack shared by nested runs; each run claims a window on top of it
+std::vector<Value> operandStack(1 << 16);
+size_t operandTop = 0;
+
+class StackWindow {
+public:
+    explicit StackWindow(size_t size) : saved(operandTop) {
+        if (operandTop + size <= operandStack.size()) {
+            base = operandStack.data() + operandTop;
+            operandTop += size;
+        } else {
+            overflow.reset(new Value[size]);
+            base = overflow.get();
+        }
+        // Values on the window are collector roots
+        heap.pushRange(base, base + size);
+    }
+    ~StackWindow() {
+        heap.popRange();
+        operandTop = saved;
+    }
+    
+    Value* base;
+
+private:
+    size_t saved;
+    std::unique_ptr<Value[]> overflow;
+};
+
+// State of a running for-in loop
+struct ForInIterator {
+    enum class Kind { None, List, Map, Elements, Entries };
+    
+    Kind kind = Kind::None;
+    List* list = nullptr;
+    HashMap* map = nullptr;
+    size_t index = 0;
+    // Counted loops over range(...) use these instead
+    RangeLoop range;
+    uint64_t iteration = 0;
+};
+
+// Installed try-happen handler
+struct Handler {
+    TryHappenStatement* stmt;
+    size_t target;
+    size_t stackDepth;
+};
+
+// Truthiness of conditions, strings count only when allowStrings is set
+inline bool isTruthy(const Value& value, bool allowStrings) {
+    switch (value.type()) {
+        case ValueType::Bool: return value.asBool();
+        case ValueType::Int: return value.asInt() != 0;
+        case ValueType::Float: return value.asFloat() != 0.0f;
+        case ValueType::Double: return value.asDouble() != 0.0;
+        case ValueType::String: return allowStrings && !value.asString().empty();
+        default: return false;
+    }
+}
+
+// Switch case comparison: only values of the same type match
+bool caseMatches(const Value& switchValue, const Value& caseValue) {
+    if (switchValue.type() != caseValue.type()) {
+        return false;
+    }
+    switch (switchValue.type()) {
+        case ValueType::Int: return switchValue.asInt() == caseValue.asInt();
+        case ValueType::String: return switchValue.asString() == caseValue.asString();
+        case ValueType::Bool: return switchValue.asBool() == caseValue.asBool();
+        case ValueType::Float: return switchValue.asFloat() == caseValue.asFloat();
+        case ValueType::Double: return switchValue.asDouble() == caseValue.asDouble();
+        default: return false;
+    }
+}
+
+// Start iterating the collection of a for-in loop
+void initIterator(ForInIterator& it, ForInLoopStatement* stmt, const Value& collection) {
+    it = ForInIterator();
+    if (collection.isList()) {
+        it.kind = ForInIterator::Kind::List;
+        it.list = collection.asList();
+    } else if (collection.isHashMap()) {
+        it.kind = ForInIterator::Kind::Map;
+        it.map = collection.asHashMap();
+    } else if (nodeCast<ListLiteral>(stmt->collection)) {
+        it.kind = ForInIterator::Kind::Elements;
+    } else if (nodeCast<HashMapLiteral>(stmt->collection)) {
+        it.kind = ForInIterator::Kind::Entries;
+    }
+}
+
+// Bind the next element to the loop variables, returns false when the loop is done
+bool advanceIterator(ForInIterator& it, ForInLoopStatement* stmt) {
+    switch (it.kind) {
+        case ForInIterator::Kind::List: {
+            if (it.index >= static_cast<size_t>(it.list->size())) {
+                return false;
+            }
+            Value elementValue = it.list->at(it.index++);
+            checkLoopBinding(stmt);
+            storeVariable(stmt->keySlot, stmt->keyVariableName, elementValue);
+            return true;
+        }
+        case ForInIterator::Kind::Map: {
+            // Entries are visited in insertion order, skipping removed ones
+            while (it.index < it.map->entries.size() && it.map->entries[it.index].key.isNil()) {
+                ++it.index;
+            }
+            if (it.index >= it.map->entries.size()) {
+                return false;
+            }
+            Value key = it.map->entries[it.index].key;
+            Value value = it.map->entries[it.index].value;
+            ++it.index;
+            checkLoopBinding(stmt);
+            storeVariable(stmt->keySlot, stmt->keyVariableName, key);
+            storeVariable(stmt->valueSlot, stmt->valueVariableName, value);
+            return true;
+        }
+        case ForInIterator::Kind::Elements: {
+            auto listLit = static_cast<ListLiteral*>(stmt->collection);
+            if (it.index >= listLit->elements.size()) {
+                return false;
+            }
+            Value elementValue = executeExpression(listLit->elements[it.index++]);
+            checkLoopBinding(stmt);
+            storeVariable(stmt->keySlot, stmt->keyVariableName, elementValue);
+            return true;
+        }
+        case ForInIterator::Kind::Entries: {
+            auto hashMapLit = static_cast<HashMapLiteral*>(stmt->collection);
+            if (it.index >= hashMapLit->entries.size()) {
+                return false;
+            }
+            HashMapEntry* entry = hashMapLit->entries[it.index++];
+            Value keyValue = executeExpression(entry->key);
+            Value valueValue = executeExpression(entry->value);
+            checkLoopBinding(stmt);
+            storeVariable(stmt->keySlot, stmt->keyVariableName, keyValue);
+            storeVariable(stmt->valueSlot, stmt->valueVariableName, valueValue);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Execute a chunk in the current frame
+Value execute(Chunk* chunk, bool keepLastValue, bool* returned) {
+    heap.safepoint();
+    
+    StackWindow window(chunk->maxStack + chunk->tempCount);
+    Value* const stackBase = window.base;
+    Value* const temps = stackBase + chunk->maxStack;
+    Value* sp = stackBase;
+    
+    const Instruction* const code = chunk->code.data();
+    const Instruction* ip = code;
+    const Value* const constantPool = chunk->constants.data();
+    Frame* const frame = currentFrame;
+    
+    std::vector<ForInIterator> iterators(chunk->iteratorCount);
+    std::vector<Handler> handlers;
+    Value lastValue = std::monostate{};
+    
+    // Transfer control to the innermost matching handler, returns false when none matches
+    // The text of the error is "type: info", or what() of an exception raised by C++ code
+    auto handleError = [&](ErrorType type, const std::string& info, const char* what) {
+        while (!handlers.empty()) {
+            Handler handler = handlers.back();
+            handlers.pop_back();
+            
+            if (catchesError(handler.stmt->errorTypeId, type)) {
+                sp = stackBase + handler.stackDepth;
+                ErrorObject* error = what ? heap.newError(what, errorTypeName(type), info) : heap.newError(errorTypeName(type), info);
+                storeVariable(handler.stmt->errorSlot, handler.stmt->errorVariableName, error);
+                ip = code + handler.target;
+                return true;
+            }
+        }
+        return false;
+    };
+    
+    for (;;) {
+        try {
+#ifdef VANCTION_COMPUTED_GOTO
+            static void* const dispatchTable[] = {
+                &&op_Constant, &&op_Nil, &&op_Pop, &&op_LoadLocal, &&op_LoadUpvalue, &&op_LoadGlobal,
+                &&op_AssignLocal, &&op_StoreLocal, &&op_Assign, &&op_DeclareLocal, &&op_DeclareEmpty,
+                &&op_Add, &&op_Subtract, &&op_Multiply, &&op_Divide, &&op_Modulo,
+                &&op_Less, &&op_LessEqual, &&op_Greater, &&op_GreaterEqual, &&op_Equal, &&op_NotEqual,
+                &&op_Binary, &&op_Jump, &&op_JumpIfFalse, &&op_JumpIfFalseNumeric,
+                &&op_PrepareCall, &&op_Call, &&op_CheckLambda, &&op_CallLambda, &&op_CallNode,
+                &&op_MakeList, &&op_StoreTemp, &&op_Switch, &&op_CaseMatch, &&op_IterInit, &&op_IterNext,
+                &&op_RangeInit, &&op_RangeNext, &&op_TailCall,
+                &&op_PushHandler, &&op_PopHandler, &&op_SetResult, &&op_Return, &&op_End,
+                &&op_Eval, &&op_Exec
+            };
+#define VM_CASE(name) op_##name:
+#define VM_DISPATCH() goto *dispatchTable[static_cast<int>(ip->op)]
+#else
+#define VM_CASE(name) case OpCode::name:
+#define VM_DISPATCH() goto dispatch
+#endif
+#define VM_NEXT() do { ++ip; VM_DISPATCH(); } while (0)
+#define VM_JUMP(target) do { ip = code + (target); VM_DISPATCH(); } while (0)
+
+// Arithmetic with fast paths for int and double pairs
+// Int results go through double like the interpreter's numeric path
+#define VM_ARITHMETIC(op) \
+            { \
+                Value& left = sp[-2]; \
+                const Value& right = sp[-1]; \
+                if (left.type() == right.type() && left.isInt()) { \
+                    left = static_cast<int>(static_cast<double>(left.asInt()) op static_cast<double>(right.asInt())); \
+                } else if (left.type() == right.type() && left.isDouble()) { \
+                    left = left.asDouble() op right.asDouble(); \
+                } else { \
+                    left = evaluateBinary(static_cast<BinaryExpression*>(ip->node), left, right); \
+                } \
+                --sp; \
+                VM_NEXT(); \
+            }
+#define VM_COMPARISON(op) \
+            { \
+                Value& left = sp[-2]; \
+                const Value& right = sp[-1]; \
+                if (left.type() == right.type() && left.isInt()) { \
+                    left = left.asInt() op right.asInt(); \
+                } else if (left.type() == right.type() && left.isDouble()) { \
+                    left = left.asDouble() op right.asDouble(); \
+                } else { \
+                    left = evaluateBinary(static_cast<BinaryExpression*>(ip->node), left, right); \
+                } \
+                --sp; \
+                VM_NEXT(); \
+            }
+            
+            VM_DISPATCH();
+#ifndef VANCTION_COMPUTED_GOTO
+        dispatch:
+            switch (ip->op) {
+#endif
+            VM_CASE(Constant) {
+                *sp++ = constantPool[ip->a];
+                VM_NEXT();
+            }
+            VM_CASE(Nil) {
+                *sp++ = std::monostate{};
+                VM_NEXT();
+            }
+            VM_CASE(Pop) {
+                --sp;
+                VM_NEXT();
+            }
+            VM_CASE(LoadLocal) {
+                *sp++ = frame->slots[ip->a];
+                VM_NEXT();
+            }
+            VM_CASE(LoadUpvalue) {
+                Upvalue* upvalue = upvalueAt(ip->a);
+                if (!upvalue) {
+                    auto ident = static_cast<Identifier*>(ip->node);
+                    throw vanction_error::VariableError("Undefined variable '" + ident->name + "'", ident->getLine(), ident->getColumn());
+                }
+                *sp++ = *upvalue->location;
+                VM_NEXT();
+            }
+            VM_CASE(LoadGlobal) {
+                auto ident = static_cast<Identifier*>(ip->node);
+                Value* entry = globalBinding(ident);
+                if (!entry) {
+                    throw vanction_error::VariableError("Undefined variable '" + ident->name + "'", ident->getLine(), ident->getColumn());
+                }
+                *sp++ = *entry;
+                VM_NEXT();
+            }
+            VM_CASE(AssignLocal) {
+                checkSlotAssignment(frame->types[ip->a], sp[-1]);
+                frame->slots[ip->a] = sp[-1];
+                VM_NEXT();
+            }
+            VM_CASE(StoreLocal) {
+                frame->slots[ip->a] = sp[-1];
+                VM_NEXT();
+            }
+            VM_CASE(Assign) {
+                assignValue(static_cast<Expression*>(ip->node), sp[-1]);
+                VM_NEXT();
+            }
+            VM_CASE(DeclareLocal) {
+                --sp;
+                frame->types[ip->a] = declaredTypeOf(*sp);
+                frame->slots[ip->a] = std::move(*sp);
+                VM_NEXT();
+            }
+            VM_CASE(DeclareEmpty) {
+                frame->slots[ip->a] = std::monostate{};
+                frame->types[ip->a] = SlotType::Unknown;
+                VM_NEXT();
+            }
+            VM_CASE(Add) VM_ARITHMETIC(+)
+            VM_CASE(Subtract) VM_ARITHMETIC(-)
+            VM_CASE(Multiply) VM_ARITHMETIC(*)
+            VM_CASE(Divide) {
+                Value& left = sp[-2];
+                const Value& right = sp[-1];
+                if (left.type() == right.type() && left.isInt() && right.asInt() != 0) {
+                    left = static_cast<int>(static_cast<double>(left.asInt()) / static_cast<double>(right.asInt()));
+                } else if (left.type() == right.type() && left.isDouble() && right.asDouble() != 0.0) {
+                    left = left.asDouble() / right.asDouble();
+                } else {
+                    left = evaluateBinary(static_cast<BinaryExpression*>(ip->node), left, right);
+                }
+                --sp;
+                VM_NEXT();
+            }
+            VM_CASE(Modulo) {
+                Value& left = sp[-2];
+                const Value& right = sp[-1];
+                if (left.type() == right.type() && left.isInt() && right.asInt() != 0) {
+                    left = left.asInt() % right.asInt();
+                } else {
+                    left = evaluateBinary(static_cast<BinaryExpression*>(ip->node), left, right);
+                }
+                --sp;
+                VM_NEXT();
+            }
+            VM_CASE(Less) VM_COMPARISON(<)
+            VM_CASE(LessEqual) VM_COMPARISON(<=)
+            VM_CASE(Greater) VM_COMPARISON(>)
+            VM_CASE(GreaterEqual) VM_COMPARISON(>=)
+            VM_CASE(Equal) VM_COMPARISON(==)
+            VM_CASE(NotEqual) VM_COMPARISON(!=)
+            VM_CASE(Binary) {
+                sp[-2] = evaluateBinary(static_cast<BinaryExpression*>(ip->node), sp[-2], sp[-1]);
+                --sp;
+                VM_NEXT();
+            }
+            VM_CASE(Jump) {
+                // Loop back-edges are collection safepoints, and count towards tiering
+                if (ip->a < ip - code) {
+                    heap.safepoint();
+                    if (nativeTier.enabled()) {
+                        nativeTier.backEdge();
+                    }
+                }
+                VM_JUMP(ip->a);
+            }
+            VM_CASE(JumpIfFalse) {
+                --sp;
+                if (!isTruthy(*sp, true)) {
+                    VM_JUMP(ip->a);
+                }
+                VM_NEXT();
+            }
+            VM_CASE(JumpIfFalseNumeric) {
+                --sp;
+                if (!isTruthy(*sp, false)) {
+                    VM_JUMP(ip->a);
+                }
+                VM_NEXT();
+            }
+            VM_CASE(PrepareCall) {
+                // Debug runs keep the interpreter's logging, except for tail calls of functions,
+                // which runTailCalls logs so they still run in constant stack
+                auto call = static_cast<FunctionCall*>(ip->node);
+                if ((!debugMode || ip->b) && lookupCallee(call, *sp) && (!debugMode || sp->isFunction())) {
+                    ++sp;
+                    VM_NEXT();
+                }
+                *sp++ = executeFunctionCall(call);
+                VM_JUMP(ip->a);
+            }
+            VM_CASE(Call) {
+                int argCount = ip->a;
+                Value* args = sp - argCount;
+                Value& callee = args[-1];
+                Value result = callee.isLambda()
+                    ? callLambda(callee.asClosure(), args, argCount)
+                    : callFunctionValue(callee.asClosure(), args, argCount);
+                sp = args;
+                sp[-1] = std::move(result);
+                VM_NEXT();
+            }
+            VM_CASE(TailCall) {
+                int argCount = ip->a;
+                Value* args = sp - argCount;
+                if (args[-1].isFunction()) {
+                    pendingTailCall.assign(args - 1, sp);
+                    if (returned) {
+                        *returned = true;
+                    }
+                    return std::monostate{};
+                }
+                // Lambdas are called in place
+                Value result = callLambda(args[-1].asClosure(), args, argCount);
+                sp = args;
+                sp[-1] = std::move(result);
+                VM_NEXT();
+            }
+            VM_CASE(CheckLambda) {
+                if (!sp[-1].isLambda()) {
+                    throw vanction_error::MethodError("Attempt to call a non-function value");
+                }
+                if (sp[-1].asClosure()->lambda->parameters.size() != static_cast<size_t>(ip->a)) {
+                    throw vanction_error::MethodError("Argument count mismatch for lambda call");
+                }
+                VM_NEXT();
+            }
+            VM_CASE(CallLambda) {
+                int argCount = ip->a;
+                Value* args = sp - argCount;
+                Value result = callLambda(args[-1].asClosure(), args, argCount);
+                sp = args;
+                sp[-1] = std::move(result);
+                VM_NEXT();
+            }
+            VM_CASE(CallNode) {
+                if (handlers.empty()) {
+                    *sp++ = executeFunctionCall(static_cast<FunctionCall*>(ip->node));
+                    VM_NEXT();
+                }
+                // Inside a try, errors of builtins are returned and handled without unwinding
+                {
+                    ErrorResultScope scope(static_cast<FunctionCall*>(ip->node));
+                    *sp++ = executeFunctionCall(static_cast<FunctionCall*>(ip->node));
+                }
+                if (errorResult.raised) {
+                    errorResult.raised = false;
+                    if (!handleError(errorResult.type, errorResult.message, nullptr)) {
+                        throw vanction_error::VanctionError(errorResult.type, errorResult.message);
+                    }
+                    VM_DISPATCH();
+                }
+                VM_NEXT();
+            }
+            VM_CASE(MakeList) {
+                List* list = heap.newList();
+                sp -= ip->a;
+                for (int i = 0; i < ip->a; ++i) {
+                    list->add(sp[i]);
+                }
+                *sp++ = list;
+                VM_NEXT();
+            }
+            VM_CASE(StoreTemp) {
+                temps[ip->a] = std::move(*--sp);
+                VM_NEXT();
+            }
+            VM_CASE(Switch) {
+                --sp;
+                int index = findCase(*static_cast<SwitchStatement*>(ip->node)->table, *sp);
+                size_t caseCount = static_cast<SwitchStatement*>(ip->node)->cases.size();
+                VM_JUMP((ip - code) + 1 + (index >= 0 ? index : static_cast<int>(caseCount)));
+            }
+            VM_CASE(CaseMatch) {
+                --sp;
+                if (!caseMatches(temps[ip->a], *sp)) {
+                    VM_JUMP(ip->b);
+                }
+                VM_NEXT();
+            }
+            VM_CASE(IterInit) {
+                --sp;
+                // The collection stays in a temporary so the collector sees it for the whole loop
+                temps[ip->b] = *sp;
+                initIterator(iterators[ip->a], static_cast<ForInLoopStatement*>(ip->node), *sp);
+                VM_NEXT();
+            }
+            VM_CASE(IterNext) {
+                if (!advanceIterator(iterators[ip->a], static_cast<ForInLoopStatement*>(ip->node))) {
+                    VM_JUMP(ip->b);
+                }
+                VM_NEXT();
+            }
+            VM_CASE(RangeInit) {
+                sp -= 3;
+                iterators[ip->a].range = makeRangeLoop(sp[0], sp[1], sp[2]);
+                iterators[ip->a].iteration = 0;
+                if (iterators[ip->a].range.count > 0) {
+                    checkLoopBinding(static_cast<ForInLoopStatement*>(ip->node));
+                }
+                VM_NEXT();
+            }
+            VM_CASE(RangeNext) {
+                ForInIterator& it = iterators[ip->a];
+                if (it.iteration >= it.range.count) {
+                    VM_JUMP(ip->b);
+                }
+                auto forInStmt = static_cast<ForInLoopStatement*>(ip->node);
+                if (forInStmt->keySlot >= 0 && frame) {
+                    frame->slots[forInStmt->keySlot] = it.range.at(it.iteration++);
+                } else {
+                    storeVariable(forInStmt->keySlot, forInStmt->keyVariableName, it.range.at(it.iteration++));
+                }
+                VM_NEXT();
+            }
+            VM_CASE(PushHandler) {
+                handlers.push_back(Handler{static_cast<TryHappenStatement*>(ip->node), static_cast<size_t>(ip->a), static_cast<size_t>(sp - stackBase)});
+                VM_NEXT();
+            }
+            VM_CASE(PopHandler) {
+                handlers.pop_back();
+                VM_NEXT();
+            }
+            VM_CASE(SetResult) {
+                lastValue = std::move(*--sp);
+                VM_NEXT();
+            }
+            VM_CASE(Return) {
+                if (returned) {
+                    *returned = true;
+                }
+                return std::move(*--sp);
+            }
+            VM_CASE(End) {
+                return keepLastValue ? lastValue : Value(std::monostate{});
+            }
+            VM_CASE(Eval) {
+                *sp++ = executeExpression(static_cast<Expression*>(ip->node));
+                VM_NEXT();
+            }
+            VM_CASE(Exec) {
+                *sp++ = executeStatement(ip->node, nullptr);
+                VM_NEXT();
+            }
+#ifndef VANCTION_COMPUTED_GOTO
+            }
+#endif
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_NEXT
+#undef VM_JUMP
+#undef VM_ARITHMETIC
+#undef VM_COMPARISON
+        } catch (const vanction_error::VanctionError& e) {
+            if (!handleError(e.getKind(), e.getMessage(), nullptr)) {
+                throw;
+            }
+        } catch (const std::exception& e) {
+            if (!handleError(ErrorType::CError, e.what(), e.what())) {
+                throw;
+            }
+        }
+    }
+}
+
+} // namespace
+
+// Look up the function value a plain-name call refers to (local slot or upvalue, constants, then globals)
+bool lookupCallee(FunctionCall* call, Value& callee) {
+    auto isCallable = [](const Value& val) {
+        return val.isLambda() || val.isFunction();
+    };
+    
+    if (call->slot >= 0 && currentFrame && isCallable(currentFrame->slots[call->slot])) {
+        callee = currentFrame->slots[call->slot];
+        return true;
+    }
+    if (call->upvalue >= 0) {
+        Upvalue* upvalue = upvalueAt(call->upvalue);
+        if (upvalue && isCallable(*upvalue->location)) {
+            callee = *upvalue->location;
+            return true;
+        }
+    }
+    if (Value* entry = globalCallee(call)) {
+        callee = *entry;
+        return true;
+    }
+    return false;
+}
+
+// Run the body of a function in the current frame
+Value runFunctionBody(FunctionDeclaration* func, bool keepLastValue, bool* returned) {
+    if (!func->chunk) {
+        BytecodeCompiler compiler;
+        func->chunk = compiler.compileFunction(func);
+        chunks.emplace_back(func->chunk);
+    }
+    return execute(func->chunk, keepLastValue, returned);
+}
+
+// Evaluate the body of a lambda in the current frame
+Value runLambdaBody(LambdaExpression* lambda) {
+    if (!lambda->chunk) {
+        BytecodeCompiler compiler;
+        lambda->chunk = compiler.compileLambda(lambda);
+        chunks.emplace_back(lambda->chunk);
+    }
+    return execute(lambda->chunk, false, nullptr);
+}
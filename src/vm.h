@@ -0,0 +1,140 @@
+#ifndef VANCTION_VM_H
+#define VANCTION_VM_H
+
+#include "runtime.h"
+#include <vector>
+
+// Bytecode instruction set
+// Operands: a and b are integer operands, node is the AST node the instruction was compiled from
+enum class OpCode : unsigned char {
+    Constant,           // push constants[a]
+    Nil,                // push undefined
+    Pop,                // discard the top value
+    LoadLocal,          // push slot a of the current frame
+    LoadUpvalue,        // push upvalue a of the current closure
+    LoadGlobal,         // push the constant or global variable named by node
+    AssignLocal,        // assign the top value to slot a of the current frame (value stays)
+    StoreLocal,         // same, without the type check (the value's type was proven by type inference)
+    Assign,             // assign the top value to the target expression node (value stays)
+    DeclareLocal,       // pop the initializer into slot a and record its type
+    DeclareEmpty,       // declare slot a without initializer
+    Add,                // binary operators with fast paths, node is the BinaryExpression
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    Binary,             // any other binary operator
+    Jump,               // jump to a
+    JumpIfFalse,        // pop a condition, jump to a when it is false
+    JumpIfFalseNumeric, // same, but strings count as false (for loop conditions)
+    PrepareCall,        // push the callable named by call node, or run the whole call and jump to a
+                        // (b is set when the call is a tail call)
+    Call,               // call the function value below the a arguments
+    CheckLambda,        // check that the callee is a lambda taking a arguments
+    CallLambda,         // call the lambda below the a arguments
+    CallNode,           // run the function call node through the interpreter
+    MakeList,           // pop a elements into a new list
+    StoreTemp,          // pop into temporary a
+    Switch,             // pop the value of switch node, jump to the case jump of its matching case or past all of them
+    CaseMatch,          // pop a case value, jump to b unless it matches temporary a
+    IterInit,           // pop a collection into iterator a of for-in node, keeping it in temporary b
+    IterNext,           // advance iterator a and bind loop variables, jump to b when done
+    RangeInit,          // pop start, end and step into the counted loop of iterator a
+    RangeNext,          // store the next counter of iterator a in the for-in node's variable, jump to b when done
+    TailCall,           // return f(...): leave the call of the function value below the a arguments pending and return
+    PushHandler,        // install the happen handler at a for try node
+    PopHandler,         // remove the innermost handler
+    SetResult,          // pop the value of a top-level statement
+    Return,             // return the top value
+    End,                // end of body
+    Eval,               // evaluate expression node with the tree-walker
+    Exec                // execute statement node with the tree-walker
+};
+
+// Single bytecode instruction
+struct Instruction {
+    OpCode op;
+    int a;
+    int b;
+    ASTNode* node;
+};
+
+// Compiled function or lambda body
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    int maxStack = 0;
+    int tempCount = 0;
+    int iteratorCount = 0;
+};
+
+// Bytecode compiler: translates function and lambda bodies into chunks
+class BytecodeCompiler {
+public:
+    Chunk* compileFunction(FunctionDeclaration* func);
+    Chunk* compileLambda(LambdaExpression* lambda);
+
+private:
+    // Statement kinds a return statement completes instead of the function
+    enum class ContextKind { Loop, Switch, TryBody, Happen };
+    
+    struct Context {
+        ContextKind kind;
+        std::vector<size_t> exits;
+        // Jumps of break and continue statements targeting a loop
+        std::vector<size_t> breaks;
+        std::vector<size_t> continues;
+    };
+    
+    Chunk* chunk = nullptr;
+    std::vector<Context> contexts;
+    int stackDepth = 0;
+    
+    size_t emit(OpCode op, int stackEffect, int a = 0, int b = 0, ASTNode* node = nullptr);
+    int addConstant(const Value& value);
+    void patch(size_t index);
+    void setStackDepth(int depth);
+    
+    void compileBody(const std::vector<ASTNode*>& body);
+    void compileStatement(ASTNode* stmt, bool wantValue);
+    void compileIf(IfStatement* stmt);
+    void compileReturn(ReturnStatement* stmt);
+    void compileJump(bool isBreak, int depth);
+    void compileFor(ForLoopStatement* stmt);
+    void compileForIn(ForInLoopStatement* stmt);
+    void compileWhile(WhileLoopStatement* stmt);
+    void compileDoWhile(DoWhileLoopStatement* stmt);
+    void compileSwitch(SwitchStatement* stmt);
+    void compileTry(TryHappenStatement* stmt);
+    void compileExpression(Expression* expr);
+    void compileCall(FunctionCall* call, bool tailCall = false);
+    
+    // Open a context for returns, and close it by patching its exits to the current position
+    void beginContext(ContextKind kind);
+    void endContext();
+    
+    // Point the break jumps of the innermost loop at the current position, its continue jumps at target
+    void patchBreaks();
+    void patchContinues(size_t target);
+};
+
+// Use the bytecode VM for -i (the AST tree-walker is kept behind -ast)
+extern bool useBytecodeVM;
+
+// Run the body of a function in the current frame
+// Sets returned when a return statement completed the function
+Value runFunctionBody(FunctionDeclaration* func, bool keepLastValue, bool* returned = nullptr);
+
+// Evaluate the body of a lambda in the current frame
+Value runLambdaBody(LambdaExpression* lambda);
+
+// Look up the function value a plain-name call refers to (local slot or upvalue, constants, then globals)
+bool lookupCallee(FunctionCall* call, Value& callee);
+
+#endif // VANCTION_VM_H
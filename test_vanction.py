@@ -3,6 +3,7 @@ import os
 import subprocess
 import sys
 import glob
+import re
 
 # Vanction编译器路径
 VANCTION_EXEC = os.path.join(os.getcwd(), "build", "vanction.exe")
@@ -35,9 +36,46 @@ if not test_files:
 print(f"Found {len(test_files)} test files in {TEST_DIR}")
 print("=" * 60)
 
+# 读取测试文件中的期望输出：以 "|| expect: " 开头的注释行，须按顺序出现在输出中
+# "|| expect -i: " 或 "|| expect -g: " 开头的只在该模式下检查
+def read_expectations(test_file, mode):
+    prefixes = ["|| expect: ", f"|| expect {mode}: "]
+    expectations = []
+    with open(test_file, encoding="utf-8") as f:
+        for line in f:
+            for prefix in prefixes:
+                if line.strip().startswith(prefix):
+                    expectations.append(line.strip()[len(prefix):])
+    return expectations
+
+# 读取测试文件限定的运行方式：以 "|| mode: " 开头的注释行，没有时所有模式都运行
+def read_modes(test_file):
+    with open(test_file, encoding="utf-8") as f:
+        return [line.strip()[len("|| mode: "):] for line in f if line.strip().startswith("|| mode: ")]
+
+# 过长的输出（例如 -debug 的调用日志）只显示开头和结尾
+def shorten_output(output, keep=20):
+    lines = output.strip().splitlines()
+    if len(lines) <= keep * 2:
+        return "\n".join(lines)
+    return "\n".join(lines[:keep] + [f"... ({len(lines) - keep * 2} lines omitted) ..."] + lines[-keep:])
+
+# 返回输出中没有按顺序出现的第一条期望输出，全部出现时返回None（忽略颜色控制码）
+def missing_expectation(output, expectations):
+    lines = re.sub(r"\x1b\[[0-9;]*m", "", output).splitlines()
+    index = 0
+    for expected in expectations:
+        while index < len(lines) and expected not in lines[index]:
+            index += 1
+        if index == len(lines):
+            return expected
+        index += 1
+    return None
+
 # 测试结果
 pass_count = 0
 fail_count = 0
+skip_count = 0
 
 # 从命令行参数获取编译模式，默认为-g
 if len(sys.argv) > 1:
@@ -45,47 +83,76 @@ if len(sys.argv) > 1:
 else:
     mode = "-g"
 
+# 其余参数原样传给Vanction，例如 -i -ast 用树遍历解释器运行测试
+extra_args = sys.argv[2:]
+
 if mode not in ["-i", "-g"]:
     print("错误：请输入 -i 或 -g")
     exit(1)
 # 运行测试
 for test_file in test_files:
     filename = os.path.basename(test_file)
-    print(f"Testing: {filename}")
     
-    try:
-        result = subprocess.run(
-            [VANCTION_EXEC, mode, test_file],
-            capture_output=True,
-            text=True,
-            timeout=15
-        )
-        
-        # 检查结果
-        # Vanction编译器返回main函数的返回值作为退出码，所以非零退出码不一定是错误
-        has_error = bool(result.stderr.strip())
+    # 每条 "|| mode: " 行是一种运行方式，模式之后的参数额外传给Vanction（例如 "|| mode: -i -debug"）
+    # 没有当前模式的测试跳过（例如代码生成器没有的打包列表、浮点范围等功能）
+    modes = read_modes(test_file)
+    runs = [m.split()[1:] for m in modes if m.split()[0] == mode] if modes else [[]]
+    if not runs:
+        print(f"Testing: {filename}")
+        print(f"  - SKIP (only {', '.join(modes)})")
+        print()
+        skip_count += 1
+        continue
+    
+    for run_args in runs:
+        print(f"Testing: {' '.join([filename] + run_args)}")
         
-        if not has_error:
-            print(f"  ✓ PASS")
-            print(f"  Output: {result.stdout.strip()}")
-            print(f"  Exit code: {result.returncode}")
-            pass_count += 1
-        else:
-            print(f"  ✗ FAIL")
-            print(f"  Exit code: {result.returncode}")
-            print(f"  Error: {result.stderr.strip()}")
-            print(f"  Output: {result.stdout.strip()}")
-            fail_count += 1
+        try:
+            result = subprocess.run(
+                [VANCTION_EXEC, mode] + extra_args + run_args + [test_file],
+                capture_output=True,
+                text=True,
+                timeout=15
+            )
             
-    except subprocess.TimeoutExpired:
-        print(f"  ✗ FAIL - Timeout")
-        fail_count += 1
-    except Exception as e:
-        print(f"  ✗ FAIL - Exception: {e}")
-        fail_count += 1
-    
-    
-    print()
+            # 检查结果
+            # Vanction编译器返回main函数的返回值作为退出码，所以非零退出码不一定是错误
+            errors = result.stderr.strip()
+            output = result.stdout
+            
+            # 编译模式下运行生成的可执行文件，期望输出同样要出现在它的输出中
+            exe_file = test_file.replace(".vn", ".exe")
+            if mode == "-g" and not errors and os.path.exists(exe_file):
+                program = subprocess.run([exe_file], capture_output=True, text=True, timeout=15)
+                errors = program.stderr.strip()
+                output += program.stdout
+            has_error = bool(errors)
+            
+            missing = missing_expectation(output, read_expectations(test_file, mode))
+            
+            if not has_error and missing is None:
+                print(f"  ✓ PASS")
+                print(f"  Output: {shorten_output(output)}")
+                print(f"  Exit code: {result.returncode}")
+                pass_count += 1
+            else:
+                print(f"  ✗ FAIL")
+                print(f"  Exit code: {result.returncode}")
+                if missing is not None:
+                    print(f"  Missing output: {missing}")
+                print(f"  Error: {errors}")
+                print(f"  Output: {shorten_output(output)}")
+                fail_count += 1
+                
+        except subprocess.TimeoutExpired:
+            print(f"  ✗ FAIL - Timeout")
+            fail_count += 1
+        except Exception as e:
+            print(f"  ✗ FAIL - Exception: {e}")
+            fail_count += 1
+        
+        
+        print()
 
 # 清理生成的.exe文件
 for test_file in test_files:
@@ -101,6 +168,7 @@ print(f"Test Results:")
 print(f"  Total: {pass_count + fail_count}")
 print(f"  Pass: {pass_count}")
 print(f"  Fail: {fail_count}")
+print(f"  Skip: {skip_count}")
 print("=" * 60)
 
 if fail_count == 0: